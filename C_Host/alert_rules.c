@@ -0,0 +1,258 @@
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+
+#include "alert_rules.h"
+#include "app_log.h"
+
+static alert_rule_t rules[ALERT_MAX_RULES];
+static uint8_t rule_count = 0;
+static uint32_t silence_rules = 0;    // bit i: rule i tests ALERT_SILENCE
+static alert_fire_t fire_handler = NULL;
+
+static const char *const metric_names[] = { "activity", "temp", "battery", "lying", "silence" };
+
+bool alert_set_rules(const alert_rule_t *list, uint8_t count)
+{
+  if (count > ALERT_MAX_RULES)
+  {
+    return false;
+  }
+
+  memcpy(rules, list, count * sizeof(alert_rule_t));
+  rule_count = count;
+  silence_rules = 0;
+  for (uint8_t i = 0; i < count; i++)
+  {
+    if (rules[i].metric == ALERT_SILENCE)
+    {
+      silence_rules |= 1u << i;
+    }
+  }
+  return true;
+}
+
+static bool parse_rule(char *line, alert_rule_t *rule)
+{
+  char name[ALERT_NAME_LEN];
+  char metric[16];
+  char op[4];
+  char threshold[32];
+  char *end;
+  unsigned int reports = 1;
+  int fields;
+
+  fields = sscanf(line, "%23s %15s %3s %31s %u", name, metric, op, threshold, &reports);
+  if (fields < 4 || reports == 0 || reports > UINT16_MAX)
+  {
+    return false;
+  }
+
+  memset(rule, 0, sizeof(*rule));
+  strcpy(rule->name, name);
+
+  rule->metric = 0xFF;
+  for (uint8_t m = 0; m < sizeof(metric_names) / sizeof(metric_names[0]); m++)
+  {
+    if (strcmp(metric, metric_names[m]) == 0)
+    {
+      rule->metric = m;
+    }
+  }
+  if (rule->metric == 0xFF)
+  {
+    return false;
+  }
+
+  if (strcmp(op, ">") == 0)
+  {
+    rule->above = true;
+  }
+  else if (strcmp(op, "<") != 0)
+  {
+    return false;
+  }
+
+  rule->threshold = strtof(threshold, &end);
+  if (end == threshold)
+  {
+    return false;
+  }
+  if (*end == 'x')
+  {
+    rule->relative = true;
+    end++;
+  }
+  if (*end != '\0' || (rule->metric == ALERT_SILENCE && (rule->relative || !rule->above)))
+  {
+    return false;
+  }
+
+  rule->reports = (uint16_t)reports;
+  return true;
+}
+
+bool alert_load(const char *path)
+{
+  alert_rule_t list[ALERT_MAX_RULES];
+  uint8_t count = 0;
+  unsigned int line_no = 0;
+  char line[256];
+  FILE *f = fopen(path, "r");
+
+  if (f == NULL)
+  {
+    app_log("Cannot open alert rules %s" APP_LOG_NL, path);
+    return false;
+  }
+
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    char *p = strchr(line, '#');
+    char word[2];
+
+    line_no++;
+    if (p != NULL)
+    {
+      *p = '\0';
+    }
+    if (sscanf(line, "%1s", word) != 1)
+    {
+      continue;
+    }
+    if (count == ALERT_MAX_RULES || !parse_rule(line, &list[count]))
+    {
+      app_log("%s:%u: invalid alert rule" APP_LOG_NL, path, line_no);
+      fclose(f);
+      return false;
+    }
+    count++;
+  }
+  fclose(f);
+
+  return alert_set_rules(list, count);
+}
+
+void alert_set_handler(alert_fire_t fire)
+{
+  fire_handler = fire;
+}
+
+uint8_t alert_rule_count(void)
+{
+  return rule_count;
+}
+
+static void fire(collar_t *collar, uint8_t i, float value, float threshold)
+{
+  collar->alerts.fired |= 1u << i;
+  if (fire_handler != NULL)
+  {
+    fire_handler(collar, &rules[i], value, threshold);
+  }
+}
+
+void alert_report(collar_t *collar, const alert_sample_t *sample, uint64_t now_ms)
+{
+  collar_alerts_t *a = &collar->alerts;
+  bool baseline_ready = a->baseline_s >= ALERT_BASELINE_MIN_S;
+  float dt;
+
+  // A report ends any silence
+  a->fired &= ~silence_rules;
+
+  for (uint8_t i = 0; i < rule_count; i++)
+  {
+    const alert_rule_t *rule = &rules[i];
+    float threshold = rule->threshold;
+    float value;
+    bool hold;
+
+    if (rule->metric >= ALERT_METRICS || !(sample->present & (1u << rule->metric)))
+    {
+      continue;
+    }
+
+    value = sample->value[rule->metric];
+    if (rule->relative)
+    {
+      threshold *= a->baseline[rule->metric];
+    }
+    hold = (!rule->relative || baseline_ready) && (rule->above ? value > threshold : value < threshold);
+
+    if (!hold)
+    {
+      a->run[i] = 0;
+      a->fired &= ~(1u << i);
+      continue;
+    }
+    if (a->run[i] < UINT16_MAX)
+    {
+      a->run[i]++;
+    }
+    if (a->run[i] >= rule->reports && !(a->fired & (1u << i)))
+    {
+      fire(collar, i, value, threshold);
+    }
+  }
+
+  // Baselines: running mean until they cover ALERT_BASELINE_S, an
+  // exponential average over that period afterwards
+  dt = (a->last_ms == 0) ? 0.0f : (float)(now_ms - a->last_ms) / 1000.0f;
+  if (dt > ALERT_BASELINE_MAX_GAP_S)
+  {
+    dt = ALERT_BASELINE_MAX_GAP_S;
+  }
+  a->baseline_s += dt;
+  if (a->baseline_s > ALERT_BASELINE_S)
+  {
+    a->baseline_s = ALERT_BASELINE_S;
+  }
+  for (uint8_t m = 0; m < ALERT_METRICS; m++)
+  {
+    if (sample->present & (1u << m))
+    {
+      float weight = (a->last_ms == 0 || a->baseline_s <= 0.0f) ? 1.0f : dt / a->baseline_s;
+
+      a->baseline[m] += (sample->value[m] - a->baseline[m]) * weight;
+    }
+  }
+  a->last_ms = now_ms;
+}
+
+void alert_poll_collar(collar_t *c, uint64_t now_ms)
+{
+  float silent_s;
+
+  // a report newer than now_ms (handled first on a worker) is no silence
+  if (c->alerts.last_ms == 0 || now_ms <= c->alerts.last_ms || (c->alerts.fired & silence_rules) == silence_rules)
+  {
+    return;
+  }
+  silent_s = (float)(now_ms - c->alerts.last_ms) / 1000.0f;
+  for (uint8_t i = 0; i < rule_count; i++)
+  {
+    if ((silence_rules & (1u << i)) && !(c->alerts.fired & (1u << i)) && silent_s > rules[i].threshold)
+    {
+      fire(c, i, silent_s, rules[i].threshold);
+    }
+  }
+}
+
+bool alert_has_silence(void)
+{
+  return silence_rules != 0;
+}
+
+void alert_poll(uint64_t now_ms)
+{
+  if (silence_rules == 0)
+  {
+    return;
+  }
+
+  for (collar_t *c = collar_table_next(NULL); c != NULL; c = collar_table_next(c))
+  {
+    alert_poll_collar(c, now_ms);
+  }
+}
@@ -0,0 +1,98 @@
+#ifndef ALERT_RULES_H
+#define ALERT_RULES_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "collar_table.h"
+
+// Metrics a rule can test. The first ALERT_METRICS come with a report.
+#define ALERT_ACTIVITY 0    // mean dynamic acceleration (ODBA) of the window, mg
+#define ALERT_TEMP     1    // collar temperature, degC
+#define ALERT_BATTERY  2    // battery level as the collar reports it
+#define ALERT_LYING    3    // share of the window spent lying, %
+#define ALERT_SILENCE  4    // time since the collar's last report, s
+
+#define ALERT_NAME_LEN 24
+
+// Baselines average a metric over the last 10 days
+#define ALERT_BASELINE_S (10 * 24 * 3600)
+
+// Rules relative to the baseline wait until it covers 6 hours
+#define ALERT_BASELINE_MIN_S (6 * 3600)
+
+// Gap between reports folded into the baseline at most, s
+#define ALERT_BASELINE_MAX_GAP_S 600
+
+/**
+ * A rule: metric above or below a threshold for a number of reports in a
+ * row. A relative threshold is a multiple of the collar's baseline.
+ */
+typedef struct alert_rule
+{
+  char name[ALERT_NAME_LEN];
+  uint8_t metric;           // ALERT_*
+  bool above;               // true: metric > threshold, false: metric < threshold (silence: >)
+  bool relative;            // threshold times the collar's baseline of the metric
+  float threshold;
+  uint16_t reports;         // reports in a row the condition must hold (silence: unused)
+} alert_rule_t;
+
+/**
+ * Metrics of one decoded window. present has bit m set for each metric m
+ * the window carries.
+ */
+typedef struct alert_sample
+{
+  float value[ALERT_METRICS];
+  uint8_t present;
+} alert_sample_t;
+
+/**
+ * Called when a rule fires for a collar, with the value that crossed the
+ * threshold and the threshold it was compared with.
+ */
+typedef void (*alert_fire_t)(const collar_t *collar, const alert_rule_t *rule, float value, float threshold);
+
+/**
+ * Load rules from a text file, one per line:
+ *
+ *   <name> <activity|temp|battery|lying|silence> <'>'|'<'> <threshold>[x] [reports]
+ *
+ * A threshold ending in x is relative to the collar's baseline. '#' starts
+ * a comment. Returns false and logs the line of the first error.
+ */
+bool alert_load(const char *path);
+
+/**
+ * Use the given rules instead of a file.
+ */
+bool alert_set_rules(const alert_rule_t *rules, uint8_t count);
+
+void alert_set_handler(alert_fire_t fire);
+
+uint8_t alert_rule_count(void);
+
+/**
+ * Evaluate every rule on a new report from collar at now_ms, then fold the
+ * report into the collar's baselines. Constant work per report.
+ */
+void alert_report(collar_t *collar, const alert_sample_t *sample, uint64_t now_ms);
+
+/**
+ * Evaluate the silence rules of every collar. Call about once a second.
+ */
+void alert_poll(uint64_t now_ms);
+
+/**
+ * Evaluate the silence rules of one collar, e.g. on the worker that owns
+ * it (work_pool.h).
+ */
+void alert_poll_collar(collar_t *collar, uint64_t now_ms);
+
+/**
+ * True if a silence rule is loaded: alert_poll() has work to do.
+ */
+bool alert_has_silence(void);
+
+#endif // ALERT_RULES_H
@@ -6,6 +6,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <stdbool.h>
+#include <pthread.h>
 
 #include "app.h"
 #include "gatt_db.h"
@@ -14,17 +15,74 @@
 #include "app_log_cli.h"
 #include "app_assert.h"
 #include "sl_bt_api.h"
+#include "collar_table.h"
+#include "link_control.h"
+#include "gap_tracker.h"
+#include "alert_rules.h"
+#include "ncp_capture.h"
+#include "host_metrics.h"
+#include "host_store.h"
+#include "store_retention.h"
+#include "sync_acquire.h"
+#include "ota_batch.h"
+#include "work_pool.h"
+#include "shm_feed.h"
+#include "query_server.h"
+#include "cs_endian.h"
+#include "cs_pawr.h"
+#include "cs_payload.h"
+#include "cs_classifier.h"
+#include "cs_config.h"
+#include "cs_link.h"
 
 // Optstring argument for getopt.
-#define OPTSTRING NCP_HOST_OPTSTRING APP_LOG_OPTSTRING "hR"
+#define OPTSTRING NCP_HOST_OPTSTRING APP_LOG_OPTSTRING "hRak:m:c:W:P:FM:A:T:L:D:G:K:Z:O:Q:"
 
 // Usage info.
-#define USAGE APP_LOG_NL "%s " NCP_HOST_USAGE APP_LOG_USAGE " [-h]" APP_LOG_NL
+#define USAGE APP_LOG_NL "%s " NCP_HOST_USAGE APP_LOG_USAGE " [-h] [-a] [-k <redundancy>] [-m <old>:<new>]" \
+  " [-c <imu_ms>,<window>,<env_s>,<pa_ms>,<k>[,<mode>[,<options>]]] [-W <capture>] [-P <capture> [-F]]" \
+  " [-M <metrics.prom>] [-A <rules> [-T <workers>]] [-L <feed>[,<slots>]] [-O <patch>]" \
+  " [-D <store dir> [-G <ms>,<records>] [-K <raw days>,<minute days>[,<max MB>] [-Z <archive dir>]]" \
+  " [-Q <socket>[,<cache MB>]]]" APP_LOG_NL
 
 // Options info.
-#define OPTIONS                                  \
-  "\nOPTIONS\n" NCP_HOST_OPTIONS APP_LOG_OPTIONS \
-  "    -h  Print this help message.\n"
+#define OPTIONS                                                              \
+  "\nOPTIONS\n" NCP_HOST_OPTIONS APP_LOG_OPTIONS                             \
+  "    -h  Print this help message.\n"                                       \
+  "    -a  Adapt each collar's TX power and PHY to its link (over PAwR).\n" \
+  "    -k  Periodic advertising redundancy pushed to collars over PAwR.\n"   \
+  "    -m  Reassign a cow ID over PAwR, e.g. -m 1:7 (may be repeated).\n"   \
+  "    -c  Collar configuration written when provisioning: IMU period (ms),\n" \
+  "        samples per window, RHT/battery period (s), periodic adv\n"       \
+  "        interval (ms, 0 = window period / k), redundancy k and\n"      \
+  "        optionally the data mode (0 = raw windows, 1 = summaries,\n"    \
+  "        2 = behaviour labels) and options (1 = orientation with\n"   \
+  "        every record).\n"                                          \
+  "    -W  Record the NCP byte stream with timestamps to a capture file.\n" \
+  "    -P  Replay a capture instead of opening the NCP, at its own pace.\n" \
+  "    -F  With -P, replay as fast as the host reads.\n"                  \
+  "    -M  Export gateway and per-collar metrics to a Prometheus textfile\n" \
+  "        every 10 s.\n"                                                \
+  "    -A  Evaluate the alert rules in the file on every report and log\n" \
+  "        alerts to ble_alert_log.csv (example: C_Host/alerts.conf).\n" \
+  "    -T  With -A, run the features and alert rules of each cow on a pool\n" \
+  "        of this many worker threads instead of the event thread.\n" \
+  "    -L  Publish every window logged to the shared memory feed\n" \
+  "        /dev/shm/<feed> (C_Host/shm_feed.h), a ring of <slots> records\n" \
+  "        (power of two, default 16384).\n" \
+  "    -O  Update the firmware of every collar heard running the base\n" \
+  "        image of this delta patch (made with collar_delta).\n" \
+  "    -D  Also store raw windows in the window store in this directory.\n" \
+  "    -G  With -D, sync stored windows to disk once the oldest is <ms> old\n" \
+  "        or <records> are pending (0 = no limit; default 1000,1000).\n" \
+  "    -K  With -D, summarize raw windows older than <raw days> per minute\n" \
+  "        and hour, then delete them; drop minute summaries older than\n" \
+  "        <minute days>, and keep the store under <max MB> (0 = no limit).\n" \
+  "    -Z  With -K, move summarized raw segments to this directory instead\n" \
+  "        of deleting them.\n" \
+  "    -Q  With -D, answer queries over the store on this Unix socket\n" \
+  "        (C_Host/query_server.h), reading it through a page cache of\n" \
+  "        <cache MB> (default 64) shared by all clients.\n"
 
 
 
@@ -38,9 +96,16 @@
 #define WRITE_DATA      4
 #define PA_SYNC         5
 #define DISCONNECTING   6
+#define BULK_FIND_SERVICE   7
+#define BULK_FIND_CHAR      8
+#define BULK_ENABLE_NOTIFY  9
+#define BULK_STREAM         10
 
 #define UUID_LEN        16
 
+// Time between two looks at how the scanner should run (ms)
+#define SCAN_POLL_MS    100
+
 // UUIDs (converted to little-endian as per BLE spec)
 static const uint8_t serviceUUID[UUID_LEN] = {
   0x79, 0x2d, 0xf6, 0x66, 0x9c, 0x19, 0xca, 0x84,
@@ -57,6 +122,58 @@ static const uint8_t char2_UUID[UUID_LEN] = {
   0x7c, 0x4f, 0x73, 0x0f, 0xdd, 0x4a, 0xab, 0x52
 };
 
+// collar_config characteristic (optional, newer collar firmware)
+static const uint8_t config_char_UUID[UUID_LEN] = {
+  0xa4, 0x04, 0xfb, 0x79, 0x41, 0x0b, 0xa8, 0xaa,
+  0x14, 0x4e, 0x39, 0x47, 0x3f, 0x7a, 0x36, 0x04
+};
+
+// Bulk transfer service and characteristics
+static const uint8_t bulk_serviceUUID[UUID_LEN] = {
+  0x01, 0xf4, 0x3e, 0x81, 0xa6, 0xcd, 0x40, 0xa8,
+  0xb6, 0x48, 0x60, 0x7d, 0x97, 0x60, 0x9f, 0xea
+};
+
+static const uint8_t bulk_ctrl_UUID[UUID_LEN] = {
+  0xae, 0x74, 0xed, 0x19, 0xf4, 0x62, 0x96, 0x8f,
+  0x4a, 0x47, 0xae, 0x78, 0x4e, 0x4c, 0xc6, 0x8c
+};
+
+static const uint8_t bulk_data_UUID[UUID_LEN] = {
+  0x22, 0xe3, 0x16, 0xf7, 0xed, 0x4d, 0x31, 0x8b,
+  0x07, 0x48, 0xe6, 0x9e, 0x02, 0xd4, 0x96, 0xac
+};
+
+// Delta firmware update characteristics, also on the bulk service
+static const uint8_t ota_ctrl_UUID[UUID_LEN] = {
+  0x61, 0x7b, 0x0a, 0x1e, 0x2c, 0x3f, 0x57, 0x9d,
+  0x8a, 0x4c, 0x4e, 0x6f, 0x1e, 0x5a, 0x0b, 0x5b
+};
+
+static const uint8_t ota_data_UUID[UUID_LEN] = {
+  0x3e, 0xc0, 0x81, 0x6f, 0x9b, 0x2d, 0xc4, 0xa5,
+  0x69, 0x4e, 0x7d, 0x8b, 0xa2, 0xf0, 0xc1, 0xe3
+};
+
+// Bulk notification header: 4 byte little endian window sequence number,
+// BULK_SEQ_MORE set on every fragment of a long window but the last
+#define BULK_HEADER_LEN     4
+#define BULK_SEQ_MORE       0x80000000UL
+
+// Largest periodic advertising data a controller can chain over AUX_CHAIN_IND
+#define PA_DATA_MAX         1650
+
+// data_status of a periodic sync report
+#define PA_DATA_COMPLETE    0
+#define PA_DATA_INCOMPLETE  1   // more reports follow for this event
+#define PA_DATA_TRUNCATED   2   // the rest of the chain was not received
+
+// Periodic report reassembly buffers, indexed by sync handle
+#define PA_REASSEMBLY_SLOTS 64
+
+// Silicon Labs company ID used in the collar's bulk manufacturer data
+#define BULK_COMPANY_ID     0x02FF
+
 /*******************************************************************************
  *    Local Variables
  ******************************************************************************/
@@ -66,19 +183,89 @@ static uint8_t main_state;
 static uint32_t service_handle;
 static uint16_t char1_handle;
 static uint16_t char2_handle;
+static uint16_t config_char_handle;
 static uint16_t sync_id;
 
 static uint8_t date_time[6];
 static uint8_t cow_id;
 
+// Collar configuration to write during provisioning (-c)
+static bool config_set = false;
+static cs_config_t collar_config;
+
 static bool conn_close_flag = false;
-static bool reprov_flag = false;
+
+// Scanner as last started, the sync acquisition decides how it runs
+static bool booted = false;
+static sync_acq_scan_t scan_now;
+static uint64_t scan_poll_ms = 0;
+
+// Bulk transfer state
+static bool bulk_mode = false;
+static collar_t *bulk_collar = NULL;
+static uint32_t bulk_service_handle;
+static uint16_t bulk_ctrl_handle;
+static uint16_t bulk_data_handle;
+static uint32_t bulk_windows;
+static uint32_t bulk_bytes;
+static struct timespec bulk_start;
+static uint8_t bulk_frag[CS_PAYLOAD_MAX_LEN];
+static uint16_t bulk_frag_len;
+static uint32_t bulk_frag_seq;
+
+// Chained periodic advertising data collected per sync
+typedef struct pa_reassembly
+{
+  uint16_t sync;
+  bool overflow;            // chain longer than PA_DATA_MAX, drop it
+  uint16_t len;
+  uint8_t data[PA_DATA_MAX];
+} pa_reassembly_t;
+
+static pa_reassembly_t pa_reassembly[PA_REASSEMBLY_SLOTS];
+static uint32_t pa_truncated;
 
 static uint8_t prev_id_data[6] = {0};
 static FILE *csv_file = NULL;
+static FILE *summary_file = NULL;
+static FILE *class_file = NULL;
+static FILE *orient_file = NULL;
 
 static timer_t connection_close_timer;
-static timer_t reprov_timer;
+
+// PAwR control channel
+#define PAWR_MAX_REMAP      16
+#define PAWR_MAX_DATA       251
+
+static uint8_t pawr_set_handle = 0xFF;
+static uint8_t pawr_redundancy = 0;   // 0: leave collars as they are
+static bool link_adapt = false;       // -a: steer collar TX power and PHY
+
+static const char *capture_path = NULL;   // -W: record the NCP byte stream
+static const char *replay_path = NULL;    // -P: replay a capture instead of the NCP
+static bool replay_fast = false;          // -F: replay without the recorded timing
+static const char *metrics_file = NULL;   // -M: Prometheus textfile
+static const char *alert_file = NULL;     // -A: alert rules
+static FILE *alert_log = NULL;
+static pthread_mutex_t alert_lock = PTHREAD_MUTEX_INITIALIZER;   // alerts fire on the workers
+static uint8_t pool_workers = 0;          // -T: alert workers, 0 = on the event thread
+static const char *store_dir = NULL;      // -D: window store
+static const char *ota_patch = NULL;      // -O: delta firmware update
+static const char *query_socket = NULL;   // -Q: query service
+static size_t query_cache_mb = QUERY_DEFAULT_CACHE_MB;
+static const char *feed_name = NULL;      // -L: shared memory feed
+static uint32_t feed_slots = SHM_FEED_DEFAULT_SLOTS;
+static shm_feed_writer_t feed;
+static store_writer_t store;
+static uint32_t store_commit_ms = 1000;   // -G: group commit
+static uint32_t store_commit_records = 1000;
+static bool retention_on = false;         // -K: retention
+static retention_config_t retention;
+static uint64_t alert_poll_ms = 0;
+static uint8_t remap_from[PAWR_MAX_REMAP];
+static uint8_t remap_to[PAWR_MAX_REMAP];
+static uint8_t remap_count = 0;
+static const uint8_t gatewayUUID[UUID_LEN] = CS_PAWR_GATEWAY_UUID;
 
 
 
@@ -133,6 +320,244 @@ void get_local_time()
 
 
 
+// Milliseconds on a coarse monotonic clock, cheap enough to read per report.
+static uint64_t monotonic_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+/**
+ * Current local time as YY MM DD hh mm ss, without logging.
+ */
+static void read_local_time(uint8_t *out)
+{
+  time_t rawtime;
+  struct tm timeinfo;
+
+  time(&rawtime);
+  localtime_r(&rawtime, &timeinfo);
+
+  out[0] = (uint8_t)(timeinfo.tm_year + 1900 - 2000);
+  out[1] = (uint8_t)(timeinfo.tm_mon + 1);
+  out[2] = (uint8_t)(timeinfo.tm_mday);
+  out[3] = (uint8_t)(timeinfo.tm_hour);
+  out[4] = (uint8_t)(timeinfo.tm_min);
+  out[5] = (uint8_t)(timeinfo.tm_sec);
+}
+
+// ─────────────────────────────────────────────────────────────────────────────
+// PAwR control channel
+// ─────────────────────────────────────────────────────────────────────────────
+
+/**
+ * Start the PAwR train the collars sync to. The extended advertising carries
+ * the gateway UUID so collars can find it with a short scan.
+ */
+static void pawr_start(void)
+{
+  uint8_t adv_data[3 + 2 + UUID_LEN] = { 2, 0x01, 0x06, 17, 0x07 };
+
+  memcpy(&adv_data[5], gatewayUUID, UUID_LEN);
+
+  app_assert_status(sl_bt_advertiser_create_set(&pawr_set_handle));
+  app_assert_status(sl_bt_advertiser_set_timing(pawr_set_handle, 160, 160, 0, 0));
+  app_assert_status(sl_bt_extended_advertiser_set_phy(pawr_set_handle, sl_bt_gap_phy_1m, sl_bt_gap_phy_1m));
+  app_assert_status(sl_bt_extended_advertiser_set_data(pawr_set_handle, sizeof(adv_data), adv_data));
+
+  app_assert_status(sl_bt_pawr_advertiser_start(pawr_set_handle,
+                                                CS_PAWR_INTERVAL,
+                                                CS_PAWR_INTERVAL,
+                                                0,
+                                                CS_PAWR_SUBEVENTS,
+                                                CS_PAWR_SUBEVENT_INTERVAL,
+                                                CS_PAWR_RESPONSE_SLOT_DELAY,
+                                                CS_PAWR_RESPONSE_SLOT_SPACING,
+                                                CS_PAWR_RESPONSE_SLOTS));
+
+  app_assert_status(sl_bt_extended_advertiser_start(pawr_set_handle,
+                                                    sl_bt_extended_advertiser_non_connectable,
+                                                    0));
+
+  app_log("PAwR train started, %d subevents x %d slots\r\n", CS_PAWR_SUBEVENTS, CS_PAWR_RESPONSE_SLOTS);
+}
+
+static uint8_t pawr_add_record(uint8_t *data, uint8_t len, uint8_t cow, uint8_t type,
+                               const uint8_t *value, uint8_t value_len)
+{
+  if (len + CS_PAWR_CMD_RECORD_LEN + value_len > PAWR_MAX_DATA)
+  {
+    return len;
+  }
+  data[len] = cow;
+  data[len + 1] = type;
+  data[len + 2] = value_len;
+  memcpy(&data[len + CS_PAWR_CMD_RECORD_LEN], value, value_len);
+  return len + CS_PAWR_CMD_RECORD_LEN + value_len;
+}
+
+/**
+ * Build one subevent: gateway time followed by the commands still pending for
+ * the collars listening on it. Commands are repeated until the collar's
+ * response shows they took effect.
+ */
+static void pawr_fill_subevent(uint8_t subevent)
+{
+  uint8_t data[PAWR_MAX_DATA];
+  uint8_t len = CS_PAWR_CMD_HEADER_LEN;
+  uint8_t value[4];
+
+  data[0] = CS_PAWR_VERSION;
+  read_local_time(&data[1]);
+
+  for (uint16_t cow = subevent; cow <= 0xFF; cow += CS_PAWR_SUBEVENTS)
+  {
+    collar_t *collar = collar_table_find(cow);
+
+    if (!collar || !collar->responded)
+    {
+      continue;
+    }
+
+    // Windows we already have (or gave up on) do not need to stay on the collar
+    if (collar_wanted_seq(collar) > collar->first_seq)
+    {
+      cs_put_le32(value, collar_wanted_seq(collar));
+      len = pawr_add_record(data, len, (uint8_t)cow, CS_PAWR_CMD_ACK, value, 4);
+    }
+
+    if (pawr_redundancy != 0 && collar->redundancy != pawr_redundancy)
+    {
+      len = pawr_add_record(data, len, (uint8_t)cow, CS_PAWR_CMD_PA_CONFIG, &pawr_redundancy, 1);
+    }
+
+    if (link_adapt && collar->link_known)
+    {
+      uint8_t level = link_choose(collar);
+
+      if (level != collar->link_level)
+      {
+        len = pawr_add_record(data, len, (uint8_t)cow, CS_PAWR_CMD_LINK, &level, 1);
+      }
+    }
+
+    for (uint8_t i = 0; i < remap_count; i++)
+    {
+      if (remap_from[i] == cow && remap_from[i] != remap_to[i])
+      {
+        len = pawr_add_record(data, len, (uint8_t)cow, CS_PAWR_CMD_COW_ID, &remap_to[i], 1);
+      }
+    }
+  }
+
+  sl_bt_pawr_advertiser_set_subevent_data(pawr_set_handle, subevent, 0, CS_PAWR_RESPONSE_SLOTS, len, data);
+}
+
+static void pawr_response_report(const sl_bt_evt_pawr_advertiser_response_report_t *report)
+{
+  const uint8_t *data = report->data.data;
+  collar_t *collar;
+
+  if (report->data_status != 0 || report->data.len < CS_PAWR_RSP_MIN_LEN || data[CS_PAWR_RSP_VERSION] != CS_PAWR_VERSION)
+  {
+    return;
+  }
+
+  collar = collar_table_get(data[CS_PAWR_RSP_COW_ID]);
+  if (!collar)
+  {
+    return;
+  }
+
+  collar->responded = true;
+  collar->pawr_rssi = report->rssi;
+  collar->battery = data[CS_PAWR_RSP_BATTERY];
+  collar->redundancy = data[CS_PAWR_RSP_REDUNDANCY];
+  collar->first_seq = cs_get_le32(&data[CS_PAWR_RSP_FIRST_SEQ]);
+  collar->next_seq = cs_get_le32(&data[CS_PAWR_RSP_NEXT_SEQ]);
+
+  if (collar_seq_restarted(collar, collar->next_seq))
+  {
+    app_log("Cow %d restarted its windows in the same session\r\n", collar->cow_id);
+    collar_restart_seq(collar);
+    gap_note_reset(collar);
+  }
+
+  // Bulk transfer can no longer fetch what the collar overwrote
+  if (collar->have_seq)
+  {
+    collar_skip_to(collar, collar->first_seq);
+  }
+
+  if (report->data.len >= CS_PAWR_RSP_LEN)
+  {
+    uint8_t level = data[CS_PAWR_RSP_LINK];
+
+    if (level < CS_LINK_LEVELS && (!collar->link_known || level != collar->link_level))
+    {
+      app_log("Cow %d link level %d: PHY %d, %d.%d dBm\r\n", collar->cow_id, level,
+              cs_link_levels[level].phy, cs_link_levels[level].tx_power / 10,
+              abs(cs_link_levels[level].tx_power % 10));
+    }
+    // The collar restarted its train on the new PHY and TX power: the old
+    // sync would only run out its timeout, so drop it and sync again now
+    if (level < CS_LINK_LEVELS && collar->link_known && level != collar->link_level && collar->synced)
+    {
+      app_log("Cow %d changed link level, syncing again\r\n", collar->cow_id);
+      sl_bt_sync_close(collar->sync_handle);
+      sync_acq_expect(monotonic_ms());
+    }
+    link_note_level(collar, level);
+  }
+
+  // A reassigned collar answering under its new ID is done
+  for (uint8_t i = 0; i < remap_count; i++)
+  {
+    if (remap_to[i] == collar->cow_id && remap_from[i] != remap_to[i])
+    {
+      app_log("Cow %d is now cow %d\r\n", remap_from[i], remap_to[i]);
+      remap_from[i] = remap_to[i];
+    }
+  }
+}
+
+// Parse a bulk transfer advertisement: bulk service UUID plus manufacturer
+// data carrying the cow ID and the number of windows stored on the collar.
+static bool parse_bulk_adv(const uint8_t *data, uint8_t len, uint8_t *cow, uint8_t *count)
+{
+  bool found = false;
+  bool have_info = false;
+  uint8_t i = 0;
+
+  *cow = 0;
+  *count = 0;
+  while (i + 1 < len)
+  {
+    uint8_t adFieldLength = data[i];
+    uint8_t adFieldType = data[i + 1];
+
+    if (adFieldLength == 0 || i + adFieldLength >= len)
+    {
+      break;
+    }
+    if ((adFieldType == 0x06 || adFieldType == 0x07) && adFieldLength == 17)
+    {
+      found = (memcmp(&data[i + 2], bulk_serviceUUID, UUID_LEN) == 0);
+    }
+    if (adFieldType == 0xFF && adFieldLength == 5
+        && data[i + 2] == (BULK_COMPANY_ID & 0xFF) && data[i + 3] == (BULK_COMPANY_ID >> 8))
+    {
+      *cow = data[i + 4];
+      *count = data[i + 5];
+      have_info = true;
+    }
+    i = i + adFieldLength + 1;
+  }
+  return found && have_info;
+}
+
 // Parse advertisements looking for advertised periodicSync Service.
 static uint8_t parse_adv(uint8_t *data, uint8_t len)
 {
@@ -173,39 +598,740 @@ static uint8_t parse_adv(uint8_t *data, uint8_t len)
   return 0;
 }
 
-static void process_periodic_sync_report(const sl_bt_evt_periodic_sync_report_t *report)
+// Write one activity summary to the summary CSV log.
+static void log_summary(const cs_window_t *window, uint32_t counter, int8_t rssi)
+{
+  const cs_summary_t *s = &window->summary;
+
+  if (summary_file) {
+    fprintf(summary_file, "%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%u,%d\n",
+            window->hour, window->min, window->sec, window->battery, window->temp, window->cow_id,
+            s->windows, s->samples, s->mean[0], s->mean[1], s->mean[2], s->std[0], s->std[1], s->std[2],
+            s->odba, s->zc[0], s->zc[1], s->zc[2], s->tilt_deg, s->posture, window->seq, counter, rssi);
+    fflush(summary_file);
+  }
+}
+
+// Write the behaviour labels of a class record, one row per window (the
+// last label belongs to the window ending at the record time).
+static void log_labels(const cs_window_t *window, uint32_t counter, int8_t rssi)
+{
+  if (class_file) {
+    for (int i = 0; i < window->n_labels; i++) {
+      fprintf(class_file, "%d,%d,%d,%d,%d,%d,%d,%d,%s,%d,%u,%d\n",
+              window->hour, window->min, window->sec, window->battery, window->temp, window->cow_id,
+              window->seq, i - (window->n_labels - 1), cs_classifier_name(window->labels[i].class),
+              window->labels[i].confidence, counter, rssi);
+    }
+    fflush(class_file);
+  }
+}
+
+// Write the orientation a record carries, with the posture looked up from it.
+static void log_orient(const cs_window_t *window, uint32_t counter, int8_t rssi)
 {
-  uint8_t buffer[191];
-  memcpy(buffer, report->data.data, report->data.len);
+  const cs_orient_t *o = &window->orient;
+
+  if (orient_file) {
+    fprintf(orient_file, "%d,%d,%d,%d,%d,%d,%d,%d,%d,%d,%u,%d\n",
+            window->hour, window->min, window->sec, window->cow_id, window->seq,
+            cs_orient_deg(o->roll), cs_orient_deg(o->pitch), cs_orient_deg(o->yaw),
+            cs_orient_tilt_deg(o), cs_orient_posture(o), counter, rssi);
+    fflush(orient_file);
+  }
+}
 
-  int16_t *values = (int16_t *)buffer;
+// Append a window of any kind to the window store, stamped with its time
+// on the gateway's day.
+static void store_window(const cs_window_t *window, uint32_t counter, int8_t rssi)
+{
+  store_window_t w;
+
+  w.kind = window->kind;
+  w.time = store_local_time(window->hour, window->min, window->sec, time(NULL));
+  w.cow_id = window->cow_id;
+  w.flags = (window->version >= 1) ? STORE_WINDOW_SEQ : 0;
+  w.seq = window->seq;
+  w.battery = window->battery;
+  w.temp = window->temp;
+  w.counter = counter;
+  w.rssi = rssi;
+  w.n_samples = window->n_samples;
+  memcpy(w.samples, window->samples, (size_t)window->n_samples * sizeof(window->samples[0]));
+  w.summary = window->summary;
+  w.n_labels = window->n_labels;
+  memcpy(w.labels, window->labels, (size_t)window->n_labels * sizeof(window->labels[0]));
+
+  if (!store_append(&store, &w)) {
+    app_log_warning("Cannot write to the window store %s" APP_LOG_NL, store_dir);
+  }
+}
 
-  uint8_t id_data[6];
-  memcpy(id_data, &buffer[180], 6);
+// Write one decoded window (cow_t ID data, samples, counter, RSSI) to the CSV log.
+static void write_window(const cs_window_t *window, uint32_t counter, int8_t rssi)
+{
+  if ((window->version >= 1) && (window->flags & CS_FLAG_ORIENT)) {
+    log_orient(window, counter, rssi);
+  }
+
+  if (store_dir) {
+    store_window(window, counter, rssi);
+  }
+
+  if (window->kind == CS_KIND_SUMMARY) {
+    log_summary(window, counter, rssi);
+    return;
+  }
+  if (window->kind == CS_KIND_CLASS) {
+    log_labels(window, counter, rssi);
+    return;
+  }
+
+  if (csv_file) {
+    fprintf(csv_file, "%d,%d,%d,%d,%d,%d,", window->hour, window->min, window->sec,
+            window->battery, window->temp, window->cow_id);
+
+    for (int i = 0; i < window->n_samples; i++) {
+      fprintf(csv_file, "%d,%d,%d,", window->samples[i][0], window->samples[i][1], window->samples[i][2]);
+    }
+
+    fprintf(csv_file, "%u,%d\n", counter, rssi);
+    fflush(csv_file);
+  }
+}
+
+static void log_window(const cs_window_t *window, uint32_t counter, int8_t rssi, uint8_t source)
+{
+  static uint64_t windows;
+  uint64_t start = metrics_sample_begin(windows++);
 
-  // Check for new ID data
-  if (memcmp(id_data, prev_id_data, 6) != 0) {
+  if (feed_name)
+  {
+    shm_feed_publish(&feed, window, counter, rssi, source);
+  }
+  write_window(window, counter, rssi);
+  metrics_sample_end(&metrics.writer, start);
+}
+
+// Check a decoded window against what has already been logged for the collar.
+// v0 payloads carry no sequence number and fall back to comparing the ID data.
+// seq32 is the full sequence number when the transport provides one (bulk).
+static bool window_is_new(collar_t *collar, const cs_window_t *window, const uint32_t *seq32)
+{
+  uint32_t missed;
+
+  if (window->version == 0) {
+    uint8_t id_data[6] = {
+      window->hour, window->min, window->sec, window->battery, window->temp, (uint8_t)window->cow_id
+    };
+
+    if (memcmp(id_data, prev_id_data, 6) == 0) {
+      metrics.duplicates++;
+      return false;
+    }
     memcpy(prev_id_data, id_data, 6);
+    return true;
+  }
 
-    if (csv_file) {
-      fprintf(csv_file, "%d,%d,%d,%d,%d,%d,", id_data[0], id_data[1], id_data[2], id_data[3], id_data[4], id_data[5]);
+  if (!collar) {
+    return true;
+  }
 
-      for (int i = 0; i < 90; i += 3) {
-        fprintf(csv_file, "%d,%d,%d,", values[i], values[i + 1], values[i + 2]);
-      }
+  if (collar_set_session(collar, window->session)) {
+    app_log("Cow %d started a new session\r\n", collar->cow_id);
+    gap_note_reset(collar);
+  } else if (!seq32 && collar_seq_restarted(collar, collar_unwrap_seq(collar, window->seq))) {
+    app_log("Cow %d restarted its windows in the same session\r\n", collar->cow_id);
+    collar_restart_seq(collar);
+    gap_note_reset(collar);
+  }
+  missed = collar->seq_missed;
+  if (!collar_mark_seq(collar, seq32 ? *seq32 : collar_unwrap_seq(collar, window->seq))) {
+    metrics.duplicates++;
+    collar->duplicates++;
+    return false;
+  }
+  if (collar->seq_missed != missed) {
+    app_log("Cow %d: %u missed windows left out of bulk recovery\r\n",
+            collar->cow_id, collar->seq_missed - missed);
+  }
+  return true;
+}
+
+// Log when a collar switches between full and low (motion adaptive) sample rate.
+static void note_rate(collar_t *collar, const cs_window_t *window)
+{
+  uint8_t shift = window->flags & CS_FLAG_RATE_SHIFT_MASK;
+
+  if (collar && (window->version > 0) && (shift != collar->rate_shift))
+  {
+    app_log("Cow %d sampling at 1/%d rate\r\n", collar->cow_id, 1 << shift);
+    collar->rate_shift = shift;
+  }
+}
+
+// Account for the windows missed before a new periodic advertising window.
+static void note_gap(collar_t *collar, const cs_window_t *window)
+{
+  uint32_t missed;
+  uint8_t cause;
+  uint16_t loss;
+
+  if (!collar || (window->version == 0))
+  {
+    return;
+  }
+
+  cause = gap_note_window(collar, collar_unwrap_seq(collar, window->seq), &missed);
+  if (cause != GAP_NONE)
+  {
+    loss = gap_recent_loss(collar);
+    app_log("Cow %d missed %u windows (%s), recent loss %u.%u %%\r\n",
+            collar->cow_id, missed, gap_cause_name(cause), loss / 10, loss % 10);
+  }
+}
 
-      fprintf(csv_file, "%d,%d\n", report->counter, report->rssi);
-      fflush(csv_file);
+// Log an alert raised by a rule.
+static void on_alert(const collar_t *collar, const alert_rule_t *rule, float value, float threshold)
+{
+  uint8_t now[6];
+
+  read_local_time(now);
+  pthread_mutex_lock(&alert_lock);
+  app_log("ALERT cow %d: %s (%.1f, threshold %.1f)\r\n", collar->cow_id, rule->name, value, threshold);
+  if (alert_log)
+  {
+    fprintf(alert_log, "%d,%d,%d,%d,%s,%.1f,%.1f\n", now[3], now[4], now[5], collar->cow_id, rule->name,
+            value, threshold);
+    fflush(alert_log);
+  }
+  pthread_mutex_unlock(&alert_lock);
+}
+
+// Alert metrics of a window: activity and posture come from the samples, the
+// summary or the behaviour labels, whichever the window carries.
+static void alert_sample_of(const cs_window_t *window, alert_sample_t *sample)
+{
+  sample->value[ALERT_TEMP] = window->temp;
+  sample->value[ALERT_BATTERY] = window->battery;
+  sample->present = (1u << ALERT_TEMP) | (1u << ALERT_BATTERY);
+
+  if (window->kind == CS_KIND_RAW && window->n_samples > 0)
+  {
+    cs_features_acc_t acc;
+    cs_summary_t summary;
+
+    cs_features_reset(&acc);
+    cs_features_add_window(&acc, window->samples, window->n_samples);
+    cs_features_finish(&acc, &summary);
+    if (window->flags & CS_FLAG_ORIENT)
+    {
+      // the fused orientation is steadier than the window's mean gravity
+      summary.posture = cs_orient_posture(&window->orient);
     }
+    sample->value[ALERT_ACTIVITY] = summary.odba;
+    sample->value[ALERT_LYING] = (summary.posture == CS_POSTURE_LYING) ? 100 : 0;
+    sample->present |= (1u << ALERT_ACTIVITY) | (1u << ALERT_LYING);
+  }
+  else if (window->kind == CS_KIND_SUMMARY)
+  {
+    sample->value[ALERT_ACTIVITY] = window->summary.odba;
+    sample->value[ALERT_LYING] = (window->summary.posture == CS_POSTURE_LYING) ? 100 : 0;
+    sample->present |= (1u << ALERT_ACTIVITY) | (1u << ALERT_LYING);
+  }
+  else if (window->kind == CS_KIND_CLASS && window->n_labels > 0)
+  {
+    uint8_t lying = 0;
+
+    for (uint8_t i = 0; i < window->n_labels; i++)
+    {
+      lying += (window->labels[i].class == CS_CLASS_LYING);
+    }
+    sample->value[ALERT_LYING] = 100.0f * lying / window->n_labels;
+    sample->present |= (1u << ALERT_LYING);
+  }
+}
+
+// Evaluate the alert rules on a window of a collar: on a worker with -T.
+static void alert_window(void *owner, const work_item_t *item)
+{
+  alert_sample_t sample;
+
+  alert_sample_of(&item->window, &sample);
+  alert_report(owner, &sample, item->now_ms);
+}
+
+static void alert_tick(void *owner, uint64_t now_ms)
+{
+  alert_poll_collar(owner, now_ms);
+}
+
+// Evaluate the alert rules on a new window, on the cow's worker with -T.
+static void note_alerts(collar_t *collar, const cs_window_t *window)
+{
+  alert_sample_t sample;
+
+  if (!alert_file || !collar)
+  {
+    return;
+  }
+
+  if (pool_workers > 0)
+  {
+    work_item_t *item = work_pool_item();
+
+    item->cow_id = collar->cow_id;
+    item->now_ms = monotonic_ms();
+    memcpy(&item->window, window, sizeof(*window));
+    work_pool_submit(collar, item);
+    return;
+  }
+
+  alert_sample_of(window, &sample);
+  alert_report(collar, &sample, monotonic_ms());
+}
+
+// Run the scanner the way the sync acquisition asks, unless a connection
+// has it stopped.
+static void scan_update(uint64_t now)
+{
+  sync_acq_scan_t scan;
+  sl_status_t sc;
+
+  if (!booted || (conn_handle != 0xFF))
+  {
+    return;
+  }
+  sync_acq_scan(now, &scan);
+  if (scan_now.on && (scan.phy == scan_now.phy) && (scan.interval == scan_now.interval)
+      && (scan.window == scan_now.window))
+  {
+    return;
+  }
+
+  if (scan_now.on)
+  {
+    sl_bt_scanner_stop();
+  }
+  sc = sl_bt_scanner_set_parameters(sl_bt_scanner_scan_mode_passive, scan.interval, scan.window);
+  if (SL_STATUS_OK == sc)
+  {
+    sc = sl_bt_scanner_start(scan.phy, sl_bt_scanner_discover_observation);
+  }
+  if (SL_STATUS_OK != sc)
+  {
+    app_log_warning("Cannot start scanning, status 0x%04X" APP_LOG_NL, sc);
+    scan_now.on = false;
+    return;
+  }
+  scan_now = scan;
+}
+
+// Stop the scanner for a connection.
+static void scan_stop(void)
+{
+  sl_bt_scanner_stop();
+  scan_now.on = false;
+}
+
+// Start collecting a new chain for sync.
+static void pa_reassembly_reset(pa_reassembly_t *r, uint16_t sync)
+{
+  r->sync = sync;
+  r->overflow = false;
+  r->len = 0;
+}
+
+static void process_periodic_sync_report(const sl_bt_evt_periodic_sync_report_t *report)
+{
+  pa_reassembly_t *r = &pa_reassembly[report->sync % PA_REASSEMBLY_SLOTS];
+  const uint8_t *data = report->data.data;
+  uint16_t len = report->data.len;
+  cs_window_t window;
+  uint8_t status;
+
+  sync_acq_report(report->sync, report->counter);
+
+  if (r->sync != report->sync)
+  {
+    pa_reassembly_reset(r, report->sync);
+  }
+
+  // Chained data arrives as several reports: collect until complete
+  if ((report->data_status != PA_DATA_COMPLETE) || (r->len > 0) || r->overflow)
+  {
+    if (r->len + report->data.len > PA_DATA_MAX)
+    {
+      r->overflow = true;
+    }
+    else
+    {
+      memcpy(&r->data[r->len], report->data.data, report->data.len);
+      r->len += report->data.len;
+    }
+
+    if (report->data_status == PA_DATA_INCOMPLETE)
+    {
+      return;
+    }
+    if ((report->data_status == PA_DATA_TRUNCATED) || r->overflow)
+    {
+      pa_truncated++;
+      metrics.truncated++;
+      app_log("Truncated chain on sync %d (%u bytes), %u so far\r\n", report->sync, r->len, pa_truncated);
+      pa_reassembly_reset(r, report->sync);
+      return;
+    }
+    data = r->data;
+    len = r->len;
+  }
+
+  status = cs_payload_decode(data, len, &window);
+  pa_reassembly_reset(r, report->sync);
+  if (status != CS_PAYLOAD_OK) {
+    metrics.decode_errors++;
+    app_log("Dropped report, decode error %d len %d\r\n", status, len);
+    return;
+  }
+
+  metrics.reports++;
+  metrics_rssi(report->rssi);
+
+  // Remember which collar this sync belongs to
+  collar_t *collar = collar_table_get(window.cow_id);
+  if (collar) {
+    collar->synced = true;
+    collar->sync_handle = report->sync;
+    collar->reports++;
+    link_note_rssi(collar, report->rssi);
+  }
+
+  if (window_is_new(collar, &window, NULL)) {
+    note_rate(collar, &window);
+    note_gap(collar, &window);
+    note_alerts(collar, &window);
+    log_window(&window, report->counter, report->rssi, SHM_FEED_PERIODIC);
   }
 
   app_log("Counter: %d\r\n", report->counter);
 }
 
+// Handle one bulk_data notification: a stored window or the end marker.
+static void process_bulk_notification(const uint8array *value)
+{
+  cs_window_t window;
+  uint32_t header;
+  uint32_t seq;
+  uint16_t fragment;
+  uint8_t status;
+
+  if (value->len < BULK_HEADER_LEN) {
+    return;
+  }
 
-void connection_close_callback(union sigval arg);
+  header = cs_get_le32(value->data);
+  seq = header & ~BULK_SEQ_MORE;
+
+  if ((value->len == BULK_HEADER_LEN) && !(header & BULK_SEQ_MORE)) {
+    // End of backlog
+    struct timespec now;
+    double elapsed;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    elapsed = (now.tv_sec - bulk_start.tv_sec) + (now.tv_nsec - bulk_start.tv_nsec) / 1e9;
+
+    collar_skip_to(bulk_collar, seq);
+
+    app_log("Bulk drain cow %d: %u windows, %u bytes in %.3f s, %.2f kB/s\r\n",
+            bulk_collar->cow_id, bulk_windows, bulk_bytes, elapsed,
+            (elapsed > 0) ? bulk_bytes / elapsed / 1000.0 : 0.0);
+
+    sl_bt_connection_close(conn_handle);
+    main_state = DISCONNECTING;
+    return;
+  }
+
+  // Long windows come in fragments of the same sequence number
+  if ((bulk_frag_len > 0) && (seq != bulk_frag_seq)) {
+    app_log("Bulk window %u incomplete, dropped\r\n", bulk_frag_seq);
+    bulk_frag_len = 0;
+  }
+  fragment = value->len - BULK_HEADER_LEN;
+  if (bulk_frag_len + fragment > sizeof(bulk_frag)) {
+    app_log("Bulk window %u too long, dropped\r\n", seq);
+    bulk_frag_len = 0;
+    return;
+  }
+  memcpy(&bulk_frag[bulk_frag_len], &value->data[BULK_HEADER_LEN], fragment);
+  bulk_frag_len += fragment;
+  bulk_frag_seq = seq;
+  bulk_bytes += value->len;
+
+  if (header & BULK_SEQ_MORE) {
+    return;
+  }
+
+  status = cs_payload_decode(bulk_frag, bulk_frag_len, &window);
+  bulk_frag_len = 0;
+  if (status != CS_PAYLOAD_OK) {
+    metrics.decode_errors++;
+    app_log("Bulk window %u dropped, decode error %d\r\n", seq, status);
+    return;
+  }
+  metrics.bulk_windows++;
+
+  if (seq > collar_wanted_seq(bulk_collar)) {
+    // windows before seq were overwritten on the collar before we got them
+    app_log("Bulk gap cow %d: expected %u got %u\r\n",
+            bulk_collar->cow_id, collar_wanted_seq(bulk_collar), seq);
+    collar_skip_to(bulk_collar, seq);
+  }
+
+  if (window_is_new(bulk_collar, &window, &seq)) {
+    note_rate(bulk_collar, &window);
+    gap_note_bulk(bulk_collar);
+    log_window(&window, seq, 0, SHM_FEED_BULK);
+  }
+
+  bulk_windows++;
+}
+
+
+// ─────────────────────────────────────────────────────────────────────────────
+// Delta firmware update
+// ─────────────────────────────────────────────────────────────────────────────
+
+/**
+ * Write the session's patch body until its window is full or the NCP has no
+ * room for more; the rest goes at the next poll.
+ */
+static void ota_pump(ota_session_t *s)
+{
+  uint8_t buf[CS_DELTA_DATA_HEADER_LEN + OTA_BATCH_CHUNK];
+  uint16_t sent_len;
+  uint16_t len;
+
+  while ((len = ota_batch_next(s, buf)) > 0)
+  {
+    if (sl_bt_gatt_write_characteristic_value_without_response(s->connection, s->data, len, buf, &sent_len)
+        != SL_STATUS_OK)
+    {
+      break;
+    }
+    ota_batch_sent(s, len);
+  }
+}
+
+static void ota_apply(ota_session_t *s, ota_do_t action)
+{
+  uint8_t command;
+  uint16_t sent_len;
+
+  switch (action)
+  {
+  case OTA_DO_SEND:
+    ota_pump(s);
+    break;
+
+  case OTA_DO_INSTALL:
+    command = CS_DELTA_CMD_INSTALL;
+    sl_bt_gatt_write_characteristic_value(s->connection, s->ctrl, 1, &command);
+    break;
+
+  case OTA_DO_ABORT:
+    command = CS_DELTA_CMD_ABORT;
+    sl_bt_gatt_write_characteristic_value_without_response(s->connection, s->ctrl, 1, &command, &sent_len);
+    sl_bt_connection_close(s->connection);
+    break;
+
+  case OTA_DO_CLOSE:
+    sl_bt_connection_close(s->connection);
+    break;
+
+  default:
+    break;
+  }
+}
+
+/**
+ * Events of update connections, which run beside the main connection.
+ * Returns true if the event was one.
+ */
+static bool ota_event(sl_bt_msg_t *evt)
+{
+  uint64_t now = monotonic_ms();
+  ota_session_t *s;
+
+  switch (SL_BT_MSG_ID(evt->header))
+  {
+  case sl_bt_evt_connection_opened_id:
+    s = ota_batch_session(evt->data.evt_connection_opened.connection);
+    if (s == NULL)
+    {
+      return false;
+    }
+    sl_bt_connection_set_preferred_phy(s->connection, sl_bt_gap_phy_2m, sl_bt_gap_phy_any);
+    s->step = OTA_STEP_SERVICE;
+    sl_bt_gatt_discover_primary_services_by_uuid(s->connection, UUID_LEN, bulk_serviceUUID);
+    return true;
+
+  case sl_bt_evt_connection_closed_id:
+    s = ota_batch_session(evt->data.evt_connection_closed.connection);
+    if (s == NULL)
+    {
+      return false;
+    }
+    app_log("Update cow %d: connection closed, reason 0x%04X, %u of %u patch bytes taken\r\n", s->cow_id,
+            evt->data.evt_connection_closed.reason, s->taken, ota_batch_header()->body_len);
+    ota_batch_closed(s->connection, now);
+    return true;
+
+  case sl_bt_evt_gatt_mtu_exchanged_id:
+    s = ota_batch_session(evt->data.evt_gatt_mtu_exchanged.connection);
+    if (s == NULL)
+    {
+      return false;
+    }
+    ota_batch_mtu(s, evt->data.evt_gatt_mtu_exchanged.mtu);
+    return true;
+
+  case sl_bt_evt_gatt_service_id:
+    s = ota_batch_session(evt->data.evt_gatt_service.connection);
+    if (s == NULL)
+    {
+      return false;
+    }
+    if (evt->data.evt_gatt_service.uuid.len == UUID_LEN
+        && memcmp(bulk_serviceUUID, evt->data.evt_gatt_service.uuid.data, UUID_LEN) == 0)
+    {
+      s->service = evt->data.evt_gatt_service.service;
+    }
+    return true;
+
+  case sl_bt_evt_gatt_characteristic_id:
+    s = ota_batch_session(evt->data.evt_gatt_characteristic.connection);
+    if (s == NULL)
+    {
+      return false;
+    }
+    if (evt->data.evt_gatt_characteristic.uuid.len == UUID_LEN)
+    {
+      if (memcmp(ota_ctrl_UUID, evt->data.evt_gatt_characteristic.uuid.data, UUID_LEN) == 0)
+      {
+        s->ctrl = evt->data.evt_gatt_characteristic.characteristic;
+      }
+      else if (memcmp(ota_data_UUID, evt->data.evt_gatt_characteristic.uuid.data, UUID_LEN) == 0)
+      {
+        s->data = evt->data.evt_gatt_characteristic.characteristic;
+      }
+    }
+    return true;
+
+  case sl_bt_evt_gatt_procedure_completed_id:
+    s = ota_batch_session(evt->data.evt_gatt_procedure_completed.connection);
+    if (s == NULL)
+    {
+      return false;
+    }
+    if (evt->data.evt_gatt_procedure_completed.result != SL_STATUS_OK)
+    {
+      app_log("Update cow %d: GATT error 0x%04X\r\n", s->cow_id, evt->data.evt_gatt_procedure_completed.result);
+      sl_bt_connection_close(s->connection);
+      return true;
+    }
+    switch (s->step)
+    {
+    case OTA_STEP_SERVICE:
+      if (s->service == 0)
+      {
+        app_log("Update cow %d: bulk service not found\r\n", s->cow_id);
+        sl_bt_connection_close(s->connection);
+        break;
+      }
+      s->step = OTA_STEP_CHARACTERISTICS;
+      sl_bt_gatt_discover_characteristics(s->connection, s->service);
+      break;
+
+    case OTA_STEP_CHARACTERISTICS:
+      if (s->ctrl == 0 || s->data == 0)
+      {
+        app_log("Update cow %d: firmware without delta updates, left alone\r\n", s->cow_id);
+        ota_batch_no_update(s);
+        sl_bt_connection_close(s->connection);
+        break;
+      }
+      s->step = OTA_STEP_NOTIFY;
+      sl_bt_gatt_set_characteristic_notification(s->connection, s->ctrl, sl_bt_gatt_notification);
+      break;
+
+    case OTA_STEP_NOTIFY:
+    {
+      uint8_t command[1 + CS_DELTA_HEADER_LEN];
+      uint16_t len = ota_batch_begin(s, command);
 
-void reprov_callback(union sigval arg);
+      sl_bt_gatt_write_characteristic_value(s->connection, s->ctrl, len, command);
+      break;
+    }
+
+    default:
+      break;
+    }
+    return true;
+
+  case sl_bt_evt_gatt_characteristic_value_id:
+  {
+    uint8array *value = &evt->data.evt_gatt_characteristic_value.value;
+    ota_do_t action;
+
+    s = ota_batch_session(evt->data.evt_gatt_characteristic_value.connection);
+    if (s == NULL)
+    {
+      return false;
+    }
+    if (evt->data.evt_gatt_characteristic_value.characteristic != s->ctrl)
+    {
+      return true;
+    }
+    action = ota_batch_status(s, value->data, value->len, now);
+    if (value->len >= CS_DELTA_STATUS_LEN && value->data[0] != CS_DELTA_OK)
+    {
+      app_log("Update cow %d: status %u at %u of %u patch bytes\r\n", s->cow_id, value->data[0],
+              cs_get_le32(&value->data[1]), ota_batch_header()->body_len);
+    }
+    ota_apply(s, action);
+    return true;
+  }
+
+  default:
+    return false;
+  }
+}
+
+/**
+ * Keep the update sessions writing and drop the ones that stalled.
+ */
+static void ota_poll(uint64_t now)
+{
+  ota_session_t *s;
+
+  for (int i = 0; i < OTA_BATCH_SESSIONS; i++)
+  {
+    s = ota_batch_get(i);
+    if (s->step == OTA_STEP_SEND)
+    {
+      ota_pump(s);
+    }
+  }
+
+  while ((s = ota_batch_stalled(now)) != NULL)
+  {
+    app_log("Update cow %d: stalled at %u patch bytes, closing\r\n", s->cow_id, s->taken);
+    sl_bt_connection_close(s->connection);
+  }
+}
+
+
+void connection_close_callback(union sigval arg);
 
 
 /**************************************************************************/ /**
@@ -231,6 +1357,164 @@ void app_init(int argc, char *argv[])
       app_log("Deprecated option: -R" APP_LOG_NL);
       break;
 
+    case 'a':
+      link_adapt = true;
+      break;
+
+    case 'k':
+      pawr_redundancy = (uint8_t)atoi(optarg);
+      break;
+
+    case 'c':
+    {
+      unsigned int imu_ms, window, env_s, pa_ms, k, mode = CS_MODE_RAW, options = 0;
+
+      if (sscanf(optarg, "%u,%u,%u,%u,%u,%u,%u", &imu_ms, &window, &env_s, &pa_ms, &k, &mode, &options) < 5
+          || imu_ms > 0xFFFF || window > 0xFF || env_s > 0xFFFF || pa_ms > 0xFFFF || k > 0xFF || mode > 0xFF
+          || options > 0xFF)
+      {
+        app_log(USAGE, argv[0]);
+        exit(EXIT_FAILURE);
+      }
+      collar_config.imu_period_ms = (uint16_t)imu_ms;
+      collar_config.window_samples = (uint8_t)window;
+      collar_config.env_period_s = (uint16_t)env_s;
+      collar_config.pa_interval_ms = (uint16_t)pa_ms;
+      collar_config.pa_redundancy = (uint8_t)k;
+      collar_config.mode = (uint8_t)mode;
+      collar_config.options = (uint8_t)options;
+
+      if (!cs_config_valid(&collar_config))
+      {
+        app_log("Invalid collar configuration: %s" APP_LOG_NL, optarg);
+        exit(EXIT_FAILURE);
+      }
+      config_set = true;
+      break;
+    }
+
+    case 'W':
+      capture_path = optarg;
+      break;
+
+    case 'P':
+      replay_path = optarg;
+      break;
+
+    case 'F':
+      replay_fast = true;
+      break;
+
+    case 'M':
+      metrics_file = optarg;
+      break;
+
+    case 'A':
+      alert_file = optarg;
+      break;
+
+    case 'T':
+    {
+      int n = atoi(optarg);
+
+      if (n < 1 || n > WORK_POOL_MAX_WORKERS)
+      {
+        app_log(USAGE, argv[0]);
+        exit(EXIT_FAILURE);
+      }
+      pool_workers = (uint8_t)n;
+      break;
+    }
+
+    case 'O':
+      ota_patch = optarg;
+      break;
+
+    case 'L':
+    {
+      static char name[SHM_FEED_NAME_MAX];
+      unsigned int slots = SHM_FEED_DEFAULT_SLOTS;
+
+      if (sscanf(optarg, "%63[^,],%u", name, &slots) < 1 || slots == 0 || (slots & (slots - 1)))
+      {
+        app_log(USAGE, argv[0]);
+        exit(EXIT_FAILURE);
+      }
+      feed_name = name;
+      feed_slots = slots;
+      break;
+    }
+
+    case 'D':
+      store_dir = optarg;
+      break;
+
+    case 'G':
+    {
+      unsigned int ms, records;
+
+      if (sscanf(optarg, "%u,%u", &ms, &records) != 2)
+      {
+        app_log(USAGE, argv[0]);
+        exit(EXIT_FAILURE);
+      }
+      store_commit_ms = ms;
+      store_commit_records = records;
+      break;
+    }
+
+    case 'K':
+    {
+      double raw_days, minute_days;
+      unsigned long long max_mb = 0;
+
+      if (sscanf(optarg, "%lf,%lf,%llu", &raw_days, &minute_days, &max_mb) < 2 || raw_days < 0
+          || minute_days < raw_days || minute_days > 10000)
+      {
+        app_log(USAGE, argv[0]);
+        exit(EXIT_FAILURE);
+      }
+      retention.raw_age_s = (uint32_t)(raw_days * 86400);
+      retention.minute_age_s = (uint32_t)(minute_days * 86400);
+      retention.max_bytes = max_mb << 20;
+      retention_on = true;
+      break;
+    }
+
+    case 'Z':
+      retention.archive_dir = optarg;
+      break;
+
+    case 'Q':
+    {
+      static char path[108];
+      unsigned int mb = QUERY_DEFAULT_CACHE_MB;
+
+      if (sscanf(optarg, "%107[^,],%u", path, &mb) < 1 || mb == 0)
+      {
+        app_log(USAGE, argv[0]);
+        exit(EXIT_FAILURE);
+      }
+      query_socket = path;
+      query_cache_mb = mb;
+      break;
+    }
+
+    case 'm':
+    {
+      unsigned int from, to;
+
+      if (remap_count >= PAWR_MAX_REMAP || sscanf(optarg, "%u:%u", &from, &to) != 2 || from > 0xFF || to > 0xFF)
+      {
+        app_log(USAGE, argv[0]);
+        exit(EXIT_FAILURE);
+      }
+      remap_from[remap_count] = (uint8_t)from;
+      remap_to[remap_count] = (uint8_t)to;
+      remap_count++;
+      break;
+    }
+
     // Process options for other modules.
     default:
       sc = ncp_host_set_option((char)opt, optarg);
@@ -247,21 +1531,159 @@ void app_init(int argc, char *argv[])
     }
   }
 
-  // Initialize NCP connection.
-  sc = ncp_host_init();
-  if (sc == SL_STATUS_INVALID_PARAMETER)
+  if (replay_path != NULL)
+  {
+    // Replay a capture through the same receive path instead of an NCP.
+    sc = ncp_replay_open(replay_path, !replay_fast);
+    if (sc != SL_STATUS_OK)
+    {
+      app_log("Cannot replay NCP capture %s" APP_LOG_NL, replay_path);
+      exit(EXIT_FAILURE);
+    }
+    app_log_info("Replaying NCP capture %s." APP_LOG_NL, replay_path);
+  }
+  else
   {
-    app_log(USAGE, argv[0]);
-    exit(EXIT_FAILURE);
+    // Initialize NCP connection.
+    sc = ncp_host_init();
+    if (sc == SL_STATUS_INVALID_PARAMETER)
+    {
+      app_log(USAGE, argv[0]);
+      exit(EXIT_FAILURE);
+    }
+    app_assert_status(sc);
+    app_log_info("NCP host initialised." APP_LOG_NL);
+
+    if (capture_path != NULL)
+    {
+      sc = ncp_capture_open(capture_path);
+      if (sc != SL_STATUS_OK)
+      {
+        app_log("Cannot open NCP capture %s" APP_LOG_NL, capture_path);
+        exit(EXIT_FAILURE);
+      }
+      app_log_info("Recording NCP bytes to %s." APP_LOG_NL, capture_path);
+    }
   }
-  app_assert_status(sc);
-  app_log_info("NCP host initialised." APP_LOG_NL);
   app_log_info("Press Crtl+C to quit" APP_LOG_NL APP_LOG_NL);
 
   get_local_time();
 
   cow_id = COW_ID;
 
+  collar_table_init();
+  sync_acq_init();
+  metrics_init(metrics_file);
+
+  if (alert_file)
+  {
+    if (!alert_load(alert_file))
+    {
+      exit(EXIT_FAILURE);
+    }
+    alert_set_handler(on_alert);
+    app_log_info("%u alert rules loaded from %s." APP_LOG_NL, alert_rule_count(), alert_file);
+
+    alert_log = fopen("ble_alert_log.csv", "a");
+    if (alert_log && ftell(alert_log) == 0)
+    {
+      fprintf(alert_log, "Hour,Min,Sec,CowID,Rule,Value,Threshold\n");
+      fflush(alert_log);
+    }
+
+    if (pool_workers > 0)
+    {
+      if (!work_pool_start(pool_workers, alert_window, alert_tick))
+      {
+        app_log_error("Cannot start %u alert workers" APP_LOG_NL, pool_workers);
+        exit(EXIT_FAILURE);
+      }
+      app_log_info("Alert rules run on %u workers." APP_LOG_NL, pool_workers);
+    }
+  }
+  else
+  {
+    pool_workers = 0;
+  }
+
+  if (feed_name)
+  {
+    if (!shm_feed_create(&feed, feed_name, feed_slots))
+    {
+      app_log_error("Cannot create the feed /dev/shm/%s" APP_LOG_NL, feed_name);
+      exit(EXIT_FAILURE);
+    }
+    app_log_info("Publishing windows to /dev/shm/%s, %u records." APP_LOG_NL, feed_name, feed_slots);
+  }
+
+  if (ota_patch)
+  {
+    const cs_delta_header_t *h;
+
+    if (!ota_batch_load(ota_patch))
+    {
+      app_log_error("%s is not a delta patch" APP_LOG_NL, ota_patch);
+      exit(EXIT_FAILURE);
+    }
+    h = ota_batch_header();
+    app_log_info("Updating collars running the %u byte image at 0x%08x (CRC-32 %08x) to a %u byte image,"
+                 " %u patch bytes." APP_LOG_NL, h->base_len, h->base_addr, h->base_crc, h->new_len, h->body_len);
+  }
+
+  if (store_dir)
+  {
+    char prefix[STORE_PREFIX_MAX];
+    store_recovery_t recovery;
+
+    // Segments a crash left behind end at their last valid record
+    if (!store_recover(store_dir, &recovery))
+    {
+      app_log("Cannot recover the window store %s" APP_LOG_NL, store_dir);
+      exit(EXIT_FAILURE);
+    }
+    if (recovery.repaired > 0)
+    {
+      app_log_warning("Window store: %u segments cut back by %llu bytes in all" APP_LOG_NL,
+                      recovery.repaired, (unsigned long long)recovery.truncated);
+    }
+
+    // segments of this run, named after its start
+    snprintf(prefix, sizeof(prefix), "live-%lld", (long long)time(NULL));
+    if (!store_open(&store, store_dir, prefix, STORE_RAW))
+    {
+      app_log("Cannot open the window store %s" APP_LOG_NL, store_dir);
+      exit(EXIT_FAILURE);
+    }
+    store_set_commit(&store, store_commit_ms, store_commit_records);
+    app_log_info("Storing raw windows in %s." APP_LOG_NL, store_dir);
+
+    if (retention_on)
+    {
+      if (!retention_init(store_dir, &retention, &store))
+      {
+        app_log("Cannot start the retention of the window store %s" APP_LOG_NL, store_dir);
+        exit(EXIT_FAILURE);
+      }
+      app_log_info("Summarizing raw windows after %.1f days, minute summaries kept %.1f days." APP_LOG_NL,
+                   retention.raw_age_s / 86400.0, retention.minute_age_s / 86400.0);
+    }
+
+    if (query_socket)
+    {
+      if (!query_server_start(query_socket, store_dir, query_cache_mb << 20))
+      {
+        app_log_error("Cannot serve queries on %s" APP_LOG_NL, query_socket);
+        exit(EXIT_FAILURE);
+      }
+      app_log_info("Answering queries over the window store on %s, %u MB page cache." APP_LOG_NL, query_socket,
+                   (unsigned int)query_cache_mb);
+    }
+  }
+  else
+  {
+    query_socket = NULL;
+  }
+
   csv_file = fopen("ble_data_log.csv", "a");
   if (csv_file && ftell(csv_file) == 0)
   {
@@ -270,6 +1692,28 @@ void app_init(int argc, char *argv[])
     fflush(csv_file);
   }
 
+  summary_file = fopen("ble_summary_log.csv", "a");
+  if (summary_file && ftell(summary_file) == 0)
+  {
+    fprintf(summary_file, "Hour,Min,Sec,Battery,Temp,CowID,Windows,Samples,MeanX,MeanY,MeanZ,"
+                          "StdX,StdY,StdZ,ODBA,ZcX,ZcY,ZcZ,Tilt,Posture,Seq,Counter,RSSI\n");
+    fflush(summary_file);
+  }
+
+  class_file = fopen("ble_class_log.csv", "a");
+  if (class_file && ftell(class_file) == 0)
+  {
+    fprintf(class_file, "Hour,Min,Sec,Battery,Temp,CowID,Seq,Window,Class,Confidence,Counter,RSSI\n");
+    fflush(class_file);
+  }
+
+  orient_file = fopen("ble_orient_log.csv", "a");
+  if (orient_file && ftell(orient_file) == 0)
+  {
+    fprintf(orient_file, "Hour,Min,Sec,CowID,Seq,Roll,Pitch,Yaw,Tilt,Posture,Counter,RSSI\n");
+    fflush(orient_file);
+  }
+
   /////////////////////////////////////////////////////////////////////////////
   // Put your additional application init code here!                         //
   // This is called once during start-up.                                    //
@@ -281,24 +1725,66 @@ void app_init(int argc, char *argv[])
                                                                               *****************************************************************************/
 void app_process_action(void)
 {
+  uint64_t now = monotonic_ms();
+
+  if ((replay_path != NULL) && ncp_replay_ended())
+  {
+    // the SDK's main loop never returns, the replay front end stops before this
+    app_deinit();
+    exit(EXIT_SUCCESS);
+  }
+
   if (conn_close_flag) {
     conn_close_flag = false;
 
-    app_assert_status(sl_bt_scanner_stop());
+    // the collar just provisioned starts its periodic advertising
+    sync_acq_expect(now);
+    scan_poll_ms = now;
+  }
+
+  if (now >= scan_poll_ms)
+  {
+    scan_poll_ms = now + SCAN_POLL_MS;
+    scan_update(now);
+  }
 
-    app_assert_status(sl_bt_scanner_set_parameters(sl_bt_scanner_scan_mode_passive, 160, 160));
-    app_assert_status(sl_bt_sync_scanner_set_sync_parameters(0, 6000, sl_bt_sync_report_all));
-    app_assert_status(sl_bt_scanner_start(sl_bt_scanner_scan_phy_coded, sl_bt_scanner_discover_observation));
+  if (alert_file)
+  {
+    if (now >= alert_poll_ms)
+    {
+      alert_poll_ms = now + 1000;
+      if (pool_workers == 0)
+      {
+        alert_poll(now);
+      }
+      else if (alert_has_silence())
+      {
+        // each collar's silence is looked at by the worker that has it
+        for (collar_t *c = collar_table_next(NULL); c != NULL; c = collar_table_next(c))
+        {
+          work_pool_tick(c->cow_id, c, now);
+        }
+      }
+    }
+  }
 
-  } else if (reprov_flag) {
-    reprov_flag = false;
+  if (ota_patch)
+  {
+    ota_poll(now);
+  }
 
-    app_assert_status(sl_bt_scanner_stop());
+  if (store_dir && !store_poll(&store))
+  {
+    app_log_warning("Cannot write to the window store %s" APP_LOG_NL, store_dir);
+  }
 
-    app_assert_status(sl_bt_scanner_set_parameters(sl_bt_scanner_scan_mode_passive, 160, 160));
-    app_assert_status(sl_bt_sync_scanner_set_sync_parameters(0, 6000, sl_bt_sync_report_all));
-    app_assert_status(sl_bt_scanner_start(sl_bt_scanner_scan_phy_1m_and_coded, sl_bt_scanner_discover_observation));
+  if (retention_on)
+  {
+    // logs its own errors, and tries again later
+    retention_poll(now);
   }
+
+  metrics_poll();
 }
 
 /**************************************************************************/ /**
@@ -306,6 +1792,19 @@ void app_process_action(void)
                                                                               *****************************************************************************/
 void app_deinit(void)
 {
+  if (pool_workers > 0)
+  {
+    work_pool_stats_t stats;
+
+    // the alerts still queued go to the log before it closes
+    work_pool_drain();
+    work_pool_get_stats(&stats);
+    work_pool_stop();
+    app_log_info("Alert workers: %llu windows in %llu runs, %llu stolen, %llu waits for a free item." APP_LOG_NL,
+                 (unsigned long long)stats.items, (unsigned long long)stats.runs,
+                 (unsigned long long)stats.steals, (unsigned long long)stats.full);
+    pool_workers = 0;
+  }
 
   if (csv_file)
   {
@@ -313,12 +1812,97 @@ void app_deinit(void)
     csv_file = NULL;
   }
 
-  ncp_host_deinit();
+  if (summary_file)
+  {
+    fclose(summary_file);
+    summary_file = NULL;
+  }
+
+  if (class_file)
+  {
+    fclose(class_file);
+    class_file = NULL;
+  }
+
+  if (orient_file)
+  {
+    fclose(orient_file);
+    orient_file = NULL;
+  }
+
+  if (alert_log)
+  {
+    fclose(alert_log);
+    alert_log = NULL;
+  }
+
+  if (sync_acq_stats.reacquired > 0)
+  {
+    app_log_info("Time to sync after a loss: %llu syncs, p50 %llu ms, p90 %llu ms, p99 %llu ms." APP_LOG_NL,
+                 (unsigned long long)sync_acq_stats.reacquired, (unsigned long long)sync_acq_percentile(0.5),
+                 (unsigned long long)sync_acq_percentile(0.9), (unsigned long long)sync_acq_percentile(0.99));
+  }
+
+  if (ota_patch)
+  {
+    app_log_info("Firmware update: %u collars updated, %u on another image, %u given up on; %u connections,"
+                 " %u retries, %u rewinds, %llu patch bytes written." APP_LOG_NL,
+                 ota_batch_stats.updated, ota_batch_stats.other_base, ota_batch_stats.failed,
+                 ota_batch_stats.sessions, ota_batch_stats.retries, ota_batch_stats.rewinds,
+                 (unsigned long long)ota_batch_stats.body_bytes);
+    if (ota_batch_stats.updated > 0)
+    {
+      app_log_info("Firmware update: %llu ms per collar on average." APP_LOG_NL,
+                   (unsigned long long)(ota_batch_stats.update_ms / ota_batch_stats.updated));
+    }
+  }
+
+  if (query_socket)
+  {
+    query_server_stats_t stats;
+    store_cache_stats_t cache;
+
+    // before the store closes under the queries
+    query_server_get_stats(&stats, &cache);
+    query_server_stop();
+    app_log_info("Queries: %llu from %llu connections (%llu turned away), %llu failed, %llu rows; page cache"
+                 " %llu hits, %llu misses, %llu evictions." APP_LOG_NL,
+                 (unsigned long long)stats.queries, (unsigned long long)stats.connections,
+                 (unsigned long long)stats.busy, (unsigned long long)stats.failed, (unsigned long long)stats.rows,
+                 (unsigned long long)cache.hits, (unsigned long long)cache.misses,
+                 (unsigned long long)cache.evictions);
+    query_socket = NULL;
+  }
+
+  if (retention_on)
+  {
+    retention_close();
+  }
+
+  if (feed_name)
+  {
+    shm_feed_destroy(&feed);
+  }
+
+  if (store_dir)
+  {
+    store_close(&store);
+  }
+
+  metrics_export();
+  ncp_capture_close();
+
+  if (replay_path == NULL)
+  {
+    ncp_host_deinit();
+  }
 
 }
 
 
 
+static void handle_event(sl_bt_msg_t *evt);
+
 /******************************************************************************
  * Bluetooth stack event handler.
  * This overrides the dummy weak implementation.
@@ -326,10 +1910,24 @@ void app_deinit(void)
  * @param[in] evt Event coming from the Bluetooth stack.
  *****************************************************************************/
 void sl_bt_on_event(sl_bt_msg_t *evt)
+{
+  uint64_t start = metrics_sample_begin(metrics.events++);
+
+  handle_event(evt);
+  metrics_sample_end(&metrics.handler, start);
+}
+
+static void handle_event(sl_bt_msg_t *evt)
 {
   sl_status_t sc;
   uint16_t max_mtu_out;
 
+  // update connections are kept apart from the main connection
+  if (ota_patch && ota_event(evt))
+  {
+    return;
+  }
+
   switch (SL_BT_MSG_ID(evt->header))
   {
   // -------------------------------
@@ -341,13 +1939,62 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
 
     sl_bt_gatt_server_set_max_mtu(247, &max_mtu_out);
 
-    sl_bt_scanner_start(sl_bt_scanner_scan_phy_1m_and_coded, sl_bt_scanner_discover_generic);
+    pawr_start();
+
+    booted = true;
+    scan_update(monotonic_ms());
 
     main_state = SCANNING;
 
     break;
 
   case sl_bt_evt_scanner_legacy_advertisement_report_id:
+  {
+    uint8_t bulk_cow;
+    uint8_t bulk_count;
+
+    if (parse_bulk_adv(evt->data.evt_scanner_legacy_advertisement_report.data.data,
+                       evt->data.evt_scanner_legacy_advertisement_report.data.len,
+                       &bulk_cow, &bulk_count))
+    {
+      collar_t *collar = collar_table_get(bulk_cow);
+      uint64_t now = monotonic_ms();
+      uint8_t connection;
+
+      if (ota_patch && ota_batch_want(bulk_cow, now))
+      {
+        // the update goes first; the scanner keeps running beside it
+        sc = sl_bt_connection_open(
+            evt->data.evt_scanner_legacy_advertisement_report.address,
+            evt->data.evt_scanner_legacy_advertisement_report.address_type,
+            sl_bt_gap_1m_phy,
+            &connection);
+
+        if (SL_STATUS_OK == sc)
+        {
+          app_log("Update cow %d\r\n", bulk_cow);
+          ota_batch_start(bulk_cow, connection, now);
+        }
+      }
+      // Only drain collars we are not receiving live
+      else if (conn_handle == 0xFF && bulk_count > 0 && collar && !collar->synced)
+      {
+        sc = sl_bt_connection_open(
+            evt->data.evt_scanner_legacy_advertisement_report.address,
+            evt->data.evt_scanner_legacy_advertisement_report.address_type,
+            sl_bt_gap_1m_phy,
+            &conn_handle);
+
+        if (SL_STATUS_OK == sc)
+        {
+          app_log("Bulk drain cow %d, %d windows stored\r\n", bulk_cow, bulk_count);
+          scan_stop();
+          bulk_mode = true;
+          bulk_collar = collar;
+        }
+      }
+      break;
+    }
 
     if (parse_adv(&(evt->data.evt_scanner_legacy_advertisement_report.data.data[0]), evt->data.evt_scanner_legacy_advertisement_report.data.len) != 0)
     {
@@ -360,29 +2007,57 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
 
       if (SL_STATUS_OK == sc)
       {
-        sl_bt_scanner_stop();
+        scan_stop();
       }
     }
     break;
+  }
 
   case sl_bt_evt_scanner_extended_advertisement_report_id:
-
-    if (parse_adv(&(evt->data.evt_scanner_extended_advertisement_report.data.data[0]), evt->data.evt_scanner_extended_advertisement_report.data.len) != 0)
+  {
+    sl_bt_evt_scanner_extended_advertisement_report_t *report = &evt->data.evt_scanner_extended_advertisement_report;
+    uint64_t now = monotonic_ms();
+    uint16_t skip;
+    uint16_t timeout;
+
+    // collars already synced advertise too: only the others are opened
+    if (parse_adv(&(report->data.data[0]), report->data.len) != 0
+        && sync_acq_adv(&report->address, report->primary_phy, report->periodic_interval, now, &skip, &timeout))
     {
       app_log("Found periodic sync service, attempting to open sync\r\n");
-      sc = sl_bt_sync_scanner_open(evt->data.evt_scanner_extended_advertisement_report.address,
-                                   evt->data.evt_scanner_extended_advertisement_report.address_type,
-                                   evt->data.evt_scanner_extended_advertisement_report.adv_sid,
-                                   &sync_id);
+      sc = sl_bt_sync_scanner_set_sync_parameters(skip, timeout, sl_bt_sync_report_all);
+      if (SL_STATUS_OK == sc)
+      {
+        sc = sl_bt_sync_scanner_open(report->address, report->address_type, report->adv_sid, &sync_id);
+      }
+      sync_acq_open_result(&report->address, SL_STATUS_OK == sc, sync_id, now);
 
-      app_log_info("cmd_sync_open() sync = 0x%4X\r\n", sc);
+      app_log_info("cmd_sync_open() sync = 0x%4X, timeout %u ms\r\n", sc, timeout * 10);
     }
     break;
+  }
 
   case sl_bt_evt_connection_opened_id:
 
     app_log("Connection opened!\r\n");
 
+    if (bulk_mode)
+    {
+      // 2M PHY for the drain, the collar also asks for it
+      sl_bt_connection_set_preferred_phy(conn_handle, sl_bt_gap_phy_2m, sl_bt_gap_phy_any);
+
+      bulk_service_handle = 0;
+      bulk_ctrl_handle = 0;
+      bulk_data_handle = 0;
+
+      main_state = BULK_FIND_SERVICE;
+
+      sl_bt_gatt_discover_primary_services_by_uuid(conn_handle,
+                                                   16,
+                                                   bulk_serviceUUID);
+      break;
+    }
+
     main_state = FIND_SERVICE;
 
     sl_bt_gatt_discover_primary_services_by_uuid(conn_handle,
@@ -393,7 +2068,22 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
 
   case sl_bt_evt_connection_closed_id:
 
-    sl_bt_scanner_start(sl_bt_gap_1m_phy, sl_bt_scanner_discover_generic);
+    conn_handle = 0xFF;
+
+    if (bulk_mode)
+    {
+      bulk_mode = false;
+      bulk_collar = NULL;
+
+      // back to looking for periodic advertisers and other backlogs
+      scan_poll_ms = 0;
+
+      main_state = DISCONNECTED;
+
+      break;
+    }
+
+    scan_poll_ms = 0;
 
     main_state = SCANNING;
 
@@ -415,6 +2105,11 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
         app_log("Service discovered\r\n");
         service_handle = evt->data.evt_gatt_service.service;
       }
+      else if (memcmp(bulk_serviceUUID, evt->data.evt_gatt_service.uuid.data, 16) == 0)
+      {
+        app_log("Bulk service discovered\r\n");
+        bulk_service_handle = evt->data.evt_gatt_service.service;
+      }
     }
     break;
 
@@ -457,6 +2152,19 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
           app_assert_status(sc);
         }
 
+        if (config_set && config_char_handle > 0)
+        {
+          uint8_t config_data[CS_CONFIG_LEN];
+          uint8_t config_len = cs_config_encode(&collar_config, config_data);
+
+          sc = sl_bt_gatt_write_characteristic_value_without_response(conn_handle, config_char_handle, config_len, config_data, &sent_len);
+          app_log("Collar config written, status 0x%04X\r\n", sc);
+        }
+        else if (config_set)
+        {
+          app_log("Collar has no config characteristic, keeping its defaults\r\n");
+        }
+
         start_timer(&connection_close_timer, 2000, connection_close_callback);
 
         main_state = WRITE_DATA;
@@ -469,11 +2177,64 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
       }
       break;
 
+    case BULK_FIND_SERVICE:
+      if (bulk_service_handle > 0)
+      {
+        sl_bt_gatt_discover_characteristics(conn_handle, bulk_service_handle);
+        main_state = BULK_FIND_CHAR;
+      }
+      else
+      {
+        app_log("Bulk service not found!\r\n");
+        sl_bt_connection_close(conn_handle);
+      }
+      break;
+
+    case BULK_FIND_CHAR:
+      if (bulk_ctrl_handle > 0 && bulk_data_handle > 0)
+      {
+        sl_bt_gatt_set_characteristic_notification(conn_handle, bulk_data_handle, sl_bt_gatt_notification);
+        main_state = BULK_ENABLE_NOTIFY;
+      }
+      else
+      {
+        app_log("Bulk char not found closing connection\r\n");
+        sl_bt_connection_close(conn_handle);
+      }
+      break;
+
+    case BULK_ENABLE_NOTIFY:
+    {
+      // Ask for everything from the oldest window missing onwards
+      uint32_t seq = collar_wanted_seq(bulk_collar);
+      uint8_t offset[4] = {
+        (uint8_t)seq, (uint8_t)(seq >> 8), (uint8_t)(seq >> 16), (uint8_t)(seq >> 24)
+      };
+
+      bulk_windows = 0;
+      bulk_bytes = 0;
+      bulk_frag_len = 0;
+      clock_gettime(CLOCK_MONOTONIC, &bulk_start);
+
+      sl_bt_gatt_write_characteristic_value(conn_handle, bulk_ctrl_handle, sizeof(offset), offset);
+      main_state = BULK_STREAM;
+      break;
+    }
+
     default:
       break;
     }
     break;
 
+  case sl_bt_evt_gatt_characteristic_value_id:
+
+    if (main_state == BULK_STREAM
+        && evt->data.evt_gatt_characteristic_value.characteristic == bulk_data_handle)
+    {
+      process_bulk_notification(&evt->data.evt_gatt_characteristic_value.value);
+    }
+    break;
+
   case sl_bt_evt_gatt_characteristic_id:
     if (evt->data.evt_gatt_characteristic.uuid.len == 16)
     {
@@ -487,20 +2248,45 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
         app_log("Char 2 discovered\r\n");
         char2_handle = evt->data.evt_gatt_characteristic.characteristic;
       }
+      else if (memcmp(config_char_UUID, evt->data.evt_gatt_characteristic.uuid.data, 16) == 0)
+      {
+        app_log("Config char discovered\r\n");
+        config_char_handle = evt->data.evt_gatt_characteristic.characteristic;
+      }
+      else if (memcmp(bulk_ctrl_UUID, evt->data.evt_gatt_characteristic.uuid.data, 16) == 0)
+      {
+        bulk_ctrl_handle = evt->data.evt_gatt_characteristic.characteristic;
+      }
+      else if (memcmp(bulk_data_UUID, evt->data.evt_gatt_characteristic.uuid.data, 16) == 0)
+      {
+        bulk_data_handle = evt->data.evt_gatt_characteristic.characteristic;
+      }
     }
     break;
 
   case sl_bt_evt_periodic_sync_opened_id:
-    /* now that sync is open, we can stop scanning*/
+  {
+    /* the scanner keeps running for the collars still lost */
+    uint64_t lost_ms = sync_acq_opened(evt->data.evt_periodic_sync_opened.sync,
+                                       &evt->data.evt_periodic_sync_opened.address,
+                                       evt->data.evt_periodic_sync_opened.adv_interval, monotonic_ms());
+
     app_log("evt_sync_opened\r\n");
 
     app_log("sync %d, adv_phy: %d , interval: %d \r\n", evt->data.evt_periodic_sync_opened.sync, evt->data.evt_periodic_sync_opened.adv_phy, evt->data.evt_periodic_sync_opened.adv_interval);
+    if (lost_ms > 0)
+    {
+      app_log("sync %d reacquired %llu ms after the loss\r\n", evt->data.evt_periodic_sync_opened.sync,
+              (unsigned long long)lost_ms);
+    }
 
-    sl_bt_scanner_stop();
+    metrics.sync_opens++;
+    scan_poll_ms = 0;
 
     main_state = PA_SYNC;
 
     break;
+  }
 
   case sl_bt_evt_sync_closed_id:
 
@@ -508,13 +2294,25 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
             evt->data.evt_sync_closed.reason,
             evt->data.evt_sync_closed.sync);
 
-    /* restart discovery */
-    sl_bt_scanner_start(sl_bt_scanner_scan_phy_coded,
-                        sl_bt_scanner_discover_observation);
+    metrics_sync_closed(evt->data.evt_sync_closed.reason);
+    sync_acq_closed(evt->data.evt_sync_closed.sync, monotonic_ms());
 
-    main_state = DISCONNECTED;
+    {
+      collar_t *collar = collar_table_find_sync(evt->data.evt_sync_closed.sync);
+      if (collar)
+      {
+        collar->synced = false;
+        collar->sync_losses++;
+        gap_note_sync_lost(collar);
+      }
+      pa_reassembly_reset(&pa_reassembly[evt->data.evt_sync_closed.sync % PA_REASSEMBLY_SLOTS],
+                          evt->data.evt_sync_closed.sync);
+    }
 
-    start_timer(&reprov_timer, 20000, reprov_callback);
+    /* the scanner goes after it at the next poll */
+    scan_poll_ms = 0;
+
+    main_state = DISCONNECTED;
 
     break;
 
@@ -524,6 +2322,21 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
 
     break;
 
+  case sl_bt_evt_pawr_advertiser_subevent_data_request_id:
+
+    for (uint8_t i = 0; i < evt->data.evt_pawr_advertiser_subevent_data_request.subevent_data_count; i++)
+    {
+      pawr_fill_subevent((evt->data.evt_pawr_advertiser_subevent_data_request.subevent_start + i) % CS_PAWR_SUBEVENTS);
+    }
+
+    break;
+
+  case sl_bt_evt_pawr_advertiser_response_report_id:
+
+    pawr_response_report(&evt->data.evt_pawr_advertiser_response_report);
+
+    break;
+
   // -------------------------------
   // Default event handler.
   default:
@@ -533,15 +2346,8 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
 
 void connection_close_callback(union sigval arg)
 {
+  (void)arg;
   // Simulate sl_bt_external_signal(WRITE_DATA);
   conn_close_flag = 1;
 }
 
-void reprov_callback(union sigval arg)
-{
-  // Simulate sl_bt_external_signal(SCANNING);
-  if (main_state == DISCONNECTED)
-  {
-    reprov_flag = 1;
-  }
-}
@@ -0,0 +1,238 @@
+#include <string.h>
+
+#include "collar_table.h"
+
+static collar_t collars[COLLAR_TABLE_SIZE];
+
+// Open addressing, linear probing. Entries are never removed.
+static uint32_t collar_hash(uint16_t cow_id)
+{
+  return ((uint32_t)cow_id * 2654435761u) >> 16;
+}
+
+void collar_table_init(void)
+{
+  memset(collars, 0, sizeof(collars));
+}
+
+static collar_t *collar_table_lookup(uint16_t cow_id, bool insert)
+{
+  uint32_t idx = collar_hash(cow_id) & (COLLAR_TABLE_SIZE - 1);
+
+  for (uint32_t n = 0; n < COLLAR_TABLE_SIZE; n++)
+  {
+    collar_t *c = &collars[idx];
+
+    if (!c->in_use)
+    {
+      if (!insert)
+      {
+        return NULL;
+      }
+      c->in_use = true;
+      c->cow_id = cow_id;
+      return c;
+    }
+    if (c->cow_id == cow_id)
+    {
+      return c;
+    }
+    idx = (idx + 1) & (COLLAR_TABLE_SIZE - 1);
+  }
+  return NULL;
+}
+
+collar_t *collar_table_get(uint16_t cow_id)
+{
+  return collar_table_lookup(cow_id, true);
+}
+
+collar_t *collar_table_find(uint16_t cow_id)
+{
+  return collar_table_lookup(cow_id, false);
+}
+
+collar_t *collar_table_find_sync(uint16_t sync_handle)
+{
+  for (uint32_t i = 0; i < COLLAR_TABLE_SIZE; i++)
+  {
+    if (collars[i].in_use && collars[i].synced && collars[i].sync_handle == sync_handle)
+    {
+      return &collars[i];
+    }
+  }
+  return NULL;
+}
+
+collar_t *collar_table_next(collar_t *collar)
+{
+  uint32_t i = (collar == NULL) ? 0 : (uint32_t)(collar - collars) + 1;
+
+  for (; i < COLLAR_TABLE_SIZE; i++)
+  {
+    if (collars[i].in_use)
+    {
+      return &collars[i];
+    }
+  }
+  return NULL;
+}
+
+bool collar_set_session(collar_t *collar, uint8_t session)
+{
+  if (collar->have_session && collar->session == session)
+  {
+    return false;
+  }
+  collar->have_session = true;
+  collar->session = session;
+  collar_restart_seq(collar);
+  return true;
+}
+
+void collar_restart_seq(collar_t *collar)
+{
+  collar->have_seq = false;
+  collar->resume_seq = 0;
+  collar->seen_mask = 0;
+  collar->hole_seq = 0;
+  collar->hole_end = 0;
+}
+
+bool collar_seq_restarted(const collar_t *collar, uint32_t seq)
+{
+  return collar->have_seq && (seq + COLLAR_SEQ_RESTART < collar->resume_seq);
+}
+
+uint32_t collar_unwrap_seq(const collar_t *collar, uint16_t seq16)
+{
+  uint32_t seq = (collar->resume_seq & 0xFFFF0000u) | seq16;
+
+  if (seq + 0x8000u < collar->resume_seq)
+  {
+    seq += 0x10000u;
+  }
+  else if (seq > collar->resume_seq + 0x8000u && seq >= 0x10000u)
+  {
+    seq -= 0x10000u;
+  }
+  return seq;
+}
+
+// Windows from up to to were never received: extend the hole with them,
+// or count them missed.
+static void collar_miss(collar_t *collar, uint32_t from, uint32_t to)
+{
+  if (collar->hole_seq >= collar->hole_end)
+  {
+    collar->hole_seq = from;
+    collar->hole_end = to;
+  }
+  else if (collar->hole_end == from)
+  {
+    collar->hole_end = to;
+  }
+  else
+  {
+    collar->seq_missed += to - from;
+  }
+}
+
+// Move the start of the remembered windows on to seq.
+static void collar_slide(collar_t *collar, uint32_t seq)
+{
+  while (collar->resume_seq < seq && collar->seen_mask)
+  {
+    if (!(collar->seen_mask & 1))
+    {
+      collar_miss(collar, collar->resume_seq, collar->resume_seq + 1);
+    }
+    collar->seen_mask >>= 1;
+    collar->resume_seq++;
+  }
+  if (collar->resume_seq < seq)
+  {
+    collar_miss(collar, collar->resume_seq, seq);
+    collar->resume_seq = seq;
+  }
+}
+
+bool collar_mark_seq(collar_t *collar, uint32_t seq)
+{
+  uint32_t d;
+
+  if (!collar->have_seq)
+  {
+    collar->have_seq = true;
+    collar->resume_seq = seq;
+    collar->seen_mask = 0;
+    collar->hole_seq = 0;
+    collar->hole_end = seq;
+  }
+
+  if (seq < collar->resume_seq)
+  {
+    if (seq >= collar->hole_seq && seq < collar->hole_end)
+    {
+      // Bulk transfer sends the hole oldest first
+      collar->hole_seq = seq + 1;
+      return true;
+    }
+    return false;
+  }
+
+  d = seq - collar->resume_seq;
+  if (d >= 64)
+  {
+    collar_slide(collar, seq - 63);
+    d = 63;
+  }
+  if (collar->seen_mask & (1ull << d))
+  {
+    return false;
+  }
+
+  collar->seen_mask |= 1ull << d;
+  while (collar->seen_mask & 1)
+  {
+    collar->seen_mask >>= 1;
+    collar->resume_seq++;
+  }
+  return true;
+}
+
+void collar_skip_to(collar_t *collar, uint32_t seq)
+{
+  if (!collar->have_seq)
+  {
+    collar->have_seq = true;
+    collar->resume_seq = seq;
+    collar->seen_mask = 0;
+    collar->hole_seq = seq;
+    collar->hole_end = seq;
+    return;
+  }
+  if (collar->hole_seq < seq)
+  {
+    collar->hole_seq = seq;
+  }
+  while (collar->resume_seq < seq && collar->seen_mask)
+  {
+    collar->seen_mask >>= 1;
+    collar->resume_seq++;
+  }
+  if (collar->resume_seq < seq)
+  {
+    collar->resume_seq = seq;
+  }
+  while (collar->seen_mask & 1)
+  {
+    collar->seen_mask >>= 1;
+    collar->resume_seq++;
+  }
+}
+
+uint32_t collar_wanted_seq(const collar_t *collar)
+{
+  return (collar->hole_seq < collar->hole_end) ? collar->hole_seq : collar->resume_seq;
+}
@@ -0,0 +1,175 @@
+#ifndef COLLAR_TABLE_H
+#define COLLAR_TABLE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Windows the rolling loss rate of a collar looks back over
+#define GAP_RECENT_WINDOWS 64
+
+// A live window this far behind the windows logged is a collar that restarted
+// its sequence with the same session byte
+#define COLLAR_SEQ_RESTART 64
+
+// Alert rules evaluated per collar, and the report metrics they test
+#define ALERT_MAX_RULES 32
+#define ALERT_METRICS 4
+
+// Number of collars the gateway can track (power of two), room for a
+// 10,000 head herd at a load factor below 2/3.
+#define COLLAR_TABLE_SIZE 16384
+
+/**
+ * Windows a collar sent against those received over periodic advertising,
+ * by the cause of each gap (see gap_tracker.h).
+ */
+typedef struct collar_gaps
+{
+  bool started;             // a window has been received
+  bool sync_lost;           // the sync closed since the last window
+  bool reset;               // a new session began since the last window
+  uint8_t recent_len;       // windows tracked in recent, up to GAP_RECENT_WINDOWS
+  uint32_t last_seq;        // newest window received over periodic advertising
+  uint64_t recent;          // bit i: window last_seq - i was received
+  uint64_t recent_sync;     // bit i: it was missed across a sync loss
+  uint64_t recent_reset;    // bit i: it was missed before a reset was heard
+  uint32_t received;        // windows received over periodic advertising
+  uint32_t lost_radio;      // windows missed while synced
+  uint32_t lost_sync;       // windows missed across a sync loss
+  uint32_t lost_reset;      // windows of a new session sent before it was heard
+  uint32_t bulk;            // windows received over bulk transfer
+  uint16_t resets;          // sessions after the first
+} collar_gaps_t;
+
+/**
+ * Incremental state of the alert rules for one collar (see alert_rules.h).
+ */
+typedef struct collar_alerts
+{
+  float baseline[ALERT_METRICS];    // mean of each metric over the baseline period
+  float baseline_s;                 // time the baseline covers, up to ALERT_BASELINE_S
+  uint64_t last_ms;                 // time of the last report, 0 before the first
+  uint32_t fired;                   // bit i: rule i raised its alert and has not cleared
+  uint16_t run[ALERT_MAX_RULES];    // reports in a row the condition of rule i held
+} collar_alerts_t;
+
+/**
+ * Per-collar state kept by the host, keyed by cow ID.
+ */
+typedef struct collar
+{
+  uint16_t cow_id;
+  bool in_use;
+  bool synced;              // periodic sync currently open
+  uint16_t sync_handle;
+
+  // Window sequence tracking (v1 payloads)
+  bool have_session;
+  uint8_t session;          // changes when the collar reboots
+  bool have_seq;            // a window of the session has been seen
+  uint32_t resume_seq;      // every window before this one was logged, missed or is in the hole
+  uint64_t seen_mask;       // bit i: window resume_seq + i has been logged
+  uint32_t hole_seq;        // windows from hole_seq up to hole_end were missed and
+  uint32_t hole_end;        // are left for bulk transfer to fetch
+  uint32_t seq_missed;      // windows missed for good: neither logged nor in the hole
+  uint8_t rate_shift;       // sample period of the last window: imu period << shift
+
+  // Last PAwR response from the collar
+  bool responded;
+  int8_t pawr_rssi;
+  uint8_t battery;
+  uint8_t redundancy;       // periodic advertising redundancy in use
+  uint32_t first_seq;       // oldest window stored on the collar
+  uint32_t next_seq;        // next window sequence number on the collar
+
+  // Link control: periodic report RSSI and the collar's link level
+  int16_t rssi_q4;          // RSSI average, 1/16 dBm
+  uint16_t rssi_reports;    // reports averaged at the current level
+  bool link_known;          // collar reports its link level
+  uint8_t link_level;       // index into cs_link_levels
+
+  // Metrics since the host started
+  uint32_t reports;         // periodic reports decoded
+  uint32_t duplicates;      // windows dropped as already logged
+  uint16_t sync_losses;     // periodic syncs closed
+
+  collar_gaps_t gaps;
+  collar_alerts_t alerts;
+} collar_t;
+
+/**
+ * Clear the table.
+ */
+void collar_table_init(void);
+
+/**
+ * Look up a collar by cow ID, adding it if it is not known yet.
+ * Returns NULL when the table is full.
+ */
+collar_t *collar_table_get(uint16_t cow_id);
+
+/**
+ * Look up a collar by cow ID without adding it.
+ */
+collar_t *collar_table_find(uint16_t cow_id);
+
+/**
+ * Note the boot session of a collar's payload. A new session means the
+ * collar restarted and its sequence numbers start again from zero.
+ * Returns true if the session changed.
+ */
+bool collar_set_session(collar_t *collar, uint8_t session);
+
+/**
+ * The collar restarted: its sequence numbers start again from zero.
+ */
+void collar_restart_seq(collar_t *collar);
+
+/**
+ * True if seq, a collar's newest window, is far enough behind the windows
+ * already logged that the collar must have restarted (COLLAR_SEQ_RESTART):
+ * the session byte matches after a reset one time in 256.
+ */
+bool collar_seq_restarted(const collar_t *collar, uint32_t seq);
+
+/**
+ * Extend a 16-bit payload sequence number to the collar's 32-bit sequence,
+ * picking the value closest to resume_seq.
+ */
+uint32_t collar_unwrap_seq(const collar_t *collar, uint16_t seq16);
+
+/**
+ * Record that a window has been received. Returns false if it was already
+ * logged (duplicate), true if it is new.
+ *
+ * The first window of a session starts the sequence, the windows before it
+ * are left to bulk transfer. The last 64 windows are remembered: a window
+ * further ahead slides them on, and those of them never received join the
+ * hole if they follow on from it, or are missed for good.
+ */
+bool collar_mark_seq(collar_t *collar, uint32_t seq);
+
+/**
+ * Everything before seq has been dealt with (e.g. end of a bulk drain, or
+ * windows the collar no longer stores).
+ */
+void collar_skip_to(collar_t *collar, uint32_t seq);
+
+/**
+ * Oldest window the host still wants from the collar: the start of the
+ * hole, else resume_seq. The collar may drop the windows before it.
+ */
+uint32_t collar_wanted_seq(const collar_t *collar);
+
+/**
+ * Look up the collar currently synced on the given periodic sync handle.
+ */
+collar_t *collar_table_find_sync(uint16_t sync_handle);
+
+/**
+ * Walk the known collars: the first with NULL, then the one after collar.
+ * Returns NULL after the last one.
+ */
+collar_t *collar_table_next(collar_t *collar);
+
+#endif // COLLAR_TABLE_H
@@ -0,0 +1,450 @@
+#include <stdlib.h>
+#include <string.h>
+
+#include "delta_diff.h"
+
+// A match is taken once it beats extending the last one by this many bytes
+#define DIFF_MIN_GAIN 8
+
+typedef struct out_buf
+{
+  uint8_t *data;
+  size_t len;
+  size_t size;
+  bool failed;
+} out_buf_t;
+
+static void out_reserve(out_buf_t *out, size_t n)
+{
+  size_t size = out->size ? out->size : 4096;
+  uint8_t *data;
+
+  if (out->failed || (out->len + n <= out->size))
+  {
+    return;
+  }
+  while (size < out->len + n)
+  {
+    size *= 2;
+  }
+  data = realloc(out->data, size);
+  if (data == NULL)
+  {
+    out->failed = true;
+    return;
+  }
+  out->data = data;
+  out->size = size;
+}
+
+static void out_bytes(out_buf_t *out, const uint8_t *data, size_t n)
+{
+  out_reserve(out, n);
+  if (!out->failed)
+  {
+    memcpy(&out->data[out->len], data, n);
+    out->len += n;
+  }
+}
+
+static void out_varint(out_buf_t *out, uint32_t v)
+{
+  uint8_t buf[5];
+  size_t n = 0;
+
+  do
+  {
+    buf[n] = v & 0x7F;
+    v >>= 7;
+    if (v)
+    {
+      buf[n] |= 0x80;
+    }
+    n++;
+  } while (v);
+  out_bytes(out, buf, n);
+}
+
+/*
+ * Suffix array by prefix doubling: suffixes are ranked by their first k
+ * bytes, then by the rank pairs at i and i + k with two counting sorts.
+ * O(n log n), and runs of erased flash (0xFF) do not slow it down.
+ */
+static int32_t *suffix_array(const uint8_t *s, int32_t n)
+{
+  int32_t *sa = malloc(sizeof(int32_t) * (n + 1));
+  int32_t *rank = malloc(sizeof(int32_t) * (n + 1));
+  int32_t *next = malloc(sizeof(int32_t) * (n + 1));
+  int32_t *tmp = malloc(sizeof(int32_t) * (n + 1));
+  int32_t *count = malloc(sizeof(int32_t) * ((n > 256) ? n + 1 : 257));
+  int32_t classes = 256;
+
+  if (!sa || !rank || !next || !tmp || !count)
+  {
+    free(sa);
+    sa = NULL;
+    goto done;
+  }
+
+  memset(count, 0, sizeof(int32_t) * 257);
+  for (int32_t i = 0; i < n; i++)
+  {
+    rank[i] = s[i];
+    count[s[i] + 1]++;
+  }
+  for (int32_t c = 1; c <= 256; c++)
+  {
+    count[c] += count[c - 1];
+  }
+  for (int32_t i = 0; i < n; i++)
+  {
+    sa[count[s[i]]++] = i;
+  }
+
+  for (int32_t k = 1; k < n; k <<= 1)
+  {
+    int32_t p = 0;
+
+    // by second key: suffixes without one first, then in the order of the
+    // suffixes k further on
+    for (int32_t i = n - k; i < n; i++)
+    {
+      tmp[p++] = i;
+    }
+    for (int32_t j = 0; j < n; j++)
+    {
+      if (sa[j] >= k)
+      {
+        tmp[p++] = sa[j] - k;
+      }
+    }
+
+    // stable by first key
+    memset(count, 0, sizeof(int32_t) * (classes + 1));
+    for (int32_t i = 0; i < n; i++)
+    {
+      count[rank[i] + 1]++;
+    }
+    for (int32_t c = 1; c <= classes; c++)
+    {
+      count[c] += count[c - 1];
+    }
+    for (int32_t j = 0; j < n; j++)
+    {
+      sa[count[rank[tmp[j]]]++] = tmp[j];
+    }
+
+    next[sa[0]] = 0;
+    for (int32_t i = 1; i < n; i++)
+    {
+      int32_t a = sa[i - 1];
+      int32_t b = sa[i];
+      int32_t ka = (a + k < n) ? rank[a + k] : -1;
+      int32_t kb = (b + k < n) ? rank[b + k] : -1;
+
+      next[b] = next[a] + ((rank[a] != rank[b]) || (ka != kb));
+    }
+    memcpy(rank, next, sizeof(int32_t) * n);
+    classes = rank[sa[n - 1]] + 1;
+    if (classes == n)
+    {
+      break;
+    }
+  }
+
+done:
+  free(rank);
+  free(next);
+  free(tmp);
+  free(count);
+  return sa;
+}
+
+static uint32_t match_len(const uint8_t *a, uint32_t a_len, const uint8_t *b, uint32_t b_len)
+{
+  uint32_t i = 0;
+
+  while ((i < a_len) && (i < b_len) && (a[i] == b[i]))
+  {
+    i++;
+  }
+  return i;
+}
+
+// Longest match of new_image in base, by binary search of the suffix array
+static uint32_t search(const int32_t *sa, const uint8_t *base, uint32_t base_len,
+                       const uint8_t *new_image, uint32_t new_len, uint32_t *pos)
+{
+  uint32_t st = 0;
+  uint32_t en = base_len - 1;
+  uint32_t x;
+  uint32_t y;
+
+  while (en - st >= 2)
+  {
+    uint32_t mid = st + (en - st) / 2;
+    uint32_t tail = base_len - sa[mid];
+
+    if (memcmp(&base[sa[mid]], new_image, (tail < new_len) ? tail : new_len) < 0)
+    {
+      st = mid;
+    }
+    else
+    {
+      en = mid;
+    }
+  }
+
+  x = match_len(&base[sa[st]], base_len - sa[st], new_image, new_len);
+  y = match_len(&base[sa[en]], base_len - sa[en], new_image, new_len);
+  if (x > y)
+  {
+    *pos = sa[st];
+    return x;
+  }
+  *pos = sa[en];
+  return y;
+}
+
+// The copy of a block: runs of zero differences and of literal differences
+static void out_copy(out_buf_t *out, const uint8_t *base, const uint8_t *new_image, uint32_t n)
+{
+  uint32_t i = 0;
+
+  while (i < n)
+  {
+    uint32_t zeros = 0;
+    uint32_t j;
+
+    while ((i + zeros < n) && (new_image[i + zeros] == base[i + zeros]))
+    {
+      zeros++;
+    }
+    out_varint(out, zeros);
+    i += zeros;
+    if (i == n)
+    {
+      break;
+    }
+
+    // literals, through short zero gaps that would cost more as runs
+    j = i;
+    while (j < n)
+    {
+      uint32_t gap = 0;
+
+      if (new_image[j] != base[j])
+      {
+        j++;
+        continue;
+      }
+      while ((j + gap < n) && (new_image[j + gap] == base[j + gap]))
+      {
+        gap++;
+      }
+      if ((j + gap == n) || (gap > DELTA_DIFF_ZERO_GAP))
+      {
+        break;
+      }
+      j += gap;
+    }
+
+    out_varint(out, j - i);
+    out_reserve(out, j - i);
+    if (out->failed)
+    {
+      return;
+    }
+    for (uint32_t k = i; k < j; k++)
+    {
+      out->data[out->len++] = (uint8_t)(new_image[k] - base[k]);
+    }
+    i = j;
+  }
+}
+
+static void out_block(out_buf_t *out, const uint8_t *base, uint32_t base_pos, const uint8_t *new_image,
+                      uint32_t new_pos, uint32_t copy, uint32_t extra, int32_t seek)
+{
+  out_varint(out, copy);
+  out_varint(out, extra);
+  out_varint(out, ((uint32_t)seek << 1) ^ (uint32_t)(seek >> 31));
+  out_copy(out, &base[base_pos], &new_image[new_pos], copy);
+  out_bytes(out, &new_image[new_pos + copy], extra);
+}
+
+/*
+ * The matching of bsdiff 4: scan the new image for a match in the base
+ * that does better than carrying on with the last one, then split the
+ * bytes between the two into the last match extended forwards, new bytes,
+ * and the new match extended backwards.
+ */
+static void diff_blocks(out_buf_t *out, const int32_t *sa, const uint8_t *base, uint32_t base_len,
+                        const uint8_t *new_image, uint32_t new_len)
+{
+  uint32_t scan = 0;
+  uint32_t len = 0;
+  uint32_t pos = 0;
+  uint32_t last_scan = 0;
+  uint32_t last_pos = 0;
+  int64_t last_offset = 0;
+
+  while (scan < new_len)
+  {
+    uint32_t old_score = 0;
+    uint32_t scsc;
+
+    for (scsc = scan += len; scan < new_len; scan++)
+    {
+      len = search(sa, base, base_len, &new_image[scan], new_len - scan, &pos);
+
+      for (; scsc < scan + len; scsc++)
+      {
+        if ((scsc + last_offset < base_len) && (base[scsc + last_offset] == new_image[scsc]))
+        {
+          old_score++;
+        }
+      }
+      if (((len == old_score) && (len != 0)) || (len > old_score + DIFF_MIN_GAIN))
+      {
+        break;
+      }
+      if ((scan + last_offset < base_len) && (base[scan + last_offset] == new_image[scan]))
+      {
+        old_score--;
+      }
+    }
+
+    if ((len != old_score) || (scan == new_len))
+    {
+      int64_t s = 0;
+      int64_t best = 0;
+      uint32_t len_f = 0;
+      uint32_t len_b = 0;
+
+      for (uint32_t i = 0; (last_scan + i < scan) && (last_pos + i < base_len);)
+      {
+        if (base[last_pos + i] == new_image[last_scan + i])
+        {
+          s++;
+        }
+        i++;
+        if (s * 2 - i > best * 2 - len_f)
+        {
+          best = s;
+          len_f = i;
+        }
+      }
+
+      if (scan < new_len)
+      {
+        s = 0;
+        best = 0;
+        for (uint32_t i = 1; (scan >= last_scan + i) && (pos >= i); i++)
+        {
+          if (base[pos - i] == new_image[scan - i])
+          {
+            s++;
+          }
+          if (s * 2 - i > best * 2 - len_b)
+          {
+            best = s;
+            len_b = i;
+          }
+        }
+      }
+
+      // the two extensions overlap: split where the most bytes match
+      if (last_scan + len_f > scan - len_b)
+      {
+        uint32_t overlap = (last_scan + len_f) - (scan - len_b);
+        uint32_t len_s = 0;
+
+        s = 0;
+        best = 0;
+        for (uint32_t i = 0; i < overlap; i++)
+        {
+          if (new_image[last_scan + len_f - overlap + i] == base[last_pos + len_f - overlap + i])
+          {
+            s++;
+          }
+          if (new_image[scan - len_b + i] == base[pos - len_b + i])
+          {
+            s--;
+          }
+          if (s > best)
+          {
+            best = s;
+            len_s = i + 1;
+          }
+        }
+        len_f += len_s - overlap;
+        len_b -= len_s;
+      }
+
+      out_block(out, base, last_pos, new_image, last_scan, len_f, (scan - len_b) - (last_scan + len_f),
+                (int32_t)((int64_t)(pos - len_b) - (int64_t)(last_pos + len_f)));
+
+      last_scan = scan - len_b;
+      last_pos = pos - len_b;
+      last_offset = (int64_t)pos - scan;
+    }
+  }
+}
+
+size_t delta_diff(const uint8_t *base, uint32_t base_len, uint32_t base_addr,
+                  const uint8_t *new_image, uint32_t new_len, uint8_t **patch)
+{
+  out_buf_t out = { NULL, 0, 0, false };
+  cs_delta_header_t header;
+  int32_t *sa = NULL;
+
+  *patch = NULL;
+  out_reserve(&out, CS_DELTA_HEADER_LEN);
+  out.len = CS_DELTA_HEADER_LEN;
+
+  if (base_len > 0)
+  {
+    sa = suffix_array(base, (int32_t)base_len);
+    if (sa == NULL)
+    {
+      free(out.data);
+      return 0;
+    }
+    diff_blocks(&out, sa, base, base_len, new_image, new_len);
+    free(sa);
+  }
+  else
+  {
+    out_block(&out, base, 0, new_image, 0, 0, new_len, 0);
+  }
+  if (out.failed)
+  {
+    free(out.data);
+    return 0;
+  }
+
+  header.base_addr = base_addr;
+  header.base_len = base_len;
+  header.base_crc = cs_delta_crc32(CS_DELTA_CRC32_INIT, base, base_len) ^ CS_DELTA_CRC32_INIT;
+  header.new_len = new_len;
+  header.new_crc = cs_delta_crc32(CS_DELTA_CRC32_INIT, new_image, new_len) ^ CS_DELTA_CRC32_INIT;
+  header.body_len = (uint32_t)(out.len - CS_DELTA_HEADER_LEN);
+  header.body_crc = cs_delta_crc32(CS_DELTA_CRC32_INIT, &out.data[CS_DELTA_HEADER_LEN], header.body_len)
+                    ^ CS_DELTA_CRC32_INIT;
+  cs_delta_header_encode(&header, out.data);
+
+  *patch = out.data;
+  return out.len;
+}
+
+bool delta_check(const uint8_t *patch, size_t len, cs_delta_header_t *header)
+{
+  if (!cs_delta_header_decode(patch, (len > UINT16_MAX) ? UINT16_MAX : (uint16_t)len, header)
+      || (len != CS_DELTA_HEADER_LEN + (size_t)header->body_len))
+  {
+    return false;
+  }
+  return (cs_delta_crc32(CS_DELTA_CRC32_INIT, &patch[CS_DELTA_HEADER_LEN], header->body_len)
+          ^ CS_DELTA_CRC32_INIT) == header->body_crc;
+}
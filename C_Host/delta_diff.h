@@ -0,0 +1,41 @@
+#ifndef DELTA_DIFF_H
+#define DELTA_DIFF_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#include "cs_delta.h"
+
+/*
+ * Delta patch generator: makes the patch (Common/inc/cs_delta.h) that
+ * rebuilds a new firmware image from the base image a collar runs.
+ *
+ * Matches are found with a suffix array of the base image and extended
+ * both ways while more than half the bytes agree, as bsdiff does, so code
+ * that moved or had its addresses shifted becomes a copy with a few
+ * literal differences rather than new bytes. The new image is normally
+ * the GBL file written to the bootloader storage slot: its program data is
+ * the application binary, which the base (the application in flash) has
+ * most of.
+ */
+
+// Differences in a copy that are worth more as literals than a new zero
+// run: a zero run and a literal run cost two varints
+#define DELTA_DIFF_ZERO_GAP 2
+
+/**
+ * Make the patch turning base (at base_addr in collar flash) into new.
+ * The patch, header first, is malloc'd into *patch. Returns its length,
+ * 0 if out of memory.
+ */
+size_t delta_diff(const uint8_t *base, uint32_t base_len, uint32_t base_addr,
+                  const uint8_t *new_image, uint32_t new_len, uint8_t **patch);
+
+/**
+ * Read the header of a patch and check its body CRC. False if it is not a
+ * whole patch.
+ */
+bool delta_check(const uint8_t *patch, size_t len, cs_delta_header_t *header);
+
+#endif // DELTA_DIFF_H
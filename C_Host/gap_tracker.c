@@ -0,0 +1,153 @@
+#include "gap_tracker.h"
+
+uint8_t gap_note_window(collar_t *collar, uint32_t seq, uint32_t *missed)
+{
+  collar_gaps_t *g = &collar->gaps;
+  uint8_t cause = GAP_NONE;
+  uint32_t gap = 0;
+  uint64_t gap_bits;
+
+  *missed = 0;
+
+  if (!g->started)
+  {
+    // Nothing was expected before the first window
+    g->started = true;
+  }
+  else if (g->reset)
+  {
+    // The new session numbers its windows from 0
+    gap = seq;
+    cause = (gap > 0) ? GAP_RESET : GAP_NONE;
+    g->lost_reset += gap;
+  }
+  else if (seq <= g->last_seq)
+  {
+    // Late: it was counted as missed, under the cause of its gap, when a
+    // newer window came in. One further back than the windows tracked would
+    // have restarted the sequence (COLLAR_SEQ_RESTART).
+    uint64_t bit = (g->last_seq - seq < g->recent_len) ? (1ULL << (g->last_seq - seq)) : 0;
+
+    if (bit && !(g->recent & bit))
+    {
+      if (g->recent_reset & bit)
+      {
+        g->lost_reset--;
+      }
+      else if (g->recent_sync & bit)
+      {
+        g->lost_sync--;
+      }
+      else
+      {
+        g->lost_radio--;
+      }
+      g->recent |= bit;
+      g->recent_sync &= ~bit;
+      g->recent_reset &= ~bit;
+    }
+    g->received++;
+    return GAP_NONE;
+  }
+  else
+  {
+    gap = seq - g->last_seq - 1;
+    if (gap > 0)
+    {
+      cause = g->sync_lost ? GAP_SYNC : GAP_RADIO;
+      if (cause == GAP_SYNC)
+      {
+        g->lost_sync += gap;
+      }
+      else
+      {
+        g->lost_radio += gap;
+      }
+    }
+  }
+
+  if (gap + 1 >= GAP_RECENT_WINDOWS)
+  {
+    g->recent = 1;
+    g->recent_sync = 0;
+    g->recent_reset = 0;
+    g->recent_len = GAP_RECENT_WINDOWS;
+    gap_bits = UINT64_MAX << 1;
+  }
+  else
+  {
+    g->recent = (g->recent << (gap + 1)) | 1;
+    g->recent_sync <<= gap + 1;
+    g->recent_reset <<= gap + 1;
+    g->recent_len = (g->recent_len + gap + 1 > GAP_RECENT_WINDOWS) ? GAP_RECENT_WINDOWS
+                                                                    : (uint8_t)(g->recent_len + gap + 1);
+    gap_bits = ((1ULL << gap) - 1) << 1;
+  }
+  if (cause == GAP_SYNC)
+  {
+    g->recent_sync |= gap_bits;
+  }
+  else if (cause == GAP_RESET)
+  {
+    g->recent_reset |= gap_bits;
+  }
+
+  g->last_seq = seq;
+  g->received++;
+  g->sync_lost = false;
+  g->reset = false;
+
+  *missed = gap;
+  return cause;
+}
+
+void gap_note_reset(collar_t *collar)
+{
+  // The first session of a collar is no reset, and one seen twice (a PAwR
+  // response, then the window) is one reset
+  if (collar->gaps.started && !collar->gaps.reset)
+  {
+    collar->gaps.reset = true;
+    collar->gaps.resets++;
+  }
+}
+
+void gap_note_sync_lost(collar_t *collar)
+{
+  collar->gaps.sync_lost = true;
+}
+
+void gap_note_bulk(collar_t *collar)
+{
+  collar->gaps.bulk++;
+}
+
+uint16_t gap_recent_loss(const collar_t *collar)
+{
+  const collar_gaps_t *g = &collar->gaps;
+  uint64_t mask;
+  uint8_t missed;
+
+  if (g->recent_len == 0)
+  {
+    return 0;
+  }
+  mask = (g->recent_len == GAP_RECENT_WINDOWS) ? UINT64_MAX : ((1ULL << g->recent_len) - 1);
+  missed = g->recent_len - (uint8_t)__builtin_popcountll(g->recent & mask);
+  return (uint16_t)(missed * 1000u / g->recent_len);
+}
+
+const char *gap_cause_name(uint8_t cause)
+{
+  switch (cause)
+  {
+  case GAP_RADIO:
+    return "radio";
+  case GAP_SYNC:
+    return "sync";
+  case GAP_RESET:
+    return "reset";
+  default:
+    return "none";
+  }
+}
@@ -0,0 +1,50 @@
+#ifndef GAP_TRACKER_H
+#define GAP_TRACKER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "collar_table.h"
+
+// Cause of the windows missing before a received one
+#define GAP_NONE  0
+#define GAP_RADIO 1   // reports missed while the sync was up
+#define GAP_SYNC  2   // the sync was lost in between
+#define GAP_RESET 3   // the collar restarted, its sequence began again
+
+/**
+ * Note a new window (not a duplicate) received over periodic advertising,
+ * seq being its 32-bit sequence number. Returns the cause of the gap before
+ * it and stores the number of windows missed in *missed. A window older
+ * than the newest one received was counted as missed: it is taken off the
+ * count for the cause of its gap.
+ */
+uint8_t gap_note_window(collar_t *collar, uint32_t seq, uint32_t *missed);
+
+/**
+ * The collar started a new session: its next window opens a new sequence.
+ */
+void gap_note_reset(collar_t *collar);
+
+/**
+ * The periodic sync with the collar closed.
+ */
+void gap_note_sync_lost(collar_t *collar);
+
+/**
+ * A window came in over bulk transfer instead of periodic advertising.
+ */
+void gap_note_bulk(collar_t *collar);
+
+/**
+ * Windows missed among the last GAP_RECENT_WINDOWS the collar sent, in
+ * 1/1000. 0 until a window has been received.
+ */
+uint16_t gap_recent_loss(const collar_t *collar);
+
+/**
+ * Name of a gap cause for logs and metrics.
+ */
+const char *gap_cause_name(uint8_t cause);
+
+#endif // GAP_TRACKER_H
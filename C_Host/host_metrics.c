@@ -0,0 +1,231 @@
+#include <stdio.h>
+
+#include "host_metrics.h"
+#include "collar_table.h"
+#include "gap_tracker.h"
+#include "sync_acquire.h"
+
+// Prefix of every metric name
+#define METRICS_PREFIX "cow_collar_"
+
+host_metrics_t metrics;
+
+static const char *metrics_path = NULL;
+static time_t metrics_next_s;
+
+// Coarse clock: a few ns to read, ms resolution is plenty for the period
+static time_t metrics_seconds(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return ts.tv_sec;
+}
+
+void metrics_init(const char *path)
+{
+  metrics_path = path;
+  metrics_next_s = metrics_seconds() + METRICS_PERIOD_S;
+}
+
+void metrics_poll(void)
+{
+  if (metrics_path == NULL || metrics_seconds() < metrics_next_s)
+  {
+    return;
+  }
+  metrics_next_s += METRICS_PERIOD_S;
+  metrics_export();
+}
+
+void metrics_sync_closed(uint16_t reason)
+{
+  for (uint8_t i = 0; i < metrics.close_reasons; i++)
+  {
+    if (metrics.close_reason[i] == reason)
+    {
+      metrics.close_count[i]++;
+      return;
+    }
+  }
+  if (metrics.close_reasons < METRICS_CLOSE_REASONS)
+  {
+    metrics.close_reason[metrics.close_reasons] = reason;
+    metrics.close_count[metrics.close_reasons++] = 1;
+    return;
+  }
+  metrics.close_other++;
+}
+
+static void write_counter(FILE *f, const char *name, const char *help, uint64_t value)
+{
+  fprintf(f, "# HELP " METRICS_PREFIX "%s %s\n", name, help);
+  fprintf(f, "# TYPE " METRICS_PREFIX "%s counter\n", name);
+  fprintf(f, METRICS_PREFIX "%s %llu\n", name, (unsigned long long)value);
+}
+
+static void write_time_hist(FILE *f, const char *name, const char *help, const metrics_hist_t *hist)
+{
+  uint64_t cumulative = 0;
+
+  fprintf(f, "# HELP " METRICS_PREFIX "%s %s\n", name, help);
+  fprintf(f, "# TYPE " METRICS_PREFIX "%s histogram\n", name);
+  for (int i = 0; i < METRICS_TIME_BUCKETS; i++)
+  {
+    cumulative += hist->bucket[i];
+    fprintf(f, METRICS_PREFIX "%s_bucket{le=\"%g\"} %llu\n", name,
+            (double)(1ULL << (i + METRICS_TIME_MIN_SHIFT)) / 1e9, (unsigned long long)cumulative);
+  }
+  fprintf(f, METRICS_PREFIX "%s_bucket{le=\"+Inf\"} %llu\n", name, (unsigned long long)hist->count);
+  fprintf(f, METRICS_PREFIX "%s_sum %.9f\n", name, hist->sum_ns / 1e9);
+  fprintf(f, METRICS_PREFIX "%s_count %llu\n", name, (unsigned long long)hist->count);
+}
+
+static void write_metrics(FILE *f)
+{
+  uint64_t cumulative = 0;
+  collar_t *c;
+
+  write_counter(f, "events_total", "BGAPI events handled.", metrics.events);
+  write_counter(f, "reports_total", "Periodic sync reports decoded into a window.", metrics.reports);
+  write_counter(f, "bulk_windows_total", "Windows received over bulk transfer.", metrics.bulk_windows);
+  write_counter(f, "duplicates_total", "Windows dropped as already logged.", metrics.duplicates);
+  write_counter(f, "decode_errors_total", "Reports that did not decode.", metrics.decode_errors);
+  write_counter(f, "truncated_chains_total", "Periodic advertising chains cut short.", metrics.truncated);
+  write_counter(f, "sync_opens_total", "Periodic syncs opened.", metrics.sync_opens);
+
+  fprintf(f, "# HELP " METRICS_PREFIX "sync_closes_total Periodic syncs closed, by reason.\n");
+  fprintf(f, "# TYPE " METRICS_PREFIX "sync_closes_total counter\n");
+  for (uint8_t i = 0; i < metrics.close_reasons; i++)
+  {
+    fprintf(f, METRICS_PREFIX "sync_closes_total{reason=\"0x%04X\"} %llu\n",
+            metrics.close_reason[i], (unsigned long long)metrics.close_count[i]);
+  }
+  fprintf(f, METRICS_PREFIX "sync_closes_total{reason=\"other\"} %llu\n",
+          (unsigned long long)metrics.close_other);
+
+  fprintf(f, "# HELP " METRICS_PREFIX "sync_acquire_seconds Time from a periodic sync closing to it opening again.\n");
+  fprintf(f, "# TYPE " METRICS_PREFIX "sync_acquire_seconds summary\n");
+  fprintf(f, METRICS_PREFIX "sync_acquire_seconds{quantile=\"0.5\"} %.3f\n", sync_acq_percentile(0.5) / 1e3);
+  fprintf(f, METRICS_PREFIX "sync_acquire_seconds{quantile=\"0.9\"} %.3f\n", sync_acq_percentile(0.9) / 1e3);
+  fprintf(f, METRICS_PREFIX "sync_acquire_seconds{quantile=\"0.99\"} %.3f\n", sync_acq_percentile(0.99) / 1e3);
+  fprintf(f, METRICS_PREFIX "sync_acquire_seconds_sum %.3f\n", sync_acq_stats.sum_ms / 1e3);
+  fprintf(f, METRICS_PREFIX "sync_acquire_seconds_count %llu\n", (unsigned long long)sync_acq_stats.reacquired);
+
+  fprintf(f, "# HELP " METRICS_PREFIX "sync_acquiring Periodic advertisers lost or being synced, scanned for at full effort.\n");
+  fprintf(f, "# TYPE " METRICS_PREFIX "sync_acquiring gauge\n");
+  fprintf(f, METRICS_PREFIX "sync_acquiring %u\n", sync_acq_stats.acquiring);
+
+  fprintf(f, "# HELP " METRICS_PREFIX "rssi_dbm RSSI of decoded periodic reports.\n");
+  fprintf(f, "# TYPE " METRICS_PREFIX "rssi_dbm histogram\n");
+  for (int i = 0; i < METRICS_RSSI_BUCKETS; i++)
+  {
+    cumulative += metrics.rssi_bucket[i];
+    fprintf(f, METRICS_PREFIX "rssi_dbm_bucket{le=\"%d\"} %llu\n",
+            METRICS_RSSI_MIN + i * METRICS_RSSI_STEP, (unsigned long long)cumulative);
+  }
+  cumulative += metrics.rssi_bucket[METRICS_RSSI_BUCKETS];
+  fprintf(f, METRICS_PREFIX "rssi_dbm_bucket{le=\"+Inf\"} %llu\n", (unsigned long long)cumulative);
+  fprintf(f, METRICS_PREFIX "rssi_dbm_sum %lld\n", (long long)metrics.rssi_sum);
+  fprintf(f, METRICS_PREFIX "rssi_dbm_count %llu\n", (unsigned long long)cumulative);
+
+  write_time_hist(f, "handler_seconds", "Time in sl_bt_on_event(), one event in 16.", &metrics.handler);
+  write_time_hist(f, "writer_seconds", "Time writing one window to the CSV logs, one window in 16.",
+                  &metrics.writer);
+
+  fprintf(f, "# HELP " METRICS_PREFIX "collar_reports_total Periodic reports decoded, per collar.\n");
+  fprintf(f, "# TYPE " METRICS_PREFIX "collar_reports_total counter\n");
+  for (c = collar_table_next(NULL); c != NULL; c = collar_table_next(c))
+  {
+    fprintf(f, METRICS_PREFIX "collar_reports_total{cow=\"%u\"} %u\n", c->cow_id, c->reports);
+  }
+  fprintf(f, "# HELP " METRICS_PREFIX "collar_duplicates_total Windows dropped as already logged, per collar.\n");
+  fprintf(f, "# TYPE " METRICS_PREFIX "collar_duplicates_total counter\n");
+  for (c = collar_table_next(NULL); c != NULL; c = collar_table_next(c))
+  {
+    fprintf(f, METRICS_PREFIX "collar_duplicates_total{cow=\"%u\"} %u\n", c->cow_id, c->duplicates);
+  }
+  fprintf(f, "# HELP " METRICS_PREFIX "collar_sync_losses_total Periodic syncs closed, per collar.\n");
+  fprintf(f, "# TYPE " METRICS_PREFIX "collar_sync_losses_total counter\n");
+  for (c = collar_table_next(NULL); c != NULL; c = collar_table_next(c))
+  {
+    fprintf(f, METRICS_PREFIX "collar_sync_losses_total{cow=\"%u\"} %u\n", c->cow_id, c->sync_losses);
+  }
+  fprintf(f, "# HELP " METRICS_PREFIX "collar_windows_received_total Windows received, per collar and path.\n");
+  fprintf(f, "# TYPE " METRICS_PREFIX "collar_windows_received_total counter\n");
+  for (c = collar_table_next(NULL); c != NULL; c = collar_table_next(c))
+  {
+    fprintf(f, METRICS_PREFIX "collar_windows_received_total{cow=\"%u\",path=\"periodic\"} %u\n",
+            c->cow_id, c->gaps.received);
+    fprintf(f, METRICS_PREFIX "collar_windows_received_total{cow=\"%u\",path=\"bulk\"} %u\n",
+            c->cow_id, c->gaps.bulk);
+  }
+  fprintf(f, "# HELP " METRICS_PREFIX "collar_windows_missed_total Windows missed over periodic advertising, "
+             "per collar and cause.\n");
+  fprintf(f, "# TYPE " METRICS_PREFIX "collar_windows_missed_total counter\n");
+  for (c = collar_table_next(NULL); c != NULL; c = collar_table_next(c))
+  {
+    fprintf(f, METRICS_PREFIX "collar_windows_missed_total{cow=\"%u\",cause=\"%s\"} %u\n",
+            c->cow_id, gap_cause_name(GAP_RADIO), c->gaps.lost_radio);
+    fprintf(f, METRICS_PREFIX "collar_windows_missed_total{cow=\"%u\",cause=\"%s\"} %u\n",
+            c->cow_id, gap_cause_name(GAP_SYNC), c->gaps.lost_sync);
+    fprintf(f, METRICS_PREFIX "collar_windows_missed_total{cow=\"%u\",cause=\"%s\"} %u\n",
+            c->cow_id, gap_cause_name(GAP_RESET), c->gaps.lost_reset);
+  }
+  fprintf(f, "# HELP " METRICS_PREFIX "collar_resets_total Collar restarts seen, per collar.\n");
+  fprintf(f, "# TYPE " METRICS_PREFIX "collar_resets_total counter\n");
+  for (c = collar_table_next(NULL); c != NULL; c = collar_table_next(c))
+  {
+    fprintf(f, METRICS_PREFIX "collar_resets_total{cow=\"%u\"} %u\n", c->cow_id, c->gaps.resets);
+  }
+  fprintf(f, "# HELP " METRICS_PREFIX "collar_recent_loss_ratio Windows missed among the last %d.\n",
+          GAP_RECENT_WINDOWS);
+  fprintf(f, "# TYPE " METRICS_PREFIX "collar_recent_loss_ratio gauge\n");
+  for (c = collar_table_next(NULL); c != NULL; c = collar_table_next(c))
+  {
+    if (c->gaps.started)
+    {
+      fprintf(f, METRICS_PREFIX "collar_recent_loss_ratio{cow=\"%u\"} %.3f\n", c->cow_id,
+              gap_recent_loss(c) / 1000.0);
+    }
+  }
+  fprintf(f, "# HELP " METRICS_PREFIX "collar_synced 1 while the collar's periodic sync is open.\n");
+  fprintf(f, "# TYPE " METRICS_PREFIX "collar_synced gauge\n");
+  for (c = collar_table_next(NULL); c != NULL; c = collar_table_next(c))
+  {
+    fprintf(f, METRICS_PREFIX "collar_synced{cow=\"%u\"} %d\n", c->cow_id, c->synced ? 1 : 0);
+  }
+  fprintf(f, "# HELP " METRICS_PREFIX "collar_rssi_dbm Average RSSI of the collar's periodic reports.\n");
+  fprintf(f, "# TYPE " METRICS_PREFIX "collar_rssi_dbm gauge\n");
+  for (c = collar_table_next(NULL); c != NULL; c = collar_table_next(c))
+  {
+    if (c->rssi_reports > 0)
+    {
+      fprintf(f, METRICS_PREFIX "collar_rssi_dbm{cow=\"%u\"} %.2f\n", c->cow_id, c->rssi_q4 / 16.0);
+    }
+  }
+}
+
+void metrics_export(void)
+{
+  char tmp[512];
+  FILE *f;
+
+  if (metrics_path == NULL)
+  {
+    return;
+  }
+
+  // Write aside and rename, so the collector never reads half a file
+  snprintf(tmp, sizeof(tmp), "%s.tmp", metrics_path);
+  f = fopen(tmp, "w");
+  if (f == NULL)
+  {
+    return;
+  }
+  write_metrics(f);
+  if (fclose(f) == 0)
+  {
+    rename(tmp, metrics_path);
+  }
+}
@@ -0,0 +1,147 @@
+#ifndef HOST_METRICS_H
+#define HOST_METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+// Seconds between two exports of the metrics textfile
+#define METRICS_PERIOD_S 10
+
+// One event in this many (power of two) has its handler timed
+#define METRICS_LATENCY_SAMPLE 16
+
+// Time histograms: bucket i holds times up to 2^(i + METRICS_TIME_MIN_SHIFT) ns,
+// 256 ns to 33.5 ms, the last bucket everything longer
+#define METRICS_TIME_MIN_SHIFT 8
+#define METRICS_TIME_BUCKETS 18
+
+// RSSI histogram: bucket i holds RSSI up to METRICS_RSSI_MIN + i * METRICS_RSSI_STEP dBm,
+// -110 to -30 dBm, the last bucket everything stronger
+#define METRICS_RSSI_MIN (-110)
+#define METRICS_RSSI_STEP 5
+#define METRICS_RSSI_BUCKETS 17
+
+// Distinct sync close reasons counted on their own, the rest add up as other
+#define METRICS_CLOSE_REASONS 8
+
+typedef struct metrics_hist
+{
+  uint64_t bucket[METRICS_TIME_BUCKETS + 1];
+  uint64_t count;
+  uint64_t sum_ns;
+} metrics_hist_t;
+
+/**
+ * Gateway wide counters. The host handles events on one thread, so they
+ * are plain increments; the export runs on the same thread between
+ * events. Per-collar counters live in collar_t.
+ */
+typedef struct host_metrics
+{
+  uint64_t events;            // BGAPI events handled
+  uint64_t reports;           // periodic sync reports decoded into a window
+  uint64_t bulk_windows;      // windows decoded from bulk notifications
+  uint64_t duplicates;        // windows dropped as already logged
+  uint64_t decode_errors;     // reports that did not decode
+  uint64_t truncated;         // periodic advertising chains cut short
+  uint64_t sync_opens;
+  uint16_t close_reason[METRICS_CLOSE_REASONS];
+  uint64_t close_count[METRICS_CLOSE_REASONS];
+  uint8_t close_reasons;      // entries of close_reason in use
+  uint64_t close_other;       // closes with a reason not in the table
+  uint64_t rssi_bucket[METRICS_RSSI_BUCKETS + 1];
+  int64_t rssi_sum;
+  metrics_hist_t handler;     // sl_bt_on_event(), sampled
+  metrics_hist_t writer;      // CSV writers of one window, sampled
+} host_metrics_t;
+
+extern host_metrics_t metrics;
+
+/**
+ * Export to a Prometheus textfile (node_exporter textfile collector) at
+ * path every METRICS_PERIOD_S seconds. NULL keeps the counters without
+ * exporting them.
+ */
+void metrics_init(const char *path);
+
+/**
+ * Write the textfile when it is due. Call from the main loop.
+ */
+void metrics_poll(void);
+
+/**
+ * Write the textfile now, e.g. on exit.
+ */
+void metrics_export(void);
+
+/**
+ * Count a sync close by its reason.
+ */
+void metrics_sync_closed(uint16_t reason);
+
+static inline uint64_t metrics_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static inline void metrics_hist_add(metrics_hist_t *hist, uint64_t ns)
+{
+  // smallest power of two >= ns, relative to the first bucket
+  int bucket = (ns <= 1) ? 0 : 64 - __builtin_clzll(ns - 1) - METRICS_TIME_MIN_SHIFT;
+
+  if (bucket < 0)
+  {
+    bucket = 0;
+  }
+  else if (bucket > METRICS_TIME_BUCKETS)
+  {
+    bucket = METRICS_TIME_BUCKETS;
+  }
+  hist->bucket[bucket]++;
+  hist->count++;
+  hist->sum_ns += ns;
+}
+
+/**
+ * Start of a timed section: a timestamp for one call in
+ * METRICS_LATENCY_SAMPLE, 0 for the others.
+ */
+static inline uint64_t metrics_sample_begin(uint64_t n)
+{
+  return ((n & (METRICS_LATENCY_SAMPLE - 1)) == 0) ? metrics_now_ns() : 0;
+}
+
+static inline void metrics_sample_end(metrics_hist_t *hist, uint64_t start)
+{
+  if (start != 0)
+  {
+    metrics_hist_add(hist, metrics_now_ns() - start);
+  }
+}
+
+static inline void metrics_rssi(int8_t rssi)
+{
+  int bucket = (rssi - METRICS_RSSI_MIN + METRICS_RSSI_STEP - 1) / METRICS_RSSI_STEP;
+
+  // the controller reports 127 when it has no RSSI
+  if (rssi == 127)
+  {
+    return;
+  }
+  if (bucket < 0)
+  {
+    bucket = 0;
+  }
+  else if (bucket > METRICS_RSSI_BUCKETS)
+  {
+    bucket = METRICS_RSSI_BUCKETS;
+  }
+  metrics.rssi_bucket[bucket]++;
+  metrics.rssi_sum += rssi;
+}
+
+#endif // HOST_METRICS_H
@@ -0,0 +1,919 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+#include "host_store.h"
+#include "cs_endian.h"
+#include "cs_crc16.h"
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Coarse clock for the commit interval: a few ns to read
+static uint64_t now_ms(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+  return (uint64_t)ts.tv_sec * 1000ULL + (uint64_t)ts.tv_nsec / 1000000ULL;
+}
+
+// Header fields after the magic
+static void put_header(uint8_t *field, uint32_t committed, uint32_t first, uint32_t last, uint8_t level)
+{
+  cs_put_le32(&field[0], committed);
+  cs_put_le32(&field[4], first);
+  cs_put_le32(&field[8], last);
+  field[12] = level;
+  field[13] = 0;
+  cs_put_le16(&field[14], cs_crc16(CS_CRC16_INIT, &field[0], 14));
+}
+
+static bool get_header(const uint8_t *field, store_segment_t *seg)
+{
+  if (cs_crc16(CS_CRC16_INIT, &field[0], 14) != cs_get_le16(&field[14]))
+  {
+    return false;
+  }
+  seg->committed = cs_get_le32(&field[0]);
+  seg->first_time = cs_get_le32(&field[4]);
+  seg->last_time = cs_get_le32(&field[8]);
+  seg->level = field[12];
+  return true;
+}
+
+// Length of the valid record at p, 0 if there is none
+static size_t record_check(const uint8_t *p, size_t len)
+{
+  const uint8_t *body = &p[STORE_RECORD_HEADER_LEN];
+  size_t body_len;
+  bool ok;
+
+  if (len < STORE_RECORD_HEADER_LEN + 6)
+  {
+    return 0;
+  }
+  body_len = cs_get_le16(p);
+  if ((body_len < 6) || (STORE_RECORD_HEADER_LEN + body_len > len))
+  {
+    return 0;
+  }
+  if (cs_crc16(cs_crc16(CS_CRC16_INIT, p, 2), body, body_len) != cs_get_le16(&p[2]))
+  {
+    return 0;
+  }
+  switch (body[0])
+  {
+    case STORE_KIND_WINDOW:
+      ok = (body_len >= STORE_WINDOW_HEADER_LEN) && (body_len == STORE_WINDOW_HEADER_LEN + (size_t)body[15] * 6);
+      break;
+    case STORE_KIND_FEATURES:
+      ok = (body_len == STORE_WINDOW_HEADER_LEN + STORE_FEATURES_LEN);
+      break;
+    case STORE_KIND_LABELS:
+      ok = (body_len >= STORE_WINDOW_HEADER_LEN) && (body_len == STORE_WINDOW_HEADER_LEN + (size_t)body[15] * 2)
+           && (body[15] <= CS_CLASS_MAX_LABELS);
+      break;
+    case STORE_KIND_SUMMARY:
+      ok = (body_len == STORE_SUMMARY_LEN);
+      break;
+    default:
+      ok = false;
+      break;
+  }
+  return ok ? STORE_RECORD_HEADER_LEN + body_len : 0;
+}
+
+// Time of a valid record
+static uint32_t record_time(const uint8_t *p)
+{
+  return cs_get_le32(&p[STORE_RECORD_HEADER_LEN + 2]);
+}
+
+// The directory entry of a new segment must survive a crash too
+static void sync_dir(const char *dir)
+{
+  int fd = open(dir, O_RDONLY | O_DIRECTORY);
+
+  if (fd >= 0)
+  {
+    fsync(fd);
+    close(fd);
+  }
+}
+
+static bool segment_create(store_writer_t *w)
+{
+  char path[STORE_PATH_MAX + STORE_PREFIX_MAX + 16];
+
+  // O_EXCL: never append to a segment someone else wrote
+  do
+  {
+    snprintf(path, sizeof(path), "%s/%s-%06u.seg", w->dir, w->prefix, w->segment);
+    w->fd = open(path, O_WRONLY | O_CREAT | O_EXCL, 0644);
+  } while ((w->fd < 0) && (errno == EEXIST) && (++w->segment != 0));
+
+  if (w->fd < 0)
+  {
+    return false;
+  }
+  sync_dir(w->dir);
+
+  memcpy(w->buf, STORE_MAGIC, STORE_MAGIC_LEN);
+  put_header(&w->buf[STORE_MAGIC_LEN], STORE_SEGMENT_HEADER_LEN, 0, 0, w->level);
+  w->len = STORE_SEGMENT_HEADER_LEN;
+  w->segment_bytes = STORE_SEGMENT_HEADER_LEN;
+  w->committed = 0;
+  w->first_time = 0;
+  w->last_time = 0;
+  return true;
+}
+
+bool store_open(store_writer_t *w, const char *dir, const char *prefix, uint8_t level)
+{
+  memset(w, 0, sizeof(*w));
+  w->fd = -1;
+  if ((strlen(dir) >= sizeof(w->dir)) || (strlen(prefix) >= sizeof(w->prefix)))
+  {
+    return false;
+  }
+  strcpy(w->dir, dir);
+  strcpy(w->prefix, prefix);
+  w->level = level;
+
+  if ((mkdir(dir, 0755) != 0) && (errno != EEXIST))
+  {
+    return false;
+  }
+  // the first segment is created with the first record
+  w->buf = malloc(STORE_BUFFER_SIZE);
+  return w->buf != NULL;
+}
+
+void store_set_commit(store_writer_t *w, uint32_t every_ms, uint32_t every_records)
+{
+  w->every_ms = every_ms;
+  w->every_records = every_records;
+}
+
+// Hand the buffered records to the kernel
+static bool write_out(store_writer_t *w)
+{
+  size_t done = 0;
+
+  while (done < w->len)
+  {
+    ssize_t n = write(w->fd, &w->buf[done], w->len - done);
+
+    if (n < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    done += (size_t)n;
+  }
+  w->len = 0;
+  return true;
+}
+
+bool store_commit(store_writer_t *w)
+{
+  uint8_t field[STORE_SEGMENT_HEADER_LEN - STORE_MAGIC_LEN];
+  uint64_t start;
+  uint64_t spent;
+
+  if (w->fd < 0)
+  {
+    return true;
+  }
+  if (!write_out(w))
+  {
+    return false;
+  }
+  w->pending = 0;
+  if (w->committed == w->segment_bytes)
+  {
+    return true;
+  }
+
+  start = now_ns();
+  if (fdatasync(w->fd) != 0)
+  {
+    return false;
+  }
+  spent = now_ns() - start;
+  w->commits++;
+  w->commit_ns += spent;
+  if (spent > w->commit_max_ns)
+  {
+    w->commit_max_ns = spent;
+  }
+
+  // Reaches the disk with the next sync: until then recovery starts from
+  // an older committed size, which only costs a longer scan
+  w->committed = w->segment_bytes;
+  put_header(field, (uint32_t)w->committed, w->first_time, w->last_time, w->level);
+  return pwrite(w->fd, field, sizeof(field), STORE_MAGIC_LEN) == (ssize_t)sizeof(field);
+}
+
+// Commit, sync the header as well and close: a sealed segment needs no scan
+static bool segment_seal(store_writer_t *w)
+{
+  bool ok = store_commit(w) && (fdatasync(w->fd) == 0);
+
+  ok = (close(w->fd) == 0) && ok;
+  w->fd = -1;
+  return ok;
+}
+
+// Room for a record of need bytes, in a new segment if the open one is full
+static bool make_room(store_writer_t *w, size_t need)
+{
+  if (w->buf == NULL)
+  {
+    return false;
+  }
+  if (w->fd >= 0 && w->segment_bytes + need > STORE_SEGMENT_MAX)
+  {
+    if (!segment_seal(w))
+    {
+      return false;
+    }
+    w->segment++;
+  }
+  if ((w->fd < 0) && !segment_create(w))
+  {
+    return false;
+  }
+  return (w->len + need <= STORE_BUFFER_SIZE) || write_out(w);
+}
+
+// Account for the record just encoded at the end of the buffer
+static bool appended(store_writer_t *w, size_t len, uint32_t time)
+{
+  if (w->segment_bytes == STORE_SEGMENT_HEADER_LEN)
+  {
+    w->first_time = time;
+    w->last_time = time;
+  }
+  else if (time < w->first_time)
+  {
+    w->first_time = time;
+  }
+  else if (time > w->last_time)
+  {
+    w->last_time = time;
+  }
+  w->len += len;
+  w->segment_bytes += len;
+  w->records++;
+  w->bytes += len;
+
+  if ((w->pending++ == 0) && (w->every_ms != 0))
+  {
+    w->pending_ms = now_ms();
+  }
+  if ((w->every_records != 0) && (w->pending >= w->every_records))
+  {
+    return store_commit(w);
+  }
+  return store_poll(w);
+}
+
+// Body length of a window of any kind, 0 if it does not fit a record
+static size_t window_len(const store_window_t *win)
+{
+  switch (win->kind)
+  {
+    case CS_KIND_SUMMARY:
+      return STORE_WINDOW_HEADER_LEN + STORE_FEATURES_LEN;
+    case CS_KIND_CLASS:
+      return (win->n_labels > CS_CLASS_MAX_LABELS) ? 0 : STORE_WINDOW_HEADER_LEN + (size_t)win->n_labels * 2;
+    default:
+      return (win->n_samples > CS_WINDOW_MAX_SAMPLES) ? 0 : STORE_WINDOW_HEADER_LEN + (size_t)win->n_samples * 6;
+  }
+}
+
+bool store_append(store_writer_t *w, const store_window_t *win)
+{
+  size_t need = STORE_RECORD_HEADER_LEN + window_len(win);
+
+  if ((need == STORE_RECORD_HEADER_LEN) || !make_room(w, need))
+  {
+    return false;
+  }
+  store_encode(win, &w->buf[w->len]);
+  return appended(w, need, win->time);
+}
+
+bool store_append_summary(store_writer_t *w, const store_summary_t *sum)
+{
+  size_t need = STORE_RECORD_HEADER_LEN + STORE_SUMMARY_LEN;
+
+  if (!make_room(w, need))
+  {
+    return false;
+  }
+  store_encode_summary(sum, &w->buf[w->len]);
+  return appended(w, need, sum->start);
+}
+
+bool store_poll(store_writer_t *w)
+{
+  if ((w->pending == 0) || (w->every_ms == 0) || (now_ms() - w->pending_ms < w->every_ms))
+  {
+    return true;
+  }
+  return store_commit(w);
+}
+
+bool store_close(store_writer_t *w)
+{
+  bool ok = true;
+
+  if (w->fd >= 0)
+  {
+    ok = segment_seal(w);
+  }
+  free(w->buf);
+  w->buf = NULL;
+  return ok;
+}
+
+bool store_rotate(store_writer_t *w)
+{
+  if (w->fd < 0)
+  {
+    return true;
+  }
+  if (!segment_seal(w))
+  {
+    return false;
+  }
+  w->segment++;
+  return true;
+}
+
+void store_segment_path(const store_writer_t *w, char *path, size_t size)
+{
+  if (w->fd < 0)
+  {
+    path[0] = '\0';
+    return;
+  }
+  snprintf(path, size, "%s/%s-%06u.seg", w->dir, w->prefix, w->segment);
+}
+
+bool store_segment_info(const char *path, store_segment_t *seg)
+{
+  uint8_t header[STORE_SEGMENT_HEADER_LEN];
+  struct stat st;
+  bool ok;
+  int fd = open(path, O_RDONLY);
+
+  if (fd < 0)
+  {
+    return false;
+  }
+  ok = (fstat(fd, &st) == 0) && (pread(fd, header, sizeof(header), 0) == (ssize_t)sizeof(header))
+       && (memcmp(header, STORE_MAGIC, STORE_MAGIC_LEN) == 0) && get_header(&header[STORE_MAGIC_LEN], seg);
+  close(fd);
+  if (ok)
+  {
+    seg->size = (uint64_t)st.st_size;
+  }
+  return ok;
+}
+
+bool store_reader_open(store_reader_t *r, const char *path)
+{
+  memset(r, 0, sizeof(*r));
+  r->fd = open(path, O_RDONLY);
+  if (r->fd < 0)
+  {
+    return false;
+  }
+  r->buf = malloc(STORE_READ_SIZE);
+  if (r->buf == NULL)
+  {
+    close(r->fd);
+    r->fd = -1;
+    return false;
+  }
+  // records start after the header
+  r->offset = STORE_SEGMENT_HEADER_LEN;
+  return true;
+}
+
+int store_reader_next(store_reader_t *r, store_record_t *rec)
+{
+  size_t len = store_decode(&r->buf[r->pos], r->len - r->pos, rec);
+  ssize_t n;
+
+  if (len != 0)
+  {
+    r->pos += len;
+    return 1;
+  }
+
+  // refill with the rest of the buffer at its start
+  r->offset += r->pos;
+  r->len -= r->pos;
+  memmove(r->buf, &r->buf[r->pos], r->len);
+  r->pos = 0;
+  do
+  {
+    if (r->read != NULL)
+    {
+      n = r->read(r->read_ctx, &r->buf[r->len], STORE_READ_SIZE - r->len, r->offset + r->len);
+    }
+    else
+    {
+      n = pread(r->fd, &r->buf[r->len], STORE_READ_SIZE - r->len, (off_t)(r->offset + r->len));
+    }
+  } while ((n < 0) && (errno == EINTR));
+  if (n < 0)
+  {
+    return -1;
+  }
+  r->len += (size_t)n;
+
+  len = store_decode(r->buf, r->len, rec);
+  if (len == 0)
+  {
+    return 0;
+  }
+  r->pos = len;
+  return 1;
+}
+
+void store_reader_close(store_reader_t *r)
+{
+  if (r->fd >= 0)
+  {
+    close(r->fd);
+    r->fd = -1;
+  }
+  free(r->buf);
+  r->buf = NULL;
+}
+
+// Cut one segment back to its last valid record
+static bool segment_recover(const char *path, uint8_t *buf, store_recovery_t *r)
+{
+  uint8_t header[STORE_SEGMENT_HEADER_LEN];
+  store_segment_t seg;
+  struct stat st;
+  uint64_t end;
+  bool ok = true;
+  int fd = open(path, O_RDWR);
+
+  if ((fd < 0) || (fstat(fd, &st) != 0))
+  {
+    if (fd >= 0)
+    {
+      close(fd);
+    }
+    return false;
+  }
+  if ((pread(fd, header, sizeof(header), 0) != (ssize_t)sizeof(header))
+      || (memcmp(header, STORE_MAGIC, STORE_MAGIC_LEN) != 0))
+  {
+    // another format, or a segment created without its header: leave it
+    r->skipped++;
+    close(fd);
+    return true;
+  }
+  r->segments++;
+
+  if (!get_header(&header[STORE_MAGIC_LEN], &seg) || (seg.committed < STORE_SEGMENT_HEADER_LEN)
+      || (seg.committed > (uint64_t)st.st_size))
+  {
+    // scan it all: the level is that of the first record
+    seg.committed = STORE_SEGMENT_HEADER_LEN;
+    seg.level = 0xFF;
+  }
+  if (seg.committed == (uint64_t)st.st_size)
+  {
+    close(fd);
+    return true;
+  }
+  if (seg.committed == STORE_SEGMENT_HEADER_LEN)
+  {
+    seg.first_time = UINT32_MAX;
+    seg.last_time = 0;
+  }
+
+  // Scan the tail a buffer at a time; a record cut by the end of the
+  // buffer is read again at the start of the next one
+  end = seg.committed;
+  while (end < (uint64_t)st.st_size)
+  {
+    ssize_t n = pread(fd, buf, STORE_BUFFER_SIZE, (off_t)end);
+    size_t pos = 0;
+    size_t len;
+
+    if (n <= 0)
+    {
+      break;
+    }
+    while ((len = record_check(&buf[pos], (size_t)n - pos)) != 0)
+    {
+      uint32_t t = record_time(&buf[pos]);
+
+      if (seg.level == 0xFF)
+      {
+        seg.level = (buf[pos + STORE_RECORD_HEADER_LEN] != STORE_KIND_SUMMARY)
+                    ? STORE_RAW : buf[pos + STORE_RECORD_HEADER_LEN + 1];
+      }
+      seg.first_time = (t < seg.first_time) ? t : seg.first_time;
+      seg.last_time = (t > seg.last_time) ? t : seg.last_time;
+      pos += len;
+    }
+    end += pos;
+    // a record the buffer held in full, or the last one, was not valid:
+    // the tail ends here
+    if (((size_t)n - pos >= STORE_RECORD_MAX) || (end + ((size_t)n - pos) == (uint64_t)st.st_size))
+    {
+      break;
+    }
+  }
+  r->scanned += (uint64_t)st.st_size - seg.committed;
+
+  if (end < (uint64_t)st.st_size)
+  {
+    ok = (ftruncate(fd, (off_t)end) == 0);
+    r->repaired++;
+    r->truncated += (uint64_t)st.st_size - end;
+  }
+  if (seg.first_time > seg.last_time)
+  {
+    // no records
+    seg.first_time = 0;
+    seg.last_time = 0;
+  }
+  put_header(&header[STORE_MAGIC_LEN], (uint32_t)end, seg.first_time, seg.last_time,
+             (seg.level == 0xFF) ? STORE_RAW : seg.level);
+  ok = ok && (pwrite(fd, &header[STORE_MAGIC_LEN], STORE_SEGMENT_HEADER_LEN - STORE_MAGIC_LEN, STORE_MAGIC_LEN)
+              == STORE_SEGMENT_HEADER_LEN - STORE_MAGIC_LEN);
+  ok = (fdatasync(fd) == 0) && ok;
+  ok = (close(fd) == 0) && ok;
+  return ok;
+}
+
+bool store_recover(const char *dir, store_recovery_t *r)
+{
+  char path[STORE_PATH_MAX + 256 + 2];
+  struct dirent *entry;
+  uint8_t *buf;
+  bool ok = true;
+  DIR *d;
+
+  memset(r, 0, sizeof(*r));
+  d = opendir(dir);
+  if (d == NULL)
+  {
+    // nothing to recover in a store not created yet
+    return errno == ENOENT;
+  }
+  buf = malloc(STORE_BUFFER_SIZE);
+  if (buf == NULL)
+  {
+    closedir(d);
+    return false;
+  }
+
+  while ((entry = readdir(d)) != NULL)
+  {
+    size_t name_len = strlen(entry->d_name);
+
+    if ((name_len < 4) || (strcmp(&entry->d_name[name_len - 4], ".seg") != 0))
+    {
+      continue;
+    }
+    snprintf(path, sizeof(path), "%s/%s", dir, entry->d_name);
+    ok = segment_recover(path, buf, r) && ok;
+  }
+  closedir(d);
+  free(buf);
+  return ok;
+}
+
+// Length and CRC in front of the body
+static size_t seal_record(uint8_t *out, size_t body_len)
+{
+  cs_put_le16(out, (uint16_t)body_len);
+  cs_put_le16(&out[2], cs_crc16(cs_crc16(CS_CRC16_INIT, out, 2), &out[STORE_RECORD_HEADER_LEN], body_len));
+  return STORE_RECORD_HEADER_LEN + body_len;
+}
+
+size_t store_encode(const store_window_t *win, uint8_t *out)
+{
+  uint8_t *p = &out[STORE_RECORD_HEADER_LEN];
+  size_t len = window_len(win);
+
+  p[1] = win->flags;
+  cs_put_le32(&p[2], win->time);
+  cs_put_le16(&p[6], win->cow_id);
+  p[8] = win->battery;
+  p[9] = win->temp;
+  cs_put_le32(&p[10], win->counter);
+  p[14] = (uint8_t)win->rssi;
+  cs_put_le16(&p[16], win->seq);
+
+  switch (win->kind)
+  {
+    case CS_KIND_SUMMARY:
+    {
+      const cs_summary_t *f = &win->summary;
+
+      p[0] = STORE_KIND_FEATURES;
+      p[15] = f->windows;
+      p += STORE_WINDOW_HEADER_LEN;
+      cs_put_le16(&p[0], f->samples);
+      for (uint8_t a = 0; a < 3; a++)
+      {
+        cs_put_le16(&p[2 + 2 * a], (uint16_t)f->mean[a]);
+        cs_put_le16(&p[8 + 2 * a], f->std[a]);
+        cs_put_le16(&p[16 + 2 * a], f->zc[a]);
+      }
+      cs_put_le16(&p[14], f->odba);
+      p[22] = f->tilt_deg;
+      p[23] = f->posture;
+      break;
+    }
+
+    case CS_KIND_CLASS:
+      p[0] = STORE_KIND_LABELS;
+      p[15] = win->n_labels;
+      p += STORE_WINDOW_HEADER_LEN;
+      for (uint8_t i = 0; i < win->n_labels; i++)
+      {
+        p[2 * i] = win->labels[i].class;
+        p[2 * i + 1] = win->labels[i].confidence;
+      }
+      break;
+
+    default:
+      p[0] = STORE_KIND_WINDOW;
+      p[15] = win->n_samples;
+      p += STORE_WINDOW_HEADER_LEN;
+      for (uint8_t i = 0; i < win->n_samples; i++)
+      {
+        cs_put_le16(&p[0], (uint16_t)win->samples[i][0]);
+        cs_put_le16(&p[2], (uint16_t)win->samples[i][1]);
+        cs_put_le16(&p[4], (uint16_t)win->samples[i][2]);
+        p += 6;
+      }
+      break;
+  }
+  return seal_record(out, len);
+}
+
+static void put_stat(uint8_t *p, const store_stat_t *stat)
+{
+  cs_put_le16(&p[0], (uint16_t)stat->min);
+  cs_put_le16(&p[2], (uint16_t)stat->max);
+  cs_put_le32(&p[4], (uint32_t)stat->sum);
+}
+
+static void get_stat(const uint8_t *p, store_stat_t *stat)
+{
+  stat->min = (int16_t)cs_get_le16(&p[0]);
+  stat->max = (int16_t)cs_get_le16(&p[2]);
+  stat->sum = (int32_t)cs_get_le32(&p[4]);
+}
+
+size_t store_encode_summary(const store_summary_t *sum, uint8_t *out)
+{
+  uint8_t *p = &out[STORE_RECORD_HEADER_LEN];
+
+  p[0] = STORE_KIND_SUMMARY;
+  p[1] = sum->level;
+  cs_put_le32(&p[2], sum->start);
+  cs_put_le16(&p[6], sum->cow_id);
+  cs_put_le16(&p[8], sum->windows);
+  cs_put_le16(&p[10], sum->missed);
+  cs_put_le16(&p[12], sum->lying);
+  cs_put_le16(&p[14], sum->active);
+  put_stat(&p[16], &sum->activity);
+  put_stat(&p[24], &sum->temp);
+  put_stat(&p[32], &sum->battery);
+  put_stat(&p[40], &sum->rssi);
+  cs_put_le32(&p[48], (uint32_t)sum->activity_sq);
+  cs_put_le32(&p[52], (uint32_t)(sum->activity_sq >> 32));
+  return seal_record(out, STORE_SUMMARY_LEN);
+}
+
+static void get_window(const uint8_t *p, store_window_t *win)
+{
+  uint8_t n = p[15];
+
+  win->flags = p[1];
+  win->time = cs_get_le32(&p[2]);
+  win->cow_id = cs_get_le16(&p[6]);
+  win->battery = p[8];
+  win->temp = p[9];
+  win->counter = cs_get_le32(&p[10]);
+  win->rssi = (int8_t)p[14];
+  win->seq = cs_get_le16(&p[16]);
+  win->n_samples = 0;
+  win->n_labels = 0;
+
+  switch (p[0])
+  {
+    case STORE_KIND_FEATURES:
+    {
+      cs_summary_t *f = &win->summary;
+
+      win->kind = CS_KIND_SUMMARY;
+      p += STORE_WINDOW_HEADER_LEN;
+      f->windows = n;
+      f->samples = cs_get_le16(&p[0]);
+      for (uint8_t a = 0; a < 3; a++)
+      {
+        f->mean[a] = (int16_t)cs_get_le16(&p[2 + 2 * a]);
+        f->std[a] = cs_get_le16(&p[8 + 2 * a]);
+        f->zc[a] = cs_get_le16(&p[16 + 2 * a]);
+      }
+      f->odba = cs_get_le16(&p[14]);
+      f->tilt_deg = p[22];
+      f->posture = p[23];
+      break;
+    }
+
+    case STORE_KIND_LABELS:
+      win->kind = CS_KIND_CLASS;
+      win->n_labels = n;
+      p += STORE_WINDOW_HEADER_LEN;
+      for (uint8_t i = 0; i < n; i++)
+      {
+        win->labels[i].class = p[2 * i];
+        win->labels[i].confidence = p[2 * i + 1];
+      }
+      break;
+
+    default:
+      win->kind = CS_KIND_RAW;
+      win->n_samples = n;
+      p += STORE_WINDOW_HEADER_LEN;
+      for (uint8_t i = 0; i < n; i++)
+      {
+        win->samples[i][0] = (int16_t)cs_get_le16(&p[0]);
+        win->samples[i][1] = (int16_t)cs_get_le16(&p[2]);
+        win->samples[i][2] = (int16_t)cs_get_le16(&p[4]);
+        p += 6;
+      }
+      break;
+  }
+}
+
+static void get_summary(const uint8_t *p, store_summary_t *sum)
+{
+  sum->level = p[1];
+  sum->start = cs_get_le32(&p[2]);
+  sum->cow_id = cs_get_le16(&p[6]);
+  sum->windows = cs_get_le16(&p[8]);
+  sum->missed = cs_get_le16(&p[10]);
+  sum->lying = cs_get_le16(&p[12]);
+  sum->active = cs_get_le16(&p[14]);
+  get_stat(&p[16], &sum->activity);
+  get_stat(&p[24], &sum->temp);
+  get_stat(&p[32], &sum->battery);
+  get_stat(&p[40], &sum->rssi);
+  sum->activity_sq = cs_get_le32(&p[48]) | (uint64_t)cs_get_le32(&p[52]) << 32;
+}
+
+size_t store_decode(const uint8_t *p, size_t len, store_record_t *rec)
+{
+  size_t record = record_check(p, len);
+
+  if (record == 0)
+  {
+    return 0;
+  }
+  rec->kind = p[STORE_RECORD_HEADER_LEN];
+  if (rec->kind == STORE_KIND_SUMMARY)
+  {
+    get_summary(&p[STORE_RECORD_HEADER_LEN], &rec->summary);
+  }
+  else
+  {
+    get_window(&p[STORE_RECORD_HEADER_LEN], &rec->window);
+  }
+  return record;
+}
+
+void store_summary_init(store_summary_t *sum, uint16_t cow_id, uint8_t level, uint32_t start)
+{
+  memset(sum, 0, sizeof(*sum));
+  sum->start = start;
+  sum->cow_id = cow_id;
+  sum->level = level;
+}
+
+static void merge_stat(store_stat_t *stat, const store_stat_t *part, bool first)
+{
+  if (first || (part->min < stat->min))
+  {
+    stat->min = part->min;
+  }
+  if (first || (part->max > stat->max))
+  {
+    stat->max = part->max;
+  }
+  stat->sum += part->sum;
+}
+
+void store_summary_merge(store_summary_t *sum, const store_summary_t *part)
+{
+  bool first = (sum->windows == 0);
+
+  if (part->windows == 0)
+  {
+    sum->missed += part->missed;
+    return;
+  }
+  if (part->active > 0)
+  {
+    merge_stat(&sum->activity, &part->activity, sum->active == 0);
+  }
+  merge_stat(&sum->temp, &part->temp, first);
+  merge_stat(&sum->battery, &part->battery, first);
+  merge_stat(&sum->rssi, &part->rssi, first);
+  sum->activity_sq += part->activity_sq;
+  sum->windows += part->windows;
+  sum->missed += part->missed;
+  sum->lying += part->lying;
+  sum->active += part->active;
+}
+
+// Local midnight of the day ref falls on, plus days
+static time_t local_midnight(time_t ref, int days)
+{
+  struct tm tm;
+
+  localtime_r(&ref, &tm);
+  tm.tm_mday += days;
+  tm.tm_hour = 0;
+  tm.tm_min = 0;
+  tm.tm_sec = 0;
+  tm.tm_isdst = -1;
+  return mktime(&tm);
+}
+
+uint32_t store_local_time(uint8_t hour, uint8_t min, uint8_t sec, time_t ref)
+{
+  // mktime() costs more than the rest of storing a window: remember the
+  // current day, unless it is not 24 hours long (daylight saving)
+  static time_t day_begin = 0;
+  static time_t day_end = 0;
+  struct tm tm;
+  time_t t = day_begin + (time_t)hour * 3600 + min * 60 + sec;
+
+  if ((ref >= day_begin) && (ref < day_end) && (t <= ref + 12 * 3600) && (t >= ref - 12 * 3600))
+  {
+    return (uint32_t)t;
+  }
+  day_begin = local_midnight(ref, 0);
+  day_end = local_midnight(ref, 1);
+  if (day_end - day_begin != 24 * 3600)
+  {
+    day_end = day_begin;
+  }
+
+  localtime_r(&ref, &tm);
+  tm.tm_hour = hour;
+  tm.tm_min = min;
+  tm.tm_sec = sec;
+  tm.tm_isdst = -1;
+  t = mktime(&tm);
+
+  // a window stamped just before midnight, received just after, and back
+  if (t > ref + 12 * 3600)
+  {
+    tm.tm_mday--;
+    tm.tm_isdst = -1;
+    t = mktime(&tm);
+  }
+  else if (t < ref - 12 * 3600)
+  {
+    tm.tm_mday++;
+    tm.tm_isdst = -1;
+    t = mktime(&tm);
+  }
+  return (uint32_t)t;
+}
@@ -0,0 +1,325 @@
+#ifndef HOST_STORE_H
+#define HOST_STORE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <time.h>
+#include <sys/types.h>
+
+#include "cs_payload.h"
+
+/*
+ * Window store: a directory of segment files. A segment starts with a
+ * header:
+ *
+ *   8 bytes         STORE_MAGIC
+ *   u32 committed   bytes of the segment known to be on disk
+ *   u32 first       earliest record time in them, s since the epoch
+ *   u32 last        latest record time in them
+ *   u8  level       STORE_RAW, STORE_MINUTE or STORE_HOUR
+ *   u8              0
+ *   u16 crc         CRC-16 of the 14 bytes from committed on
+ *
+ * followed by records back to back, each a little endian u16 body length,
+ * the CRC-16 of the length and body, then the body. Every body starts
+ * with its kind, one byte that depends on the kind, and the record time
+ * (u32). Raw segments hold STORE_KIND_WINDOW records:
+ *
+ *   u8  kind        STORE_KIND_WINDOW
+ *   u8  flags       STORE_WINDOW_*
+ *   u32 time        window time
+ *   u16 cow_id
+ *   u8  battery
+ *   u8  temp
+ *   u32 counter     periodic report counter of the window
+ *   i8  rssi
+ *   u8  n           samples in the window
+ *   u16 seq         window sequence number, if flags has STORE_WINDOW_SEQ
+ *   n x 3 x i16     acceleration samples
+ *
+ * Collars that send summaries or class labels instead of samples
+ * (CS_KIND_SUMMARY, CS_KIND_CLASS) have STORE_KIND_FEATURES and
+ * STORE_KIND_LABELS records in raw segments, with the same fields up to
+ * seq and then:
+ *
+ *   features: n is the windows summarized, then u16 samples, 3 x i16 mean,
+ *             3 x u16 std, u16 odba, 3 x u16 zc, u8 tilt, u8 posture
+ *   labels:   n labels of u8 class, u8 confidence, one per window
+ *
+ * Minute and hour segments hold STORE_KIND_SUMMARY records (see
+ * store_summary_t), written by the retention stage (store_retention.h).
+ *
+ * Segments are written by one writer each and never rewritten, so any
+ * number of writers can share a directory. A writer syncs its records to
+ * disk in groups (store_set_commit()) and then records the synced size in
+ * the header, so after a crash only the records past it need checking.
+ */
+#define STORE_MAGIC "CSSTORE4"
+#define STORE_MAGIC_LEN 8
+#define STORE_SEGMENT_HEADER_LEN 24
+
+// Segment levels
+#define STORE_RAW    0
+#define STORE_MINUTE 1
+#define STORE_HOUR   2
+
+// Record kinds
+#define STORE_KIND_WINDOW   0
+#define STORE_KIND_SUMMARY  1
+#define STORE_KIND_FEATURES 2
+#define STORE_KIND_LABELS   3
+
+// Window flags
+#define STORE_WINDOW_SEQ 0x01   // seq is valid (v1 payloads; not in CSV imports)
+
+#define STORE_RECORD_HEADER_LEN 4
+#define STORE_WINDOW_HEADER_LEN 18
+#define STORE_FEATURES_LEN 24
+#define STORE_SUMMARY_LEN 56
+#define STORE_RECORD_MAX (STORE_RECORD_HEADER_LEN + STORE_WINDOW_HEADER_LEN + CS_WINDOW_MAX_SAMPLES * 6)
+
+// A writer moves on to a new segment past this size
+#define STORE_SEGMENT_MAX (64u << 20)
+
+// Records a writer collects before writing them out
+#define STORE_BUFFER_SIZE (1u << 20)
+
+// Bytes a reader reads at a time
+#define STORE_READ_SIZE (64u << 10)
+
+#define STORE_PATH_MAX 256
+#define STORE_PREFIX_MAX 64
+
+/**
+ * A window as the collar sent it: samples, a summary of windows or their
+ * class labels.
+ */
+typedef struct store_window
+{
+  uint8_t kind;                 // CS_KIND_RAW, CS_KIND_SUMMARY or CS_KIND_CLASS
+  uint32_t time;
+  uint16_t cow_id;
+  uint8_t flags;
+  uint8_t battery;
+  uint8_t temp;
+  uint32_t counter;
+  int8_t rssi;
+  uint16_t seq;
+  uint8_t n_samples;
+  int16_t samples[CS_WINDOW_MAX_SAMPLES][3];
+  cs_summary_t summary;
+  uint8_t n_labels;
+  cs_label_t labels[CS_CLASS_MAX_LABELS];
+} store_window_t;
+
+// Minimum, maximum and sum of a metric over the windows of a summary
+typedef struct store_stat
+{
+  int16_t min;
+  int16_t max;
+  int32_t sum;
+} store_stat_t;
+
+/**
+ * The windows of one cow over a minute or an hour. Summaries of the same
+ * cow and period can be merged (store_summary_merge()): a period whose
+ * windows were spread over several raw segments has one record per part.
+ */
+typedef struct store_summary
+{
+  uint32_t start;               // start of the minute or hour
+  uint16_t cow_id;
+  uint8_t level;                // STORE_MINUTE or STORE_HOUR
+  uint16_t windows;             // windows received
+  uint16_t missed;              // windows missed, from the sequence numbers
+  uint16_t lying;               // windows spent lying
+  uint16_t active;              // windows with an ODBA: class labels have none
+  store_stat_t activity;        // ODBA of each of them, mg
+  store_stat_t temp;
+  store_stat_t battery;
+  store_stat_t rssi;
+  uint64_t activity_sq;         // sum of squared ODBA, for its deviation
+} store_summary_t;
+
+typedef struct store_record
+{
+  uint8_t kind;                 // STORE_KIND_*: summary for STORE_KIND_SUMMARY, else window
+  store_window_t window;
+  store_summary_t summary;
+} store_record_t;
+
+typedef struct store_writer
+{
+  int fd;                       // open segment, -1 if none
+  char dir[STORE_PATH_MAX];
+  char prefix[STORE_PREFIX_MAX];
+  uint8_t level;
+  uint32_t segment;             // number of the open segment
+  uint64_t segment_bytes;       // bytes in it, buffered ones included
+  uint64_t committed;           // bytes of it synced to disk
+  uint32_t first_time;          // record times in it
+  uint32_t last_time;
+  uint8_t *buf;
+  size_t len;                   // bytes in buf
+  // group commit
+  uint32_t every_ms;            // sync records this old, 0: no time limit
+  uint32_t every_records;       // sync this many records, 0: no count limit
+  uint32_t pending;             // records appended since the last sync
+  uint64_t pending_ms;          // time the first of them was appended
+  // statistics
+  uint64_t records;             // records appended since store_open()
+  uint64_t bytes;
+  uint64_t commits;
+  uint64_t commit_ns;           // time spent syncing
+  uint64_t commit_max_ns;
+} store_writer_t;
+
+/**
+ * Header of a segment.
+ */
+typedef struct store_segment
+{
+  uint8_t level;
+  uint32_t first_time;          // record times, as of the last commit
+  uint32_t last_time;
+  uint64_t committed;
+  uint64_t size;
+} store_segment_t;
+
+/**
+ * Reads len bytes of a segment at offset into buf, as pread() does on its
+ * file: the bytes read, 0 at its end, -1 on error.
+ */
+typedef ssize_t (*store_read_fn)(void *ctx, void *buf, size_t len, uint64_t offset);
+
+/**
+ * Sequential reader of a segment, STORE_READ_SIZE bytes at a time.
+ */
+typedef struct store_reader
+{
+  int fd;
+  uint8_t *buf;
+  size_t len;                   // bytes in buf
+  size_t pos;                   // next record in buf
+  uint64_t offset;              // file offset of buf[0]
+  store_read_fn read;           // reads in place of pread() on fd, if set
+  void *read_ctx;
+} store_reader_t;
+
+typedef struct store_recovery
+{
+  uint32_t segments;            // segments looked at
+  uint32_t repaired;            // segments cut back to their last valid record
+  uint32_t skipped;             // not segments of this format
+  uint64_t scanned;             // bytes checked past the committed sizes
+  uint64_t truncated;           // bytes cut off
+} store_recovery_t;
+
+/**
+ * Open a writer appending to new segments <dir>/<prefix>-NNNNNN.seg of
+ * the given level, creating dir if needed. Existing segments are left
+ * alone: numbering skips past them. Records are synced only by
+ * store_commit() and store_close() until store_set_commit() is called.
+ */
+bool store_open(store_writer_t *w, const char *dir, const char *prefix, uint8_t level);
+
+/**
+ * Group commit: sync the records appended so far once the oldest of them
+ * is every_ms old or every_records have been appended, whichever comes
+ * first. A limit of 0 is not used; every_records = 1 syncs every record.
+ * Unsynced records stay in the writer's buffer (up to STORE_BUFFER_SIZE).
+ */
+void store_set_commit(store_writer_t *w, uint32_t every_ms, uint32_t every_records);
+
+/**
+ * Append a window of any kind, committing if the policy says so.
+ */
+bool store_append(store_writer_t *w, const store_window_t *win);
+
+/**
+ * Append a summary, committing if the policy says so.
+ */
+bool store_append_summary(store_writer_t *w, const store_summary_t *sum);
+
+/**
+ * Commit if the oldest pending record is every_ms old. Call from the main
+ * loop so that records are synced when no more come in.
+ */
+bool store_poll(store_writer_t *w);
+
+/**
+ * Write out the buffered records and sync them to disk.
+ */
+bool store_commit(store_writer_t *w);
+
+/**
+ * Commit and close the segment.
+ */
+bool store_close(store_writer_t *w);
+
+/**
+ * Seal the open segment: the next record starts a new one.
+ */
+bool store_rotate(store_writer_t *w);
+
+/**
+ * Path of the writer's open segment, "" if none.
+ */
+void store_segment_path(const store_writer_t *w, char *path, size_t size);
+
+/**
+ * Read the header of the segment at path. False if it is not a segment of
+ * this format.
+ */
+bool store_segment_info(const char *path, store_segment_t *seg);
+
+bool store_reader_open(store_reader_t *r, const char *path);
+
+/**
+ * Next record: 1, or 0 at the end of the segment (or at a record that is
+ * not valid), -1 on a read error.
+ */
+int store_reader_next(store_reader_t *r, store_record_t *rec);
+
+void store_reader_close(store_reader_t *r);
+
+/**
+ * Check the segments in dir after a crash: each is cut back to its last
+ * valid record, reading only what lies past its committed size. Call
+ * before opening writers on dir.
+ */
+bool store_recover(const char *dir, store_recovery_t *r);
+
+/**
+ * Encode a record (record header included) to out, STORE_RECORD_MAX
+ * bytes at most. Returns its length.
+ */
+size_t store_encode(const store_window_t *win, uint8_t *out);
+
+size_t store_encode_summary(const store_summary_t *sum, uint8_t *out);
+
+/**
+ * Decode the record at p, len bytes being available. Returns its length,
+ * 0 if it is cut short, malformed or fails its CRC.
+ */
+size_t store_decode(const uint8_t *p, size_t len, store_record_t *rec);
+
+/**
+ * Start a summary of one cow's windows over the period starting at start.
+ */
+void store_summary_init(store_summary_t *sum, uint16_t cow_id, uint8_t level, uint32_t start);
+
+/**
+ * Fold another part of the same period into sum.
+ */
+void store_summary_merge(store_summary_t *sum, const store_summary_t *part);
+
+/**
+ * Time of a window stamped hh:mm:ss (local time) on the day closest to
+ * ref, which should be within 12 hours of it. Not thread safe: it keeps
+ * the day of the last call.
+ */
+uint32_t store_local_time(uint8_t hour, uint8_t min, uint8_t sec, time_t ref);
+
+#endif // HOST_STORE_H
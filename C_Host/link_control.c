@@ -0,0 +1,92 @@
+#include "link_control.h"
+#include "cs_link.h"
+
+// RSSI average weight of a new report: 1/8
+#define LINK_EWMA_SHIFT 3
+
+// RSSI the controller reports when it has none
+#define LINK_RSSI_UNAVAILABLE 127
+
+void link_note_rssi(collar_t *collar, int8_t rssi)
+{
+  int16_t sample = (int16_t)(rssi * 16);
+
+  if (rssi == LINK_RSSI_UNAVAILABLE)
+  {
+    return;
+  }
+
+  if (collar->rssi_reports == 0)
+  {
+    collar->rssi_q4 = sample;
+  }
+  else
+  {
+    collar->rssi_q4 += (sample - collar->rssi_q4) / (1 << LINK_EWMA_SHIFT);
+  }
+  if (collar->rssi_reports < UINT16_MAX)
+  {
+    collar->rssi_reports++;
+  }
+}
+
+void link_note_level(collar_t *collar, uint8_t level)
+{
+  if (level >= CS_LINK_LEVELS)
+  {
+    return;
+  }
+
+  if (collar->link_known && level != collar->link_level)
+  {
+    // same path loss, new TX power (0.1 dBm -> 1/16 dBm)
+    collar->rssi_q4 += (cs_link_levels[level].tx_power - cs_link_levels[collar->link_level].tx_power) * 16 / 10;
+    collar->rssi_reports = 0;
+  }
+  collar->link_level = level;
+  collar->link_known = true;
+}
+
+// Margin above sensitivity of a level for a path loss in 1/16 dB
+static int32_t link_margin_q4(uint8_t level, int32_t path_loss_q4)
+{
+  const cs_link_level_t *l = &cs_link_levels[level];
+
+  return l->tx_power * 16 / 10 - path_loss_q4 - cs_link_sensitivity(l->phy) * 16;
+}
+
+uint8_t link_choose(const collar_t *collar)
+{
+  uint8_t current = collar->link_level;
+  uint8_t target = CS_LINK_LEVEL_DEFAULT;
+  int32_t path_loss_q4;
+  bool weak;
+
+  if (!collar->link_known || collar->rssi_reports == 0)
+  {
+    return current;
+  }
+
+  path_loss_q4 = cs_link_levels[current].tx_power * 16 / 10 - collar->rssi_q4;
+  weak = link_margin_q4(current, path_loss_q4) < LINK_MARGIN_DB * 16;
+
+  // cheapest level that clears the margin with room to spare
+  for (uint8_t level = 0; level < CS_LINK_LEVELS; level++)
+  {
+    if (link_margin_q4(level, path_loss_q4) >= (LINK_MARGIN_DB + LINK_HYST_DB) * 16)
+    {
+      target = level;
+    }
+  }
+
+  if (weak)
+  {
+    // losing the margin: move at once, to the default level if nothing fits
+    return target;
+  }
+  if (target > current && collar->rssi_reports >= LINK_MIN_REPORTS)
+  {
+    return target;
+  }
+  return current;
+}
@@ -0,0 +1,36 @@
+#ifndef LINK_CONTROL_H
+#define LINK_CONTROL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "collar_table.h"
+
+// Fade margin above receiver sensitivity a link level must keep (dB)
+#define LINK_MARGIN_DB 10
+
+// Extra margin a cheaper level needs before the collar is moved to it (dB)
+#define LINK_HYST_DB 4
+
+// Periodic reports at the current level before a cheaper level is chosen
+#define LINK_MIN_REPORTS 8
+
+/**
+ * Fold the RSSI of a periodic report into the collar's average.
+ */
+void link_note_rssi(collar_t *collar, int8_t rssi);
+
+/**
+ * Note the link level a collar reports over PAwR. On a change the RSSI
+ * average is shifted by the TX power difference and the report count
+ * restarts.
+ */
+void link_note_level(collar_t *collar, uint8_t level);
+
+/**
+ * Cheapest link level that keeps LINK_MARGIN_DB at the gateway, with
+ * hysteresis. Returns the current level when nothing should change.
+ */
+uint8_t link_choose(const collar_t *collar);
+
+#endif // LINK_CONTROL_H
@@ -0,0 +1,359 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ncp_capture.h"
+#include "ncp_host.h"
+#include "sl_bt_api.h"
+#include "sl_bt_ncp_host.h"
+#include "app_log.h"
+#include "cs_endian.h"
+
+// stdio buffer of the capture file, flushed whenever the NCP goes quiet
+#define CAPTURE_BUFFER_SIZE (256 * 1024)
+
+// Bytes peek() reports at most, across records that are due
+#define REPLAY_PEEK_MAX 4096
+
+static FILE *capture_file = NULL;
+static char *capture_buffer = NULL;
+static uint64_t capture_start_ns;
+
+static uint8_t *replay = NULL;      // whole capture file
+static size_t replay_size;          // up to the last complete record
+static size_t replay_rx;            // current NCP to host record
+static size_t replay_rx_off;        // bytes of it already read
+static size_t replay_tx;            // current host to NCP record
+static size_t replay_tx_off;
+static bool replay_paced;
+static bool replay_diverged;
+static bool replay_ended;
+static uint64_t replay_start_ns;
+static uint64_t replay_rx_bytes;
+static uint64_t replay_tx_bytes;
+static uint64_t replay_frames;
+static uint32_t frame_left;         // payload bytes of the frame being read
+static uint8_t frame_header[SL_BGAPI_MSG_HEADER_LEN];
+static uint8_t frame_header_len;
+
+static uint64_t now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/***************************************************************************
+ * Capture
+ ***************************************************************************/
+
+static void capture_record(uint8_t direction, uint32_t len, const uint8_t *data)
+{
+  uint8_t record[NCP_CAPTURE_RECORD_LEN];
+  uint64_t t = now_ns() - capture_start_ns;
+
+  // one transfer is at most a BGAPI frame, well below the u16 length
+  while (len > 0)
+  {
+    uint16_t n = (len > UINT16_MAX) ? UINT16_MAX : (uint16_t)len;
+
+    cs_put_le32(&record[0], (uint32_t)t);
+    cs_put_le32(&record[4], (uint32_t)(t >> 32));
+    record[8] = direction;
+    cs_put_le16(&record[9], n);
+    fwrite(record, 1, sizeof(record), capture_file);
+    fwrite(data, 1, n, capture_file);
+    data += n;
+    len -= n;
+  }
+}
+
+static void capture_tx(uint32_t len, uint8_t *data)
+{
+  capture_record(NCP_CAPTURE_TX, len, data);
+  ncp_host_tx(len, data);
+}
+
+static int32_t capture_rx(uint32_t len, uint8_t *data)
+{
+  int32_t n = ncp_host_rx(len, data);
+
+  if (n > 0)
+  {
+    capture_record(NCP_CAPTURE_RX, (uint32_t)n, data);
+  }
+  return n;
+}
+
+static int32_t capture_peek(void)
+{
+  int32_t n = ncp_host_peek();
+
+  // nothing pending: a good moment to get the buffer to disk
+  if (n <= 0)
+  {
+    fflush(capture_file);
+  }
+  return n;
+}
+
+sl_status_t ncp_capture_open(const char *path)
+{
+  capture_file = fopen(path, "wb");
+  if (capture_file == NULL)
+  {
+    return SL_STATUS_FAIL;
+  }
+
+  capture_buffer = malloc(CAPTURE_BUFFER_SIZE);
+  if (capture_buffer != NULL)
+  {
+    setvbuf(capture_file, capture_buffer, _IOFBF, CAPTURE_BUFFER_SIZE);
+  }
+  fwrite(NCP_CAPTURE_MAGIC, 1, NCP_CAPTURE_MAGIC_LEN, capture_file);
+  capture_start_ns = now_ns();
+
+  return sl_bt_api_initialize_nonblock(capture_tx, capture_rx, capture_peek);
+}
+
+void ncp_capture_close(void)
+{
+  if (capture_file == NULL)
+  {
+    return;
+  }
+  fclose(capture_file);
+  capture_file = NULL;
+  free(capture_buffer);
+  capture_buffer = NULL;
+}
+
+/***************************************************************************
+ * Replay
+ ***************************************************************************/
+
+static uint64_t record_ns(size_t pos)
+{
+  return cs_get_le32(&replay[pos]) | ((uint64_t)cs_get_le32(&replay[pos + 4]) << 32);
+}
+
+static uint16_t record_len(size_t pos)
+{
+  return cs_get_le16(&replay[pos + 9]);
+}
+
+// First record at or after pos in the given direction, replay_size if none
+static size_t record_find(size_t pos, uint8_t direction)
+{
+  while (pos < replay_size)
+  {
+    if (replay[pos + 8] == direction)
+    {
+      return pos;
+    }
+    pos += NCP_CAPTURE_RECORD_LEN + record_len(pos);
+  }
+  return replay_size;
+}
+
+static bool record_due(size_t pos)
+{
+  return !replay_paced || (record_ns(pos) <= now_ns() - replay_start_ns);
+}
+
+// Logged once, the main loop stops on ncp_replay_ended()
+static void replay_finish(void)
+{
+  double seconds = (double)(now_ns() - replay_start_ns) / 1e9;
+  double cpu = (double)clock() / CLOCKS_PER_SEC;
+
+  if (replay_ended)
+  {
+    return;
+  }
+  replay_ended = true;
+  app_log("Replay: %llu frames, %llu bytes in %.3f s (CPU %.3f s), %.0f frames/s, %.0f ns/frame" APP_LOG_NL,
+          (unsigned long long)replay_frames, (unsigned long long)replay_rx_bytes, seconds, cpu,
+          (seconds > 0) ? replay_frames / seconds : 0.0,
+          (replay_frames > 0) ? seconds * 1e9 / replay_frames : 0.0);
+  app_log("Replay: host sent %llu bytes, %s the capture" APP_LOG_NL,
+          (unsigned long long)replay_tx_bytes, replay_diverged ? "diverging from" : "matching");
+}
+
+// Count BGAPI frames in the bytes handed to the host
+static void replay_count(const uint8_t *data, uint32_t len)
+{
+  replay_rx_bytes += len;
+
+  while (len > 0)
+  {
+    if (frame_left > 0)
+    {
+      uint32_t n = (len < frame_left) ? len : frame_left;
+
+      frame_left -= n;
+      data += n;
+      len -= n;
+      continue;
+    }
+
+    frame_header[frame_header_len++] = *data++;
+    len--;
+    if (frame_header_len == SL_BGAPI_MSG_HEADER_LEN)
+    {
+      frame_left = SL_BGAPI_MSG_LEN(cs_get_le32(frame_header));
+      frame_header_len = 0;
+      replay_frames++;
+    }
+  }
+}
+
+static void replay_wait(size_t pos)
+{
+  uint64_t due = replay_start_ns + record_ns(pos);
+  uint64_t now = now_ns();
+
+  if (due > now)
+  {
+    struct timespec ts = { .tv_sec = (time_t)((due - now) / 1000000000ULL),
+                           .tv_nsec = (long)((due - now) % 1000000000ULL) };
+
+    nanosleep(&ts, NULL);
+  }
+}
+
+static int32_t replay_peek(void)
+{
+  size_t pos = replay_rx;
+  size_t off = replay_rx_off;
+  int32_t avail = 0;
+
+  if (replay_rx >= replay_size)
+  {
+    replay_finish();
+    return 0;
+  }
+
+  while ((pos < replay_size) && (avail < REPLAY_PEEK_MAX) && record_due(pos))
+  {
+    avail += record_len(pos) - off;
+    off = 0;
+    pos = record_find(pos + NCP_CAPTURE_RECORD_LEN + record_len(pos), NCP_CAPTURE_RX);
+  }
+  return avail;
+}
+
+// Reads block until the bytes are due, like a read on the serial port
+static int32_t replay_read(uint32_t len, uint8_t *data)
+{
+  uint32_t done = 0;
+
+  while (done < len)
+  {
+    uint32_t n;
+
+    if (replay_rx >= replay_size)
+    {
+      // a frame cut short fails the read in the host library
+      replay_finish();
+      break;
+    }
+    if (replay_paced)
+    {
+      replay_wait(replay_rx);
+    }
+
+    n = record_len(replay_rx) - replay_rx_off;
+    if (n > len - done)
+    {
+      n = len - done;
+    }
+    memcpy(&data[done], &replay[replay_rx + NCP_CAPTURE_RECORD_LEN + replay_rx_off], n);
+    done += n;
+    replay_rx_off += n;
+
+    if (replay_rx_off == record_len(replay_rx))
+    {
+      replay_rx = record_find(replay_rx + NCP_CAPTURE_RECORD_LEN + replay_rx_off, NCP_CAPTURE_RX);
+      replay_rx_off = 0;
+    }
+  }
+
+  replay_count(data, done);
+  return (done > 0) ? (int32_t)done : -1;
+}
+
+// Commands the host sends should be the ones it sent when the capture was made
+static void replay_write(uint32_t len, uint8_t *data)
+{
+  for (uint32_t i = 0; (i < len) && !replay_diverged; i++)
+  {
+    if ((replay_tx >= replay_size)
+        || (replay[replay_tx + NCP_CAPTURE_RECORD_LEN + replay_tx_off] != data[i]))
+    {
+      replay_diverged = true;
+      app_log_warning("Replay: host to NCP bytes differ from the capture at byte %llu,"
+                      " responses may no longer fit" APP_LOG_NL,
+                      (unsigned long long)(replay_tx_bytes + i));
+      break;
+    }
+    if (++replay_tx_off == record_len(replay_tx))
+    {
+      replay_tx = record_find(replay_tx + NCP_CAPTURE_RECORD_LEN + replay_tx_off, NCP_CAPTURE_TX);
+      replay_tx_off = 0;
+    }
+  }
+  replay_tx_bytes += len;
+}
+
+sl_status_t ncp_replay_open(const char *path, bool paced)
+{
+  FILE *f = fopen(path, "rb");
+  long size;
+  size_t pos;
+
+  if (f == NULL)
+  {
+    return SL_STATUS_FAIL;
+  }
+  if ((fseek(f, 0, SEEK_END) != 0) || ((size = ftell(f)) < NCP_CAPTURE_MAGIC_LEN)
+      || (fseek(f, 0, SEEK_SET) != 0))
+  {
+    fclose(f);
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  replay = malloc((size_t)size);
+  if ((replay == NULL) || (fread(replay, 1, (size_t)size, f) != (size_t)size)
+      || (memcmp(replay, NCP_CAPTURE_MAGIC, NCP_CAPTURE_MAGIC_LEN) != 0))
+  {
+    fclose(f);
+    free(replay);
+    replay = NULL;
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  fclose(f);
+
+  // a capture cut short by a crash ends at its last complete record
+  pos = NCP_CAPTURE_MAGIC_LEN;
+  while ((pos + NCP_CAPTURE_RECORD_LEN <= (size_t)size)
+         && (pos + NCP_CAPTURE_RECORD_LEN + cs_get_le16(&replay[pos + 9]) <= (size_t)size))
+  {
+    pos += NCP_CAPTURE_RECORD_LEN + cs_get_le16(&replay[pos + 9]);
+  }
+  replay_size = pos;
+
+  replay_rx = record_find(NCP_CAPTURE_MAGIC_LEN, NCP_CAPTURE_RX);
+  replay_tx = record_find(NCP_CAPTURE_MAGIC_LEN, NCP_CAPTURE_TX);
+  replay_paced = paced;
+  replay_start_ns = now_ns();
+
+  return sl_bt_api_initialize_nonblock(replay_write, replay_read, replay_peek);
+}
+
+bool ncp_replay_ended(void)
+{
+  return replay_ended;
+}
@@ -0,0 +1,52 @@
+#ifndef NCP_CAPTURE_H
+#define NCP_CAPTURE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sl_status.h"
+
+/**
+ * Capture file: NCP_CAPTURE_MAGIC, then one record per transport transfer:
+ *
+ *   u64 le  time since the capture started, ns
+ *   u8      direction, NCP_CAPTURE_RX or NCP_CAPTURE_TX
+ *   u16 le  length
+ *   bytes   the raw BGAPI bytes as they crossed the transport
+ */
+#define NCP_CAPTURE_MAGIC       "CSNCPCAP"
+#define NCP_CAPTURE_MAGIC_LEN   8
+#define NCP_CAPTURE_RECORD_LEN  11
+
+#define NCP_CAPTURE_RX          0   // NCP to host
+#define NCP_CAPTURE_TX          1   // host to NCP
+
+/**
+ * Record every byte exchanged with the NCP to path. Call after
+ * ncp_host_init(): the BGAPI host library is pointed at recording wrappers
+ * around the live transport.
+ */
+sl_status_t ncp_capture_open(const char *path);
+
+/**
+ * Flush and close the capture, if one is open.
+ */
+void ncp_capture_close(void);
+
+/**
+ * Present the NCP to host bytes of a capture to the BGAPI host library
+ * instead of an adapter. Paced replay keeps the recorded timing, otherwise
+ * the bytes are available as fast as the host reads them. Host to NCP
+ * bytes are compared with the capture and the first difference is logged.
+ * A summary is logged at the end of the capture, where reads fail and
+ * ncp_replay_ended() turns true.
+ */
+sl_status_t ncp_replay_open(const char *path, bool paced);
+
+/**
+ * True once the whole capture has been read. The main loop then stops and
+ * shuts the host down with app_deinit().
+ */
+bool ncp_replay_ended(void);
+
+#endif // NCP_CAPTURE_H
@@ -0,0 +1,311 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ota_batch.h"
+#include "delta_diff.h"
+#include "cs_endian.h"
+
+// Body bytes per write until the MTU is known: the ATT default of 23
+#define OTA_BATCH_CHUNK_MIN (23 - 3 - CS_DELTA_DATA_HEADER_LEN)
+
+typedef enum
+{
+  OTA_COW_WAITING,            // to be updated when heard, after retry_ms
+  OTA_COW_ACTIVE,
+  OTA_COW_DONE,
+  OTA_COW_OTHER_BASE,
+  OTA_COW_FAILED
+} ota_cow_state_t;
+
+typedef struct ota_cow
+{
+  ota_cow_state_t state;
+  uint8_t retries;
+  uint64_t retry_ms;
+  uint64_t begin_ms;          // first BEGIN taken, 0 before
+} ota_cow_t;
+
+ota_batch_stats_t ota_batch_stats;
+
+static uint8_t *patch = NULL;
+static cs_delta_header_t header;
+static ota_cow_t cows[256];
+static ota_session_t sessions[OTA_BATCH_SESSIONS];
+
+bool ota_batch_load(const char *path)
+{
+  FILE *f = fopen(path, "rb");
+  long size;
+
+  if (f == NULL)
+  {
+    return false;
+  }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  free(patch);
+  patch = (size > 0) ? malloc(size) : NULL;
+  if ((patch == NULL) || (fread(patch, 1, size, f) != (size_t)size) || !delta_check(patch, size, &header))
+  {
+    free(patch);
+    patch = NULL;
+    fclose(f);
+    return false;
+  }
+  fclose(f);
+
+  memset(cows, 0, sizeof(cows));
+  memset(sessions, 0, sizeof(sessions));
+  memset(&ota_batch_stats, 0, sizeof(ota_batch_stats));
+  return true;
+}
+
+const cs_delta_header_t *ota_batch_header(void)
+{
+  return patch ? &header : NULL;
+}
+
+static ota_session_t *free_session(void)
+{
+  for (int i = 0; i < OTA_BATCH_SESSIONS; i++)
+  {
+    if (sessions[i].step == OTA_STEP_FREE)
+    {
+      return &sessions[i];
+    }
+  }
+  return NULL;
+}
+
+bool ota_batch_want(uint8_t cow_id, uint64_t now_ms)
+{
+  const ota_cow_t *cow = &cows[cow_id];
+
+  return patch && (cow->state == OTA_COW_WAITING) && (now_ms >= cow->retry_ms) && free_session();
+}
+
+ota_session_t *ota_batch_start(uint8_t cow_id, uint8_t connection, uint64_t now_ms)
+{
+  ota_session_t *s = free_session();
+
+  if (s == NULL)
+  {
+    return NULL;
+  }
+  memset(s, 0, sizeof(*s));
+  s->step = OTA_STEP_CONNECTING;
+  s->cow_id = cow_id;
+  s->connection = connection;
+  s->chunk = OTA_BATCH_CHUNK_MIN;
+  s->start_ms = now_ms;
+  s->progress_ms = now_ms;
+
+  cows[cow_id].state = OTA_COW_ACTIVE;
+  ota_batch_stats.sessions++;
+  return s;
+}
+
+ota_session_t *ota_batch_session(uint8_t connection)
+{
+  for (int i = 0; i < OTA_BATCH_SESSIONS; i++)
+  {
+    if ((sessions[i].step != OTA_STEP_FREE) && (sessions[i].connection == connection))
+    {
+      return &sessions[i];
+    }
+  }
+  return NULL;
+}
+
+ota_session_t *ota_batch_get(int i)
+{
+  return &sessions[i];
+}
+
+void ota_batch_mtu(ota_session_t *s, uint16_t mtu)
+{
+  uint16_t chunk = (mtu > 3 + CS_DELTA_DATA_HEADER_LEN) ? mtu - 3 - CS_DELTA_DATA_HEADER_LEN : 0;
+
+  if (chunk > OTA_BATCH_CHUNK)
+  {
+    chunk = OTA_BATCH_CHUNK;
+  }
+  if (chunk >= OTA_BATCH_CHUNK_MIN)
+  {
+    s->chunk = chunk;
+  }
+}
+
+uint16_t ota_batch_begin(ota_session_t *s, uint8_t *command)
+{
+  command[0] = CS_DELTA_CMD_BEGIN;
+  memcpy(&command[1], patch, CS_DELTA_HEADER_LEN);
+  s->step = OTA_STEP_BEGIN;
+  return 1 + CS_DELTA_HEADER_LEN;
+}
+
+static void cow_give_up(ota_cow_t *cow, ota_cow_state_t state)
+{
+  cow->state = state;
+  if (state == OTA_COW_OTHER_BASE)
+  {
+    ota_batch_stats.other_base++;
+  }
+  else
+  {
+    ota_batch_stats.failed++;
+  }
+}
+
+void ota_batch_no_update(ota_session_t *s)
+{
+  cow_give_up(&cows[s->cow_id], OTA_COW_OTHER_BASE);
+}
+
+ota_do_t ota_batch_status(ota_session_t *s, const uint8_t *data, uint16_t len, uint64_t now_ms)
+{
+  ota_cow_t *cow = &cows[s->cow_id];
+  uint32_t taken;
+
+  if (len < CS_DELTA_STATUS_LEN)
+  {
+    return OTA_DO_NOTHING;
+  }
+  taken = cs_get_le32(&data[1]);
+  if (taken > s->taken)
+  {
+    s->progress_ms = now_ms;
+  }
+
+  switch (data[0])
+  {
+  case CS_DELTA_OK:
+    if (s->step == OTA_STEP_BEGIN)
+    {
+      // a resumed transfer carries on from the collar's offset
+      s->step = OTA_STEP_SEND;
+      s->sent = taken;
+      s->progress_ms = now_ms;
+      if (cow->begin_ms == 0)
+      {
+        cow->begin_ms = now_ms;
+      }
+    }
+    if (taken > s->taken)
+    {
+      s->taken = taken;
+    }
+    return (s->step == OTA_STEP_SEND) ? OTA_DO_SEND : OTA_DO_NOTHING;
+
+  case CS_DELTA_DONE:
+    if (s->step == OTA_STEP_INSTALL)
+    {
+      cow->state = OTA_COW_DONE;
+      ota_batch_stats.updated++;
+      ota_batch_stats.update_ms += now_ms - (cow->begin_ms ? cow->begin_ms : s->start_ms);
+      return OTA_DO_CLOSE;
+    }
+    s->taken = taken;
+    s->step = OTA_STEP_INSTALL;
+    s->progress_ms = now_ms;
+    return OTA_DO_INSTALL;
+
+  case CS_DELTA_ERR_OFFSET:
+    // writes lost on the way: back to where the collar is
+    if (s->step == OTA_STEP_SEND)
+    {
+      ota_batch_stats.rewinds++;
+      s->taken = taken;
+      s->sent = taken;
+    }
+    return OTA_DO_SEND;
+
+  case CS_DELTA_ERR_BASE:
+    cow_give_up(cow, OTA_COW_OTHER_BASE);
+    return OTA_DO_CLOSE;
+
+  case CS_DELTA_ERR_HEADER:
+  case CS_DELTA_ERR_SIZE:
+  case CS_DELTA_ERR_UNSIGNED:
+    // another try would get the same answer
+    cow_give_up(cow, OTA_COW_FAILED);
+    return OTA_DO_CLOSE;
+
+  case CS_DELTA_ERR_STATE:
+    // the collar lost the transfer (reset): start again on a new connection
+    return OTA_DO_CLOSE;
+
+  default:
+    // the image came out wrong: throw it away and try again
+    return OTA_DO_ABORT;
+  }
+}
+
+uint16_t ota_batch_next(const ota_session_t *s, uint8_t *buf)
+{
+  uint32_t n;
+
+  if ((s->step != OTA_STEP_SEND) || (s->sent >= header.body_len) || (s->sent - s->taken >= OTA_BATCH_WINDOW))
+  {
+    return 0;
+  }
+  n = header.body_len - s->sent;
+  if (n > s->chunk)
+  {
+    n = s->chunk;
+  }
+  cs_put_le32(buf, s->sent);
+  memcpy(&buf[CS_DELTA_DATA_HEADER_LEN], &patch[CS_DELTA_HEADER_LEN + s->sent], n);
+  return (uint16_t)(CS_DELTA_DATA_HEADER_LEN + n);
+}
+
+void ota_batch_sent(ota_session_t *s, uint16_t len)
+{
+  s->sent += len - CS_DELTA_DATA_HEADER_LEN;
+  ota_batch_stats.body_bytes += len - CS_DELTA_DATA_HEADER_LEN;
+}
+
+ota_session_t *ota_batch_stalled(uint64_t now_ms)
+{
+  for (int i = 0; i < OTA_BATCH_SESSIONS; i++)
+  {
+    ota_session_t *s = &sessions[i];
+
+    if ((s->step != OTA_STEP_FREE) && (now_ms - s->progress_ms >= OTA_BATCH_STALL_MS))
+    {
+      // once per stall period until the close comes through
+      s->progress_ms = now_ms;
+      return s;
+    }
+  }
+  return NULL;
+}
+
+void ota_batch_closed(uint8_t connection, uint64_t now_ms)
+{
+  ota_session_t *s = ota_batch_session(connection);
+  ota_cow_t *cow;
+
+  if (s == NULL)
+  {
+    return;
+  }
+  cow = &cows[s->cow_id];
+  if (cow->state == OTA_COW_ACTIVE)
+  {
+    if (++cow->retries >= OTA_BATCH_RETRIES)
+    {
+      cow_give_up(cow, OTA_COW_FAILED);
+    }
+    else
+    {
+      cow->state = OTA_COW_WAITING;
+      cow->retry_ms = now_ms + OTA_BATCH_BACKOFF_MS;
+      ota_batch_stats.retries++;
+    }
+  }
+  s->step = OTA_STEP_FREE;
+}
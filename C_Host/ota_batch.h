@@ -0,0 +1,167 @@
+#ifndef OTA_BATCH_H
+#define OTA_BATCH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cs_delta.h"
+
+/*
+ * Batch delta firmware update of the herd: one patch (delta_diff.h) sent
+ * to every collar whose bulk advertising is heard, over up to
+ * OTA_BATCH_SESSIONS bulk connections at once.
+ *
+ * A session finds the bulk service, turns on ota_ctrl notifications and
+ * writes BEGIN with the patch header. The collar checks the patch was
+ * made from the image it runs; one that runs another is left alone. The
+ * body then goes out in ota_data writes without response, at most
+ * OTA_BATCH_WINDOW bytes ahead of the progress the collar notified, and
+ * once the collar has the whole image it is told to install it.
+ *
+ * A session that drops or stalls is tried again after a backoff. The
+ * collar keeps its place across connections, so a retry resumes where the
+ * last one stopped. After OTA_BATCH_RETRIES failures the collar is given
+ * up on.
+ *
+ * The module issues no commands: the host applies what it returns.
+ */
+
+#define OTA_BATCH_SESSIONS 4
+
+// Body bytes in flight beyond the last progress notified
+#define OTA_BATCH_WINDOW (4 * CS_DELTA_ACK_BYTES)
+
+// Body bytes per ota_data write at the most: the collar's 247 byte MTU
+#define OTA_BATCH_CHUNK (247 - 3 - CS_DELTA_DATA_HEADER_LEN)
+
+#define OTA_BATCH_RETRIES 5
+#define OTA_BATCH_BACKOFF_MS 30000
+
+// A session without progress for this long is closed
+#define OTA_BATCH_STALL_MS 15000
+
+typedef enum
+{
+  OTA_STEP_FREE,
+  OTA_STEP_CONNECTING,
+  OTA_STEP_SERVICE,           // discovering the bulk service
+  OTA_STEP_CHARACTERISTICS,
+  OTA_STEP_NOTIFY,            // turning on ota_ctrl notifications
+  OTA_STEP_BEGIN,             // BEGIN written, waiting for the answer
+  OTA_STEP_SEND,
+  OTA_STEP_INSTALL            // INSTALL written
+} ota_step_t;
+
+// What the host should do after a notification
+typedef enum
+{
+  OTA_DO_NOTHING,
+  OTA_DO_SEND,                // write the body, ota_batch_next()
+  OTA_DO_INSTALL,             // write CS_DELTA_CMD_INSTALL to ota_ctrl
+  OTA_DO_ABORT,               // write CS_DELTA_CMD_ABORT, then close
+  OTA_DO_CLOSE
+} ota_do_t;
+
+typedef struct ota_session
+{
+  ota_step_t step;
+  uint8_t cow_id;
+  uint8_t connection;
+  uint32_t service;
+  uint16_t ctrl;
+  uint16_t data;
+  uint16_t chunk;             // body bytes per write
+  uint32_t sent;              // body bytes written
+  uint32_t taken;             // of them applied by the collar
+  uint64_t start_ms;
+  uint64_t progress_ms;
+} ota_session_t;
+
+typedef struct ota_batch_stats
+{
+  uint32_t sessions;          // connections opened
+  uint32_t updated;           // collars installing the new image
+  uint32_t other_base;        // collars running another image
+  uint32_t failed;            // given up on
+  uint32_t retries;
+  uint32_t rewinds;           // writes the collar did not get, sent again
+  uint64_t body_bytes;        // written, resent ones included
+  uint64_t update_ms;         // first BEGIN to install, summed over collars
+} ota_batch_stats_t;
+
+extern ota_batch_stats_t ota_batch_stats;
+
+/**
+ * Load and check the patch to send. False if it is not a whole patch.
+ */
+bool ota_batch_load(const char *path);
+
+/**
+ * The header of the patch loaded, NULL if none.
+ */
+const cs_delta_header_t *ota_batch_header(void);
+
+/**
+ * Bulk advertising of a collar was heard: true if a session to it should
+ * be opened now.
+ */
+bool ota_batch_want(uint8_t cow_id, uint64_t now_ms);
+
+/**
+ * A connection to the collar is being opened for its session.
+ */
+ota_session_t *ota_batch_start(uint8_t cow_id, uint8_t connection, uint64_t now_ms);
+
+/**
+ * The session on a connection, NULL if it is not one.
+ */
+ota_session_t *ota_batch_session(uint8_t connection);
+
+/**
+ * Session i of OTA_BATCH_SESSIONS, free or not.
+ */
+ota_session_t *ota_batch_get(int i);
+
+/**
+ * The ATT MTU of the session's connection.
+ */
+void ota_batch_mtu(ota_session_t *s, uint16_t mtu);
+
+/**
+ * The BEGIN command: CS_DELTA_CMD_BEGIN and the patch header, 1 +
+ * CS_DELTA_HEADER_LEN bytes. The session waits for the answer.
+ */
+uint16_t ota_batch_begin(ota_session_t *s, uint8_t *command);
+
+/**
+ * The collar has no ota_ctrl and ota_data: its firmware is older than
+ * delta updates, and it is left alone like one on another base.
+ */
+void ota_batch_no_update(ota_session_t *s);
+
+/**
+ * An ota_ctrl notification of the session's collar.
+ */
+ota_do_t ota_batch_status(ota_session_t *s, const uint8_t *data, uint16_t len, uint64_t now_ms);
+
+/**
+ * The next ota_data write, offset and body bytes, into buf (room for
+ * CS_DELTA_DATA_HEADER_LEN + OTA_BATCH_CHUNK). Returns its length, 0 if
+ * nothing may be sent now. Call ota_batch_sent() once it is written.
+ */
+uint16_t ota_batch_next(const ota_session_t *s, uint8_t *buf);
+
+void ota_batch_sent(ota_session_t *s, uint16_t len);
+
+/**
+ * A session that has made no progress for OTA_BATCH_STALL_MS, NULL if
+ * none. The host closes its connection.
+ */
+ota_session_t *ota_batch_stalled(uint64_t now_ms);
+
+/**
+ * The connection of a session closed, or could not be opened.
+ */
+void ota_batch_closed(uint8_t connection, uint64_t now_ms);
+
+#endif // OTA_BATCH_H
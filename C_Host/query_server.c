@@ -0,0 +1,818 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <time.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include "query_server.h"
+#include "store_query.h"
+#include "cs_features.h"
+#include "cs_classifier.h"
+
+// A client that stops reading is dropped after this long
+#define SEND_TIMEOUT_S 10
+
+typedef struct client_slot
+{
+  pthread_t thread;
+  int fd;
+  bool used;
+  atomic_bool done;           // its thread has ended and can be joined
+} client_slot_t;
+
+// A window or summary, or what is kept of several
+typedef struct sample
+{
+  uint32_t key;               // in a sample_table_t: the bucket, 0 for latest values
+  uint32_t time;
+  uint16_t cow_id;
+  uint8_t level;
+  uint32_t windows;
+  float mean[QUERY_FIELDS];
+  float min[QUERY_FIELDS];
+  float max[QUERY_FIELDS];
+  double sum[QUERY_FIELDS];   // aggregates: of mean * windows
+} sample_t;
+
+// Latest values or aggregates, open addressing on (key, cow)
+typedef struct sample_table
+{
+  sample_t *entries;
+  uint32_t count;
+  uint32_t *index;            // entry + 1, 0 if free
+  uint32_t size;              // power of two
+} sample_table_t;
+
+typedef struct client
+{
+  int fd;
+  query_request_t req;
+  size_t row_size;
+  uint8_t frame[sizeof(query_frame_t) + QUERY_FRAME_MAX];
+  size_t len;                 // row bytes in frame
+  uint64_t rows;
+  bool stop;                  // the client is gone, or the server stopping
+  bool failed;                // out of memory
+  sample_table_t table;
+} client_t;
+
+static int listen_fd = -1;
+static char socket_path[sizeof(((struct sockaddr_un *)NULL)->sun_path)];
+static char *store_dir = NULL;
+static store_cache_t *cache = NULL;
+static pthread_t accept_thread;
+static atomic_bool stopping;
+
+static client_slot_t slots[QUERY_MAX_CLIENTS];
+static pthread_mutex_t slots_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static query_server_stats_t server_stats;
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t mono_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static bool send_all(int fd, const void *buf, size_t len)
+{
+  const uint8_t *p = buf;
+
+  while (len > 0)
+  {
+    ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+
+    if (n < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    p += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+static bool recv_all(int fd, void *buf, size_t len)
+{
+  uint8_t *p = buf;
+
+  while (len > 0)
+  {
+    ssize_t n = recv(fd, p, len, 0);
+
+    if (n < 0 && errno == EINTR)
+    {
+      continue;
+    }
+    if (n <= 0)
+    {
+      return false;
+    }
+    p += n;
+    len -= (size_t)n;
+  }
+  return true;
+}
+
+static void block_signals(void)
+{
+  sigset_t all;
+
+  // signals are for the event thread
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, NULL);
+}
+
+size_t query_row_size(uint8_t op, uint16_t fields)
+{
+  size_t n = 0;
+
+  for (int i = 0; i < QUERY_FIELDS; i++)
+  {
+    n += (fields >> i) & 1;
+  }
+  return sizeof(query_row_t) + n * sizeof(float) * ((op == QUERY_AGGREGATE) ? 3 : 1);
+}
+
+/*
+ * Samples
+ */
+
+static void sample_set(sample_t *s, int field, float mean, float min, float max)
+{
+  s->mean[field] = mean;
+  s->min[field] = min;
+  s->max[field] = max;
+}
+
+static void window_sample(const store_window_t *win, uint16_t fields, sample_t *s)
+{
+  memset(s, 0, sizeof(*s));
+  s->time = win->time;
+  s->cow_id = win->cow_id;
+  s->level = STORE_RAW;
+  s->windows = 1;
+  if (win->kind == CS_KIND_SUMMARY)
+  {
+    float lying = (win->summary.posture == CS_POSTURE_LYING) ? 1.0f : 0.0f;
+
+    s->windows = (win->summary.windows > 0) ? win->summary.windows : 1;
+    sample_set(s, 0, win->summary.odba, win->summary.odba, win->summary.odba);
+    sample_set(s, 1, lying, lying, lying);
+  }
+  else if (win->kind == CS_KIND_CLASS)
+  {
+    uint32_t lying = 0;
+
+    for (uint8_t i = 0; i < win->n_labels; i++)
+    {
+      lying += (win->labels[i].class == CS_CLASS_LYING);
+    }
+    s->windows = (win->n_labels > 0) ? win->n_labels : 1;
+    sample_set(s, 0, NAN, NAN, NAN);
+    sample_set(s, 1, (float)lying / s->windows, (lying == s->windows) ? 1.0f : 0.0f, (lying > 0) ? 1.0f : 0.0f);
+  }
+  // the features only if asked for: they take most of the time
+  else if (fields & (QUERY_FIELD_ACTIVITY | QUERY_FIELD_LYING))
+  {
+    cs_features_acc_t acc;
+    cs_summary_t features;
+    float lying;
+
+    cs_features_reset(&acc);
+    cs_features_add_window(&acc, (const int16_t (*)[3])win->samples, win->n_samples);
+    cs_features_finish(&acc, &features);
+    lying = (features.posture == CS_POSTURE_LYING) ? 1.0f : 0.0f;
+    sample_set(s, 0, features.odba, features.odba, features.odba);
+    sample_set(s, 1, lying, lying, lying);
+  }
+  sample_set(s, 2, win->temp, win->temp, win->temp);
+  sample_set(s, 3, win->battery, win->battery, win->battery);
+  sample_set(s, 4, win->rssi, win->rssi, win->rssi);
+}
+
+static void stat_sample(sample_t *s, int field, const store_stat_t *stat, uint16_t windows)
+{
+  sample_set(s, field, (float)stat->sum / windows, stat->min, stat->max);
+}
+
+static void summary_sample(const store_summary_t *sum, sample_t *s)
+{
+  uint16_t windows = (sum->windows > 0) ? sum->windows : 1;
+
+  memset(s, 0, sizeof(*s));
+  s->time = sum->start;
+  s->cow_id = sum->cow_id;
+  s->level = sum->level;
+  s->windows = sum->windows;
+  if (sum->active > 0)
+  {
+    stat_sample(s, 0, &sum->activity, sum->active);
+  }
+  else
+  {
+    sample_set(s, 0, NAN, NAN, NAN);
+  }
+  sample_set(s, 1, (float)sum->lying / windows, (sum->lying == sum->windows) ? 1.0f : 0.0f,
+             (sum->lying > 0) ? 1.0f : 0.0f);
+  stat_sample(s, 2, &sum->temp, windows);
+  stat_sample(s, 3, &sum->battery, windows);
+  stat_sample(s, 4, &sum->rssi, windows);
+}
+
+static uint32_t sample_hash(uint32_t key, uint16_t cow_id)
+{
+  uint32_t h = key * 2654435761u;
+
+  h ^= (uint32_t)cow_id * 2246822519u;
+  return h ^ (h >> 15);
+}
+
+static bool table_grow(sample_table_t *t)
+{
+  uint32_t size = (t->size == 0) ? 1024 : t->size * 2;
+  uint32_t *index = calloc(size, sizeof(uint32_t));
+  sample_t *entries = realloc(t->entries, (size / 2) * sizeof(sample_t));
+
+  if ((index == NULL) || (entries == NULL))
+  {
+    free(index);
+    if (entries != NULL)
+    {
+      t->entries = entries;
+    }
+    return false;
+  }
+  for (uint32_t i = 0; i < t->count; i++)
+  {
+    uint32_t idx = sample_hash(entries[i].key, entries[i].cow_id) & (size - 1);
+
+    while (index[idx] != 0)
+    {
+      idx = (idx + 1) & (size - 1);
+    }
+    index[idx] = i + 1;
+  }
+  free(t->index);
+  t->index = index;
+  t->entries = entries;
+  t->size = size;
+  return true;
+}
+
+// The entry of (key, cow), added zeroed if new. NULL if out of memory.
+static sample_t *table_get(sample_table_t *t, uint32_t key, uint16_t cow_id, bool *added)
+{
+  uint32_t idx;
+  sample_t *e;
+
+  if ((t->count + 1 > t->size / 2) && !table_grow(t))
+  {
+    return NULL;
+  }
+  idx = sample_hash(key, cow_id) & (t->size - 1);
+  while (t->index[idx] != 0)
+  {
+    e = &t->entries[t->index[idx] - 1];
+    if ((e->key == key) && (e->cow_id == cow_id))
+    {
+      *added = false;
+      return e;
+    }
+    idx = (idx + 1) & (t->size - 1);
+  }
+  e = &t->entries[t->count];
+  memset(e, 0, sizeof(*e));
+  e->key = key;
+  e->time = key;
+  e->cow_id = cow_id;
+  t->index[idx] = ++t->count;
+  *added = true;
+  return e;
+}
+
+static void table_reset(sample_table_t *t)
+{
+  if (t->index != NULL)
+  {
+    memset(t->index, 0, t->size * sizeof(uint32_t));
+  }
+  t->count = 0;
+}
+
+static int by_time(const void *a, const void *b)
+{
+  const sample_t *x = a;
+  const sample_t *y = b;
+
+  if (x->time != y->time)
+  {
+    return (x->time > y->time) - (x->time < y->time);
+  }
+  return (x->cow_id > y->cow_id) - (x->cow_id < y->cow_id);
+}
+
+/*
+ * Rows
+ */
+
+// Send the rows in the frame
+static void flush_rows(client_t *c)
+{
+  query_frame_t head = { QUERY_FRAME_ROWS, (uint32_t)c->len };
+
+  if (c->len == 0)
+  {
+    return;
+  }
+  memcpy(c->frame, &head, sizeof(head));
+  if (!send_all(c->fd, c->frame, sizeof(head) + c->len))
+  {
+    c->stop = true;
+  }
+  c->len = 0;
+}
+
+static void put_row(client_t *c, const sample_t *s)
+{
+  bool aggregate = (c->req.op == QUERY_AGGREGATE);
+  query_row_t head = { s->time, s->cow_id, aggregate ? 0 : s->level, 0, s->windows };
+  uint8_t *p;
+
+  if (c->len + c->row_size > QUERY_FRAME_MAX)
+  {
+    flush_rows(c);
+  }
+  if (c->stop)
+  {
+    return;
+  }
+
+  p = &c->frame[sizeof(query_frame_t) + c->len];
+  memcpy(p, &head, sizeof(head));
+  p += sizeof(head);
+  for (int i = 0; i < QUERY_FIELDS; i++)
+  {
+    if (c->req.fields & (1u << i))
+    {
+      float mean = s->mean[i];
+
+      if (aggregate)
+      {
+        mean = (s->windows > 0) ? (float)(s->sum[i] / s->windows) : 0.0f;
+        memcpy(p, &s->min[i], sizeof(float));
+        memcpy(p + sizeof(float), &s->max[i], sizeof(float));
+        p += 2 * sizeof(float);
+      }
+      memcpy(p, &mean, sizeof(float));
+      p += sizeof(float);
+    }
+  }
+  c->len += c->row_size;
+  c->rows++;
+}
+
+static void keep_latest(client_t *c, const sample_t *s)
+{
+  bool added;
+  sample_t *e = table_get(&c->table, 0, s->cow_id, &added);
+
+  if (e == NULL)
+  {
+    c->failed = c->stop = true;
+    return;
+  }
+  // a window over the summary of its period
+  if (added || (s->time > e->time) || ((s->time == e->time) && (s->level == STORE_RAW)))
+  {
+    *e = *s;
+    e->key = 0;
+  }
+}
+
+static void add_to_bucket(client_t *c, const sample_t *s)
+{
+  uint32_t bucket = c->req.from;
+  bool added;
+  sample_t *e;
+
+  if (c->req.bucket_s > 0)
+  {
+    bucket = s->time - s->time % c->req.bucket_s;
+  }
+  e = table_get(&c->table, bucket, s->cow_id, &added);
+  if (e == NULL)
+  {
+    c->failed = c->stop = true;
+    return;
+  }
+  for (int i = 0; i < QUERY_FIELDS; i++)
+  {
+    if (added || (s->min[i] < e->min[i]))
+    {
+      e->min[i] = s->min[i];
+    }
+    if (added || (s->max[i] > e->max[i]))
+    {
+      e->max[i] = s->max[i];
+    }
+    e->sum[i] += (double)s->mean[i] * s->windows;
+  }
+  e->windows += s->windows;
+}
+
+static void take_sample(client_t *c, const sample_t *s)
+{
+  if (atomic_load_explicit(&stopping, memory_order_relaxed))
+  {
+    c->stop = true;
+    return;
+  }
+  switch (c->req.op)
+  {
+    case QUERY_RANGE:
+      put_row(c, s);
+      break;
+    case QUERY_LATEST:
+      keep_latest(c, s);
+      break;
+    default:
+      add_to_bucket(c, s);
+      break;
+  }
+}
+
+static void on_window(const store_window_t *win, void *ctx)
+{
+  client_t *c = ctx;
+  sample_t s;
+
+  window_sample(win, c->req.fields, &s);
+  take_sample(c, &s);
+}
+
+static void on_summary(const store_summary_t *sum, void *ctx)
+{
+  client_t *c = ctx;
+  sample_t s;
+
+  summary_sample(sum, &s);
+  take_sample(c, &s);
+}
+
+static bool valid(const query_request_t *req)
+{
+  return (req->magic == QUERY_MAGIC) && (req->version == QUERY_VERSION) && (req->op >= QUERY_RANGE)
+         && (req->op <= QUERY_AGGREGATE) && ((req->fields & ~QUERY_FIELD_ALL) == 0) && (req->from < req->to);
+}
+
+static bool send_end(int fd, const query_end_t *end)
+{
+  struct
+  {
+    query_frame_t head;
+    query_end_t end;
+  } frame = { { QUERY_FRAME_END, sizeof(query_end_t) }, *end };
+
+  return send_all(fd, &frame, sizeof(frame));
+}
+
+static void run_query(client_t *c)
+{
+  store_query_t q = { c->req.from, c->req.to, c->req.all_cows != 0, c->req.cow_id, cache, &c->stop };
+  store_query_stats_t qs;
+  query_end_t end;
+  uint64_t start = mono_us();
+  bool ok;
+
+  memset(&end, 0, sizeof(end));
+  c->row_size = query_row_size(c->req.op, c->req.fields);
+  c->len = 0;
+  c->rows = 0;
+  c->failed = false;
+  table_reset(&c->table);
+
+  ok = store_query(store_dir, &q, on_window, on_summary, c, &qs);
+  if (ok && !c->stop && (c->req.op != QUERY_RANGE))
+  {
+    qsort(c->table.entries, c->table.count, sizeof(sample_t), by_time);
+    for (uint32_t i = 0; (i < c->table.count) && !c->stop; i++)
+    {
+      put_row(c, &c->table.entries[i]);
+    }
+  }
+  flush_rows(c);
+
+  end.status = (ok && !c->failed) ? QUERY_OK : QUERY_STORE_ERROR;
+  end.segments = qs.segments;
+  end.pruned = qs.pruned;
+  end.rows = c->rows;
+  end.cache_hits = qs.cache_hits;
+  end.cache_misses = qs.cache_misses;
+  end.elapsed_us = mono_us() - start;
+
+  pthread_mutex_lock(&stats_lock);
+  server_stats.queries++;
+  server_stats.failed += (end.status != QUERY_OK);
+  server_stats.rows += c->rows;
+  pthread_mutex_unlock(&stats_lock);
+
+  if (!c->stop && !send_end(c->fd, &end))
+  {
+    c->stop = true;
+  }
+}
+
+static void *client_main(void *arg)
+{
+  client_slot_t *slot = arg;
+  client_t *c = calloc(1, sizeof(client_t));
+
+  block_signals();
+  if (c != NULL)
+  {
+    c->fd = slot->fd;
+    while (!c->stop && !atomic_load(&stopping) && recv_all(c->fd, &c->req, sizeof(c->req)))
+    {
+      if (!valid(&c->req))
+      {
+        query_end_t end = { .status = QUERY_BAD_REQUEST };
+
+        pthread_mutex_lock(&stats_lock);
+        server_stats.failed++;
+        pthread_mutex_unlock(&stats_lock);
+        send_end(c->fd, &end);
+        break;
+      }
+      run_query(c);
+    }
+    free(c->table.entries);
+    free(c->table.index);
+    free(c);
+  }
+  atomic_store(&slot->done, true);
+  return NULL;
+}
+
+// Join the threads of clients gone. Under slots_lock.
+static void reap(bool all)
+{
+  for (int i = 0; i < QUERY_MAX_CLIENTS; i++)
+  {
+    client_slot_t *slot = &slots[i];
+
+    if (slot->used && (all || atomic_load(&slot->done)))
+    {
+      pthread_join(slot->thread, NULL);
+      close(slot->fd);
+      slot->used = false;
+    }
+  }
+}
+
+static void serve(int fd)
+{
+  struct timeval timeout = { SEND_TIMEOUT_S, 0 };
+  struct timeval idle = { QUERY_IDLE_TIMEOUT_S, 0 };
+  client_slot_t *slot = NULL;
+
+  // a client that stops reading, or sends nothing, gives its slot back
+  setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+  setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &idle, sizeof(idle));
+
+  pthread_mutex_lock(&slots_lock);
+  reap(false);
+  for (int i = 0; (i < QUERY_MAX_CLIENTS) && (slot == NULL); i++)
+  {
+    if (!slots[i].used)
+    {
+      slot = &slots[i];
+    }
+  }
+  if (slot != NULL)
+  {
+    slot->fd = fd;
+    slot->used = true;
+    atomic_store(&slot->done, false);
+    if (pthread_create(&slot->thread, NULL, client_main, slot) != 0)
+    {
+      slot->used = false;
+      slot = NULL;
+    }
+  }
+  pthread_mutex_unlock(&slots_lock);
+
+  pthread_mutex_lock(&stats_lock);
+  server_stats.connections++;
+  server_stats.busy += (slot == NULL);
+  pthread_mutex_unlock(&stats_lock);
+
+  if (slot == NULL)
+  {
+    query_end_t end = { .status = QUERY_BUSY };
+
+    send_end(fd, &end);
+    close(fd);
+  }
+}
+
+static void *accept_main(void *arg)
+{
+  (void)arg;
+  block_signals();
+  for (;;)
+  {
+    int fd = accept(listen_fd, NULL, NULL);
+
+    if (atomic_load(&stopping))
+    {
+      if (fd >= 0)
+      {
+        close(fd);
+      }
+      return NULL;
+    }
+    if (fd < 0)
+    {
+      if ((errno == EMFILE) || (errno == ENFILE) || (errno == ENOMEM) || (errno == ENOBUFS))
+      {
+        // out of descriptors for now: let clients end
+        usleep(10000);
+      }
+      continue;
+    }
+    serve(fd);
+  }
+}
+
+bool query_server_start(const char *path, const char *dir, size_t cache_bytes)
+{
+  struct sockaddr_un addr;
+  struct stat st;
+
+  if ((listen_fd >= 0) || (strlen(path) >= sizeof(addr.sun_path)))
+  {
+    errno = EINVAL;
+    return false;
+  }
+  // a socket left behind by a host that did not stop cleanly, not a file
+  if (lstat(path, &st) == 0)
+  {
+    if (!S_ISSOCK(st.st_mode))
+    {
+      errno = EEXIST;
+      return false;
+    }
+    unlink(path);
+  }
+
+  store_dir = strdup(dir);
+  cache = store_cache_create(cache_bytes);
+  listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if ((store_dir == NULL) || (cache == NULL) || (listen_fd < 0))
+  {
+    goto fail;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+  if ((bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) || (listen(listen_fd, QUERY_MAX_CLIENTS) != 0))
+  {
+    goto fail;
+  }
+  snprintf(socket_path, sizeof(socket_path), "%s", path);
+
+  memset(&server_stats, 0, sizeof(server_stats));
+  memset(slots, 0, sizeof(slots));
+  atomic_store(&stopping, false);
+  if (pthread_create(&accept_thread, NULL, accept_main, NULL) != 0)
+  {
+    unlink(socket_path);
+    goto fail;
+  }
+  return true;
+
+fail:
+  {
+    int err = errno;
+
+    if (listen_fd >= 0)
+    {
+      close(listen_fd);
+      listen_fd = -1;
+    }
+    store_cache_destroy(cache);
+    cache = NULL;
+    free(store_dir);
+    store_dir = NULL;
+    errno = err;
+    return false;
+  }
+}
+
+void query_server_stop(void)
+{
+  if (listen_fd < 0)
+  {
+    return;
+  }
+  atomic_store(&stopping, true);
+  // wakes accept()
+  shutdown(listen_fd, SHUT_RDWR);
+  pthread_join(accept_thread, NULL);
+  close(listen_fd);
+  listen_fd = -1;
+  unlink(socket_path);
+
+  // ends the reads and writes of the clients; their queries see stopping
+  pthread_mutex_lock(&slots_lock);
+  for (int i = 0; i < QUERY_MAX_CLIENTS; i++)
+  {
+    if (slots[i].used)
+    {
+      shutdown(slots[i].fd, SHUT_RDWR);
+    }
+  }
+  reap(true);
+  pthread_mutex_unlock(&slots_lock);
+
+  store_cache_destroy(cache);
+  cache = NULL;
+  free(store_dir);
+  store_dir = NULL;
+}
+
+void query_server_get_stats(query_server_stats_t *stats, store_cache_stats_t *cache_stats)
+{
+  pthread_mutex_lock(&stats_lock);
+  *stats = server_stats;
+  pthread_mutex_unlock(&stats_lock);
+  if (cache_stats != NULL)
+  {
+    memset(cache_stats, 0, sizeof(*cache_stats));
+    if (cache != NULL)
+    {
+      store_cache_get_stats(cache, cache_stats);
+    }
+  }
+}
+
+/*
+ * Client side
+ */
+
+int query_connect(const char *path)
+{
+  struct sockaddr_un addr;
+  int fd;
+
+  if (strlen(path) >= sizeof(addr.sun_path))
+  {
+    errno = EINVAL;
+    return -1;
+  }
+  fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+  {
+    return -1;
+  }
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  snprintf(addr.sun_path, sizeof(addr.sun_path), "%s", path);
+  if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0)
+  {
+    int err = errno;
+
+    close(fd);
+    errno = err;
+    return -1;
+  }
+  return fd;
+}
+
+bool query_send(int fd, query_request_t *req)
+{
+  req->magic = QUERY_MAGIC;
+  req->version = QUERY_VERSION;
+  return send_all(fd, req, sizeof(*req));
+}
+
+bool query_read_frame(int fd, query_frame_t *frame, void *buf, size_t cap)
+{
+  return recv_all(fd, frame, sizeof(*frame)) && (frame->len <= cap) && recv_all(fd, buf, frame->len);
+}
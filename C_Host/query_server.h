@@ -0,0 +1,167 @@
+#ifndef QUERY_SERVER_H
+#define QUERY_SERVER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "store_cache.h"
+
+/*
+ * Query service over the window store, on a local Unix stream socket, so
+ * that dashboards and other consumers ask the host for herd data rather
+ * than each scanning the store or the CSV logs on its own.
+ *
+ * A client sends a query_request_t and reads frames back until a
+ * QUERY_FRAME_END one, then may send another request on the same
+ * connection; one idle for QUERY_IDLE_TIMEOUT_S is closed. Rows are streamed as the store is read, in QUERY_FRAME_ROWS
+ * frames of whole rows:
+ *
+ *   QUERY_RANGE      a row per window, then per minute or hour summary
+ *                    retention left in place of older windows (see
+ *                    store_query()), each with the fields asked for
+ *   QUERY_LATEST     a row per cow: its newest window (or summary) in the
+ *                    range
+ *   QUERY_AGGREGATE  a row per cow and bucket of bucket_s seconds (0: the
+ *                    whole range), with the minimum, maximum and mean of
+ *                    each field over the windows in it
+ *
+ * Rows are a query_row_t followed by a float per field asked for, in the
+ * order of the QUERY_FIELD_* bits (three per field for QUERY_AGGREGATE:
+ * minimum, maximum, mean). Summaries give the mean of their windows, and
+ * the minimum and maximum to aggregates. Like the shared memory feed
+ * (shm_feed.h), requests and rows are the host's own structs: clients are
+ * built with this header on the same machine.
+ *
+ * Every client thread reads the store through one store_cache_t, so
+ * dashboards polling the same recent data read it from disk once.
+ */
+
+#define QUERY_MAGIC 0x59525143u   // "CQRY"
+#define QUERY_VERSION 1
+
+#define QUERY_DEFAULT_SOCKET "cow_query.sock"
+#define QUERY_DEFAULT_CACHE_MB 64
+
+// Clients served at once; more are told QUERY_BUSY
+#define QUERY_MAX_CLIENTS 32
+
+// A connection with no request for this long is closed, freeing its slot
+#define QUERY_IDLE_TIMEOUT_S 60
+
+// Rows per QUERY_FRAME_ROWS frame at most fill this many bytes
+#define QUERY_FRAME_MAX (64u << 10)
+
+// Operations
+#define QUERY_RANGE     1
+#define QUERY_LATEST    2
+#define QUERY_AGGREGATE 3
+
+// Fields
+#define QUERY_FIELD_ACTIVITY 0x01   // ODBA, mg; NAN for class label windows
+#define QUERY_FIELD_LYING    0x02   // 1 if lying; of a summary, the share of its windows
+#define QUERY_FIELD_TEMP     0x04
+#define QUERY_FIELD_BATTERY  0x08
+#define QUERY_FIELD_RSSI     0x10
+#define QUERY_FIELDS         5
+#define QUERY_FIELD_ALL      0x1f
+
+// Frame types
+#define QUERY_FRAME_ROWS 1
+#define QUERY_FRAME_END  2
+
+// Status of a query
+#define QUERY_OK          0
+#define QUERY_BAD_REQUEST 1
+#define QUERY_STORE_ERROR 2
+#define QUERY_BUSY        3   // too many clients: the server closes the connection
+
+typedef struct query_request
+{
+  uint32_t magic;             // QUERY_MAGIC
+  uint16_t version;           // QUERY_VERSION
+  uint8_t op;                 // QUERY_RANGE, QUERY_LATEST, QUERY_AGGREGATE
+  uint8_t all_cows;
+  uint16_t cow_id;            // unless all_cows
+  uint16_t fields;            // QUERY_FIELD_*
+  uint32_t from;              // times from, s since the epoch
+  uint32_t to;                // up to, not included
+  uint32_t bucket_s;          // QUERY_AGGREGATE: bucket length, 0: the whole range
+} query_request_t;
+
+typedef struct query_frame
+{
+  uint32_t type;              // QUERY_FRAME_*
+  uint32_t len;               // bytes after this header
+} query_frame_t;
+
+typedef struct query_row
+{
+  uint32_t time;              // window time, summary or bucket start
+  uint16_t cow_id;
+  uint8_t level;              // STORE_RAW for a window, STORE_MINUTE, STORE_HOUR; 0 for aggregates
+  uint8_t reserved;
+  uint32_t windows;           // windows the row covers
+} query_row_t;
+
+// Body of the QUERY_FRAME_END frame
+typedef struct query_end
+{
+  uint32_t status;            // QUERY_OK, ...
+  uint32_t segments;          // segments read
+  uint32_t pruned;            // segments skipped by their time range
+  uint32_t reserved;
+  uint64_t rows;
+  uint64_t cache_hits;        // pages of the store read from the cache
+  uint64_t cache_misses;      // read from disk
+  uint64_t elapsed_us;
+} query_end_t;
+
+typedef struct query_server_stats
+{
+  uint64_t connections;
+  uint64_t busy;              // connections turned away
+  uint64_t queries;
+  uint64_t failed;
+  uint64_t rows;
+} query_server_stats_t;
+
+/**
+ * Serve the store in dir on the Unix socket at path (replacing one left
+ * behind), reading through a page cache of cache_bytes. Queries run on a
+ * thread per client. False on error (errno set).
+ */
+bool query_server_start(const char *path, const char *dir, size_t cache_bytes);
+
+/**
+ * Close the socket, end the queries running and wait for their threads,
+ * then free the cache. Read the stats before.
+ */
+void query_server_stop(void);
+
+void query_server_get_stats(query_server_stats_t *stats, store_cache_stats_t *cache);
+
+/**
+ * Bytes of each row a query returns.
+ */
+size_t query_row_size(uint8_t op, uint16_t fields);
+
+/**
+ * Client side: connect to the server at path. The socket, or -1 (errno
+ * set).
+ */
+int query_connect(const char *path);
+
+/**
+ * Send a request (magic and version are filled in).
+ */
+bool query_send(int fd, query_request_t *req);
+
+/**
+ * Read the next frame, its body to buf (cap bytes at least
+ * QUERY_FRAME_MAX). False if the connection ended or sent a frame too
+ * long.
+ */
+bool query_read_frame(int fd, query_frame_t *frame, void *buf, size_t cap);
+
+#endif // QUERY_SERVER_H
@@ -0,0 +1,368 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "shm_feed.h"
+
+#define PATH_LEN (SHM_FEED_NAME_MAX + sizeof(SHM_FEED_WAKE_SUFFIX))
+
+// Ring: read-only to everyone but the host. Wake page: any reader blocks on it.
+#define RING_MODE 0444
+#define WAKE_MODE 0666
+
+static bool feed_path(const char *name, const char *suffix, char *path)
+{
+  if ((name == NULL) || (name[0] == '\0') || (strchr(name, '/') != NULL) || (strlen(name) >= SHM_FEED_NAME_MAX))
+  {
+    errno = EINVAL;
+    return false;
+  }
+  snprintf(path, PATH_LEN, "/%s%s", name, suffix);
+  return true;
+}
+
+// Create path with exactly mode, whatever the umask, mapped read-write
+static void *feed_map_new(const char *path, mode_t mode, size_t len, int flags)
+{
+  void *map;
+  int fd;
+
+  // a feed left behind by a host that did not stop cleanly
+  shm_unlink(path);
+  fd = shm_open(path, O_CREAT | O_EXCL | O_RDWR, mode);
+  if (fd < 0)
+  {
+    return NULL;
+  }
+  if ((fchmod(fd, mode) != 0) || (ftruncate(fd, (off_t)len) != 0))
+  {
+    close(fd);
+    shm_unlink(path);
+    return NULL;
+  }
+  map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | flags, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    shm_unlink(path);
+    return NULL;
+  }
+  return map;
+}
+
+static size_t feed_len(uint32_t slots)
+{
+  return sizeof(shm_feed_header_t) + (size_t)slots * sizeof(shm_feed_slot_t);
+}
+
+// The futex word is shared between processes: no FUTEX_PRIVATE_FLAG
+static void futex_wake(_Atomic uint32_t *word)
+{
+  syscall(SYS_futex, (uint32_t *)word, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
+}
+
+static void futex_wait(_Atomic uint32_t *word, uint32_t value, const struct timespec *timeout)
+{
+  syscall(SYS_futex, (uint32_t *)word, FUTEX_WAIT, value, timeout, NULL, 0);
+}
+
+bool shm_feed_create(shm_feed_writer_t *w, const char *name, uint32_t slots)
+{
+  char path[PATH_LEN];
+  char wake_path[PATH_LEN];
+  size_t len;
+  void *map;
+
+  memset(w, 0, sizeof(*w));
+  if (!feed_path(name, "", path) || !feed_path(name, SHM_FEED_WAKE_SUFFIX, wake_path))
+  {
+    return false;
+  }
+  if ((slots == 0) || (slots & (slots - 1)))
+  {
+    errno = EINVAL;
+    return false;
+  }
+
+  // readers find the wake page before the ring is ready
+  w->wake = feed_map_new(wake_path, WAKE_MODE, sizeof(shm_feed_wake_t), 0);
+  if (w->wake == NULL)
+  {
+    return false;
+  }
+  // populated now, so that publishing never takes a page fault
+  len = feed_len(slots);
+  map = feed_map_new(path, RING_MODE, len, MAP_POPULATE);
+  if (map == NULL)
+  {
+    munmap(w->wake, sizeof(shm_feed_wake_t));
+    shm_unlink(wake_path);
+    w->wake = NULL;
+    return false;
+  }
+
+  w->header = map;
+  w->slots = (shm_feed_slot_t *)((uint8_t *)map + sizeof(shm_feed_header_t));
+  w->map_len = len;
+  w->mask = slots - 1;
+  w->head = 0;
+  snprintf(w->name, sizeof(w->name), "%s", name);
+
+  w->header->layout = SHM_FEED_LAYOUT;
+  w->header->record_size = sizeof(shm_feed_slot_t);
+  w->header->slots = slots;
+  w->header->writer_pid = (int32_t)getpid();
+  atomic_store_explicit(&w->header->magic, SHM_FEED_MAGIC, memory_order_release);
+  return true;
+}
+
+void shm_feed_publish(shm_feed_writer_t *w, const cs_window_t *window, uint32_t counter, int8_t rssi,
+                      uint8_t source)
+{
+  shm_feed_slot_t *slot = &w->slots[w->head & w->mask];
+  shm_feed_record_t *rec = &slot->record;
+  struct timespec ts;
+
+  atomic_store_explicit(&slot->lock, 2 * w->head + 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+
+  rec->seq = w->head;
+  rec->time_s = time(NULL);
+  rec->counter = counter;
+  rec->rssi = rssi;
+  rec->source = source;
+  memcpy(&rec->window, window, sizeof(*window));
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  rec->publish_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+
+  atomic_store_explicit(&slot->lock, 2 * (w->head + 1), memory_order_release);
+  w->head++;
+
+  // seq_cst with the reader's waiters then head: one of the two sees the other
+  atomic_store(&w->header->head, w->head);
+  if (atomic_load(&w->wake->waiters) != 0)
+  {
+    atomic_fetch_add(&w->wake->wake, 1);
+    futex_wake(&w->wake->wake);
+  }
+}
+
+void shm_feed_destroy(shm_feed_writer_t *w)
+{
+  char path[PATH_LEN];
+
+  if (w->header == NULL)
+  {
+    return;
+  }
+  atomic_store(&w->header->closed, 1);
+  atomic_fetch_add(&w->wake->wake, 1);
+  futex_wake(&w->wake->wake);
+  munmap(w->header, w->map_len);
+  munmap(w->wake, sizeof(shm_feed_wake_t));
+  if (feed_path(w->name, "", path))
+  {
+    shm_unlink(path);
+  }
+  if (feed_path(w->name, SHM_FEED_WAKE_SUFFIX, path))
+  {
+    shm_unlink(path);
+  }
+  w->header = NULL;
+  w->slots = NULL;
+  w->wake = NULL;
+}
+
+bool shm_feed_open(shm_feed_reader_t *r, const char *name, bool oldest)
+{
+  char path[PATH_LEN];
+  const shm_feed_header_t *h;
+  struct stat st;
+  uint64_t head;
+  void *map;
+  void *wake;
+  int fd;
+
+  memset(r, 0, sizeof(*r));
+  if (!feed_path(name, SHM_FEED_WAKE_SUFFIX, path))
+  {
+    return false;
+  }
+  fd = shm_open(path, O_RDWR, 0);
+  if (fd < 0)
+  {
+    return false;
+  }
+  if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(shm_feed_wake_t)))
+  {
+    close(fd);
+    errno = EAGAIN;
+    return false;
+  }
+  wake = mmap(NULL, sizeof(shm_feed_wake_t), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  close(fd);
+  if (wake == MAP_FAILED)
+  {
+    return false;
+  }
+
+  feed_path(name, "", path);
+  fd = shm_open(path, O_RDONLY, 0);
+  if (fd < 0)
+  {
+    munmap(wake, sizeof(shm_feed_wake_t));
+    return false;
+  }
+  if ((fstat(fd, &st) != 0) || ((size_t)st.st_size < sizeof(shm_feed_header_t)))
+  {
+    close(fd);
+    munmap(wake, sizeof(shm_feed_wake_t));
+    errno = EAGAIN;
+    return false;
+  }
+  map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED)
+  {
+    munmap(wake, sizeof(shm_feed_wake_t));
+    return false;
+  }
+
+  h = map;
+  if ((atomic_load_explicit(&h->magic, memory_order_acquire) != SHM_FEED_MAGIC) || (h->layout != SHM_FEED_LAYOUT)
+      || (h->record_size != sizeof(shm_feed_slot_t)) || (h->slots == 0) || (h->slots & (h->slots - 1))
+      || (feed_len(h->slots) > (size_t)st.st_size))
+  {
+    munmap(map, (size_t)st.st_size);
+    munmap(wake, sizeof(shm_feed_wake_t));
+    errno = EPROTO;
+    return false;
+  }
+
+  r->header = h;
+  r->slots = (const shm_feed_slot_t *)((const uint8_t *)map + sizeof(shm_feed_header_t));
+  r->wake = wake;
+  r->map_len = (size_t)st.st_size;
+  r->mask = h->slots - 1;
+  head = atomic_load_explicit(&h->head, memory_order_acquire);
+  r->next = head;
+  if (oldest)
+  {
+    r->next = (head > r->mask) ? head - r->mask - 1 : 0;
+  }
+  return true;
+}
+
+const shm_feed_record_t *shm_feed_next(shm_feed_reader_t *r)
+{
+  uint64_t head = atomic_load_explicit(&r->header->head, memory_order_acquire);
+  uint64_t slots = (uint64_t)r->mask + 1;
+
+  while (r->next < head)
+  {
+    const shm_feed_slot_t *slot;
+    uint64_t lock;
+
+    if (head - r->next > slots)
+    {
+      r->lost += head - slots - r->next;
+      r->next = head - slots;
+    }
+    slot = &r->slots[r->next & r->mask];
+    lock = atomic_load_explicit(&slot->lock, memory_order_acquire);
+    if (lock == 2 * (r->next + 1))
+    {
+      r->lock = lock;
+      return &slot->record;
+    }
+    // overwritten, or being overwritten, by a record a ring later
+    r->lost++;
+    r->next++;
+  }
+  return NULL;
+}
+
+bool shm_feed_done(shm_feed_reader_t *r)
+{
+  const shm_feed_slot_t *slot = &r->slots[r->next & r->mask];
+  bool intact;
+
+  atomic_thread_fence(memory_order_acquire);
+  intact = atomic_load_explicit(&slot->lock, memory_order_relaxed) == r->lock;
+  if (!intact)
+  {
+    r->lost++;
+  }
+  r->next++;
+  r->lock = 0;
+  return intact;
+}
+
+bool shm_feed_read(shm_feed_reader_t *r, shm_feed_record_t *out)
+{
+  const shm_feed_record_t *rec;
+
+  for (;;)
+  {
+    rec = shm_feed_next(r);
+    if (rec == NULL)
+    {
+      return false;
+    }
+    memcpy(out, rec, sizeof(*out));
+    if (shm_feed_done(r))
+    {
+      return true;
+    }
+  }
+}
+
+bool shm_feed_wait(shm_feed_reader_t *r, int timeout_ms)
+{
+  const shm_feed_header_t *h = r->header;
+  struct timespec ts;
+  uint32_t wake;
+
+  if (atomic_load_explicit(&h->head, memory_order_acquire) > r->next)
+  {
+    return true;
+  }
+
+  atomic_fetch_add(&r->wake->waiters, 1);
+  wake = atomic_load(&r->wake->wake);
+  if ((atomic_load(&h->head) <= r->next) && !atomic_load(&h->closed))
+  {
+    ts.tv_sec = timeout_ms / 1000;
+    ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000;
+    futex_wait(&r->wake->wake, wake, (timeout_ms < 0) ? NULL : &ts);
+  }
+  atomic_fetch_sub(&r->wake->waiters, 1);
+
+  return atomic_load_explicit(&h->head, memory_order_acquire) > r->next;
+}
+
+bool shm_feed_ended(const shm_feed_reader_t *r)
+{
+  return atomic_load(&r->header->closed) && (atomic_load(&r->header->head) <= r->next);
+}
+
+void shm_feed_close(shm_feed_reader_t *r)
+{
+  if (r->header != NULL)
+  {
+    munmap((void *)r->header, r->map_len);
+    munmap(r->wake, sizeof(shm_feed_wake_t));
+    r->header = NULL;
+    r->slots = NULL;
+    r->wake = NULL;
+  }
+}
@@ -0,0 +1,166 @@
+#ifndef SHM_FEED_H
+#define SHM_FEED_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+
+#include "cs_payload.h"
+
+/*
+ * Live feed of decoded windows in shared memory (/dev/shm/<name>), for
+ * local processes that would otherwise tail and parse the CSV logs.
+ *
+ * The host writes every window it logs, with its metadata, into the next
+ * slot of a ring and never waits for a reader: a reader that falls more
+ * than a ring behind loses the oldest records and is told how many. Each
+ * slot is a seqlock: its lock is odd while the host writes it and
+ * 2 * (seq + 1) once record seq is in it. A reader looks at a record in
+ * place, then checks the lock is unchanged before trusting what it read,
+ * so any number of readers share the feed without copies, locks or
+ * writes to it.
+ *
+ * The ring is only writable by the host: readers open and map it read-only
+ * (mode 0444), whatever user they run as. A blocking reader counts itself
+ * in waiters in a second, world-writable page (/dev/shm/<name>.wake) that
+ * the host only checks and bumps, never indexes by.
+ *
+ * Records are the host's own structs: readers are built with this header
+ * on the same machine, and check layout and record_size when they open
+ * the feed.
+ */
+
+#define SHM_FEED_MAGIC 0x444545465f574f43ull   // "COW_FEED"
+
+// Changes whenever shm_feed_record_t or cs_window_t does
+#define SHM_FEED_LAYOUT 2
+
+#define SHM_FEED_DEFAULT_NAME "cow_feed"
+#define SHM_FEED_DEFAULT_SLOTS 16384
+
+#define SHM_FEED_NAME_MAX 64
+
+// Name of the wake page: the feed's name with this after it
+#define SHM_FEED_WAKE_SUFFIX ".wake"
+
+// How the window reached the host
+#define SHM_FEED_PERIODIC 0
+#define SHM_FEED_BULK     1
+
+typedef struct shm_feed_record
+{
+  uint64_t seq;               // publication number, from 0
+  uint64_t publish_ns;        // CLOCK_MONOTONIC when published
+  int64_t time_s;             // gateway wall clock when the window was logged
+  uint32_t counter;           // periodic event counter; bulk: the window's 32-bit sequence
+  int8_t rssi;                // 0 over bulk
+  uint8_t source;             // SHM_FEED_PERIODIC, SHM_FEED_BULK
+  cs_window_t window;
+} shm_feed_record_t;
+
+typedef struct shm_feed_slot
+{
+  _Atomic uint64_t lock;
+  shm_feed_record_t record;
+} __attribute__((aligned(64))) shm_feed_slot_t;
+
+typedef struct shm_feed_header
+{
+  _Atomic uint64_t magic;     // set last: the feed is ready
+  uint32_t layout;
+  uint32_t record_size;       // sizeof(shm_feed_slot_t)
+  uint32_t slots;             // power of two
+  int32_t writer_pid;
+  _Atomic uint32_t closed;    // the host has stopped publishing
+  _Atomic uint64_t head __attribute__((aligned(64)));   // records published
+} __attribute__((aligned(64))) shm_feed_header_t;
+
+// The only part of the feed readers write
+typedef struct shm_feed_wake
+{
+  _Atomic uint32_t waiters;   // readers blocked in shm_feed_wait()
+  _Atomic uint32_t wake;      // futex word, bumped when waiters is not 0
+} __attribute__((aligned(64))) shm_feed_wake_t;
+
+typedef struct shm_feed_writer
+{
+  shm_feed_header_t *header;
+  shm_feed_slot_t *slots;
+  shm_feed_wake_t *wake;
+  size_t map_len;
+  uint32_t mask;              // slots - 1, never read back from the shared header
+  uint64_t head;
+  char name[SHM_FEED_NAME_MAX];
+} shm_feed_writer_t;
+
+typedef struct shm_feed_reader
+{
+  const shm_feed_header_t *header;
+  const shm_feed_slot_t *slots;
+  shm_feed_wake_t *wake;
+  size_t map_len;
+  uint32_t mask;              // slots - 1
+  uint64_t next;              // seq of the next record to read
+  uint64_t lock;              // of the record being looked at, 0 if none
+  uint64_t lost;              // records overwritten before they were read
+} shm_feed_reader_t;
+
+/**
+ * Create the feed /dev/shm/<name> with slots records (power of two),
+ * replacing one left behind. False on error (errno set).
+ */
+bool shm_feed_create(shm_feed_writer_t *w, const char *name, uint32_t slots);
+
+/**
+ * Publish a window. Never blocks; wakes blocked readers if there are any.
+ */
+void shm_feed_publish(shm_feed_writer_t *w, const cs_window_t *window, uint32_t counter, int8_t rssi,
+                      uint8_t source);
+
+/**
+ * Mark the feed closed and remove its name. Readers still mapping it keep
+ * reading what is there.
+ */
+void shm_feed_destroy(shm_feed_writer_t *w);
+
+/**
+ * Open the feed for reading at the newest record, or at the oldest still
+ * in the ring. False if it does not exist yet or has another layout.
+ */
+bool shm_feed_open(shm_feed_reader_t *r, const char *name, bool oldest);
+
+/**
+ * The next record, in place in the ring, NULL if there is none yet.
+ * Records overwritten before they could be read are skipped and counted
+ * in lost. Call shm_feed_done() when finished with it.
+ */
+const shm_feed_record_t *shm_feed_next(shm_feed_reader_t *r);
+
+/**
+ * Finished with the record shm_feed_next() returned: true if the host did
+ * not overwrite it meanwhile, so what was read from it holds. False means
+ * it was lost (and counted).
+ */
+bool shm_feed_done(shm_feed_reader_t *r);
+
+/**
+ * Copy the next record out: shm_feed_next(), memcpy, shm_feed_done().
+ * False if there is none yet.
+ */
+bool shm_feed_read(shm_feed_reader_t *r, shm_feed_record_t *out);
+
+/**
+ * Block until a record newer than those read is published, the feed is
+ * closed, or timeout_ms passes (-1: no limit). True if there is a record.
+ */
+bool shm_feed_wait(shm_feed_reader_t *r, int timeout_ms);
+
+/**
+ * The host closed the feed and everything published has been read.
+ */
+bool shm_feed_ended(const shm_feed_reader_t *r);
+
+void shm_feed_close(shm_feed_reader_t *r);
+
+#endif // SHM_FEED_H
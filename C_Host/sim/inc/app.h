@@ -0,0 +1,22 @@
+/*
+ * app.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Herd generator: the application entry points of the bt_host_empty
+ *  project, implemented by C_Host/app.c.
+ */
+
+#ifndef APP_H_
+#define APP_H_
+
+
+void app_init(int argc, char *argv[]);
+
+void app_process_action(void);
+
+void app_deinit(void);
+
+
+#endif /* APP_H_ */
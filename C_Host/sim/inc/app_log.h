@@ -0,0 +1,34 @@
+/*
+ * app_log.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Herd generator: host logging goes to stdout as it does on the gateway,
+ *  so its cost is part of the measured CPU per report. Redirect stdout to
+ *  /dev/null to keep the terminal usable.
+ */
+
+#ifndef APP_LOG_H_
+#define APP_LOG_H_
+
+
+#include "stdio.h"
+#include "sl_status.h"
+
+
+#define APP_LOG_NL          "\n"
+#define APP_LOG_OPTSTRING   ""
+#define APP_LOG_USAGE       ""
+#define APP_LOG_OPTIONS     ""
+
+#define app_log(...)          printf(__VA_ARGS__)
+#define app_log_info(...)     printf(__VA_ARGS__)
+#define app_log_warning(...)  printf(__VA_ARGS__)
+#define app_log_error(...)    printf(__VA_ARGS__)
+
+
+sl_status_t app_log_set_option(char option, char *value);
+
+
+#endif /* APP_LOG_H_ */
@@ -0,0 +1,17 @@
+/*
+ * app_log_cli.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Herd generator: the host takes no log options here, see app_log.h.
+ */
+
+#ifndef APP_LOG_CLI_H_
+#define APP_LOG_CLI_H_
+
+
+#include "app_log.h"
+
+
+#endif /* APP_LOG_CLI_H_ */
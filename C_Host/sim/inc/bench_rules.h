@@ -0,0 +1,28 @@
+/*
+ * bench_rules.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Alert rules fixture of alert_bench.c and pool_bench.c: the example
+ *  rules (C_Host/alerts.conf) with short runs so that they fire now and
+ *  then, repeated with shifted thresholds, and a count of what they fire.
+ */
+
+#ifndef BENCH_RULES_H_
+#define BENCH_RULES_H_
+
+
+#include <stdint.h>
+
+
+// Hand count rules (up to ALERT_MAX_RULES) to the alert engine, with a
+// handler that counts the alerts fired from any thread
+void bench_rules_load(uint8_t count);
+
+// Alerts fired since the rules were loaded or the count reset
+uint32_t bench_rules_alerts(void);
+void bench_rules_reset_alerts(void);
+
+
+#endif /* BENCH_RULES_H_ */
@@ -0,0 +1,14 @@
+/*
+ * gatt_db.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Herd generator: the host has no local GATT database.
+ */
+
+#ifndef GATT_DB_H_
+#define GATT_DB_H_
+
+
+#endif /* GATT_DB_H_ */
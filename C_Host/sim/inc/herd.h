@@ -0,0 +1,74 @@
+/*
+ * herd.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Herd generator: C_Host/app.c built for Linux against a simulated NCP
+ *  (C_Host/sim/src/herd_ncp.c). The NCP queues the events of the virtual
+ *  herd, sends them over a UART of the configured rate and drops events it
+ *  has no room for, like the NCP firmware does when the host falls behind.
+ *  Host commands are answered from a model of the stack state and cost
+ *  their round trip on the UART. herd_main.c generates the collars' radio
+ *  traffic and drives the host; replay_main.c feeds it an NCP capture.
+ */
+
+#ifndef HERD_H_
+#define HERD_H_
+
+
+#include "sl_bt_api.h"
+
+
+// Deepest NCP event queue
+#define HERD_NCP_QUEUE_MAX    4096
+
+// Longest BGAPI event payload the herd sends: an advertising report
+#define HERD_EVENT_MAX        (27 + 255)
+
+
+typedef struct herd_ncp_stats{
+  uint32_t events;          // events handed to the host
+  uint64_t event_bytes;     // BGAPI bytes of those events
+  uint32_t dropped;         // events the NCP had no room for
+  uint32_t queue_peak;      // most events waiting at once
+  uint32_t commands;        // commands sent by the host
+  uint64_t command_bytes;   // BGAPI bytes of the commands and their responses
+}herd_ncp_stats_t;
+
+// The stack asks the herd to sync to an advertiser (sl_bt_sync_scanner_open)
+typedef sl_status_t (*herd_sync_open_t)(const bd_addr *address, uint8_t adv_sid, uint16_t *sync);
+
+// The host closes a sync at now_us (sl_bt_sync_close)
+typedef sl_status_t (*herd_sync_close_t)(uint16_t sync, uint64_t now_us);
+
+// The host sets the data of a PAwR subevent at now_us (sl_bt_pawr_advertiser_set_subevent_data)
+typedef void (*herd_subevent_data_t)(uint8_t subevent, const uint8_t *data, size_t len, uint64_t now_us);
+
+
+void herd_ncp_setup(uint32_t baud, uint32_t queue_depth, herd_sync_open_t sync_open);
+
+void herd_ncp_hooks(herd_sync_close_t sync_close, herd_subevent_data_t subevent_data);
+
+bool herd_ncp_push(sl_bt_msg_t *evt, uint16_t len, uint64_t now_us, uint32_t tag);
+
+bool herd_ncp_next(uint64_t *ready_us);
+
+void herd_ncp_release(uint64_t *queued_us, uint32_t *tag);
+
+uint64_t herd_ncp_command_us(void);
+
+void herd_ncp_clock(uint64_t now_us);
+
+bool herd_ncp_scanning(void);
+
+bool herd_ncp_hears(uint8_t phy, uint64_t t_us);
+
+uint64_t herd_ncp_sync_timeout_us(void);
+
+bool herd_ncp_pawr(uint8_t *handle, uint16_t *interval);
+
+void herd_ncp_stats(herd_ncp_stats_t *stats);
+
+
+#endif /* HERD_H_ */
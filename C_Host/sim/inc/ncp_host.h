@@ -0,0 +1,37 @@
+/*
+ * ncp_host.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Herd generator: the NCP transport is the simulated one in
+ *  C_Host/sim/src/herd_ncp.c, so it takes no options.
+ */
+
+#ifndef NCP_HOST_H_
+#define NCP_HOST_H_
+
+
+#include "stdint.h"
+#include "sl_status.h"
+
+
+#define NCP_HOST_OPTSTRING  ""
+#define NCP_HOST_USAGE      ""
+#define NCP_HOST_OPTIONS    ""
+
+
+sl_status_t ncp_host_init(void);
+
+void ncp_host_deinit(void);
+
+sl_status_t ncp_host_set_option(char option, char *value);
+
+void ncp_host_tx(uint32_t len, uint8_t *data);
+
+int32_t ncp_host_rx(uint32_t len, uint8_t *data);
+
+int32_t ncp_host_peek(void);
+
+
+#endif /* NCP_HOST_H_ */
@@ -0,0 +1,320 @@
+/*
+ * sl_bt_api.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Herd generator: the part of the Bluetooth host API used by C_Host/app.c,
+ *  implemented by C_Host/sim/src/herd_ncp.c. Names, constants, event layout
+ *  and the BGAPI message header follow the SDK so the host builds unchanged.
+ *  Events are packed as in the SDK: the BGAPI payload on the wire is the
+ *  event struct byte for byte.
+ */
+
+#ifndef SL_BT_API_H_
+#define SL_BT_API_H_
+
+
+#include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+#include "sl_status.h"
+
+
+#define PACKSTRUCT(decl) decl __attribute__((__packed__))
+
+typedef PACKSTRUCT(struct {
+  uint8_t addr[6];
+}) bd_addr;
+
+typedef PACKSTRUCT(struct {
+  uint8_t len;
+  uint8_t data[255];
+}) uint8array;
+
+
+// PHYs
+#define sl_bt_gap_phy_1m      0x1
+#define sl_bt_gap_phy_2m      0x2
+#define sl_bt_gap_phy_coded   0x4
+#define sl_bt_gap_phy_any     0xff
+
+#define sl_bt_gap_1m_phy      0x1
+#define sl_bt_gap_2m_phy      0x2
+#define sl_bt_gap_coded_phy   0x4
+
+// Advertising
+#define sl_bt_extended_advertiser_non_connectable 0x0
+
+// Scanner and sync
+#define sl_bt_scanner_scan_phy_1m             0x1
+#define sl_bt_scanner_scan_phy_coded          0x4
+#define sl_bt_scanner_scan_phy_1m_and_coded   0x5
+
+#define sl_bt_scanner_scan_mode_passive       0x0
+#define sl_bt_scanner_scan_mode_active        0x1
+
+#define sl_bt_scanner_discover_limited        0x0
+#define sl_bt_scanner_discover_generic        0x1
+#define sl_bt_scanner_discover_observation    0x2
+
+#define sl_bt_sync_report_none                0x0
+#define sl_bt_sync_report_all                 0x1
+
+// GATT client
+#define sl_bt_gatt_disable                    0x0
+#define sl_bt_gatt_notification               0x1
+#define sl_bt_gatt_indication                 0x2
+
+
+// BGAPI message header: type and length high bits, length, class, command
+#define SL_BT_MSG_ID(HDR)       ((HDR) & 0xffff00f8)
+#define SL_BGAPI_MSG_LEN(HDR)   ((((HDR) & 0x7) << 8) | (((HDR) & 0xff00) >> 8))
+#define SL_BGAPI_MSG_HEADER(ID, LEN) \
+  ((ID) | (((uint32_t)(LEN) & 0xff) << 8) | (((uint32_t)(LEN) >> 8) & 0x7))
+#define SL_BGAPI_MSG_HEADER_LEN 4
+#define SL_BGAPI_MAX_PAYLOAD_SIZE 2047
+
+// Events
+#define sl_bt_evt_system_boot_id                            0x000100a0
+#define sl_bt_evt_connection_opened_id                      0x000600a0
+#define sl_bt_evt_connection_closed_id                      0x010600a0
+#define sl_bt_evt_connection_parameters_id                  0x020600a0
+#define sl_bt_evt_gatt_mtu_exchanged_id                     0x000900a0
+#define sl_bt_evt_gatt_service_id                           0x010900a0
+#define sl_bt_evt_gatt_characteristic_id                    0x020900a0
+#define sl_bt_evt_gatt_characteristic_value_id              0x040900a0
+#define sl_bt_evt_gatt_procedure_completed_id               0x060900a0
+#define sl_bt_evt_scanner_legacy_advertisement_report_id    0x000500a0
+#define sl_bt_evt_scanner_extended_advertisement_report_id  0x020500a0
+#define sl_bt_evt_periodic_sync_opened_id                   0x004200a0
+#define sl_bt_evt_sync_closed_id                            0x014200a0
+#define sl_bt_evt_periodic_sync_report_id                   0x024200a0
+#define sl_bt_evt_pawr_advertiser_subevent_data_request_id  0x005500a0
+#define sl_bt_evt_pawr_advertiser_response_report_id        0x025500a0
+
+typedef PACKSTRUCT(struct {
+  uint16_t major;
+  uint16_t minor;
+  uint16_t patch;
+  uint16_t build;
+  uint32_t bootloader;
+  uint16_t hw;
+  uint32_t hash;
+}) sl_bt_evt_system_boot_t;
+
+typedef PACKSTRUCT(struct {
+  bd_addr address;
+  uint8_t address_type;
+  uint8_t master;
+  uint8_t connection;
+  uint8_t bonding;
+  uint8_t advertiser;
+  uint16_t sync;
+}) sl_bt_evt_connection_opened_t;
+
+typedef PACKSTRUCT(struct {
+  uint16_t reason;
+  uint8_t connection;
+}) sl_bt_evt_connection_closed_t;
+
+typedef PACKSTRUCT(struct {
+  uint8_t connection;
+  uint16_t interval;
+  uint16_t latency;
+  uint16_t timeout;
+  uint8_t security_mode;
+  uint16_t txsize;
+}) sl_bt_evt_connection_parameters_t;
+
+typedef PACKSTRUCT(struct {
+  uint8_t connection;
+  uint16_t mtu;
+}) sl_bt_evt_gatt_mtu_exchanged_t;
+
+typedef PACKSTRUCT(struct {
+  uint8_t connection;
+  uint32_t service;
+  uint8array uuid;
+}) sl_bt_evt_gatt_service_t;
+
+typedef PACKSTRUCT(struct {
+  uint8_t connection;
+  uint16_t characteristic;
+  uint8_t properties;
+  uint8array uuid;
+}) sl_bt_evt_gatt_characteristic_t;
+
+typedef PACKSTRUCT(struct {
+  uint8_t connection;
+  uint16_t characteristic;
+  uint8_t att_opcode;
+  uint16_t offset;
+  uint8array value;
+}) sl_bt_evt_gatt_characteristic_value_t;
+
+typedef PACKSTRUCT(struct {
+  uint8_t connection;
+  uint16_t result;
+}) sl_bt_evt_gatt_procedure_completed_t;
+
+typedef PACKSTRUCT(struct {
+  uint8_t event_flags;
+  bd_addr address;
+  uint8_t address_type;
+  uint8_t bonding;
+  int8_t rssi;
+  uint8_t channel;
+  bd_addr target_address;
+  uint8_t target_address_type;
+  uint8array data;
+}) sl_bt_evt_scanner_legacy_advertisement_report_t;
+
+typedef PACKSTRUCT(struct {
+  uint8_t event_flags;
+  bd_addr address;
+  uint8_t address_type;
+  uint8_t bonding;
+  int8_t rssi;
+  uint8_t channel;
+  bd_addr target_address;
+  uint8_t target_address_type;
+  uint8_t adv_sid;
+  uint8_t primary_phy;
+  uint8_t secondary_phy;
+  int8_t tx_power;
+  uint16_t periodic_interval;
+  uint8_t data_completeness;
+  uint8_t counter;
+  uint8array data;
+}) sl_bt_evt_scanner_extended_advertisement_report_t;
+
+typedef PACKSTRUCT(struct {
+  uint16_t sync;
+  uint8_t adv_sid;
+  bd_addr address;
+  uint8_t address_type;
+  uint8_t adv_phy;
+  uint16_t adv_interval;
+  uint16_t clock_accuracy;
+  uint8_t bonding;
+}) sl_bt_evt_periodic_sync_opened_t;
+
+typedef PACKSTRUCT(struct {
+  uint16_t reason;
+  uint16_t sync;
+}) sl_bt_evt_sync_closed_t;
+
+typedef PACKSTRUCT(struct {
+  uint16_t sync;
+  int8_t tx_power;
+  int8_t rssi;
+  uint8_t cte_type;
+  uint8_t data_status;
+  uint16_t counter;
+  uint8array data;
+}) sl_bt_evt_periodic_sync_report_t;
+
+typedef PACKSTRUCT(struct {
+  uint8_t advertising_set;
+  uint8_t subevent_start;
+  uint8_t subevent_data_count;
+}) sl_bt_evt_pawr_advertiser_subevent_data_request_t;
+
+typedef PACKSTRUCT(struct {
+  uint8_t advertising_set;
+  uint8_t subevent;
+  int8_t tx_power;
+  int8_t rssi;
+  uint8_t cte_type;
+  uint8_t channel_index;
+  uint8_t response_slot;
+  uint8_t data_status;
+  uint16_t counter;
+  uint8array data;
+}) sl_bt_evt_pawr_advertiser_response_report_t;
+
+typedef PACKSTRUCT(struct {
+  uint32_t header;
+  union {
+    sl_bt_evt_system_boot_t evt_system_boot;
+    sl_bt_evt_connection_opened_t evt_connection_opened;
+    sl_bt_evt_connection_closed_t evt_connection_closed;
+    sl_bt_evt_connection_parameters_t evt_connection_parameters;
+    sl_bt_evt_gatt_mtu_exchanged_t evt_gatt_mtu_exchanged;
+    sl_bt_evt_gatt_service_t evt_gatt_service;
+    sl_bt_evt_gatt_characteristic_t evt_gatt_characteristic;
+    sl_bt_evt_gatt_characteristic_value_t evt_gatt_characteristic_value;
+    sl_bt_evt_gatt_procedure_completed_t evt_gatt_procedure_completed;
+    sl_bt_evt_scanner_legacy_advertisement_report_t evt_scanner_legacy_advertisement_report;
+    sl_bt_evt_scanner_extended_advertisement_report_t evt_scanner_extended_advertisement_report;
+    sl_bt_evt_periodic_sync_opened_t evt_periodic_sync_opened;
+    sl_bt_evt_sync_closed_t evt_sync_closed;
+    sl_bt_evt_periodic_sync_report_t evt_periodic_sync_report;
+    sl_bt_evt_pawr_advertiser_subevent_data_request_t evt_pawr_advertiser_subevent_data_request;
+    sl_bt_evt_pawr_advertiser_response_report_t evt_pawr_advertiser_response_report;
+    uint8_t payload[SL_BGAPI_MAX_PAYLOAD_SIZE];
+  } data;
+}) sl_bt_msg_t;
+
+
+// Commands used by the host
+sl_status_t sl_bt_advertiser_create_set(uint8_t *handle);
+
+sl_status_t sl_bt_advertiser_set_timing(uint8_t handle, uint32_t interval_min, uint32_t interval_max,
+                                        uint16_t duration, uint8_t maxevents);
+
+sl_status_t sl_bt_extended_advertiser_set_phy(uint8_t handle, uint8_t primary_phy, uint8_t secondary_phy);
+
+sl_status_t sl_bt_extended_advertiser_set_data(uint8_t handle, size_t data_len, const uint8_t *data);
+
+sl_status_t sl_bt_extended_advertiser_start(uint8_t handle, uint8_t connect, uint32_t flags);
+
+sl_status_t sl_bt_pawr_advertiser_start(uint8_t handle, uint16_t interval_min, uint16_t interval_max,
+                                        uint32_t flags, uint8_t num_subevents, uint8_t subevent_interval,
+                                        uint8_t response_slot_delay, uint8_t response_slot_spacing,
+                                        uint8_t response_slots);
+
+sl_status_t sl_bt_pawr_advertiser_set_subevent_data(uint8_t handle, uint8_t subevent,
+                                                    uint8_t response_slot_start, uint8_t response_slot_count,
+                                                    size_t adv_data_len, const uint8_t *adv_data);
+
+sl_status_t sl_bt_scanner_set_parameters(uint8_t mode, uint16_t interval, uint16_t window);
+
+sl_status_t sl_bt_scanner_start(uint8_t scanning_phy, uint8_t discover_mode);
+
+sl_status_t sl_bt_scanner_stop(void);
+
+sl_status_t sl_bt_sync_scanner_set_sync_parameters(uint16_t skip, uint16_t timeout, uint32_t reporting_mode);
+
+sl_status_t sl_bt_sync_scanner_open(bd_addr address, uint8_t address_type, uint8_t adv_sid, uint16_t *sync);
+
+sl_status_t sl_bt_sync_close(uint16_t sync);
+
+sl_status_t sl_bt_connection_open(bd_addr address, uint8_t address_type, uint8_t initiating_phy,
+                                  uint8_t *connection);
+
+sl_status_t sl_bt_connection_set_preferred_phy(uint8_t connection, uint8_t preferred_phy, uint8_t accepted_phy);
+
+sl_status_t sl_bt_connection_close(uint8_t connection);
+
+sl_status_t sl_bt_gatt_server_set_max_mtu(uint16_t max_mtu, uint16_t *max_mtu_out);
+
+sl_status_t sl_bt_gatt_discover_primary_services_by_uuid(uint8_t connection, size_t uuid_len, const uint8_t *uuid);
+
+sl_status_t sl_bt_gatt_discover_characteristics(uint8_t connection, uint32_t service);
+
+sl_status_t sl_bt_gatt_set_characteristic_notification(uint8_t connection, uint16_t characteristic, uint8_t flags);
+
+sl_status_t sl_bt_gatt_write_characteristic_value(uint8_t connection, uint16_t characteristic,
+                                                  size_t value_len, const uint8_t *value);
+
+sl_status_t sl_bt_gatt_write_characteristic_value_without_response(uint8_t connection, uint16_t characteristic,
+                                                                   size_t value_len, const uint8_t *value,
+                                                                   uint16_t *sent_len);
+
+// Implemented by the application
+void sl_bt_on_event(sl_bt_msg_t *evt);
+
+
+#endif /* SL_BT_API_H_ */
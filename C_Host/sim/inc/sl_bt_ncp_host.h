@@ -0,0 +1,32 @@
+/*
+ * sl_bt_ncp_host.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Herd generator: the BGAPI host library entry points used by C_Host,
+ *  implemented by C_Host/sim/src/herd_bgapi.c.
+ */
+
+#ifndef SL_BT_NCP_HOST_H_
+#define SL_BT_NCP_HOST_H_
+
+
+#include "stdint.h"
+#include "sl_status.h"
+#include "sl_bt_api.h"
+
+
+typedef void (*tx_func)(uint32_t len, uint8_t *data);
+typedef int32_t (*rx_func)(uint32_t len, uint8_t *data);
+typedef int32_t (*rx_peek_func)(void);
+
+
+sl_status_t sl_bt_api_initialize_nonblock(tx_func ofunc, rx_func ifunc, rx_peek_func pfunc);
+
+sl_status_t sl_bt_pop_event(sl_bt_msg_t *evt);
+
+void sl_bt_step(void);
+
+
+#endif /* SL_BT_NCP_HOST_H_ */
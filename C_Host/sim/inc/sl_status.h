@@ -0,0 +1,32 @@
+/*
+ * sl_status.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Herd generator: the status codes of the Silicon Labs SDK used by the host.
+ */
+
+#ifndef SL_STATUS_H_
+#define SL_STATUS_H_
+
+
+#include "stdint.h"
+
+
+typedef uint32_t sl_status_t;
+
+#define SL_STATUS_OK                  ((sl_status_t)0x0000)
+#define SL_STATUS_FAIL                ((sl_status_t)0x0001)
+#define SL_STATUS_INVALID_STATE       ((sl_status_t)0x0002)
+#define SL_STATUS_BUSY                ((sl_status_t)0x0004)
+#define SL_STATUS_WOULD_BLOCK         ((sl_status_t)0x0009)
+#define SL_STATUS_NOT_SUPPORTED       ((sl_status_t)0x000F)
+#define SL_STATUS_NO_MORE_RESOURCE    ((sl_status_t)0x001A)
+#define SL_STATUS_INVALID_PARAMETER   ((sl_status_t)0x0021)
+#define SL_STATUS_INVALID_HANDLE      ((sl_status_t)0x0025)
+#define SL_STATUS_NOT_FOUND           ((sl_status_t)0x002D)
+#define SL_STATUS_ALREADY_EXISTS      ((sl_status_t)0x002E)
+
+
+#endif /* SL_STATUS_H_ */
@@ -0,0 +1,160 @@
+/*
+ * alert_bench.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Cost of the alert rules engine (C_Host/alert_rules.c) per report: N cows
+ *  report in random order, each report is evaluated against R rules (a mix
+ *  of relative activity, temperature, battery, lying and silence rules) and
+ *  folded into the cow's baselines. Cows start with a full baseline so the
+ *  relative rules are live from the first report. The silence sweep over
+ *  the herd is timed on its own.
+ *
+ *    gcc -O2 -IC_Host/sim/inc -IC_Host -ICommon/inc C_Host/sim/src/alert_bench.c \
+ *        C_Host/sim/src/bench_rules.c C_Host/alert_rules.c C_Host/collar_table.c -lm -o alert_bench
+ *    ./alert_bench -n 5000 -r 20
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "alert_rules.h"
+#include "bench_rules.h"
+
+
+#define DEFAULT_COWS        5000
+#define DEFAULT_RULES       20
+#define DEFAULT_REPORTS     10000000
+
+// Window period: a cow reports every 3.1 s
+#define WINDOW_MS           3100
+
+// Samples and report order cycle through tables of this size
+#define SAMPLE_POOL         4096
+#define ORDER_POOL          (1 << 20)
+
+#define USAGE "usage: %s [-n <cows>] [-r <rules>] [-N <reports>] [-S <seed>]\n"
+
+
+static uint64_t mono_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static float uniform(float lo, float hi)
+{
+  return lo + (hi - lo) * (float)rand() / (float)RAND_MAX;
+}
+
+
+int main(int argc, char *argv[])
+{
+  uint32_t n_cows = DEFAULT_COWS;
+  uint32_t n_rules = DEFAULT_RULES;
+  uint64_t n_reports = DEFAULT_REPORTS;
+  unsigned int seed = 1;
+  alert_sample_t *samples;
+  collar_t **order;
+  collar_t **cows;
+  uint64_t now_ms = 1;
+  uint64_t start;
+  uint64_t spent;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:r:N:S:h")) != -1) {
+    switch (opt) {
+      case 'n':
+        n_cows = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        n_rules = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'N':
+        n_reports = strtoull(optarg, NULL, 0);
+        break;
+      case 'S':
+        seed = (unsigned int)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, USAGE, argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((n_cows == 0) || (n_cows > 0xFFFF) || (n_rules == 0) || (n_rules > ALERT_MAX_RULES)) {
+    fprintf(stderr, USAGE, argv[0]);
+    return EXIT_FAILURE;
+  }
+  srand(seed);
+
+  bench_rules_load((uint8_t)n_rules);
+
+  collar_table_init();
+  cows = calloc(n_cows, sizeof(collar_t *));
+  samples = calloc(SAMPLE_POOL, sizeof(alert_sample_t));
+  order = calloc(ORDER_POOL, sizeof(collar_t *));
+  if ((cows == NULL) || (samples == NULL) || (order == NULL)) {
+    perror("alert_bench");
+    return EXIT_FAILURE;
+  }
+
+  for (uint32_t i = 0; i < n_cows; i++) {
+    collar_alerts_t *a;
+
+    cows[i] = collar_table_get((uint16_t)(i + 1));
+    a = &cows[i]->alerts;
+    a->baseline[ALERT_ACTIVITY] = uniform(40, 120);
+    a->baseline[ALERT_TEMP] = uniform(36, 39);
+    a->baseline[ALERT_BATTERY] = uniform(60, 100);
+    a->baseline[ALERT_LYING] = uniform(30, 60);
+    a->baseline_s = ALERT_BASELINE_S;
+    a->last_ms = now_ms;
+  }
+
+  // activity spread around typical baselines with the odd burst, rare fevers
+  for (uint32_t i = 0; i < SAMPLE_POOL; i++) {
+    alert_sample_t *s = &samples[i];
+
+    s->value[ALERT_ACTIVITY] = uniform(40, 120) * ((rand() % 64 == 0) ? 3.0f : 1.0f);
+    s->value[ALERT_TEMP] = uniform(36, 39) + ((rand() % 256 == 0) ? 3.0f : 0.0f);
+    s->value[ALERT_BATTERY] = uniform(25, 100) - ((rand() % 256 == 0) ? 10.0f : 0.0f);
+    s->value[ALERT_LYING] = (rand() % 2) ? 100.0f : 0.0f;
+    s->present = (1u << ALERT_METRICS) - 1;
+  }
+  for (uint32_t i = 0; i < ORDER_POOL; i++) {
+    order[i] = cows[rand() % n_cows];
+  }
+
+  start = mono_ns();
+  for (uint64_t i = 0; i < n_reports; i++) {
+    // the herd as a whole reports every WINDOW_MS / n_cows
+    now_ms = 1 + (i * WINDOW_MS) / n_cows;
+    alert_report(order[i & (ORDER_POOL - 1)], &samples[i & (SAMPLE_POOL - 1)], now_ms);
+  }
+  spent = mono_ns() - start;
+
+  printf("alert rules: %u cows, %u rules, %llu reports, %u alerts\n", n_cows, n_rules,
+         (unsigned long long)n_reports, bench_rules_alerts());
+  printf("report: %.1f ns per report, %.2f ns per rule, %.1f M reports/s\n",
+         (double)spent / n_reports, (double)spent / n_reports / n_rules, n_reports * 1e3 / spent);
+
+  // silence sweeps a minute after the last report and once every cow is silent
+  start = mono_ns();
+  alert_poll(now_ms + 60000);
+  spent = mono_ns() - start;
+  printf("silence sweep: %.1f us for %u cows, quiet\n", spent / 1e3, n_cows);
+
+  bench_rules_reset_alerts();
+  start = mono_ns();
+  alert_poll(now_ms + 3600000);
+  spent = mono_ns() - start;
+  printf("silence sweep: %.1f us for %u cows, %u alerts\n", spent / 1e3, n_cows, bench_rules_alerts());
+
+  return EXIT_SUCCESS;
+}
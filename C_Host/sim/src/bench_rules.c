@@ -0,0 +1,60 @@
+/*
+ * bench_rules.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Alert rules fixture of the alert and pool benches (bench_rules.h).
+ */
+
+#include <stdio.h>
+#include <stdatomic.h>
+
+#include "alert_rules.h"
+#include "bench_rules.h"
+
+
+static atomic_uint alerts;
+
+
+static void on_alert(const collar_t *collar, const alert_rule_t *rule, float value, float threshold)
+{
+  (void)collar;
+  (void)rule;
+  (void)value;
+  (void)threshold;
+  atomic_fetch_add_explicit(&alerts, 1, memory_order_relaxed);
+}
+
+void bench_rules_load(uint8_t count)
+{
+  static const alert_rule_t base[] = {
+    { "heat",        ALERT_ACTIVITY, true,  true,  2.0f, 2 },
+    { "lameness",    ALERT_ACTIVITY, false, true,  0.5f, 3 },
+    { "lying_long",  ALERT_LYING,    true,  true,  1.5f, 8 },
+    { "fever",       ALERT_TEMP,     true,  false, 40.0f, 1 },
+    { "low_battery", ALERT_BATTERY,  false, false, 20.0f, 2 },
+    { "silent",      ALERT_SILENCE,  true,  false, 600.0f, 1 },
+  };
+  const uint8_t n = sizeof(base) / sizeof(base[0]);
+  alert_rule_t rules[ALERT_MAX_RULES];
+
+  for (uint8_t i = 0; i < count; i++) {
+    rules[i] = base[i % n];
+    rules[i].threshold *= 1.0f + 0.05f * (i / n);
+    snprintf(rules[i].name, ALERT_NAME_LEN, "%s_%u", base[i % n].name, i / n);
+  }
+  alert_set_rules(rules, count);
+  alert_set_handler(on_alert);
+  bench_rules_reset_alerts();
+}
+
+uint32_t bench_rules_alerts(void)
+{
+  return atomic_load_explicit(&alerts, memory_order_relaxed);
+}
+
+void bench_rules_reset_alerts(void)
+{
+  atomic_store_explicit(&alerts, 0, memory_order_relaxed);
+}
@@ -0,0 +1,180 @@
+/*
+ * delta_main.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Make a delta firmware patch (C_Host/delta_diff.h) from the application
+ *  image the collars run to the new one, normally the GBL file of the new
+ *  build, for the host's batch update (-O). -a is the flash address of the
+ *  application (0x6000 behind the Gecko bootloader on the EFR32BG22).
+ *  With -x the patch is applied on Linux instead, as the collar does, to
+ *  check it.
+ *
+ *    gcc -O2 -IC_Host -ICommon/inc C_Host/sim/src/delta_main.c C_Host/delta_diff.c \
+ *        Common/src/cs_delta.c -o collar_delta
+ *    ./collar_delta -a 0x6000 Collar_V3_1.bin Collar_V3_2.gbl v3_1-v3_2.patch
+ *    ./collar_delta -x Collar_V3_1.bin v3_1-v3_2.patch check.gbl
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cs_delta.h"
+#include "delta_diff.h"
+
+
+#define USAGE "usage: %s [-a <base address>] <base image> <new image> <patch>\n" \
+              "       %s -x <base image> <patch> <new image>\n"
+
+// Flash address of the application behind the bootloader
+#define DEFAULT_BASE_ADDR 0x00006000
+
+
+static uint8_t *read_file(const char *path, uint32_t *len)
+{
+  FILE *f = fopen(path, "rb");
+  uint8_t *data;
+  long size;
+
+  if (!f) {
+    perror(path);
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data = malloc(size ? size : 1);
+  if (!data || (fread(data, 1, size, f) != (size_t)size)) {
+    perror(path);
+    free(data);
+    fclose(f);
+    return NULL;
+  }
+  fclose(f);
+  *len = (uint32_t)size;
+  return data;
+}
+
+static bool write_file(const char *path, const uint8_t *data, size_t len)
+{
+  FILE *f = fopen(path, "wb");
+
+  if (!f || (fwrite(data, 1, len, f) != len) || (fclose(f) != 0)) {
+    perror(path);
+    return false;
+  }
+  return true;
+}
+
+static bool file_write(uint32_t offset, const uint8_t *data, uint16_t len, void *ctx)
+{
+  FILE *f = ctx;
+
+  return (fseek(f, offset, SEEK_SET) == 0) && (fwrite(data, 1, len, f) == len);
+}
+
+
+static int apply(const char *base_path, const char *patch_path, const char *out_path)
+{
+  static cs_delta_t d;
+  cs_delta_header_t h;
+  uint32_t base_len;
+  uint32_t patch_len;
+  uint8_t *base = read_file(base_path, &base_len);
+  uint8_t *patch = read_file(patch_path, &patch_len);
+  uint8_t status;
+  FILE *out;
+
+  if (!base || !patch) {
+    return EXIT_FAILURE;
+  }
+  if (!delta_check(patch, patch_len, &h)) {
+    fprintf(stderr, "%s: not a whole patch\n", patch_path);
+    return EXIT_FAILURE;
+  }
+  if ((base_len != h.base_len)
+      || ((cs_delta_crc32(CS_DELTA_CRC32_INIT, base, base_len) ^ CS_DELTA_CRC32_INIT) != h.base_crc)) {
+    fprintf(stderr, "%s: not the base image of the patch\n", base_path);
+    return EXIT_FAILURE;
+  }
+
+  out = fopen(out_path, "wb");
+  if (!out) {
+    perror(out_path);
+    return EXIT_FAILURE;
+  }
+  cs_delta_init(&d, &h, base, file_write, out);
+  status = cs_delta_feed(&d, &patch[CS_DELTA_HEADER_LEN], h.body_len);
+  // the last write is padded to a flash word
+  if ((fflush(out) != 0) || (ftruncate(fileno(out), h.new_len) != 0)) {
+    status = CS_DELTA_ERR_WRITE;
+  }
+  fclose(out);
+
+  if (status != CS_DELTA_DONE) {
+    fprintf(stderr, "%s: patch failed, status %u at body byte %u\n", patch_path, status, d.taken);
+    return EXIT_FAILURE;
+  }
+  printf("%s: %u bytes, CRC-32 %08x\n", out_path, h.new_len, h.new_crc);
+  return EXIT_SUCCESS;
+}
+
+
+int main(int argc, char *argv[])
+{
+  uint32_t base_addr = DEFAULT_BASE_ADDR;
+  bool check = false;
+  uint32_t base_len;
+  uint32_t new_len;
+  uint8_t *base;
+  uint8_t *new_image;
+  uint8_t *patch;
+  size_t patch_len;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "a:xh")) != -1) {
+    switch (opt) {
+      case 'a':
+        base_addr = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'x':
+        check = true;
+        break;
+      default:
+        fprintf(stderr, USAGE, argv[0], argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if (argc - optind != 3) {
+    fprintf(stderr, USAGE, argv[0], argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (check) {
+    return apply(argv[optind], argv[optind + 1], argv[optind + 2]);
+  }
+
+  base = read_file(argv[optind], &base_len);
+  new_image = read_file(argv[optind + 1], &new_len);
+  if (!base || !new_image) {
+    return EXIT_FAILURE;
+  }
+  if (new_len == 0) {
+    fprintf(stderr, "%s: empty\n", argv[optind + 1]);
+    return EXIT_FAILURE;
+  }
+
+  patch_len = delta_diff(base, base_len, base_addr, new_image, new_len, &patch);
+  if (patch_len == 0) {
+    fprintf(stderr, "out of memory\n");
+    return EXIT_FAILURE;
+  }
+  if (!write_file(argv[optind + 2], patch, patch_len)) {
+    return EXIT_FAILURE;
+  }
+  printf("%s: %zu bytes for a %u byte image (%.1f%%), base at 0x%08x\n", argv[optind + 2], patch_len, new_len,
+         100.0 * patch_len / new_len, base_addr);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,269 @@
+/*
+ * feed_bench.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Latency of the shared memory window feed (C_Host/shm_feed.h) from
+ *  publish to consume. The parent publishes N raw windows at a steady
+ *  rate, as the host does with -L; each of C reader processes follows the
+ *  feed in place, checks every record it takes is whole (its fields agree
+ *  with its sequence number) and notes CLOCK_MONOTONIC now against the
+ *  record's publish time. Readers spin on the ring (yielding the CPU when
+ *  there is nothing new), or block in shm_feed_wait() with -w.
+ *
+ *  The cost of a publish is timed with no reader first, then with the
+ *  readers attached, to show what they cost the host.
+ *
+ *  Records are checked for a whole window rather than trusted: a reader
+ *  counts any that passed shm_feed_done() with fields that disagree.
+ *
+ *    gcc -O2 -IC_Host -ICommon/inc C_Host/sim/src/feed_bench.c C_Host/shm_feed.c -o feed_bench
+ *    ./feed_bench -N 200000 -r 20000 -c 2
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <sched.h>
+#include <sys/wait.h>
+
+#include "shm_feed.h"
+
+
+#define DEFAULT_RECORDS     200000
+#define DEFAULT_RATE        20000
+#define DEFAULT_READERS     1
+#define MAX_READERS         16
+
+#define N_SAMPLES           30
+
+// Sleep instead of spinning to the next publish when it is this far off
+#define SLEEP_MIN_NS        50000
+
+#define USAGE "usage: %s [-N <records>] [-r <records/s>] [-c <readers>] [-s <slots>] [-w]\n"
+
+
+static uint64_t mono_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+// Fields of the window published as record seq
+static void fill(cs_window_t *w, uint64_t seq)
+{
+  w->cow_id = (uint16_t)(seq % 1000 + 1);
+  w->seq = (uint16_t)seq;
+  w->hour = (uint8_t)(seq / 3600 % 24);
+  w->min = (uint8_t)(seq / 60 % 60);
+  w->sec = (uint8_t)(seq % 60);
+  for (int i = 0; i < N_SAMPLES; i++) {
+    w->samples[i][0] = (int16_t)(seq + i);
+    w->samples[i][1] = (int16_t)(seq ^ i);
+    w->samples[i][2] = (int16_t)(1000 - i);
+  }
+}
+
+static bool whole(const shm_feed_record_t *rec)
+{
+  const cs_window_t *w = &rec->window;
+
+  return (w->cow_id == rec->seq % 1000 + 1) && (w->seq == (uint16_t)rec->seq) && (rec->counter == (uint32_t)rec->seq)
+         && (w->samples[0][0] == (int16_t)rec->seq)
+         && (w->samples[N_SAMPLES - 1][1] == (int16_t)(rec->seq ^ (N_SAMPLES - 1)));
+}
+
+static int reader(int index, const char *name, uint64_t n_records, bool block, int ready)
+{
+  shm_feed_reader_t r;
+  uint32_t *latency = malloc(n_records * sizeof(uint32_t));
+  uint64_t got = 0;
+  uint64_t torn = 0;
+  uint64_t retried = 0;
+
+  if ((latency == NULL) || !shm_feed_open(&r, name, false)) {
+    perror("reader");
+    return EXIT_FAILURE;
+  }
+  if (write(ready, "r", 1) != 1) {
+    return EXIT_FAILURE;
+  }
+  close(ready);
+
+  while (!shm_feed_ended(&r)) {
+    const shm_feed_record_t *rec = shm_feed_next(&r);
+    uint64_t now;
+    bool ok;
+
+    if (rec == NULL) {
+      if (block) {
+        shm_feed_wait(&r, 100);
+      } else {
+        sched_yield();
+      }
+      continue;
+    }
+    now = mono_ns();
+    ok = whole(rec);
+    if (shm_feed_done(&r)) {
+      if (!ok) {
+        torn++;
+      } else if (got < n_records) {
+        latency[got++] = (uint32_t)(now - rec->publish_ns);
+      }
+    } else {
+      retried++;
+    }
+  }
+
+  qsort(latency, got, sizeof(uint32_t), cmp_u32);
+  printf("reader %d: %llu records, %llu lost, %llu torn, %llu overwritten while read", index,
+         (unsigned long long)got, (unsigned long long)r.lost, (unsigned long long)torn,
+         (unsigned long long)retried);
+  if (got > 0) {
+    printf("; latency p50 %.1f us, p90 %.1f us, p99 %.1f us, p99.9 %.1f us, max %.1f us", latency[got / 2] / 1e3,
+           latency[got * 9 / 10] / 1e3, latency[got * 99 / 100] / 1e3, latency[got * 999 / 1000] / 1e3,
+           latency[got - 1] / 1e3);
+  }
+  printf("\n");
+  shm_feed_close(&r);
+  return (torn == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Publish n records at rate per second (0: as fast as possible), return ns per publish
+static double publish(shm_feed_writer_t *w, uint64_t first, uint64_t n, uint64_t rate)
+{
+  static cs_window_t window;
+  uint64_t start = mono_ns();
+  uint64_t spent = 0;
+
+  window.version = CS_PAYLOAD_VERSION;
+  window.kind = CS_KIND_RAW;
+  window.n_samples = N_SAMPLES;
+  for (uint64_t i = 0; i < n; i++) {
+    uint64_t t;
+
+    if (rate > 0) {
+      uint64_t due = start + i * 1000000000ULL / rate;
+
+      for (uint64_t now = mono_ns(); now < due; now = mono_ns()) {
+        if (due - now > SLEEP_MIN_NS) {
+          struct timespec ts = { 0, (long)(due - now - SLEEP_MIN_NS / 2) };
+
+          nanosleep(&ts, NULL);
+        }
+      }
+    }
+    fill(&window, first + i);
+    t = mono_ns();
+    shm_feed_publish(w, &window, (uint32_t)(first + i), -60, SHM_FEED_PERIODIC);
+    spent += mono_ns() - t;
+  }
+  return (double)spent / n;
+}
+
+
+int main(int argc, char *argv[])
+{
+  uint64_t n_records = DEFAULT_RECORDS;
+  uint64_t rate = DEFAULT_RATE;
+  int n_readers = DEFAULT_READERS;
+  uint32_t slots = SHM_FEED_DEFAULT_SLOTS;
+  bool block = false;
+  char name[SHM_FEED_NAME_MAX];
+  shm_feed_writer_t w;
+  pid_t pids[MAX_READERS];
+  int pipes[2];
+  int failures = 0;
+  double alone_ns;
+  double read_ns;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "N:r:c:s:wh")) != -1) {
+    switch (opt) {
+      case 'N':
+        n_records = strtoull(optarg, NULL, 0);
+        break;
+      case 'r':
+        rate = strtoull(optarg, NULL, 0);
+        break;
+      case 'c':
+        n_readers = atoi(optarg);
+        break;
+      case 's':
+        slots = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'w':
+        block = true;
+        break;
+      default:
+        fprintf(stderr, USAGE, argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((n_records == 0) || (n_readers < 0) || (n_readers > MAX_READERS)) {
+    fprintf(stderr, USAGE, argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  snprintf(name, sizeof(name), "feed_bench_%d", (int)getpid());
+  if (!shm_feed_create(&w, name, slots)) {
+    perror("shm_feed_create");
+    return EXIT_FAILURE;
+  }
+  printf("feed: %u slots of %zu bytes, %llu records at %llu/s, %d %s readers\n", slots, sizeof(shm_feed_slot_t),
+         (unsigned long long)n_records, (unsigned long long)rate, n_readers, block ? "blocking" : "spinning");
+
+  // the host alone, at the same pace
+  alone_ns = publish(&w, 0, n_records, rate);
+
+  fflush(stdout);
+  if (pipe(pipes) != 0) {
+    perror("pipe");
+    return EXIT_FAILURE;
+  }
+  for (int i = 0; i < n_readers; i++) {
+    pids[i] = fork();
+    if (pids[i] == 0) {
+      close(pipes[0]);
+      exit(reader(i, name, n_records, block, pipes[1]));
+    }
+  }
+  close(pipes[1]);
+  for (int i = 0; i < n_readers; i++) {
+    char c;
+
+    if (read(pipes[0], &c, 1) != 1) {
+      fprintf(stderr, "a reader did not start\n");
+      return EXIT_FAILURE;
+    }
+  }
+  close(pipes[0]);
+
+  // continuing the sequence: the readers start at the newest record
+  read_ns = publish(&w, n_records, n_records, rate);
+  shm_feed_destroy(&w);
+
+  for (int i = 0; i < n_readers; i++) {
+    int status;
+
+    waitpid(pids[i], &status, 0);
+    failures += !WIFEXITED(status) || (WEXITSTATUS(status) != EXIT_SUCCESS);
+  }
+  printf("publish: %.0f ns with no reader, %.0f ns with %d readers\n", alone_ns, read_ns, n_readers);
+  printf("%d failures\n", failures);
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+/*
+ * gap_check.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Checks of the gap accounting in C_Host/gap_tracker.c: each case feeds a
+ *  collar a run of new periodic advertising windows, sync losses and
+ *  resets, and checks the windows received and missed by cause at the end.
+ *  A window that comes in late was counted as missed under the cause of
+ *  its gap, and is taken off that count again.
+ *
+ *    gcc -O2 -IC_Host -ICommon/inc C_Host/sim/src/gap_check.c C_Host/gap_tracker.c C_Host/collar_table.c -o gap_check
+ *    ./gap_check
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "collar_table.h"
+#include "gap_tracker.h"
+
+
+#define MAX_STEPS 16
+
+// Step kinds
+#define WIN  0      // a new window, 32-bit sequence number
+#define SYNC 1      // the sync closed
+#define RESET 2     // the collar started a new session
+
+typedef struct gap_step
+{
+  uint8_t kind;
+  uint32_t seq;
+} gap_step_t;
+
+typedef struct gap_case
+{
+  const char *name;
+  gap_step_t steps[MAX_STEPS];
+  uint8_t n_steps;
+  uint32_t received;
+  uint32_t lost_radio;
+  uint32_t lost_sync;
+  uint32_t lost_reset;
+  uint16_t loss;    // gap_recent_loss() at the end
+} gap_case_t;
+
+static const gap_case_t cases[] = {
+  {
+    "late window after a radio gap",
+    { { WIN, 0 }, { WIN, 3 }, { WIN, 1 } }, 3,
+    3, 1, 0, 0, 250
+  },
+  {
+    "late window after a sync loss",
+    { { WIN, 0 }, { SYNC, 0 }, { WIN, 5 }, { WIN, 2 } }, 4,
+    3, 0, 3, 0, 500
+  },
+  {
+    "late windows of two gaps",
+    { { WIN, 0 }, { WIN, 2 }, { SYNC, 0 }, { WIN, 6 }, { WIN, 1 }, { WIN, 4 } }, 6,
+    5, 0, 2, 0, 285
+  },
+  {
+    "late window after a reset",
+    { { WIN, 10 }, { RESET, 0 }, { WIN, 3 }, { WIN, 1 } }, 4,
+    3, 0, 0, 2, 400
+  },
+  {
+    "late window after a long gap",
+    { { WIN, 0 }, { WIN, 100 }, { WIN, 90 } }, 3,
+    3, 98, 0, 0, 968
+  },
+  {
+    "late window of the first ever",
+    { { WIN, 5 }, { WIN, 6 }, { WIN, 4 } }, 3,
+    3, 0, 0, 0, 0
+  },
+};
+
+static int run_case(const gap_case_t *c)
+{
+  collar_t *collar;
+  uint32_t missed;
+  uint16_t loss;
+  int failures = 0;
+
+  collar_table_init();
+  collar = collar_table_get(1);
+
+  for (uint8_t i = 0; i < c->n_steps; i++)
+  {
+    const gap_step_t *s = &c->steps[i];
+
+    switch (s->kind)
+    {
+    case SYNC:
+      gap_note_sync_lost(collar);
+      break;
+    case RESET:
+      gap_note_reset(collar);
+      break;
+    default:
+      gap_note_window(collar, s->seq, &missed);
+      break;
+    }
+  }
+
+  if (collar->gaps.received != c->received)
+  {
+    printf("%s: %u windows received, expected %u\n", c->name, collar->gaps.received, c->received);
+    failures++;
+  }
+  if ((collar->gaps.lost_radio != c->lost_radio) || (collar->gaps.lost_sync != c->lost_sync)
+      || (collar->gaps.lost_reset != c->lost_reset))
+  {
+    printf("%s: missed %u radio, %u sync, %u reset, expected %u, %u, %u\n", c->name,
+           collar->gaps.lost_radio, collar->gaps.lost_sync, collar->gaps.lost_reset,
+           c->lost_radio, c->lost_sync, c->lost_reset);
+    failures++;
+  }
+  loss = gap_recent_loss(collar);
+  if (loss != c->loss)
+  {
+    printf("%s: recent loss %u/1000, expected %u\n", c->name, loss, c->loss);
+    failures++;
+  }
+  return failures;
+}
+
+int main(void)
+{
+  int failures = 0;
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+  {
+    failures += run_case(&cases[i]);
+  }
+  printf("%zu cases, %d failures\n", sizeof(cases) / sizeof(cases[0]), failures);
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,79 @@
+/*
+ * herd_bgapi.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Herd generator: the receive half of the BGAPI host library. Events are
+ *  read from whatever transport is registered, header first and then the
+ *  payload, and handed to sl_bt_on_event() as the SDK's sl_bt_step() does.
+ *  Commands are answered by herd_ncp.c without a round trip on the
+ *  transport, so a response in the stream (a capture of a real adapter)
+ *  has no one waiting for it and is skipped.
+ */
+
+#include "stddef.h"
+#include "sl_bt_ncp_host.h"
+
+
+// BGAPI message type: event of the Bluetooth class
+#define MSG_TYPE_MASK     0x000000f8
+#define MSG_TYPE_BT_EVT   0x000000a0
+
+
+static tx_func tx = NULL;
+static rx_func rx = NULL;
+static rx_peek_func peek = NULL;
+
+
+sl_status_t sl_bt_api_initialize_nonblock(tx_func ofunc, rx_func ifunc, rx_peek_func pfunc)
+{
+  if ((ofunc == NULL) || (ifunc == NULL) || (pfunc == NULL)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  tx = ofunc;
+  rx = ifunc;
+  peek = pfunc;
+  return SL_STATUS_OK;
+}
+
+static sl_status_t read_all(uint32_t len, uint8_t *data)
+{
+  while (len > 0) {
+    int32_t n = rx(len, data);
+
+    if (n <= 0) {
+      return SL_STATUS_FAIL;
+    }
+    data += n;
+    len -= (uint32_t)n;
+  }
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_pop_event(sl_bt_msg_t *evt)
+{
+  if (peek == NULL) {
+    return SL_STATUS_INVALID_STATE;
+  }
+
+  while (peek() >= SL_BGAPI_MSG_HEADER_LEN) {
+    if ((read_all(SL_BGAPI_MSG_HEADER_LEN, (uint8_t *)&evt->header) != SL_STATUS_OK)
+        || (read_all(SL_BGAPI_MSG_LEN(evt->header), evt->data.payload) != SL_STATUS_OK)) {
+      return SL_STATUS_FAIL;
+    }
+    if ((evt->header & MSG_TYPE_MASK) == MSG_TYPE_BT_EVT) {
+      return SL_STATUS_OK;
+    }
+  }
+  return SL_STATUS_WOULD_BLOCK;
+}
+
+void sl_bt_step(void)
+{
+  sl_bt_msg_t evt;
+
+  if (sl_bt_pop_event(&evt) == SL_STATUS_OK) {
+    sl_bt_on_event(&evt);
+  }
+}
@@ -0,0 +1,1160 @@
+/*
+ * herd_main.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Load generator for the gateway host: C_Host/app.c runs unchanged against
+ *  the simulated NCP in herd_ncp.c while N virtual collars advertise at it.
+ *  Each collar has its own address, cow ID, clock drift, mean RSSI with
+ *  shadowing, packet loss and random periodic sync losses. The host's own
+ *  scan and sync_scanner_open calls decide when a lost collar is synced
+ *  again; collars with a cow ID up to 255 also answer on the PAwR train.
+ *
+ *  Collars send extended advertising on coded PHY every second, heard only
+ *  when it falls in a scan window of the right PHY (herd_ncp.c). A sync
+ *  opens at the first periodic event received after the host asked for it
+ *  and its advertising was heard, and fails after six events missed. A
+ *  sync is closed once no event has been received for the sync timeout
+ *  the host set: after a random sync loss, or on packet loss alone.
+ *
+ *  Collars follow the link level the host sends them on PAwR (host -a),
+ *  with the dwell of Collar/src/app.c link_apply(): the TX power shifts the
+ *  RSSI, the secondary PHY the sensitivity, and the restarted periodic
+ *  train breaks the sync to the old one until the host closes it or it
+ *  times out. The periodic advertising energy of the collars is reported
+ *  against the default level, with the records the changes cost.
+ *
+ *  Virtual time is driven by the herd. Host CPU time and the UART time of
+ *  its commands advance it 1:1, so events queue up in the NCP and are
+ *  dropped when the host or the UART cannot keep up. With -x the run is
+ *  paced against the wall clock (1 = real time) so the host's POSIX timers
+ *  line up; without it the run goes as fast as possible.
+ *
+ *  The run ends with reports delivered and lost (on air, while unsynced,
+ *  dropped by the NCP), host CPU per report, host memory per collar, the
+ *  air to host latency percentiles and the time to sync again after a
+ *  loss. Time to sync only means something paced in real time (-x 1), as
+ *  the host times its scanning on its own clock. -o appends the same as one CSV row, so
+ *  a sweep over -n builds a sizing table.
+ *
+ *  Build and run from the repository root (the host writes its CSV logs to
+ *  the working directory):
+ *    gcc -O2 -pthread -IC_Host/sim/inc -IC_Host -ICommon/inc -ICollar/inc \
+ *        C_Host/sim/src/herd_main.c C_Host/sim/src/herd_ncp.c C_Host/sim/src/herd_bgapi.c \
+ *        C_Host/app.c C_Host/collar_table.c C_Host/link_control.c C_Host/ncp_capture.c C_Host/host_metrics.c \
+ *        C_Host/gap_tracker.c C_Host/alert_rules.c C_Host/host_store.c C_Host/store_retention.c C_Host/sync_acquire.c \
+ *        C_Host/ota_batch.c C_Host/delta_diff.c C_Host/work_pool.c C_Host/shm_feed.c \
+ *        C_Host/query_server.c C_Host/store_query.c C_Host/store_cache.c \
+ *        Common/src/cs_payload.c Common/src/cs_crc16.c Common/src/cs_features.c Common/src/cs_classifier.c \
+ *        Common/src/cs_delta.c Common/src/cs_orient.c Collar/src/cs_radio.c -lm -o herd
+ *    ./herd -n 1000 -t 600 -o herd.csv > /dev/null
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+
+#include "app.h"
+#include "herd.h"
+#include "sl_bt_ncp_host.h"
+#include "cs_config.h"
+#include "cs_link.h"
+#include "cs_pawr.h"
+#include "cs_payload.h"
+#include "cs_radio.h"
+
+
+#define USAGE "usage: %s [-n <collars>] [-t <seconds>] [-x <speed>] [-b <baud>] [-q <events>]\n" \
+              "          [-l <loss_%%>] [-d <ppm>] [-y <seconds>] [-s <syncs>] [-C] [-S <seed>]\n" \
+              "          [-c <imu_ms>,<window>,<env_s>,<pa_ms>,<k>[,<mode>]] [-o <results.csv>]\n" \
+              "          [-- <host options>]\n"
+
+#define DEFAULT_COLLARS       100
+#define DEFAULT_SECONDS       60
+#define DEFAULT_BAUD          115200
+#define DEFAULT_QUEUE         32
+#define DEFAULT_LOSS_PCT      5
+#define DEFAULT_DRIFT_PPM     50
+#define DEFAULT_SYNC_LOSS_S   3600
+
+// Cow IDs are 16 bit, 0 is not used
+#define HERD_COLLARS_MAX      0xFFFF
+
+// Mean RSSI of a collar (dBm), shadowing around it and gateway sensitivity
+#define RSSI_MEAN_MIN         (-95)
+#define RSSI_MEAN_MAX         (-55)
+#define RSSI_SIGMA_DB         4.0
+#define SENSITIVITY_DBM       (-103)
+
+// Largest periodic advertising data in one report; longer records chain
+#define REPORT_DATA_MAX       247
+
+// data_status of a periodic sync report
+#define PA_DATA_COMPLETE      0
+#define PA_DATA_INCOMPLETE    1
+
+// Fixed BGAPI payload of the events, before their data
+#define BOOT_LEN              18
+#define ADV_REPORT_LEN        27
+#define SYNC_OPENED_LEN       16
+#define SYNC_CLOSED_LEN       4
+#define SYNC_REPORT_LEN       9
+#define PAWR_REQUEST_LEN      3
+#define PAWR_RESPONSE_LEN     11
+
+// sl_bt_evt_sync_closed reason: sync timeout, never established, closed by the host
+#define SYNC_LOST_REASON      0x1008
+#define SYNC_FAILED_REASON    0x103E
+#define SYNC_CLOSED_REASON    0
+
+// Published windows before a collar takes a cheaper link level (LINK_DWELL_WINDOWS)
+#define LINK_DWELL_WINDOWS    10
+
+// Extended advertising of the collars (EXTENDED_ADV_INT) and the random
+// delay added to each event
+#define EXT_ADV_US            1000000
+#define ADV_DELAY_US          10000
+
+// Periodic events missed after the sync info before a sync fails
+#define SYNC_ESTABLISH_EVENTS 6
+
+// Not available: TX power, CTE type
+#define TX_POWER_NONE         0x7f
+#define CTE_NONE              0xff
+
+// Time of day at the start of the run: 06:00:00
+#define START_SECONDS         (6 * 3600)
+
+// Events the host is timed on
+#define TAG_OTHER             0
+#define TAG_REPORT            1
+
+// Latency histogram: 16 linear steps per power of two (us)
+#define LAT_SUB_BITS          4
+#define LAT_BUCKETS           (64 << LAT_SUB_BITS)
+
+#define COLLAR_LOST           0     // no sync, advertising only
+#define COLLAR_PENDING        1     // host asked for a sync, not open yet
+#define COLLAR_SYNCED         2
+
+
+typedef struct herd_collar{
+  bd_addr address;
+  uint16_t cow_id;
+  uint8_t state;            // COLLAR_*
+  uint8_t session;
+  uint16_t sync;            // sync handle while pending or synced
+  int8_t rssi_mean;
+  double loss;              // probability a packet is lost
+  double period_us;         // periodic advertising interval seen by the gateway
+  double phase_us;          // window phase of the collar's own clock
+  uint64_t start_us;        // first periodic advertising event
+  uint64_t pa_next_us;      // next periodic advertising event
+  uint64_t adv_next_us;     // next extended advertising event
+  uint64_t next_us;         // the earlier of the two
+  uint32_t events;          // periodic advertising events so far
+  uint64_t lost_at_us;      // next sync loss
+  bool broken;              // the sync is lost, the timeout not over yet
+  bool sync_info;           // pending: advertising heard since the open
+  uint8_t missed;           // pending: events missed since the sync info
+  uint64_t timeout_us;      // sync timeout the host asked for
+  uint64_t last_rx_us;      // last periodic event received
+  uint64_t closed_us;       // sync closed, 0 if never
+  uint8_t link_level;       // index into cs_link_levels
+  uint64_t link_dwell_us;   // no cheaper level before this
+  bool link_broken;         // a level change broke the sync, not synced again yet
+}herd_collar_t;
+
+typedef struct herd_stats{
+  uint32_t reports;         // records advertised while synced
+  uint32_t unsynced;        // records advertised while not synced
+  uint32_t lost_air;        // records not received
+  uint32_t dropped;         // records the NCP dropped (all or part)
+  uint32_t delivered;       // records handed to the host whole
+  uint32_t adv_reports;     // extended advertising reports heard
+  uint32_t sync_losses;     // random sync losses
+  uint32_t sync_timeouts;   // syncs closed on packet loss alone
+  uint32_t sync_opens;      // sync_scanner_open calls that started a sync
+  uint32_t sync_failed;     // of them never established
+  uint32_t reacquired;      // syncs opened again after closing
+  uint32_t pawr_events;
+  uint32_t link_changes;    // link levels applied by the collars
+  uint32_t link_breaks;     // syncs broken by them
+  uint32_t link_unsynced;   // records advertised unsynced after a break
+  uint64_t pa_nj;           // periodic advertising energy of the collars
+  uint64_t pa_default_nj;   // the same at the default link level
+}herd_stats_t;
+
+
+static herd_collar_t *collars = NULL;
+static uint32_t n_collars = DEFAULT_COLLARS;
+static uint32_t *heap = NULL;         // collars by next_us, earliest first
+
+static cs_config_t config;
+static uint64_t pa_us;                // nominal periodic advertising interval
+static uint64_t publish_us;           // nominal time between two records
+static uint16_t record_len;           // every record of a run has the same length
+
+static double loss_mean = DEFAULT_LOSS_PCT / 100.0;
+static double sync_loss_s = DEFAULT_SYNC_LOSS_S;
+static uint32_t max_syncs = 0;
+static uint32_t active_syncs = 0;
+static uint16_t next_sync = 0;
+
+static bool pawr_on = false;
+static uint8_t pawr_handle;
+static uint64_t pawr_period_us;
+static uint64_t pawr_next_us;
+
+static uint64_t now_us = 0;
+static herd_stats_t stats;
+
+static uint32_t latency_hist[LAT_BUCKETS];
+static uint64_t latency_max_us = 0;
+static uint32_t sync_hist[LAT_BUCKETS];     // sync closed to open again
+static uint32_t outage_hist[LAT_BUCKETS];   // last event received to sync open again
+static uint64_t host_ns = 0;
+static uint64_t host_events = 0;
+
+static uint64_t rng_state = 1;
+
+// Service the collars advertise for periodic sync (C_Host/app.c serviceUUID)
+static const uint8_t service_ad[] = {
+  2, 0x01, 0x06,
+  17, 0x07,
+  0x79, 0x2d, 0xf6, 0x66, 0x9c, 0x19, 0xca, 0x84,
+  0xc4, 0x45, 0xcd, 0x93, 0x5f, 0x14, 0x98, 0x86
+};
+
+
+static uint64_t rng_next(void)
+{
+  rng_state ^= rng_state >> 12;
+  rng_state ^= rng_state << 25;
+  rng_state ^= rng_state >> 27;
+  return rng_state * 2685821657736338717ULL;
+}
+
+static double rng_uniform(void)
+{
+  return (rng_next() >> 11) * (1.0 / 9007199254740992.0);
+}
+
+static double rng_gauss(void)
+{
+  double u = 1.0 - rng_uniform();
+
+  return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * rng_uniform());
+}
+
+static double rng_exp(double mean)
+{
+  return -mean * log(1.0 - rng_uniform());
+}
+
+
+static uint64_t mono_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static uint64_t rss_bytes(void)
+{
+  unsigned long size = 0, resident = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+
+  if (f != NULL) {
+    if (fscanf(f, "%lu %lu", &size, &resident) != 2) {
+      resident = 0;
+    }
+    fclose(f);
+  }
+  return (uint64_t)resident * (uint64_t)sysconf(_SC_PAGESIZE);
+}
+
+
+static uint32_t latency_bucket(uint64_t us)
+{
+  uint32_t msb;
+
+  if (us < (1u << LAT_SUB_BITS)) {
+    return (uint32_t)us;
+  }
+  msb = 63 - __builtin_clzll(us);
+  return ((msb - LAT_SUB_BITS + 1) << LAT_SUB_BITS) | ((us >> (msb - LAT_SUB_BITS)) & ((1u << LAT_SUB_BITS) - 1));
+}
+
+static uint64_t latency_value(uint32_t bucket)
+{
+  uint32_t msb;
+
+  if (bucket < (1u << LAT_SUB_BITS)) {
+    return bucket;
+  }
+  msb = (bucket >> LAT_SUB_BITS) + LAT_SUB_BITS - 1;
+  return ((uint64_t)(bucket & ((1u << LAT_SUB_BITS) - 1)) | (1u << LAT_SUB_BITS)) << (msb - LAT_SUB_BITS);
+}
+
+// Smallest time (ms) at or above fraction p of the count in hist
+static double hist_ms(const uint32_t *hist, uint32_t count, double p)
+{
+  uint64_t target = (uint64_t)ceil(p * count);
+  uint64_t seen = 0;
+
+  for (uint32_t b = 0; b < LAT_BUCKETS; b++) {
+    seen += hist[b];
+    if ((seen > 0) && (seen >= target)) {
+      return latency_value(b) / 1000.0;
+    }
+  }
+  return 0;
+}
+
+static double latency_ms(double p)
+{
+  return hist_ms(latency_hist, stats.delivered, p);
+}
+
+static double sync_s(const uint32_t *hist, double p)
+{
+  return hist_ms(hist, stats.reacquired, p) / 1000.0;
+}
+
+
+// Binary heap of collars ordered by their next periodic advertising event
+static void heap_down(uint32_t i)
+{
+  while (1) {
+    uint32_t l = 2 * i + 1;
+    uint32_t m = i;
+    uint32_t t;
+
+    if ((l < n_collars) && (collars[heap[l]].next_us < collars[heap[m]].next_us)) {
+      m = l;
+    }
+    if ((l + 1 < n_collars) && (collars[heap[l + 1]].next_us < collars[heap[m]].next_us)) {
+      m = l + 1;
+    }
+    if (m == i) {
+      return;
+    }
+    t = heap[i];
+    heap[i] = heap[m];
+    heap[m] = t;
+    i = m;
+  }
+}
+
+
+// One packet from the collar on phy: false if the gateway does not receive
+// it. rssi_mean is at the default link level, gain_db on top of it.
+static bool air_ok(const herd_collar_t *c, uint8_t phy, double gain_db, int8_t *rssi)
+{
+  double r = c->rssi_mean + gain_db + rng_gauss() * RSSI_SIGMA_DB;
+
+  if ((r < SENSITIVITY_DBM + cs_link_sensitivity(phy) - CS_LINK_SENS_CODED) || (rng_uniform() < c->loss)) {
+    return false;
+  }
+  *rssi = (int8_t)lround(r);
+  return true;
+}
+
+// TX power of the collar's advertising above the default link level (dB)
+static double link_gain_db(const herd_collar_t *c)
+{
+  return (cs_link_levels[c->link_level].tx_power - cs_link_levels[CS_LINK_LEVEL_DEFAULT].tx_power) / 10.0;
+}
+
+// The periodic advertising PHY of the collar
+static uint8_t link_phy(const herd_collar_t *c)
+{
+  return cs_link_levels[c->link_level].phy;
+}
+
+// Encode the collar's current record as its firmware would
+static uint16_t build_record(const herd_collar_t *c, uint64_t t_us, uint8_t *buf)
+{
+  static cs_window_t w;
+  uint32_t seq = (uint32_t)((c->events * (double)pa_us + c->phase_us) / publish_us);
+  uint32_t s = START_SECONDS + (uint32_t)(t_us / 1000000);
+
+  w.version = CS_PAYLOAD_VERSION;
+  w.flags = 0;
+  w.session = c->session;
+  w.seq = (uint16_t)seq;
+  w.cow_id = c->cow_id;
+  w.hour = (uint8_t)((s / 3600) % 24);
+  w.min = (uint8_t)((s / 60) % 60);
+  w.sec = (uint8_t)(s % 60);
+  w.battery = 90;
+  w.temp = 20;
+
+  switch (config.mode) {
+    case CS_MODE_SUMMARY:
+      w.kind = CS_KIND_SUMMARY;
+      w.summary.windows = cs_config_summary_windows(&config);
+      w.summary.samples = (uint16_t)(w.summary.windows * config.window_samples);
+      w.summary.mean[0] = (int16_t)(rng_gauss() * 50);
+      w.summary.mean[1] = (int16_t)(rng_gauss() * 50);
+      w.summary.mean[2] = 1000;
+      for (uint8_t a = 0; a < 3; a++) {
+        w.summary.std[a] = (uint16_t)(rng_uniform() * 200);
+        w.summary.zc[a] = (uint16_t)(rng_uniform() * w.summary.samples / 2);
+      }
+      w.summary.odba = (uint16_t)(rng_uniform() * 300);
+      w.summary.tilt_deg = (uint8_t)(rng_uniform() * 90);
+      w.summary.posture = (w.summary.tilt_deg > CS_FEATURES_LYING_TILT_DEG) ? CS_POSTURE_LYING : CS_POSTURE_STANDING;
+      break;
+
+    case CS_MODE_CLASS:
+      w.kind = CS_KIND_CLASS;
+      w.n_labels = cs_config_class_labels(&config);
+      for (uint8_t i = 0; i < w.n_labels; i++) {
+        w.labels[i].class = (uint8_t)(rng_next() % CS_CLASS_COUNT);
+        w.labels[i].confidence = (uint8_t)(128 + rng_next() % 128);
+      }
+      break;
+
+    default:
+      w.kind = CS_KIND_RAW;
+      w.n_samples = config.window_samples;
+      for (uint8_t i = 0; i < w.n_samples; i++) {
+        w.samples[i][0] = (int16_t)(rng_gauss() * 60);
+        w.samples[i][1] = (int16_t)(rng_gauss() * 60);
+        w.samples[i][2] = (int16_t)(1000 + rng_gauss() * 60);
+      }
+      break;
+  }
+
+  return cs_payload_encode(&w, buf, CS_PAYLOAD_MAX_LEN);
+}
+
+
+static void push_adv_report(const herd_collar_t *c, uint64_t t, int8_t rssi)
+{
+  sl_bt_msg_t evt;
+  sl_bt_evt_scanner_extended_advertisement_report_t *r = &evt.data.evt_scanner_extended_advertisement_report;
+
+  memset(r, 0, sizeof(*r));
+  evt.header = sl_bt_evt_scanner_extended_advertisement_report_id;
+  r->address = c->address;
+  r->address_type = 1;
+  r->bonding = 0xff;
+  r->rssi = rssi;
+  r->target_address_type = 0xff;
+  r->primary_phy = sl_bt_gap_phy_coded;
+  r->secondary_phy = sl_bt_gap_phy_coded;
+  r->tx_power = TX_POWER_NONE;
+  r->periodic_interval = (uint16_t)(pa_us / 1250);
+  r->adv_sid = 0;
+  r->data.len = sizeof(service_ad);
+  memcpy(r->data.data, service_ad, sizeof(service_ad));
+
+  herd_ncp_push(&evt, ADV_REPORT_LEN + r->data.len, t, TAG_OTHER);
+  stats.adv_reports++;
+}
+
+static void push_sync_opened(const herd_collar_t *c, uint64_t t)
+{
+  sl_bt_msg_t evt;
+  sl_bt_evt_periodic_sync_opened_t *o = &evt.data.evt_periodic_sync_opened;
+
+  memset(o, 0, sizeof(*o));
+  evt.header = sl_bt_evt_periodic_sync_opened_id;
+  o->sync = c->sync;
+  o->address = c->address;
+  o->address_type = 1;
+  o->adv_phy = link_phy(c);
+  o->adv_interval = (uint16_t)(pa_us / 1250);
+  o->bonding = 0xff;
+
+  herd_ncp_push(&evt, SYNC_OPENED_LEN, t, TAG_OTHER);
+}
+
+static void push_sync_closed(const herd_collar_t *c, uint64_t t, uint16_t reason)
+{
+  sl_bt_msg_t evt;
+
+  evt.header = sl_bt_evt_sync_closed_id;
+  evt.data.evt_sync_closed.reason = reason;
+  evt.data.evt_sync_closed.sync = c->sync;
+
+  herd_ncp_push(&evt, SYNC_CLOSED_LEN, t, TAG_OTHER);
+}
+
+// A record as one report, or a chain of them for long records
+static void push_record(const herd_collar_t *c, uint64_t t, uint16_t counter, int8_t rssi)
+{
+  static uint8_t payload[CS_PAYLOAD_MAX_LEN];
+  uint16_t len = build_record(c, t, payload);
+  uint16_t off = 0;
+  bool whole = true;
+
+  while (off < len) {
+    sl_bt_msg_t evt;
+    sl_bt_evt_periodic_sync_report_t *r = &evt.data.evt_periodic_sync_report;
+    uint16_t n = ((len - off) > REPORT_DATA_MAX) ? REPORT_DATA_MAX : (len - off);
+    bool last = (off + n == len);
+
+    evt.header = sl_bt_evt_periodic_sync_report_id;
+    r->sync = c->sync;
+    r->tx_power = TX_POWER_NONE;
+    r->rssi = rssi;
+    r->cte_type = CTE_NONE;
+    r->data_status = last ? PA_DATA_COMPLETE : PA_DATA_INCOMPLETE;
+    r->counter = counter;
+    r->data.len = (uint8_t)n;
+    memcpy(r->data.data, &payload[off], n);
+    off += n;
+
+    // only a record that reaches the host whole counts as delivered
+    if (!herd_ncp_push(&evt, SYNC_REPORT_LEN + n, t, (last && whole) ? TAG_REPORT : TAG_OTHER)) {
+      whole = false;
+    }
+  }
+
+  if (!whole) {
+    stats.dropped++;
+  }
+}
+
+
+static void collar_schedule(herd_collar_t *c)
+{
+  c->next_us = (c->adv_next_us < c->pa_next_us) ? c->adv_next_us : c->pa_next_us;
+  heap_down(0);
+}
+
+// The collar's next extended advertising event: heard while the host scans
+static void collar_adv(herd_collar_t *c)
+{
+  uint64_t t = c->adv_next_us;
+  int8_t rssi;
+
+  c->adv_next_us = t + EXT_ADV_US + (uint64_t)(rng_uniform() * ADV_DELAY_US);
+  collar_schedule(c);
+
+  if (!herd_ncp_hears(sl_bt_gap_phy_coded, t) || !air_ok(c, sl_bt_gap_phy_coded, link_gain_db(c), &rssi)) {
+    return;
+  }
+  push_adv_report(c, t, rssi);
+
+  // its sync info lets a pending sync find the periodic events
+  if (c->state == COLLAR_PENDING) {
+    c->sync_info = true;
+  }
+}
+
+static void collar_close(herd_collar_t *c, uint64_t t, uint16_t reason)
+{
+  push_sync_closed(c, t, reason);
+  c->state = COLLAR_LOST;
+  c->broken = false;
+  c->closed_us = t;
+  active_syncs--;
+}
+
+// A record advertised while the gateway is not synced to the collar
+static void count_unsynced(const herd_collar_t *c)
+{
+  stats.unsynced++;
+  if (c->link_broken) {
+    stats.link_unsynced++;
+  }
+}
+
+// The collar's next periodic advertising event
+static void collar_event(herd_collar_t *c)
+{
+  const cs_link_level_t *level = &cs_link_levels[c->link_level];
+  const cs_link_level_t *def = &cs_link_levels[CS_LINK_LEVEL_DEFAULT];
+  uint64_t t = c->pa_next_us;
+  uint16_t counter = (uint16_t)c->events;
+  int8_t rssi;
+
+  c->events++;
+  c->pa_next_us = c->start_us + (uint64_t)(c->events * c->period_us);
+  collar_schedule(c);
+
+  stats.pa_nj += radio_pa_energy_nj(level->phy, level->tx_power, record_len);
+  stats.pa_default_nj += radio_pa_energy_nj(def->phy, def->tx_power, record_len);
+
+  switch (c->state) {
+    case COLLAR_LOST:
+      count_unsynced(c);
+      return;
+
+    case COLLAR_PENDING:
+      if (!c->sync_info || !air_ok(c, level->phy, link_gain_db(c), &rssi)) {
+        count_unsynced(c);
+        if (c->sync_info && (++c->missed >= SYNC_ESTABLISH_EVENTS)) {
+          collar_close(c, t, SYNC_FAILED_REASON);
+          stats.sync_failed++;
+        }
+        return;
+      }
+      push_sync_opened(c, t);
+      c->state = COLLAR_SYNCED;
+      c->link_broken = false;
+      if (c->closed_us != 0) {
+        stats.reacquired++;
+        sync_hist[latency_bucket(t - c->closed_us)]++;
+        outage_hist[latency_bucket(t - c->last_rx_us)]++;
+      }
+      if (sync_loss_s > 0) {
+        c->lost_at_us = t + (uint64_t)(rng_exp(sync_loss_s) * 1e6);
+      }
+      // the event that opened the sync is reported too
+      stats.reports++;
+      c->last_rx_us = t;
+      push_record(c, t, counter, rssi);
+      return;
+
+    default:
+      if (t >= c->lost_at_us) {
+        // nothing more is received, the host hears of it at the timeout
+        c->broken = true;
+        c->lost_at_us = UINT64_MAX;
+        stats.sync_losses++;
+      }
+      break;
+  }
+
+  if (c->broken) {
+    count_unsynced(c);
+  } else {
+    stats.reports++;
+    if (air_ok(c, level->phy, link_gain_db(c), &rssi)) {
+      c->last_rx_us = t;
+      push_record(c, t, counter, rssi);
+      return;
+    }
+    stats.lost_air++;
+  }
+  if (t - c->last_rx_us >= c->timeout_us) {
+    if (!c->broken) {
+      stats.sync_timeouts++;
+    }
+    collar_close(c, t, SYNC_LOST_REASON);
+  }
+}
+
+// One PAwR event: the subevent data request and the collars' responses
+static void pawr_event(void)
+{
+  sl_bt_msg_t evt;
+  uint64_t t = pawr_next_us;
+  uint32_t last = (n_collars < 0xFF) ? n_collars : 0xFF;
+
+  pawr_next_us += pawr_period_us;
+
+  evt.header = sl_bt_evt_pawr_advertiser_subevent_data_request_id;
+  evt.data.evt_pawr_advertiser_subevent_data_request.advertising_set = pawr_handle;
+  evt.data.evt_pawr_advertiser_subevent_data_request.subevent_start = 0;
+  evt.data.evt_pawr_advertiser_subevent_data_request.subevent_data_count = CS_PAWR_SUBEVENTS;
+  herd_ncp_push(&evt, PAWR_REQUEST_LEN, t, TAG_OTHER);
+
+  for (uint32_t i = 0; i < last; i++) {
+    const herd_collar_t *c = &collars[i];
+    sl_bt_evt_pawr_advertiser_response_report_t *r = &evt.data.evt_pawr_advertiser_response_report;
+    uint32_t seq = (uint32_t)((c->events * (double)pa_us + c->phase_us) / publish_us);
+    int8_t rssi;
+
+    // the PAwR train is on 1M (C_Host/app.c pawr_start), responses at the default power
+    if (!air_ok(c, sl_bt_gap_phy_1m, 0, &rssi)) {
+      continue;
+    }
+    evt.header = sl_bt_evt_pawr_advertiser_response_report_id;
+    r->advertising_set = pawr_handle;
+    r->subevent = cs_pawr_subevent((uint8_t)c->cow_id);
+    r->tx_power = TX_POWER_NONE;
+    r->rssi = rssi;
+    r->cte_type = CTE_NONE;
+    r->channel_index = 0;
+    r->response_slot = cs_pawr_slot((uint8_t)c->cow_id);
+    r->data_status = 0;
+    r->counter = (uint16_t)stats.pawr_events;
+    r->data.len = CS_PAWR_RSP_LEN;
+    r->data.data[CS_PAWR_RSP_VERSION] = CS_PAWR_VERSION;
+    r->data.data[CS_PAWR_RSP_COW_ID] = (uint8_t)c->cow_id;
+    r->data.data[CS_PAWR_RSP_BATTERY] = 90;
+    r->data.data[CS_PAWR_RSP_REDUNDANCY] = config.pa_redundancy;
+    cs_put_le32(&r->data.data[CS_PAWR_RSP_FIRST_SEQ], 0);
+    cs_put_le32(&r->data.data[CS_PAWR_RSP_NEXT_SEQ], seq + 1);
+    r->data.data[CS_PAWR_RSP_LINK] = c->link_level;
+
+    herd_ncp_push(&evt, PAWR_RESPONSE_LEN + r->data.len, t, TAG_OTHER);
+  }
+  stats.pawr_events++;
+}
+
+
+// sl_bt_sync_scanner_open: sync to the collar at its next event
+static sl_status_t herd_sync_open(const bd_addr *address, uint8_t adv_sid, uint16_t *sync)
+{
+  uint32_t i = address->addr[0] | ((uint32_t)address->addr[1] << 8) | ((uint32_t)address->addr[2] << 16);
+  herd_collar_t *c;
+
+  (void)adv_sid;
+  if ((i >= n_collars) || (memcmp(collars[i].address.addr, address->addr, sizeof(bd_addr)) != 0)) {
+    return SL_STATUS_NOT_FOUND;
+  }
+  c = &collars[i];
+  if (c->state != COLLAR_LOST) {
+    return SL_STATUS_ALREADY_EXISTS;
+  }
+  if ((max_syncs != 0) && (active_syncs >= max_syncs)) {
+    return SL_STATUS_NO_MORE_RESOURCE;
+  }
+
+  c->state = COLLAR_PENDING;
+  c->sync = next_sync++;
+  c->sync_info = false;
+  c->missed = 0;
+  c->timeout_us = herd_ncp_sync_timeout_us();
+  active_syncs++;
+  stats.sync_opens++;
+  *sync = c->sync;
+  return SL_STATUS_OK;
+}
+
+
+// sl_bt_sync_close: the collar's sync or pending sync ends at once
+static sl_status_t herd_sync_close(uint16_t sync, uint64_t t)
+{
+  for (uint32_t i = 0; i < n_collars; i++) {
+    herd_collar_t *c = &collars[i];
+
+    if ((c->state != COLLAR_LOST) && (c->sync == sync)) {
+      collar_close(c, t, SYNC_CLOSED_REASON);
+      return SL_STATUS_OK;
+    }
+  }
+  return SL_STATUS_NOT_FOUND;
+}
+
+// A link level from the host, applied as Collar/src/app.c link_apply() does
+static void collar_link(herd_collar_t *c, uint8_t level, uint64_t t)
+{
+  if ((level >= CS_LINK_LEVELS) || (level == c->link_level)) {
+    return;
+  }
+  if ((level > c->link_level) && (t < c->link_dwell_us)) {
+    return;
+  }
+  c->link_level = level;
+  c->link_dwell_us = t + LINK_DWELL_WINDOWS * publish_us;
+  stats.link_changes++;
+
+  // the periodic train restarts: a sync to the old one receives nothing more
+  if ((c->state == COLLAR_SYNCED) && !c->broken) {
+    c->broken = true;
+    c->link_broken = true;
+    stats.link_breaks++;
+  } else if (c->state == COLLAR_PENDING) {
+    c->sync_info = false;
+    c->missed = 0;
+  }
+}
+
+// sl_bt_pawr_advertiser_set_subevent_data: the collars take their link level commands
+static void herd_subevent_data(uint8_t subevent, const uint8_t *data, size_t len, uint64_t t)
+{
+  size_t off = CS_PAWR_CMD_HEADER_LEN;
+
+  (void)subevent;
+  while (off + CS_PAWR_CMD_RECORD_LEN <= len) {
+    uint8_t cow = data[off];
+    uint8_t value_len = data[off + 2];
+
+    if (off + CS_PAWR_CMD_RECORD_LEN + value_len > len) {
+      break;
+    }
+    if ((data[off + 1] == CS_PAWR_CMD_LINK) && (value_len >= 1) && (cow >= 1) && (cow <= n_collars)) {
+      collar_link(&collars[cow - 1], data[off + CS_PAWR_CMD_RECORD_LEN], t);
+    }
+    off += CS_PAWR_CMD_RECORD_LEN + value_len;
+  }
+}
+
+
+static void herd_init(double drift_ppm, bool cold)
+{
+  uint32_t window_ms = cs_config_publish_period_ms(&config);
+
+  publish_us = (uint64_t)window_ms * 1000;
+  pa_us = (config.pa_interval_ms != 0) ? (uint64_t)config.pa_interval_ms * 1000
+                                       : publish_us / config.pa_redundancy;
+
+  collars = calloc(n_collars, sizeof(herd_collar_t));
+  heap = calloc(n_collars, sizeof(uint32_t));
+  if ((collars == NULL) || (heap == NULL)) {
+    perror("herd_init");
+    exit(EXIT_FAILURE);
+  }
+
+  for (uint32_t i = 0; i < n_collars; i++) {
+    herd_collar_t *c = &collars[i];
+    double ppm = (2.0 * rng_uniform() - 1.0) * drift_ppm;
+
+    // static random address, the low bytes are the collar index
+    c->address.addr[0] = (uint8_t)i;
+    c->address.addr[1] = (uint8_t)(i >> 8);
+    c->address.addr[2] = (uint8_t)(i >> 16);
+    c->address.addr[3] = 0x3c;
+    c->address.addr[4] = 0xa7;
+    c->address.addr[5] = 0xc5;
+    c->cow_id = (uint16_t)(i + 1);
+    c->session = (uint8_t)rng_next();
+    c->rssi_mean = (int8_t)(RSSI_MEAN_MIN + rng_uniform() * (RSSI_MEAN_MAX - RSSI_MEAN_MIN));
+    c->loss = 2.0 * loss_mean * rng_uniform();
+    c->period_us = pa_us * (1.0 + ppm * 1e-6);
+    c->phase_us = rng_uniform() * publish_us;
+    c->start_us = (uint64_t)(rng_uniform() * c->period_us);
+    c->pa_next_us = c->start_us;
+    c->adv_next_us = (uint64_t)(rng_uniform() * EXT_ADV_US);
+    c->next_us = (c->adv_next_us < c->pa_next_us) ? c->adv_next_us : c->pa_next_us;
+    c->lost_at_us = UINT64_MAX;
+    c->link_level = CS_LINK_LEVEL_DEFAULT;
+
+    // warm start: the controller already follows the collar
+    if (!cold && ((max_syncs == 0) || (active_syncs < max_syncs))) {
+      c->state = COLLAR_SYNCED;
+      c->sync = next_sync++;
+      c->timeout_us = herd_ncp_sync_timeout_us();
+      c->last_rx_us = c->start_us;
+      active_syncs++;
+      if (sync_loss_s > 0) {
+        c->lost_at_us = c->start_us + (uint64_t)(rng_exp(sync_loss_s) * 1e6);
+      }
+    }
+    heap[i] = i;
+  }
+
+  for (uint32_t i = n_collars / 2; i-- > 0;) {
+    heap_down(i);
+  }
+
+  // without taking the collars' random numbers
+  {
+    static uint8_t buf[CS_PAYLOAD_MAX_LEN];
+    uint64_t rng = rng_state;
+
+    record_len = build_record(&collars[0], 0, buf);
+    rng_state = rng;
+  }
+}
+
+
+// Hand one event to the host the way the NCP host main loop does
+static void dispatch(uint64_t ready_us)
+{
+  uint64_t queued_us;
+  uint32_t tag;
+  uint64_t start;
+  uint64_t spent;
+  uint8_t handle;
+  uint16_t interval;
+
+  herd_ncp_release(&queued_us, &tag);
+  herd_ncp_clock(ready_us);
+
+  start = mono_ns();
+  sl_bt_step();
+  app_process_action();
+  spent = mono_ns() - start;
+
+  host_ns += spent;
+  host_events++;
+
+  // the host is busy for its CPU time plus its commands' UART time
+  now_us = ready_us + spent / 1000 + herd_ncp_command_us();
+
+  if (tag == TAG_REPORT) {
+    uint64_t latency = now_us - queued_us;
+
+    stats.delivered++;
+    latency_hist[latency_bucket(latency)]++;
+    if (latency > latency_max_us) {
+      latency_max_us = latency;
+    }
+  }
+
+  if (!pawr_on && herd_ncp_pawr(&handle, &interval)) {
+    pawr_on = true;
+    pawr_handle = handle;
+    pawr_period_us = (uint64_t)interval * 1250;
+    pawr_next_us = now_us + pawr_period_us;
+  }
+}
+
+static void pace(uint64_t wall_start, double speed, uint64_t t_us)
+{
+  struct timespec ts;
+  uint64_t wake = wall_start + (uint64_t)(t_us * 1000 / speed);
+
+  if (mono_ns() >= wake) {
+    return;
+  }
+  ts.tv_sec = (time_t)(wake / 1000000000ULL);
+  ts.tv_nsec = (long)(wake % 1000000000ULL);
+  clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+
+static void report(double seconds, double speed, uint32_t baud, uint32_t queue, uint64_t host_bytes,
+                   const char *output)
+{
+  herd_ncp_stats_t ncp;
+  double per_report = (stats.delivered > 0) ? (host_ns / 1000.0) / stats.delivered : 0;
+  double per_collar = (double)host_bytes / n_collars;
+  double generated = (stats.reports + stats.unsynced > 0) ? (double)(stats.reports + stats.unsynced) : 1.0;
+  double uart = 0;
+  double saved = 0;
+  uint32_t synced = 0;
+
+  herd_ncp_stats(&ncp);
+  for (uint32_t i = 0; i < n_collars; i++) {
+    synced += (collars[i].state == COLLAR_SYNCED);
+  }
+  if (stats.pa_default_nj > 0) {
+    saved = 100.0 * ((double)stats.pa_default_nj - (double)stats.pa_nj) / stats.pa_default_nj;
+  }
+  if (baud > 0) {
+    uart = 100.0 * (ncp.event_bytes + ncp.command_bytes) * 10 / baud / (now_us / 1e6);
+  }
+
+  fprintf(stderr, "herd: %u collars, %.0f s, %s, NCP %u baud, queue %u events\n",
+          n_collars, seconds, (speed > 0) ? "paced" : "as fast as possible", baud, queue);
+  fprintf(stderr, "records: %u advertised, %u while unsynced (%.1f %%), %u lost on air (%.1f %%),\n"
+                  "         %u dropped by the NCP (%.1f %%), %u delivered (%.1f %%)\n",
+          stats.reports + stats.unsynced, stats.unsynced, 100.0 * stats.unsynced / generated,
+          stats.lost_air, 100.0 * stats.lost_air / generated, stats.dropped, 100.0 * stats.dropped / generated,
+          stats.delivered, 100.0 * stats.delivered / generated);
+  fprintf(stderr, "syncs: %u lost, %u timed out on packet loss, %u opened by the host (%u failed),\n"
+                  "       %u of %u synced at the end, %u adv reports\n",
+          stats.sync_losses, stats.sync_timeouts, stats.sync_opens, stats.sync_failed, synced, n_collars,
+          stats.adv_reports);
+  fprintf(stderr, "time to sync after a loss (%u): p50 %.2f s, p90 %.2f s, p99 %.2f s; "
+                  "records missed for p50 %.2f s, p90 %.2f s, p99 %.2f s\n",
+          stats.reacquired, sync_s(sync_hist, 0.5), sync_s(sync_hist, 0.9), sync_s(sync_hist, 0.99),
+          sync_s(outage_hist, 0.5), sync_s(outage_hist, 0.9), sync_s(outage_hist, 0.99));
+  fprintf(stderr, "link: %u level changes, %u syncs broken by them, %u records unsynced after them;\n"
+                  "      PA energy %.2f mJ per collar, %.1f %% saved against the default level\n",
+          stats.link_changes, stats.link_breaks, stats.link_unsynced, stats.pa_nj / 1e6 / n_collars,
+          saved);
+  fprintf(stderr, "NCP: %u events (%llu bytes), %u dropped, queue peak %u, %u commands (%llu bytes), UART %.1f %%\n",
+          ncp.events, (unsigned long long)ncp.event_bytes, ncp.dropped, ncp.queue_peak, ncp.commands,
+          (unsigned long long)ncp.command_bytes, uart);
+  fprintf(stderr, "host CPU: %.2f us per delivered record, %.2f us per event\n",
+          per_report, (host_events > 0) ? (host_ns / 1000.0) / host_events : 0);
+  fprintf(stderr, "host memory: %llu kB, %.0f bytes per collar\n",
+          (unsigned long long)(host_bytes / 1024), per_collar);
+  fprintf(stderr, "latency air to host: p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n",
+          latency_ms(0.5), latency_ms(0.9), latency_ms(0.99), latency_max_us / 1000.0);
+
+  if (output != NULL) {
+    FILE *f = fopen(output, "a");
+
+    if (f == NULL) {
+      perror(output);
+      return;
+    }
+    if (ftell(f) == 0) {
+      fprintf(f, "Collars,Seconds,Baud,Queue,Records,Unsynced,LostAir,Dropped,Delivered,"
+                 "CpuUsPerRecord,BytesPerCollar,UartPct,LatP50Ms,LatP99Ms,LatMaxMs,SyncP50S,SyncP99S,"
+                 "LinkChanges,LinkBreaks,LinkUnsynced,PaSavedPct\n");
+    }
+    fprintf(f, "%u,%.0f,%u,%u,%u,%u,%u,%u,%u,%.2f,%.0f,%.1f,%.2f,%.2f,%.2f,%.2f,%.2f,%u,%u,%u,%.1f\n",
+            n_collars, seconds, baud, queue, stats.reports + stats.unsynced, stats.unsynced, stats.lost_air,
+            stats.dropped, stats.delivered, per_report, per_collar, uart,
+            latency_ms(0.5), latency_ms(0.99), latency_max_us / 1000.0,
+            sync_s(sync_hist, 0.5), sync_s(sync_hist, 0.99),
+            stats.link_changes, stats.link_breaks, stats.link_unsynced, saved);
+    fclose(f);
+  }
+}
+
+
+int main(int argc, char *argv[])
+{
+  const char *output = NULL;
+  double seconds = DEFAULT_SECONDS;
+  double speed = 0;
+  double drift_ppm = DEFAULT_DRIFT_PPM;
+  uint32_t baud = DEFAULT_BAUD;
+  uint32_t queue = DEFAULT_QUEUE;
+  bool cold = false;
+  uint64_t end_us;
+  uint64_t wall_start;
+  uint64_t rss_start;
+  char *host_argv[argc + 1];
+  int host_argc = 0;
+  int opt;
+
+  config.imu_period_ms = 100;
+  config.window_samples = 30;
+  config.env_period_s = 30;
+  config.pa_interval_ms = 0;
+  config.pa_redundancy = 1;
+  config.mode = CS_MODE_RAW;
+
+  while ((opt = getopt(argc, argv, "n:t:x:b:q:l:d:y:s:CS:c:o:h")) != -1) {
+    switch (opt) {
+      case 'n':
+        n_collars = (uint32_t)atol(optarg);
+        break;
+
+      case 't':
+        seconds = atof(optarg);
+        break;
+
+      case 'x':
+        speed = atof(optarg);
+        break;
+
+      case 'b':
+        baud = (uint32_t)atol(optarg);
+        break;
+
+      case 'q':
+        queue = (uint32_t)atol(optarg);
+        break;
+
+      case 'l':
+        loss_mean = atof(optarg) / 100.0;
+        break;
+
+      case 'd':
+        drift_ppm = atof(optarg);
+        break;
+
+      case 'y':
+        sync_loss_s = atof(optarg);
+        break;
+
+      case 's':
+        max_syncs = (uint32_t)atol(optarg);
+        break;
+
+      case 'C':
+        cold = true;
+        break;
+
+      case 'S':
+        rng_state = strtoull(optarg, NULL, 0) | 1;
+        break;
+
+      case 'c':
+      {
+        unsigned int imu_ms, window, env_s, pa_ms, k, mode = CS_MODE_RAW;
+
+        if (sscanf(optarg, "%u,%u,%u,%u,%u,%u", &imu_ms, &window, &env_s, &pa_ms, &k, &mode) < 5
+            || imu_ms > 0xFFFF || window > 0xFF || env_s > 0xFFFF || pa_ms > 0xFFFF || k > 0xFF || mode > 0xFF) {
+          fprintf(stderr, USAGE, argv[0]);
+          return EXIT_FAILURE;
+        }
+        config.imu_period_ms = (uint16_t)imu_ms;
+        config.window_samples = (uint8_t)window;
+        config.env_period_s = (uint16_t)env_s;
+        config.pa_interval_ms = (uint16_t)pa_ms;
+        config.pa_redundancy = (uint8_t)k;
+        config.mode = (uint8_t)mode;
+
+        if (!cs_config_valid(&config)) {
+          fprintf(stderr, "invalid collar configuration: %s\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+      }
+
+      case 'o':
+        output = optarg;
+        break;
+
+      default:
+        fprintf(stderr, USAGE, argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  if ((n_collars == 0) || (n_collars > HERD_COLLARS_MAX) || (seconds <= 0) || (speed < 0)
+      || (queue == 0) || (queue > HERD_NCP_QUEUE_MAX) || (loss_mean < 0) || (loss_mean > 0.5)) {
+    fprintf(stderr, USAGE, argv[0]);
+    return EXIT_FAILURE;
+  }
+  end_us = (uint64_t)(seconds * 1e6);
+
+  // everything after -- is for the host
+  host_argv[host_argc++] = argv[0];
+  while (optind < argc) {
+    host_argv[host_argc++] = argv[optind++];
+  }
+  host_argv[host_argc] = NULL;
+
+  herd_init(drift_ppm, cold);
+  herd_ncp_setup(baud, queue, herd_sync_open);
+  herd_ncp_hooks(herd_sync_close, herd_subevent_data);
+  rss_start = rss_bytes();
+
+  optind = 1;
+  app_init(host_argc, host_argv);
+
+  {
+    sl_bt_msg_t boot;
+
+    memset(&boot, 0, sizeof(boot));
+    boot.header = sl_bt_evt_system_boot_id;
+    boot.data.evt_system_boot.major = 8;
+    boot.data.evt_system_boot.minor = 2;
+    herd_ncp_push(&boot, BOOT_LEN, 0, TAG_OTHER);
+  }
+
+  wall_start = mono_ns();
+
+  while (1) {
+    uint64_t gen = collars[heap[0]].next_us;
+    uint64_t ready;
+    bool queued = herd_ncp_next(&ready);
+
+    if (pawr_on && (pawr_next_us < gen)) {
+      gen = pawr_next_us;
+    }
+    if (queued && (ready < now_us)) {
+      ready = now_us;
+    }
+
+    // radio traffic first, it fills the NCP queue while the host is busy
+    if ((gen < end_us) && (!queued || (gen <= ready))) {
+      if (pawr_on && (gen == pawr_next_us)) {
+        pawr_event();
+      } else if (collars[heap[0]].adv_next_us <= collars[heap[0]].pa_next_us) {
+        collar_adv(&collars[heap[0]]);
+      } else {
+        collar_event(&collars[heap[0]]);
+      }
+      continue;
+    }
+    if (!queued) {
+      break;
+    }
+
+    if (speed > 0) {
+      pace(wall_start, speed, ready);
+    }
+    dispatch(ready);
+  }
+
+  fflush(stdout);
+  report(seconds, speed, baud, queue, rss_bytes() - rss_start, output);
+  app_deinit();
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,545 @@
+/*
+ * herd_ncp.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulated NCP for the herd generator: a bounded event queue drained over
+ *  a UART, and the stack commands the host uses. Event and command sizes
+ *  are the BGAPI message sizes, so the UART time is what the real adapter
+ *  pays. The herd itself has no connectable collars: connection and GATT
+ *  client commands fail as they would with nothing in range.
+ *
+ *  Events reach the host as BGAPI bytes through ncp_host_rx()/peek(), one
+ *  frame per herd_ncp_release(), and are framed by herd_bgapi.c. Commands
+ *  are answered here directly and do not cross the byte stream.
+ *
+ *  The scanner listens for the window at the start of each scan interval,
+ *  from the virtual time it was started. Scanning on 1M and coded takes
+ *  turns, one interval on each PHY.
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "string.h"
+#include "ncp_host.h"
+#include "sl_bt_ncp_host.h"
+#include "app_log.h"
+#include "herd.h"
+
+
+#define HERD_ADV_SETS       4
+
+// UART: 8N1, ten bit times per byte
+#define UART_BITS_PER_BYTE  10
+
+// BGAPI response: header and result
+#define RSP_LEN             (SL_BGAPI_MSG_HEADER_LEN + 2)
+
+// Stack defaults: scan interval and window 10 ms, sync timeout 10 s
+#define SCAN_DEFAULT        16
+#define SYNC_TIMEOUT_DEFAULT 1000
+
+
+typedef struct herd_event{
+  uint8_t bytes[SL_BGAPI_MSG_HEADER_LEN + HERD_EVENT_MAX];
+  uint16_t len;             // header and payload
+  uint64_t queued_us;       // virtual time the event happened
+  uint64_t ready_us;        // virtual time its last byte reached the host
+  uint32_t tag;
+}herd_event_t;
+
+
+static herd_event_t *queue = NULL;
+static uint32_t queue_depth = 0;
+static uint32_t queue_head = 0;
+static uint32_t queue_count = 0;
+
+static uint32_t uart_baud = 0;
+static uint64_t uart_free_us = 0;     // NCP to host direction idle from here
+static uint64_t command_us = 0;       // command round trips not yet collected
+
+static herd_sync_open_t sync_open_hook = NULL;
+static herd_sync_close_t sync_close_hook = NULL;
+static herd_subevent_data_t subevent_data_hook = NULL;
+
+// Frame released to the host, read through ncp_host_rx()
+static uint8_t rx_frame[SL_BGAPI_MSG_HEADER_LEN + HERD_EVENT_MAX];
+static uint16_t rx_len = 0;
+static uint16_t rx_off = 0;
+
+static herd_ncp_stats_t stats;
+
+// Stack state
+static uint8_t adv_sets = 0;
+static bool scanning = false;
+static uint8_t scan_phy = 0;
+static uint16_t scan_interval = SCAN_DEFAULT;
+static uint16_t scan_window = SCAN_DEFAULT;
+static uint64_t scan_start_us = 0;
+static uint16_t sync_timeout = SYNC_TIMEOUT_DEFAULT;
+static uint64_t clock_us = 0;         // virtual time of the host's commands
+static bool pawr_running = false;
+static uint8_t pawr_handle = 0xff;
+static uint16_t pawr_interval = 0;
+
+
+// Time to move len bytes over the UART (us), none without a rate limit
+static uint64_t uart_us(uint64_t len)
+{
+  if (uart_baud == 0) {
+    return 0;
+  }
+  return (len * UART_BITS_PER_BYTE * 1000000ULL + uart_baud - 1) / uart_baud;
+}
+
+// A command and its response, the host waits for both
+static void command(size_t param_len, size_t rsp_extra)
+{
+  uint64_t len = SL_BGAPI_MSG_HEADER_LEN + param_len + RSP_LEN + rsp_extra;
+
+  stats.commands++;
+  stats.command_bytes += len;
+  command_us += uart_us(len);
+}
+
+
+void herd_ncp_setup(uint32_t baud, uint32_t depth, herd_sync_open_t sync_open)
+{
+  if ((depth == 0) || (depth > HERD_NCP_QUEUE_MAX)) {
+    depth = HERD_NCP_QUEUE_MAX;
+  }
+  queue = calloc(depth, sizeof(herd_event_t));
+  if (queue == NULL) {
+    perror("herd_ncp_setup");
+    exit(EXIT_FAILURE);
+  }
+  queue_depth = depth;
+  uart_baud = baud;
+  sync_open_hook = sync_open;
+}
+
+// Hooks for the herd to follow sync closes and PAwR commands, none by default
+void herd_ncp_hooks(herd_sync_close_t sync_close, herd_subevent_data_t subevent_data)
+{
+  sync_close_hook = sync_close;
+  subevent_data_hook = subevent_data;
+}
+
+// Queue an event that happened at now_us. len is the BGAPI payload length.
+// Returns false when the NCP has no room for it.
+bool herd_ncp_push(sl_bt_msg_t *evt, uint16_t len, uint64_t now_us, uint32_t tag)
+{
+  herd_event_t *e;
+
+  if (len > HERD_EVENT_MAX) {
+    return false;
+  }
+  if (queue_count == queue_depth) {
+    stats.dropped++;
+    return false;
+  }
+
+  e = &queue[(queue_head + queue_count) % queue_depth];
+  queue_count++;
+  if (queue_count > stats.queue_peak) {
+    stats.queue_peak = queue_count;
+  }
+
+  // little endian header, then the packed event as is
+  evt->header = SL_BGAPI_MSG_HEADER(SL_BT_MSG_ID(evt->header), len);
+  memcpy(e->bytes, evt, SL_BGAPI_MSG_HEADER_LEN + len);
+  e->len = SL_BGAPI_MSG_HEADER_LEN + len;
+  e->queued_us = now_us;
+  e->tag = tag;
+
+  // events cross the UART one after the other
+  if (uart_free_us < now_us) {
+    uart_free_us = now_us;
+  }
+  uart_free_us += uart_us(SL_BGAPI_MSG_HEADER_LEN + len);
+  e->ready_us = uart_free_us;
+
+  return true;
+}
+
+// Time the next queued event is complete at the host
+bool herd_ncp_next(uint64_t *ready_us)
+{
+  if (queue_count == 0) {
+    return false;
+  }
+  *ready_us = queue[queue_head].ready_us;
+  return true;
+}
+
+// Put the next queued event on the wire to the host
+void herd_ncp_release(uint64_t *queued_us, uint32_t *tag)
+{
+  herd_event_t *e = &queue[queue_head];
+
+  memcpy(rx_frame, e->bytes, e->len);
+  rx_len = e->len;
+  rx_off = 0;
+  *queued_us = e->queued_us;
+  *tag = e->tag;
+
+  queue_head = (queue_head + 1) % queue_depth;
+  queue_count--;
+
+  stats.events++;
+  stats.event_bytes += e->len;
+}
+
+// UART time of the commands sent since the last call (us)
+uint64_t herd_ncp_command_us(void)
+{
+  uint64_t us = command_us;
+
+  command_us = 0;
+  return us;
+}
+
+void herd_ncp_clock(uint64_t now_us)
+{
+  clock_us = now_us;
+}
+
+bool herd_ncp_scanning(void)
+{
+  return scanning;
+}
+
+bool herd_ncp_hears(uint8_t phy, uint64_t t_us)
+{
+  uint64_t interval_us = scan_interval * 625ULL;
+  uint64_t n;
+
+  if (!scanning || (t_us < scan_start_us) || !(scan_phy & phy)) {
+    return false;
+  }
+  n = (t_us - scan_start_us) / interval_us;
+  if ((scan_phy == sl_bt_scanner_scan_phy_1m_and_coded) && ((n & 1) != (phy == sl_bt_gap_phy_coded))) {
+    return false;
+  }
+  return (t_us - scan_start_us) % interval_us < scan_window * 625ULL;
+}
+
+uint64_t herd_ncp_sync_timeout_us(void)
+{
+  return sync_timeout * 10000ULL;
+}
+
+bool herd_ncp_pawr(uint8_t *handle, uint16_t *interval)
+{
+  *handle = pawr_handle;
+  *interval = pawr_interval;
+  return pawr_running;
+}
+
+void herd_ncp_stats(herd_ncp_stats_t *out)
+{
+  *out = stats;
+}
+
+
+// NCP transport
+sl_status_t ncp_host_init(void)
+{
+  if (queue == NULL) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  return sl_bt_api_initialize_nonblock(ncp_host_tx, ncp_host_rx, ncp_host_peek);
+}
+
+void ncp_host_deinit(void)
+{
+}
+
+// Commands do not cross the byte stream, see sl_bt_* below
+void ncp_host_tx(uint32_t len, uint8_t *data)
+{
+  (void)len;
+  (void)data;
+}
+
+int32_t ncp_host_rx(uint32_t len, uint8_t *data)
+{
+  uint32_t n = rx_len - rx_off;
+
+  if (n > len) {
+    n = len;
+  }
+  memcpy(data, &rx_frame[rx_off], n);
+  rx_off += n;
+  return (int32_t)n;
+}
+
+int32_t ncp_host_peek(void)
+{
+  return rx_len - rx_off;
+}
+
+sl_status_t ncp_host_set_option(char option, char *value)
+{
+  (void)option;
+  (void)value;
+  return SL_STATUS_NOT_FOUND;
+}
+
+sl_status_t app_log_set_option(char option, char *value)
+{
+  (void)option;
+  (void)value;
+  return SL_STATUS_NOT_FOUND;
+}
+
+
+// Advertiser and PAwR train
+sl_status_t sl_bt_advertiser_create_set(uint8_t *handle)
+{
+  command(0, 1);
+  if (adv_sets == HERD_ADV_SETS) {
+    return SL_STATUS_NO_MORE_RESOURCE;
+  }
+  *handle = adv_sets++;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_advertiser_set_timing(uint8_t handle, uint32_t interval_min, uint32_t interval_max,
+                                        uint16_t duration, uint8_t maxevents)
+{
+  (void)duration;
+  (void)maxevents;
+  command(12, 0);
+  if (handle >= adv_sets) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  return ((interval_min < 0x20) || (interval_max < interval_min)) ? SL_STATUS_INVALID_PARAMETER : SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_extended_advertiser_set_phy(uint8_t handle, uint8_t primary_phy, uint8_t secondary_phy)
+{
+  (void)primary_phy;
+  (void)secondary_phy;
+  command(3, 0);
+  return (handle < adv_sets) ? SL_STATUS_OK : SL_STATUS_INVALID_HANDLE;
+}
+
+sl_status_t sl_bt_extended_advertiser_set_data(uint8_t handle, size_t data_len, const uint8_t *data)
+{
+  (void)data;
+  command(2 + data_len, 0);
+  if (handle >= adv_sets) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  return (data_len > 254) ? SL_STATUS_INVALID_PARAMETER : SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_extended_advertiser_start(uint8_t handle, uint8_t connect, uint32_t flags)
+{
+  (void)connect;
+  (void)flags;
+  command(6, 0);
+  return (handle < adv_sets) ? SL_STATUS_OK : SL_STATUS_INVALID_HANDLE;
+}
+
+sl_status_t sl_bt_pawr_advertiser_start(uint8_t handle, uint16_t interval_min, uint16_t interval_max,
+                                        uint32_t flags, uint8_t num_subevents, uint8_t subevent_interval,
+                                        uint8_t response_slot_delay, uint8_t response_slot_spacing,
+                                        uint8_t response_slots)
+{
+  (void)flags;
+  (void)subevent_interval;
+  (void)response_slot_delay;
+  (void)response_slot_spacing;
+  (void)response_slots;
+  command(14, 0);
+  if (handle >= adv_sets) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  if (pawr_running) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  if ((interval_min == 0) || (interval_max < interval_min) || (num_subevents == 0)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  pawr_running = true;
+  pawr_handle = handle;
+  pawr_interval = interval_min;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_pawr_advertiser_set_subevent_data(uint8_t handle, uint8_t subevent,
+                                                    uint8_t response_slot_start, uint8_t response_slot_count,
+                                                    size_t adv_data_len, const uint8_t *adv_data)
+{
+  (void)response_slot_start;
+  (void)response_slot_count;
+  command(5 + adv_data_len, 0);
+  if (!pawr_running || (handle != pawr_handle)) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  if (adv_data_len > 251) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  if (subevent_data_hook != NULL) {
+    subevent_data_hook(subevent, adv_data, adv_data_len, clock_us);
+  }
+  return SL_STATUS_OK;
+}
+
+
+// Scanner and sync
+sl_status_t sl_bt_scanner_set_parameters(uint8_t mode, uint16_t interval, uint16_t window)
+{
+  (void)mode;
+  command(5, 0);
+  if (scanning) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  if ((window < 4) || (window > interval)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  scan_interval = interval;
+  scan_window = window;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_scanner_start(uint8_t scanning_phy, uint8_t discover_mode)
+{
+  (void)discover_mode;
+  command(2, 0);
+  if (scanning) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  if ((scanning_phy != sl_bt_scanner_scan_phy_1m) && (scanning_phy != sl_bt_scanner_scan_phy_coded)
+      && (scanning_phy != sl_bt_scanner_scan_phy_1m_and_coded)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  scanning = true;
+  scan_phy = scanning_phy;
+  scan_start_us = clock_us;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_scanner_stop(void)
+{
+  command(0, 0);
+  scanning = false;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_sync_scanner_set_sync_parameters(uint16_t skip, uint16_t timeout, uint32_t reporting_mode)
+{
+  (void)skip;
+  (void)reporting_mode;
+  command(8, 0);
+  if ((timeout < 0x0A) || (timeout > 0x4000)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  sync_timeout = timeout;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_sync_scanner_open(bd_addr address, uint8_t address_type, uint8_t adv_sid, uint16_t *sync)
+{
+  (void)address_type;
+  command(8, 2);
+  if (sync_open_hook == NULL) {
+    return SL_STATUS_NOT_FOUND;
+  }
+  return sync_open_hook(&address, adv_sid, sync);
+}
+
+sl_status_t sl_bt_sync_close(uint16_t sync)
+{
+  command(2, 0);
+  if (sync_close_hook == NULL) {
+    return SL_STATUS_NOT_FOUND;
+  }
+  return sync_close_hook(sync, clock_us);
+}
+
+
+// Connections and GATT client: no collar in the herd is connectable
+sl_status_t sl_bt_connection_open(bd_addr address, uint8_t address_type, uint8_t initiating_phy,
+                                  uint8_t *connection)
+{
+  (void)address;
+  (void)address_type;
+  (void)initiating_phy;
+  (void)connection;
+  command(8, 1);
+  return SL_STATUS_NOT_SUPPORTED;
+}
+
+sl_status_t sl_bt_connection_set_preferred_phy(uint8_t connection, uint8_t preferred_phy, uint8_t accepted_phy)
+{
+  (void)connection;
+  (void)preferred_phy;
+  (void)accepted_phy;
+  command(3, 0);
+  return SL_STATUS_INVALID_HANDLE;
+}
+
+sl_status_t sl_bt_connection_close(uint8_t connection)
+{
+  (void)connection;
+  command(1, 0);
+  return SL_STATUS_INVALID_HANDLE;
+}
+
+sl_status_t sl_bt_gatt_server_set_max_mtu(uint16_t max_mtu, uint16_t *max_mtu_out)
+{
+  command(2, 2);
+  *max_mtu_out = max_mtu;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_gatt_discover_primary_services_by_uuid(uint8_t connection, size_t uuid_len, const uint8_t *uuid)
+{
+  (void)connection;
+  (void)uuid;
+  command(2 + uuid_len, 0);
+  return SL_STATUS_INVALID_HANDLE;
+}
+
+sl_status_t sl_bt_gatt_discover_characteristics(uint8_t connection, uint32_t service)
+{
+  (void)connection;
+  (void)service;
+  command(5, 0);
+  return SL_STATUS_INVALID_HANDLE;
+}
+
+sl_status_t sl_bt_gatt_set_characteristic_notification(uint8_t connection, uint16_t characteristic, uint8_t flags)
+{
+  (void)connection;
+  (void)characteristic;
+  (void)flags;
+  command(4, 0);
+  return SL_STATUS_INVALID_HANDLE;
+}
+
+sl_status_t sl_bt_gatt_write_characteristic_value(uint8_t connection, uint16_t characteristic,
+                                                  size_t value_len, const uint8_t *value)
+{
+  (void)connection;
+  (void)characteristic;
+  (void)value;
+  command(4 + value_len, 0);
+  return SL_STATUS_INVALID_HANDLE;
+}
+
+sl_status_t sl_bt_gatt_write_characteristic_value_without_response(uint8_t connection, uint16_t characteristic,
+                                                                   size_t value_len, const uint8_t *value,
+                                                                   uint16_t *sent_len)
+{
+  (void)connection;
+  (void)characteristic;
+  (void)value;
+  command(4 + value_len, 2);
+  *sent_len = 0;
+  return SL_STATUS_INVALID_HANDLE;
+}
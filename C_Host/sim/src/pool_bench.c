@@ -0,0 +1,311 @@
+/*
+ * pool_bench.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Scaling of the per-cow analytics pool (C_Host/work_pool.h) from 1 to J
+ *  workers. One thread submits raw windows of N cows in random order, as
+ *  the BLE event thread does; the workers run what the host runs on each:
+ *  the window features and R alert rules on the cow's state. Each cow's
+ *  windows carry a sequence number the worker checks, so any window taken
+ *  out of order or twice is counted.
+ *
+ *  The herd is first run on the submitting thread alone for reference.
+ *  With -s, that share of the windows comes from the cows at home on the
+ *  first worker, which the others then have to steal. Windows per second
+ *  stop growing once the submitting thread is the bottleneck: its cost per
+ *  window is reported with each run.
+ *
+ *    gcc -O2 -pthread -IC_Host/sim/inc -IC_Host -ICommon/inc C_Host/sim/src/pool_bench.c C_Host/sim/src/bench_rules.c \
+ *        C_Host/work_pool.c C_Host/alert_rules.c C_Host/collar_table.c Common/src/cs_features.c -lm -o pool_bench
+ *    ./pool_bench -n 5000 -j 8
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stddef.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+
+#include "work_pool.h"
+#include "alert_rules.h"
+#include "bench_rules.h"
+#include "cs_features.h"
+
+
+#define DEFAULT_COWS        5000
+#define DEFAULT_RULES       20
+#define DEFAULT_WINDOWS     1000000
+#define DEFAULT_SAMPLES     30
+
+// Window period: a cow reports every 3.1 s
+#define WINDOW_MS           3100
+
+// Sample windows and submit order cycle through tables of this size
+#define SAMPLE_POOL         1024
+#define ORDER_POOL          (1 << 20)
+
+#define USAGE "usage: %s [-n <cows>] [-r <rules>] [-N <windows>] [-w <samples>] [-j <workers>] [-s <skew %%>]" \
+  " [-S <seed>]\n"
+
+// A cow's state, owned by whichever worker has the cow
+typedef struct bench_cow{
+  collar_t *collar;
+  uint16_t next_seq;
+  uint32_t handled;
+  uint32_t misordered;
+}bench_cow_t;
+
+static bench_cow_t *cows;
+static uint16_t *submit_seq;
+
+
+static uint64_t mono_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// What the host does with a raw window (app.c alert_window())
+static void analyse(bench_cow_t *c, const cs_window_t *window, uint64_t now_ms)
+{
+  cs_features_acc_t acc;
+  cs_summary_t summary;
+  alert_sample_t sample;
+
+  if (window->seq != c->next_seq) {
+    c->misordered++;
+  }
+  c->next_seq = (uint16_t)(window->seq + 1);
+  c->handled++;
+
+  cs_features_reset(&acc);
+  cs_features_add_window(&acc, window->samples, window->n_samples);
+  cs_features_finish(&acc, &summary);
+  sample.value[ALERT_TEMP] = window->temp;
+  sample.value[ALERT_BATTERY] = window->battery;
+  sample.value[ALERT_ACTIVITY] = summary.odba;
+  sample.value[ALERT_LYING] = (summary.posture == CS_POSTURE_LYING) ? 100 : 0;
+  sample.present = (1u << ALERT_METRICS) - 1;
+  alert_report(c->collar, &sample, now_ms);
+}
+
+static void pool_window(void *owner, const work_item_t *item)
+{
+  analyse(owner, &item->window, item->now_ms);
+}
+
+static void pool_tick(void *owner, uint64_t now_ms)
+{
+  alert_poll_collar(((bench_cow_t *)owner)->collar, now_ms);
+}
+
+static void reset_cows(uint32_t n_cows)
+{
+  collar_table_init();
+  for (uint32_t i = 0; i < n_cows; i++) {
+    cows[i].collar = collar_table_get((uint16_t)(i + 1));
+    cows[i].next_seq = 0;
+    cows[i].handled = 0;
+    cows[i].misordered = 0;
+    submit_seq[i] = 0;
+  }
+  bench_rules_reset_alerts();
+}
+
+// Cows to submit from, skew % of them at home on the first of workers
+static void make_order(uint32_t *order, uint32_t n_cows, uint8_t workers, uint32_t skew)
+{
+  uint32_t hot = (n_cows + workers - 1) / workers;
+
+  for (uint32_t i = 0; i < ORDER_POOL; i++) {
+    if ((workers > 1) && ((uint32_t)(rand() % 100) < skew)) {
+      // cow IDs are index + 1: home worker (index + 1) % workers == 0
+      uint32_t k = (uint32_t)(rand() % hot) * workers + workers - 1;
+
+      order[i] = (k < n_cows) ? k : (uint32_t)workers - 1;
+    } else {
+      order[i] = (uint32_t)rand() % n_cows;
+    }
+  }
+}
+
+static bool check_cows(uint32_t n_cows, uint64_t n_windows)
+{
+  uint64_t handled = 0;
+  uint64_t misordered = 0;
+
+  for (uint32_t i = 0; i < n_cows; i++) {
+    handled += cows[i].handled;
+    misordered += cows[i].misordered;
+  }
+  if ((handled != n_windows) || (misordered != 0)) {
+    printf("  %llu of %llu windows handled, %llu out of order\n", (unsigned long long)handled,
+           (unsigned long long)n_windows, (unsigned long long)misordered);
+    return false;
+  }
+  return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+  uint32_t n_cows = DEFAULT_COWS;
+  uint32_t n_rules = DEFAULT_RULES;
+  uint64_t n_windows = DEFAULT_WINDOWS;
+  uint32_t n_samples = DEFAULT_SAMPLES;
+  long max_workers = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t skew = 0;
+  unsigned int seed = 1;
+  cs_window_t *windows;
+  uint32_t *order;
+  double inline_rate;
+  double one_rate = 0;
+  uint64_t start;
+  uint64_t spent;
+  int failures = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "n:r:N:w:j:s:S:h")) != -1) {
+    switch (opt) {
+      case 'n':
+        n_cows = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        n_rules = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'N':
+        n_windows = strtoull(optarg, NULL, 0);
+        break;
+      case 'w':
+        n_samples = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'j':
+        max_workers = strtol(optarg, NULL, 0);
+        break;
+      case 's':
+        skew = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'S':
+        seed = (unsigned int)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, USAGE, argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((n_cows == 0) || (n_cows > 0xFFFE) || (n_rules == 0) || (n_rules > ALERT_MAX_RULES) || (n_samples == 0)
+      || (n_samples > CS_WINDOW_MAX_SAMPLES) || (max_workers < 1) || (max_workers > WORK_POOL_MAX_WORKERS)
+      || (skew > 100)) {
+    fprintf(stderr, USAGE, argv[0]);
+    return EXIT_FAILURE;
+  }
+  srand(seed);
+
+  bench_rules_load((uint8_t)n_rules);
+
+  cows = calloc(n_cows, sizeof(bench_cow_t));
+  submit_seq = calloc(n_cows, sizeof(uint16_t));
+  windows = calloc(SAMPLE_POOL, sizeof(cs_window_t));
+  order = calloc(ORDER_POOL, sizeof(uint32_t));
+  if ((cows == NULL) || (submit_seq == NULL) || (windows == NULL) || (order == NULL)) {
+    perror("pool_bench");
+    return EXIT_FAILURE;
+  }
+
+  // standing or lying cows moving a little, now and then a lot
+  for (uint32_t i = 0; i < SAMPLE_POOL; i++) {
+    cs_window_t *w = &windows[i];
+    double tilt = (rand() % 3 == 0) ? 1.2 : 0.1;
+    int amp = (rand() % 16 == 0) ? 400 : 40;
+
+    w->version = CS_PAYLOAD_VERSION;
+    w->kind = CS_KIND_RAW;
+    w->battery = (uint8_t)(60 + rand() % 40);
+    w->temp = (uint8_t)(37 + rand() % 3);
+    w->n_samples = (uint8_t)n_samples;
+    for (uint32_t k = 0; k < n_samples; k++) {
+      w->samples[k][0] = (int16_t)(rand() % (2 * amp + 1) - amp);
+      w->samples[k][1] = (int16_t)(1000 * sin(tilt) + rand() % (2 * amp + 1) - amp);
+      w->samples[k][2] = (int16_t)(1000 * cos(tilt) + rand() % (2 * amp + 1) - amp);
+    }
+  }
+
+  printf("pool: %u cows, %u rules, %llu windows of %u samples, skew %u %%\n", n_cows, n_rules,
+         (unsigned long long)n_windows, n_samples, skew);
+
+  // reference: everything on the submitting thread
+  reset_cows(n_cows);
+  make_order(order, n_cows, 1, 0);
+  start = mono_ns();
+  for (uint64_t i = 0; i < n_windows; i++) {
+    uint32_t k = order[i & (ORDER_POOL - 1)];
+    cs_window_t *w = &windows[i & (SAMPLE_POOL - 1)];
+
+    w->cow_id = (uint16_t)(k + 1);
+    w->seq = submit_seq[k]++;
+    analyse(&cows[k], w, 1 + (i * WINDOW_MS) / n_cows);
+  }
+  spent = mono_ns() - start;
+  inline_rate = n_windows * 1e9 / spent;
+  printf("event thread: %.0f ns per window, %.2f M windows/s, %u alerts\n", (double)spent / n_windows,
+         inline_rate / 1e6, bench_rules_alerts());
+
+  for (long j = 1; j <= max_workers; j++) {
+    work_pool_stats_t stats;
+    uint64_t submit_ns = 0;
+    double rate;
+
+    reset_cows(n_cows);
+    make_order(order, n_cows, (uint8_t)j, skew);
+    if (!work_pool_start((uint8_t)j, pool_window, pool_tick)) {
+      fprintf(stderr, "cannot start %ld workers\n", j);
+      return EXIT_FAILURE;
+    }
+
+    start = mono_ns();
+    for (uint64_t i = 0; i < n_windows; i++) {
+      uint32_t k = order[i & (ORDER_POOL - 1)];
+      const cs_window_t *w = &windows[i & (SAMPLE_POOL - 1)];
+      uint64_t t = ((i & 1023) == 0) ? mono_ns() : 0;
+      work_item_t *item = work_pool_item();
+
+      // what app.c copies, the samples in use only
+      item->cow_id = (uint16_t)(k + 1);
+      item->now_ms = 1 + (i * WINDOW_MS) / n_cows;
+      memcpy(&item->window, w, offsetof(cs_window_t, samples));
+      memcpy(item->window.samples, w->samples, w->n_samples * sizeof(w->samples[0]));
+      item->window.cow_id = item->cow_id;
+      item->window.seq = submit_seq[k]++;
+      work_pool_submit(&cows[k], item);
+      if (t != 0) {
+        submit_ns += mono_ns() - t;
+      }
+    }
+    work_pool_drain();
+    spent = mono_ns() - start;
+    work_pool_get_stats(&stats);
+    work_pool_stop();
+
+    rate = n_windows * 1e9 / spent;
+    if (j == 1) {
+      one_rate = rate;
+    }
+    printf("%2ld workers: %.2f M windows/s, x%.2f of 1 worker, x%.2f of the event thread;"
+           " %.1f windows per run, %.1f %% stolen, %llu waits for an item; submit %.0f ns per window\n",
+           j, rate / 1e6, rate / one_rate, rate / inline_rate, (double)stats.items / stats.runs,
+           100.0 * stats.steals / stats.runs, (unsigned long long)stats.full,
+           (double)submit_ns / ((n_windows + 1023) / 1024));
+    if (!check_cows(n_cows, n_windows) || (stats.items != n_windows)) {
+      failures++;
+    }
+  }
+
+  printf("%d failures\n", failures);
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
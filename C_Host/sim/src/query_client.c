@@ -0,0 +1,362 @@
+/*
+ * query_client.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Client of the host's query service (C_Host/query_server.h, host -Q):
+ *  sends one query and prints its rows as CSV, or with -N plays that many
+ *  dashboards querying at once and reports their latency and how much of
+ *  the store the shared page cache saved reading.
+ *
+ *  With -d it serves the store in that directory on the socket itself
+ *  first, for a store the host is not running on: with -w it only serves,
+ *  until interrupted, as a daemon beside the host.
+ *
+ *  The dashboards of the benchmark each repeat a mix of the three kinds
+ *  of query: the latest values of every cow, the windows of a cow picked
+ *  at random, and the hourly aggregates of another over the range.
+ *
+ *    gcc -O2 -pthread -IC_Host -ICommon/inc C_Host/sim/src/query_client.c C_Host/query_server.c \
+ *        C_Host/store_query.c C_Host/store_cache.c C_Host/host_store.c Common/src/cs_crc16.c \
+ *        Common/src/cs_features.c -lm -o query_client
+ *    ./query_client -S cow_query.sock -o aggregate -c 12 -b 3600 -F activity,lying
+ *    ./query_client -d store -N 16 -n 50 -k 100
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <signal.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "query_server.h"
+#include "host_store.h"
+#include "store_query.h"
+
+
+#define MAX_CLIENTS         QUERY_MAX_CLIENTS
+
+#define USAGE "usage: %s [-S <socket>] [-d <store dir> [-m <cache MB>] [-w]] [-o range|latest|aggregate]\n" \
+              "       [-c <cow>] [-f <from>] [-t <to>] [-F <field>,...] [-b <bucket s>]\n" \
+              "       [-N <clients> [-n <queries each>] [-k <cows>]]\n"
+
+static const char *field_names[QUERY_FIELDS] = { "activity", "lying", "temp", "battery", "rssi" };
+
+static const char *socket_path = QUERY_DEFAULT_SOCKET;
+static query_request_t base;          // the query, or the range of the benchmark
+static uint32_t n_queries = 50;
+static uint16_t n_cows = 100;
+
+static volatile sig_atomic_t interrupted = 0;
+
+typedef struct client_result {
+  uint32_t *latency_us;
+  uint32_t done;
+  uint32_t failed;
+  uint64_t rows;
+  uint64_t hits;
+  uint64_t misses;
+} client_result_t;
+
+
+static uint64_t mono_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000;
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+
+  return (x > y) - (x < y);
+}
+
+static void on_signal(int sig)
+{
+  (void)sig;
+  interrupted = 1;
+}
+
+static bool parse_fields(char *s, uint16_t *fields)
+{
+  *fields = 0;
+  for (char *name = strtok(s, ","); name != NULL; name = strtok(NULL, ",")) {
+    int i = 0;
+
+    while ((i < QUERY_FIELDS) && (strcmp(name, field_names[i]) != 0)) {
+      i++;
+    }
+    if (i == QUERY_FIELDS) {
+      return false;
+    }
+    *fields |= 1u << i;
+  }
+  return true;
+}
+
+// Send a query and read its frames to the end, printing the rows if print
+static bool run(int fd, query_request_t *req, bool print, query_end_t *end)
+{
+  size_t row_size = query_row_size(req->op, req->fields);
+  uint8_t *buf = malloc(QUERY_FRAME_MAX);
+  query_frame_t frame;
+  bool ended = false;
+
+  memset(end, 0, sizeof(*end));
+  if ((buf == NULL) || !query_send(fd, req)) {
+    free(buf);
+    return false;
+  }
+  while (!ended && query_read_frame(fd, &frame, buf, QUERY_FRAME_MAX)) {
+    ended = (frame.type == QUERY_FRAME_END);
+    if (ended) {
+      memcpy(end, buf, sizeof(*end));
+    }
+    for (size_t pos = 0; print && !ended && (pos + row_size <= frame.len); pos += row_size) {
+      query_row_t row;
+      const uint8_t *p = &buf[pos + sizeof(row)];
+
+      memcpy(&row, &buf[pos], sizeof(row));
+      printf("%u,%u,%u,%u", row.time, row.cow_id, row.level, row.windows);
+      for (size_t i = sizeof(row); i < row_size; i += sizeof(float), p += sizeof(float)) {
+        float v;
+
+        memcpy(&v, p, sizeof(v));
+        printf(",%.2f", v);
+      }
+      printf("\n");
+    }
+  }
+  free(buf);
+  return ended;
+}
+
+static void print_header(const query_request_t *req)
+{
+  printf("# time,cow,level,windows");
+  for (int i = 0; i < QUERY_FIELDS; i++) {
+    if (req->fields & (1u << i)) {
+      if (req->op == QUERY_AGGREGATE) {
+        printf(",%s min,%s max,%s mean", field_names[i], field_names[i], field_names[i]);
+      } else {
+        printf(",%s", field_names[i]);
+      }
+    }
+  }
+  printf("\n");
+}
+
+static void *dashboard(void *arg)
+{
+  client_result_t *res = arg;
+  unsigned int seed = (unsigned int)(uintptr_t)arg;
+  int fd = query_connect(socket_path);
+
+  if (fd < 0) {
+    res->failed = n_queries;
+    return NULL;
+  }
+  for (uint32_t i = 0; i < n_queries; i++) {
+    query_request_t req = base;
+    query_end_t end;
+    uint64_t t = mono_us();
+
+    req.op = (uint8_t)(QUERY_RANGE + i % 3);
+    req.all_cows = (req.op == QUERY_LATEST);
+    req.cow_id = (uint16_t)(rand_r(&seed) % n_cows + 1);
+    req.fields = QUERY_FIELD_ALL;
+    req.bucket_s = 3600;
+    if (!run(fd, &req, false, &end) || (end.status != QUERY_OK)) {
+      res->failed++;
+      if (end.status == QUERY_BUSY) {
+        break;
+      }
+      continue;
+    }
+    res->latency_us[res->done++] = (uint32_t)(mono_us() - t);
+    res->rows += end.rows;
+    res->hits += end.cache_hits;
+    res->misses += end.cache_misses;
+  }
+  close(fd);
+  return NULL;
+}
+
+static int bench(int n_clients)
+{
+  pthread_t threads[MAX_CLIENTS];
+  client_result_t results[MAX_CLIENTS];
+  client_result_t all;
+  uint64_t start = mono_us();
+  double elapsed;
+
+  memset(results, 0, sizeof(results));
+  memset(&all, 0, sizeof(all));
+  all.latency_us = malloc((size_t)n_clients * n_queries * sizeof(uint32_t));
+  for (int i = 0; i < n_clients; i++) {
+    results[i].latency_us = malloc(n_queries * sizeof(uint32_t));
+    if ((all.latency_us == NULL) || (results[i].latency_us == NULL)
+        || (pthread_create(&threads[i], NULL, dashboard, &results[i]) != 0)) {
+      perror("client");
+      return EXIT_FAILURE;
+    }
+  }
+  for (int i = 0; i < n_clients; i++) {
+    pthread_join(threads[i], NULL);
+    memcpy(&all.latency_us[all.done], results[i].latency_us, results[i].done * sizeof(uint32_t));
+    all.done += results[i].done;
+    all.failed += results[i].failed;
+    all.rows += results[i].rows;
+    all.hits += results[i].hits;
+    all.misses += results[i].misses;
+    free(results[i].latency_us);
+  }
+  elapsed = (mono_us() - start) / 1e6;
+
+  qsort(all.latency_us, all.done, sizeof(uint32_t), cmp_u32);
+  printf("%d clients x %u queries: %u done, %u failed in %.2f s, %.0f queries/s, %.0f rows/s\n", n_clients,
+         n_queries, all.done, all.failed, elapsed, all.done / elapsed, all.rows / elapsed);
+  if (all.done > 0) {
+    printf("latency p50 %.2f ms, p90 %.2f ms, p99 %.2f ms, max %.2f ms\n", all.latency_us[all.done / 2] / 1e3,
+           all.latency_us[all.done * 9 / 10] / 1e3, all.latency_us[all.done * 99 / 100] / 1e3,
+           all.latency_us[all.done - 1] / 1e3);
+  }
+  printf("store pages: %llu from the cache, %llu from disk (%.1f%% hits)\n", (unsigned long long)all.hits,
+         (unsigned long long)all.misses,
+         (all.hits + all.misses > 0) ? 100.0 * all.hits / (all.hits + all.misses) : 0.0);
+  free(all.latency_us);
+  return (all.failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+
+int main(int argc, char *argv[])
+{
+  const char *dir = NULL;
+  size_t cache_mb = QUERY_DEFAULT_CACHE_MB;
+  bool serve_only = false;
+  int n_clients = 0;
+  int status = EXIT_SUCCESS;
+  int opt;
+
+  memset(&base, 0, sizeof(base));
+  base.op = QUERY_RANGE;
+  base.all_cows = 1;
+  base.to = UINT32_MAX;
+  base.fields = QUERY_FIELD_ALL;
+
+  while ((opt = getopt(argc, argv, "S:d:m:wo:c:f:t:F:b:N:n:k:h")) != -1) {
+    switch (opt) {
+      case 'S':
+        socket_path = optarg;
+        break;
+      case 'd':
+        dir = optarg;
+        break;
+      case 'm':
+        cache_mb = strtoul(optarg, NULL, 0);
+        break;
+      case 'w':
+        serve_only = true;
+        break;
+      case 'o':
+        base.op = (strcmp(optarg, "latest") == 0) ? QUERY_LATEST
+                  : (strcmp(optarg, "aggregate") == 0) ? QUERY_AGGREGATE : QUERY_RANGE;
+        break;
+      case 'c':
+        base.all_cows = 0;
+        base.cow_id = (uint16_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'f':
+      case 't':
+        if (!store_query_parse_time(optarg, (opt == 'f') ? &base.from : &base.to)) {
+          fprintf(stderr, "%s: not a time\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'F':
+        if (!parse_fields(optarg, &base.fields)) {
+          fprintf(stderr, "fields: activity, lying, temp, battery, rssi\n");
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'b':
+        base.bucket_s = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'N':
+        n_clients = atoi(optarg);
+        break;
+      case 'n':
+        n_queries = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'k':
+        n_cows = (uint16_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, USAGE, argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((n_clients < 0) || (n_clients > MAX_CLIENTS) || (n_cows == 0) || (serve_only && (dir == NULL))) {
+    fprintf(stderr, USAGE, argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (dir != NULL) {
+    if (!query_server_start(socket_path, dir, cache_mb << 20)) {
+      perror(socket_path);
+      return EXIT_FAILURE;
+    }
+    if (serve_only) {
+      signal(SIGINT, on_signal);
+      signal(SIGTERM, on_signal);
+      fprintf(stderr, "Serving %s on %s\n", dir, socket_path);
+      while (!interrupted) {
+        pause();
+      }
+    }
+  }
+
+  if (n_clients > 0) {
+    status = bench(n_clients);
+  } else if (!serve_only) {
+    query_end_t end;
+    int fd = query_connect(socket_path);
+
+    if (fd < 0) {
+      perror(socket_path);
+      status = EXIT_FAILURE;
+    } else {
+      print_header(&base);
+      if (!run(fd, &base, true, &end) || (end.status != QUERY_OK)) {
+        fprintf(stderr, "query failed\n");
+        status = EXIT_FAILURE;
+      } else {
+        fprintf(stderr, "%llu rows in %.2f ms; %u segments read, %u skipped; %llu pages from the cache, %llu from disk\n",
+                (unsigned long long)end.rows, end.elapsed_us / 1e3, end.segments, end.pruned,
+                (unsigned long long)end.cache_hits, (unsigned long long)end.cache_misses);
+      }
+      close(fd);
+    }
+  }
+
+  if (dir != NULL) {
+    query_server_stats_t stats;
+    store_cache_stats_t cache;
+
+    query_server_get_stats(&stats, &cache);
+    query_server_stop();
+    fprintf(stderr, "server: %llu connections, %llu turned away, %llu queries, %llu failed; cache %u of %u pages,"
+            " %llu hits, %llu misses, %llu evictions\n", (unsigned long long)stats.connections,
+            (unsigned long long)stats.busy, (unsigned long long)stats.queries, (unsigned long long)stats.failed,
+            cache.pages, cache.capacity, (unsigned long long)cache.hits, (unsigned long long)cache.misses,
+            (unsigned long long)cache.evictions);
+  }
+  return status;
+}
@@ -0,0 +1,133 @@
+/*
+ * query_main.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Query the window store (C_Host/store_query.h) from the command line:
+ *  the windows of a time range as CSV, with the minute and hour summaries
+ *  that retention left in place of the older ones. Times are seconds
+ *  since the epoch or local yyyy-mm-ddThh:mm:ss.
+ *
+ *    gcc -O2 -pthread -IC_Host -ICommon/inc C_Host/sim/src/query_main.c C_Host/store_query.c \
+ *        C_Host/store_cache.c C_Host/host_store.c Common/src/cs_crc16.c -lm -o store_query
+ *    ./store_query -d store -c 12 -f 2026-10-01T00:00:00 -t 2026-10-02T00:00:00
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <math.h>
+
+#include "store_query.h"
+
+
+#define USAGE "usage: %s [-d <store dir>] [-c <cow>] [-f <from>] [-t <to>] [-w] [-s]\n"
+
+static bool summaries_only = false;   // -w: leave out the windows
+
+
+static void print_window(const store_window_t *win, void *ctx)
+{
+  (void)ctx;
+  if (summaries_only) {
+    return;
+  }
+  printf("window,%u,%u,%u,%u,%d,", win->time, win->cow_id, win->battery, win->temp, win->rssi);
+  if (win->flags & STORE_WINDOW_SEQ) {
+    printf("%u,", win->seq);
+  } else {
+    printf(",");
+  }
+  switch (win->kind) {
+    case CS_KIND_SUMMARY:
+      printf("summary,%u\n", win->summary.windows);
+      break;
+    case CS_KIND_CLASS:
+      printf("labels,%u\n", win->n_labels);
+      break;
+    default:
+      printf("samples,%u\n", win->n_samples);
+      break;
+  }
+}
+
+static void print_stat(const store_stat_t *stat, uint16_t windows)
+{
+  printf(",%.1f,%d,%d", (double)stat->sum / windows, stat->min, stat->max);
+}
+
+static void print_summary(const store_summary_t *sum, void *ctx)
+{
+  uint16_t active = (sum->active > 0) ? sum->active : 1;
+  double mean = (double)sum->activity.sum / active;
+  double var = (double)sum->activity_sq / active - mean * mean;
+
+  (void)ctx;
+  printf("%s,%u,%u,%u,%u,%.2f,%u", (sum->level == STORE_MINUTE) ? "minute" : "hour", sum->start,
+         sum->cow_id, sum->windows, sum->missed, 100.0 * sum->missed / (sum->windows + sum->missed),
+         sum->lying);
+  if (sum->active > 0) {
+    print_stat(&sum->activity, sum->active);
+    printf(",%.1f", sqrt((var > 0.0) ? var : 0.0));
+  } else {
+    // class labels only: no activity
+    printf(",,,,");
+  }
+  print_stat(&sum->temp, sum->windows);
+  print_stat(&sum->battery, sum->windows);
+  print_stat(&sum->rssi, sum->windows);
+  printf("\n");
+}
+
+
+int main(int argc, char *argv[])
+{
+  const char *dir = "store";
+  store_query_t q = { 0, UINT32_MAX, true, 0, NULL, NULL };
+  store_query_stats_t stats;
+  bool show_stats = false;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "d:c:f:t:wsh")) != -1) {
+    switch (opt) {
+      case 'd':
+        dir = optarg;
+        break;
+      case 'c':
+        q.all_cows = false;
+        q.cow_id = (uint16_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'f':
+      case 't':
+        if (!store_query_parse_time(optarg, (opt == 'f') ? &q.from : &q.to)) {
+          fprintf(stderr, "%s: not a time\n", optarg);
+          return EXIT_FAILURE;
+        }
+        break;
+      case 'w':
+        summaries_only = true;
+        break;
+      case 's':
+        show_stats = true;
+        break;
+      default:
+        fprintf(stderr, USAGE, argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  printf("# window,time,cow,battery,temp,rssi,seq,samples|summary|labels,n\n"
+         "# minute|hour,start,cow,windows,missed,loss%%,lying,activity mean,min,max,std,"
+         "temp mean,min,max,battery mean,min,max,rssi mean,min,max\n");
+  if (!store_query(dir, &q, print_window, print_summary, NULL, &stats)) {
+    perror(dir);
+    return EXIT_FAILURE;
+  }
+  if (show_stats) {
+    fprintf(stderr, "%u segments read, %u skipped by time, %llu windows, %llu summaries\n", stats.segments,
+            stats.pruned, (unsigned long long)stats.windows, (unsigned long long)stats.summaries);
+  }
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,66 @@
+/*
+ * replay_main.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Replays an NCP capture (C_Host/ncp_capture.h) through C_Host/app.c on
+ *  Linux without an adapter: the main loop of the NCP host, with the
+ *  capture standing in for the serial port. The time from BGAPI framing
+ *  through sl_bt_on_event() to the CSV writers is measured on its own, so
+ *  a capture of the herd generator or of a real gateway benchmarks host
+ *  changes against the same traffic. The run ends with a summary at the
+ *  end of the capture, and app_deinit() as at the end of a live run.
+ *
+ *  Record with the herd generator, replay as fast as possible:
+ *    ./herd -n 1000 -t 600 -b 0 -- -W herd.cap > /dev/null
+ *    gcc -O2 -pthread -IC_Host/sim/inc -IC_Host -ICommon/inc \
+ *        C_Host/sim/src/replay_main.c C_Host/sim/src/herd_ncp.c C_Host/sim/src/herd_bgapi.c \
+ *        C_Host/app.c C_Host/collar_table.c C_Host/link_control.c C_Host/ncp_capture.c C_Host/host_metrics.c \
+ *        C_Host/gap_tracker.c C_Host/alert_rules.c C_Host/host_store.c C_Host/store_retention.c C_Host/sync_acquire.c \
+ *        C_Host/ota_batch.c C_Host/delta_diff.c C_Host/work_pool.c C_Host/shm_feed.c \
+ *        C_Host/query_server.c C_Host/store_query.c C_Host/store_cache.c \
+ *        Common/src/cs_payload.c Common/src/cs_crc16.c Common/src/cs_features.c Common/src/cs_classifier.c \
+ *        Common/src/cs_delta.c Common/src/cs_orient.c -lm -o replay
+ *    ./replay -P herd.cap -F > /dev/null
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "app.h"
+#include "herd.h"
+#include "ncp_capture.h"
+#include "sl_bt_ncp_host.h"
+
+
+int main(int argc, char *argv[])
+{
+  bool replay = false;
+
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], "-P", 2) == 0) {
+      replay = true;
+    }
+  }
+  if (!replay) {
+    fprintf(stderr, "usage: %s -P <capture> [-F] [<host options>]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  // commands are answered by the simulated NCP, it has no herd behind it
+  herd_ncp_setup(0, 0, NULL);
+  app_init(argc, argv);
+
+  // the store, metrics and workers are shut down as at the end of a live run
+  while (1) {
+    sl_bt_step();
+    if (ncp_replay_ended()) {
+      break;
+    }
+    app_process_action();
+  }
+  app_deinit();
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+/*
+ * seq_check.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Checks of the window sequence tracking in C_Host/collar_table.c: each
+ *  case feeds a collar a run of windows (live or over bulk transfer) and
+ *  checks which are taken as new, and the hole left for bulk transfer. A
+ *  live window far behind the others restarts the sequence, as in the host.
+ *
+ *    gcc -O2 -IC_Host -ICommon/inc C_Host/sim/src/seq_check.c C_Host/collar_table.c -o seq_check
+ *    ./seq_check
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "collar_table.h"
+
+
+#define MAX_STEPS 16
+
+// Step kinds
+#define LIVE 0      // a periodic advertising window, 16-bit sequence number
+#define BULK 1      // a bulk transfer window, 32-bit sequence number
+#define SKIP 2      // everything before seq is dealt with
+
+typedef struct seq_step
+{
+  uint8_t kind;
+  uint32_t seq;
+  int expect;       // collar_mark_seq() result, -1 for SKIP
+} seq_step_t;
+
+typedef struct seq_case
+{
+  const char *name;
+  seq_step_t steps[MAX_STEPS];
+  uint8_t n_steps;
+  uint32_t wanted;  // collar_wanted_seq() at the end
+  uint32_t missed;  // seq_missed at the end
+} seq_case_t;
+
+static const seq_case_t cases[] = {
+  {
+    "duplicate after a jump",
+    { { LIVE, 0, 1 }, { LIVE, 100, 1 }, { LIVE, 101, 1 }, { LIVE, 101, 0 } }, 4,
+    1, 0
+  },
+  {
+    "host started mid-session",
+    { { LIVE, 5000, 1 }, { LIVE, 5001, 1 }, { LIVE, 5001, 0 }, { LIVE, 5000, 0 } }, 4,
+    0, 0
+  },
+  {
+    "bulk fills the hole",
+    { { LIVE, 10, 1 }, { SKIP, 10, -1 }, { LIVE, 200, 1 }, { BULK, 11, 1 }, { BULK, 12, 1 },
+      { BULK, 12, 0 }, { BULK, 200, 0 } }, 7,
+    13, 0
+  },
+  {
+    "bulk after windows overwritten",
+    { { LIVE, 10, 1 }, { SKIP, 10, -1 }, { LIVE, 200, 1 }, { SKIP, 150, -1 }, { BULK, 150, 1 },
+      { BULK, 150, 0 } }, 6,
+    151, 0
+  },
+  {
+    "second hole is missed",
+    { { LIVE, 0, 1 }, { LIVE, 70, 1 }, { LIVE, 72, 1 }, { LIVE, 200, 1 }, { LIVE, 100, 0 } }, 5,
+    1, 65
+  },
+  {
+    "16-bit wrap",
+    { { LIVE, 65530, 1 }, { SKIP, 65530, -1 }, { LIVE, 65535, 1 }, { LIVE, 0, 1 }, { LIVE, 3, 1 },
+      { LIVE, 0, 0 }, { LIVE, 65535, 0 } }, 7,
+    65531, 0
+  },
+  {
+    "restart in the same session",
+    { { LIVE, 500, 1 }, { LIVE, 501, 1 }, { LIVE, 500, 0 }, { LIVE, 0, 1 }, { LIVE, 1, 1 },
+      { LIVE, 0, 0 } }, 6,
+    2, 0
+  },
+};
+
+static int run_case(const seq_case_t *c)
+{
+  collar_t *collar;
+  int failures = 0;
+
+  collar_table_init();
+  collar = collar_table_get(1);
+  collar_set_session(collar, 1);
+
+  for (uint8_t i = 0; i < c->n_steps; i++)
+  {
+    const seq_step_t *s = &c->steps[i];
+    int got;
+
+    if (s->kind == SKIP)
+    {
+      collar_skip_to(collar, s->seq);
+      continue;
+    }
+    if (s->kind == LIVE)
+    {
+      // as the host does for a window in the same session
+      if (collar_seq_restarted(collar, collar_unwrap_seq(collar, (uint16_t)s->seq)))
+      {
+        collar_restart_seq(collar);
+      }
+      got = collar_mark_seq(collar, collar_unwrap_seq(collar, (uint16_t)s->seq));
+    }
+    else
+    {
+      got = collar_mark_seq(collar, s->seq);
+    }
+    if (got != s->expect)
+    {
+      printf("%s: window %u at step %u %s\n", c->name, s->seq, i,
+             got ? "taken as new" : "dropped as a duplicate");
+      failures++;
+    }
+  }
+
+  if (collar_wanted_seq(collar) != c->wanted)
+  {
+    printf("%s: oldest window wanted %u, expected %u\n", c->name, collar_wanted_seq(collar), c->wanted);
+    failures++;
+  }
+  if (collar->seq_missed != c->missed)
+  {
+    printf("%s: %u windows missed, expected %u\n", c->name, collar->seq_missed, c->missed);
+    failures++;
+  }
+  return failures;
+}
+
+int main(void)
+{
+  int failures = 0;
+
+  for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+  {
+    failures += run_case(&cases[i]);
+  }
+  printf("%zu cases, %d failures\n", sizeof(cases) / sizeof(cases[0]), failures);
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,286 @@
+/*
+ * store_bench.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Cost of the window store's group commit (C_Host/host_store.h): N raw
+ *  windows are appended under each commit policy, from no sync at all to a
+ *  sync per record, and the run reports windows and MB per second, syncs,
+ *  and mean and worst time per sync. -r paces the windows like a herd
+ *  would (a 1000 cow herd sends about 320 windows/s) instead of appending
+ *  them as fast as possible.
+ *
+ *  Then a segment is left as a crash would leave it: records written past
+ *  the last commit and a torn record at the end. Recovery from the
+ *  committed size is timed against a scan of the whole segment.
+ *
+ *  Run it on the disk the host writes to:
+ *
+ *    gcc -O2 -IC_Host -ICommon/inc C_Host/sim/src/store_bench.c C_Host/host_store.c \
+ *        Common/src/cs_crc16.c -o store_bench
+ *    ./store_bench -d /var/lib/collar/bench -N 20000
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+
+#include "host_store.h"
+
+
+#define DEFAULT_WINDOWS     20000
+#define DEFAULT_SAMPLES     30
+
+// Windows in the segment left behind by the simulated crash, and how many
+// of them come after the last commit
+#define CRASH_WINDOWS       200000
+#define CRASH_TAIL          1000
+
+#define USAGE "usage: %s [-d <dir>] [-N <windows>] [-s <samples>] [-r <windows/s>]\n"
+
+typedef struct policy {
+  const char *name;
+  uint32_t every_ms;
+  uint32_t every_records;
+} policy_t;
+
+static const policy_t policies[] = {
+  { "no sync",         0,    0 },
+  { "every 1000 ms",   1000, 0 },
+  { "every 100 ms",    100,  0 },
+  { "every 10 ms",     10,   0 },
+  { "every 1000 rec",  0,    1000 },
+  { "every 100 rec",   0,    100 },
+  { "every 10 rec",    0,    10 },
+  { "every record",    0,    1 },
+  { "1000 ms/1000 rec", 1000, 1000 },
+};
+
+
+static uint64_t mono_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void make_window(store_window_t *win, uint32_t i, uint8_t samples)
+{
+  win->kind = CS_KIND_RAW;
+  win->time = 1790000000u + i / 100;
+  win->cow_id = (uint16_t)(i % 1000 + 1);
+  win->flags = STORE_WINDOW_SEQ;
+  win->seq = (uint16_t)(i / 1000);
+  win->battery = 200;
+  win->temp = 28;
+  win->counter = i;
+  win->rssi = (int8_t)(-60 - (int)(i % 30));
+  win->n_samples = samples;
+  for (uint8_t s = 0; s < samples; s++) {
+    win->samples[s][0] = (int16_t)(-100 + (int)((i * 7 + s) % 30));
+    win->samples[s][1] = (int16_t)(-10 + (int)((i * 3 + s) % 20));
+    win->samples[s][2] = (int16_t)(990 + (int)((i + s) % 15));
+  }
+}
+
+static void remove_segments(const store_writer_t *w)
+{
+  char path[STORE_PATH_MAX + STORE_PREFIX_MAX + 16];
+
+  for (uint32_t s = 0; s <= w->segment; s++) {
+    snprintf(path, sizeof(path), "%s/%s-%06u.seg", w->dir, w->prefix, s);
+    unlink(path);
+  }
+}
+
+static bool run_policy(const char *dir, const policy_t *policy, uint32_t n, uint8_t samples, uint32_t rate)
+{
+  store_writer_t w;
+  store_window_t win;
+  uint64_t start, spent;
+  clock_t cpu;
+  double seconds;
+
+  if (!store_open(&w, dir, "bench", STORE_RAW)) {
+    perror(dir);
+    return false;
+  }
+  store_set_commit(&w, policy->every_ms, policy->every_records);
+
+  cpu = clock();
+  start = mono_ns();
+  for (uint32_t i = 0; i < n; i++) {
+    make_window(&win, i, samples);
+    if (rate > 0) {
+      // pace the arrivals, polling like the host's main loop
+      uint64_t due = start + (uint64_t)i * 1000000000ULL / rate;
+
+      while (mono_ns() < due) {
+        struct timespec ts = { 0, 200000 };
+
+        store_poll(&w);
+        nanosleep(&ts, NULL);
+      }
+    }
+    if (!store_append(&w, &win)) {
+      perror("store_append");
+      return false;
+    }
+  }
+  if (!store_close(&w)) {
+    perror("store_close");
+    return false;
+  }
+  spent = mono_ns() - start;
+  seconds = (double)spent / 1e9;
+  cpu = clock() - cpu;
+
+  printf("%-17s %10.0f %8.1f %8llu %10.3f %10.3f %8.2f\n", policy->name, n / seconds,
+         w.bytes / 1e6 / seconds, (unsigned long long)w.commits,
+         (w.commits > 0) ? w.commit_ns / 1e6 / w.commits : 0.0, w.commit_max_ns / 1e6,
+         (double)cpu / CLOCKS_PER_SEC * 1e6 / n);
+  remove_segments(&w);
+  return true;
+}
+
+// Leave a segment as a crash would: CRASH_TAIL records written after the
+// last commit, then half a record
+static bool crash_segment(const char *dir, uint8_t samples, store_writer_t *w, uint64_t *tail)
+{
+  store_window_t win;
+  uint8_t torn[STORE_RECORD_MAX];
+  size_t torn_len;
+
+  if (!store_open(w, dir, "crash", STORE_RAW)) {
+    perror(dir);
+    return false;
+  }
+  for (uint32_t i = 0; i < CRASH_WINDOWS - CRASH_TAIL; i++) {
+    make_window(&win, i, samples);
+    store_append(w, &win);
+  }
+  store_commit(w);
+
+  store_set_commit(w, 0, 0);
+  for (uint32_t i = CRASH_WINDOWS - CRASH_TAIL; i < CRASH_WINDOWS; i++) {
+    make_window(&win, i, samples);
+    store_append(w, &win);
+  }
+  make_window(&win, CRASH_WINDOWS, samples);
+  torn_len = store_encode(&win, torn) / 2;
+  *tail = w->len + torn_len;
+
+  // the kernel got the records, the header was never updated
+  if ((write(w->fd, w->buf, w->len) != (ssize_t)w->len) || (write(w->fd, torn, torn_len) != (ssize_t)torn_len)) {
+    perror("write");
+    return false;
+  }
+  close(w->fd);
+  w->fd = -1;
+  free(w->buf);
+  w->buf = NULL;
+  return true;
+}
+
+static bool bench_recovery(const char *dir, uint8_t samples)
+{
+  char path[STORE_PATH_MAX + STORE_PREFIX_MAX + 16];
+  uint8_t zero[STORE_SEGMENT_HEADER_LEN - STORE_MAGIC_LEN] = { 0 };
+  store_recovery_t r;
+  store_writer_t w;
+  uint64_t tail;
+  uint64_t start;
+  double tail_ms, full_ms;
+  int fd;
+
+  // from the committed size
+  if (!crash_segment(dir, samples, &w, &tail)) {
+    return false;
+  }
+  start = mono_ns();
+  if (!store_recover(dir, &r)) {
+    perror("store_recover");
+    return false;
+  }
+  tail_ms = (mono_ns() - start) / 1e6;
+  printf("recovery from the commit: %u segments, scanned %llu bytes, cut %llu bytes in %.3f ms"
+         " (tail written %llu bytes)\n", r.segments, (unsigned long long)r.scanned,
+         (unsigned long long)r.truncated, tail_ms, (unsigned long long)tail);
+  remove_segments(&w);
+
+  // the same crash with the committed size lost: the whole segment is scanned
+  if (!crash_segment(dir, samples, &w, &tail)) {
+    return false;
+  }
+  snprintf(path, sizeof(path), "%s/%s-%06u.seg", w.dir, w.prefix, w.segment);
+  fd = open(path, O_WRONLY);
+  if ((fd < 0) || (pwrite(fd, zero, sizeof(zero), STORE_MAGIC_LEN) != (ssize_t)sizeof(zero))) {
+    perror(path);
+    return false;
+  }
+  close(fd);
+  start = mono_ns();
+  if (!store_recover(dir, &r)) {
+    perror("store_recover");
+    return false;
+  }
+  full_ms = (mono_ns() - start) / 1e6;
+  printf("recovery of the whole segment: scanned %llu bytes, cut %llu bytes in %.3f ms\n",
+         (unsigned long long)r.scanned, (unsigned long long)r.truncated, full_ms);
+  remove_segments(&w);
+  return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+  const char *dir = "store_bench.d";
+  uint32_t n = DEFAULT_WINDOWS;
+  uint32_t samples = DEFAULT_SAMPLES;
+  uint32_t rate = 0;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "d:N:s:r:h")) != -1) {
+    switch (opt) {
+      case 'd':
+        dir = optarg;
+        break;
+      case 'N':
+        n = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 's':
+        samples = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'r':
+        rate = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      default:
+        fprintf(stderr, USAGE, argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((n == 0) || (samples == 0) || (samples > CS_WINDOW_MAX_SAMPLES)) {
+    fprintf(stderr, USAGE, argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  printf("%u windows of %u samples%s\n", n, samples, (rate > 0) ? "" : ", as fast as possible");
+  printf("%-17s %10s %8s %8s %10s %10s %8s\n", "policy", "windows/s", "MB/s", "syncs", "sync ms", "max ms",
+         "CPU us");
+  for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+    if (!run_policy(dir, &policies[i], n, (uint8_t)samples, rate)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (!bench_recovery(dir, (uint8_t)samples)) {
+    return EXIT_FAILURE;
+  }
+  rmdir(dir);
+  return EXIT_SUCCESS;
+}
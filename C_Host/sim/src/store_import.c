@@ -0,0 +1,505 @@
+/*
+ * store_import.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Import ble_data_log.csv files into the window store (C_Host/host_store.h).
+ *  Each file is mapped and cut on line boundaries into one slice per
+ *  thread. A first pass reads only the hh:mm:ss of each line to count the
+ *  midnights in every slice, so that each thread knows the day its slice
+ *  starts on; the second pass parses the lines and appends them to the
+ *  thread's own segments. The log carries no date: the last line is taken
+ *  to be from the day the file was last written (-d gives the first day
+ *  instead).
+ *
+ *  Lines are <hour>,<min>,<sec>,<battery>,<temp>,<cow>, then x,y,z for each
+ *  sample, then <counter>,<rssi>. Header lines ("ID,ID,...") are skipped,
+ *  other lines that do not parse are counted as malformed.
+ *
+ *    gcc -O2 -pthread -IC_Host -ICommon/inc C_Host/sim/src/store_import.c \
+ *        C_Host/host_store.c Common/src/cs_crc16.c -o store_import
+ *    ./store_import -o store ble_data_log.csv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "host_store.h"
+
+
+#define MAX_THREADS         64
+
+// Files smaller than this per thread use fewer threads
+#define MIN_SLICE           (1 << 20)
+
+// ID fields, then samples, then counter and RSSI
+#define ID_FIELDS           6
+#define MAX_FIELDS          (ID_FIELDS + CS_WINDOW_MAX_SAMPLES * 3 + 2)
+
+// A step back in time of more than this between lines is a new day
+#define MIDNIGHT_STEP_S     (12 * 3600)
+
+#define USAGE "usage: %s [-o <store dir>] [-j <threads>] [-d <yyyy-mm-dd>] [-n] <ble_data_log.csv>...\n"
+
+typedef struct slice {
+  const char *begin;
+  const char *end;
+  // first pass
+  int32_t first_tod;            // time of day of the first line, -1 if none
+  int32_t last_tod;
+  uint32_t midnights;           // inside the slice
+  // second pass
+  uint32_t day;                 // day of the first line, from the first day of the file
+  int32_t prev_tod;             // time of day of the line before the slice, -1 if none
+  store_writer_t *writer;
+  uint64_t windows;
+  uint64_t malformed;
+  uint64_t headers;
+  const char *first_malformed;
+  bool write_failed;
+} slice_t;
+
+static struct tm first_day;     // of the file being imported
+static bool dry_run = false;    // -n: parse only
+
+
+static uint64_t mono_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Decimal integer up to the next ',' or the end of the line, 10 digits at most
+static inline bool parse_int(const char **pp, const char *end, int64_t *v)
+{
+  const char *p = *pp;
+  const char *digits;
+  bool negative = false;
+  int64_t n = 0;
+
+  if ((p < end) && (*p == '-')) {
+    negative = true;
+    p++;
+  }
+  digits = p;
+  while ((p < end) && ((unsigned)(*p - '0') < 10)) {
+    n = n * 10 + (*p - '0');
+    p++;
+  }
+  if ((p == digits) || (p - digits > 10)) {
+    return false;
+  }
+  *v = negative ? -n : n;
+  *pp = p;
+  return true;
+}
+
+static const char *line_end(const char *p, const char *end)
+{
+  const char *nl = memchr(p, '\n', (size_t)(end - p));
+
+  return (nl != NULL) ? nl : end;
+}
+
+// hh:mm:ss of a line as seconds into the day, -1 if the line has none
+static int32_t line_tod(const char *p, const char *end)
+{
+  int64_t h, m, s;
+
+  if (!parse_int(&p, end, &h) || (p == end) || (*p++ != ',')
+      || !parse_int(&p, end, &m) || (p == end) || (*p++ != ',')
+      || !parse_int(&p, end, &s) || (p == end) || (*p != ',')
+      || (h < 0) || (h > 23) || (m < 0) || (m > 59) || (s < 0) || (s > 59)) {
+    return -1;
+  }
+  return (int32_t)(h * 3600 + m * 60 + s);
+}
+
+static void *first_pass(void *arg)
+{
+  slice_t *slice = arg;
+  int32_t prev = -1;
+
+  slice->first_tod = -1;
+  for (const char *p = slice->begin; p < slice->end;) {
+    const char *eol = line_end(p, slice->end);
+    int32_t tod = line_tod(p, eol);
+
+    if (tod >= 0) {
+      if (slice->first_tod < 0) {
+        slice->first_tod = tod;
+      }
+      if ((prev >= 0) && (tod + MIDNIGHT_STEP_S < prev)) {
+        slice->midnights++;
+      }
+      prev = tod;
+    }
+    p = eol + 1;
+  }
+  slice->last_tod = prev;
+  return NULL;
+}
+
+// Parse one line into win. The line must be followed by a byte that is
+// not a digit ('\n' in the file), so that numbers end without a bounds
+// check; the samples line of the host ends with the counter and RSSI and
+// may end in '\r'.
+static bool parse_line(const char *p, const char *end, store_window_t *win)
+{
+  int64_t f[MAX_FIELDS];
+  uint32_t count = 0;
+  uint32_t n;
+
+  if ((end > p) && (end[-1] == '\r')) {
+    end--;
+  }
+  for (;;) {
+    bool negative = (*p == '-');
+    const char *digits = p + negative;
+    uint64_t v = 0;
+    unsigned d;
+
+    p = digits;
+    while ((d = (unsigned)(*p - '0')) < 10) {
+      v = v * 10 + d;
+      p++;
+    }
+    if ((p == digits) || (p - digits > 10) || (count == MAX_FIELDS)) {
+      return false;
+    }
+    f[count++] = negative ? -(int64_t)v : (int64_t)v;
+    if (p >= end) {
+      break;
+    }
+    if (*p++ != ',') {
+      return false;
+    }
+  }
+  if (p != end) {
+    return false;
+  }
+
+  if ((count < ID_FIELDS + 3 + 2) || ((count - ID_FIELDS - 2) % 3 != 0)) {
+    return false;
+  }
+  n = (count - ID_FIELDS - 2) / 3;
+
+  if ((f[0] < 0) || (f[0] > 23) || (f[1] < 0) || (f[1] > 59) || (f[2] < 0) || (f[2] > 59)
+      || (f[3] < 0) || (f[3] > UINT8_MAX) || (f[4] < 0) || (f[4] > UINT8_MAX)
+      || (f[5] < 0) || (f[5] > UINT16_MAX) || (f[count - 2] < 0) || (f[count - 2] > UINT32_MAX)
+      || (f[count - 1] < INT8_MIN) || (f[count - 1] > INT8_MAX)) {
+    return false;
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    const int64_t *v = &f[ID_FIELDS + i * 3];
+
+    if ((v[0] < INT16_MIN) || (v[0] > INT16_MAX) || (v[1] < INT16_MIN) || (v[1] > INT16_MAX)
+        || (v[2] < INT16_MIN) || (v[2] > INT16_MAX)) {
+      return false;
+    }
+    win->samples[i][0] = (int16_t)v[0];
+    win->samples[i][1] = (int16_t)v[1];
+    win->samples[i][2] = (int16_t)v[2];
+  }
+
+  win->battery = (uint8_t)f[3];
+  win->temp = (uint8_t)f[4];
+  win->cow_id = (uint16_t)f[5];
+  win->counter = (uint32_t)f[count - 2];
+  win->rssi = (int8_t)f[count - 1];
+  win->n_samples = (uint8_t)n;
+  // the log has no sequence numbers
+  win->kind = CS_KIND_RAW;
+  win->flags = 0;
+  win->seq = 0;
+  return true;
+}
+
+// The last line of a file may end without '\n': parse it from a copy
+static bool parse_last_line(const char *p, const char *end, store_window_t *win)
+{
+  char line[MAX_FIELDS * 12];
+
+  if ((size_t)(end - p) >= sizeof(line)) {
+    return false;
+  }
+  memcpy(line, p, (size_t)(end - p));
+  line[end - p] = '\n';
+  return parse_line(line, &line[end - p], win);
+}
+
+static time_t day_start(uint32_t day)
+{
+  struct tm tm = first_day;
+
+  tm.tm_mday += (int)day;
+  tm.tm_hour = 0;
+  tm.tm_min = 0;
+  tm.tm_sec = 0;
+  tm.tm_isdst = -1;
+  return mktime(&tm);
+}
+
+static void *second_pass(void *arg)
+{
+  slice_t *slice = arg;
+  store_window_t win;
+  uint32_t day = slice->day;
+  time_t midnight = day_start(day);
+  int32_t prev = slice->prev_tod;
+
+  for (const char *p = slice->begin; p < slice->end;) {
+    const char *eol = line_end(p, slice->end);
+    int32_t tod = line_tod(p, eol);
+
+    // the same days as the first pass, which saw the same lines
+    if (tod >= 0) {
+      if ((prev >= 0) && (tod + MIDNIGHT_STEP_S < prev)) {
+        midnight = day_start(++day);
+      }
+      prev = tod;
+    }
+
+    if (p == eol || (eol - p == 1 && *p == '\r')) {
+      // blank line
+    } else if ((eol - p >= 3) && (memcmp(p, "ID,", 3) == 0)) {
+      slice->headers++;
+    } else if ((tod < 0) || !((eol < slice->end) ? parse_line(p, eol, &win) : parse_last_line(p, eol, &win))) {
+      if (slice->malformed++ == 0) {
+        slice->first_malformed = p;
+      }
+    } else {
+      win.time = (uint32_t)(midnight + tod);
+      if (!dry_run && !store_append(slice->writer, &win)) {
+        slice->write_failed = true;
+        return NULL;
+      }
+      slice->windows++;
+    }
+    p = eol + 1;
+  }
+  if (!dry_run && !store_commit(slice->writer)) {
+    slice->write_failed = true;
+  }
+  return NULL;
+}
+
+static bool run_pass(slice_t *slices, uint32_t n, void *(*pass)(void *))
+{
+  pthread_t threads[MAX_THREADS];
+
+  for (uint32_t i = 0; i < n; i++) {
+    if (pthread_create(&threads[i], NULL, pass, &slices[i]) != 0) {
+      return false;
+    }
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    pthread_join(threads[i], NULL);
+  }
+  return true;
+}
+
+static bool import_file(const char *path, store_writer_t *writers, uint32_t n_threads,
+                        const struct tm *date, uint64_t *total_windows, uint64_t *total_bytes)
+{
+  slice_t slices[MAX_THREADS];
+  struct stat st;
+  const char *data;
+  uint64_t start = mono_ns();
+  uint64_t windows = 0, malformed = 0, headers = 0;
+  uint32_t midnights = 0;
+  int32_t last_tod = -1;
+  uint32_t n;
+  double seconds;
+  int fd;
+
+  fd = open(path, O_RDONLY);
+  if ((fd < 0) || (fstat(fd, &st) != 0)) {
+    perror(path);
+    return false;
+  }
+  if (st.st_size == 0) {
+    close(fd);
+    return true;
+  }
+  data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    perror(path);
+    return false;
+  }
+  madvise((void *)data, (size_t)st.st_size, MADV_SEQUENTIAL);
+
+  // Slices end just after a '\n', the last one at the end of the file
+  n = (uint32_t)((uint64_t)st.st_size / MIN_SLICE) + 1;
+  if (n > n_threads) {
+    n = n_threads;
+  }
+  memset(slices, 0, sizeof(slices));
+  for (uint32_t i = 0; i < n; i++) {
+    const char *cut = data + (uint64_t)st.st_size * (i + 1) / n;
+
+    slices[i].begin = (i == 0) ? data : slices[i - 1].end;
+    if (i == n - 1) {
+      cut = data + st.st_size;
+    } else if (cut > slices[i].begin) {
+      const char *nl = memchr(cut - 1, '\n', (size_t)(data + st.st_size - (cut - 1)));
+
+      cut = (nl != NULL) ? nl + 1 : data + st.st_size;
+    } else {
+      cut = slices[i].begin;
+    }
+    slices[i].end = cut;
+    slices[i].writer = &writers[i];
+  }
+
+  // Days: midnights inside each slice, plus those between slices
+  if (!run_pass(slices, n, first_pass)) {
+    perror("pthread_create");
+    return false;
+  }
+  for (uint32_t i = 0; i < n; i++) {
+    slices[i].day = midnights;
+    slices[i].prev_tod = last_tod;
+    if (slices[i].first_tod >= 0) {
+      if ((last_tod >= 0) && (slices[i].first_tod + MIDNIGHT_STEP_S < last_tod)) {
+        midnights++;
+        slices[i].day = midnights;
+        // the step is counted here, the thread must not count it again
+        slices[i].prev_tod = -1;
+      }
+      midnights += slices[i].midnights;
+      last_tod = slices[i].last_tod;
+    }
+  }
+
+  if (date != NULL) {
+    first_day = *date;
+  } else {
+    // the last line was written shortly before the file's mtime
+    time_t last = (last_tod >= 0) ? (time_t)store_local_time((uint8_t)(last_tod / 3600),
+                                                             (uint8_t)(last_tod / 60 % 60),
+                                                             (uint8_t)(last_tod % 60), st.st_mtime)
+                                  : st.st_mtime;
+
+    localtime_r(&last, &first_day);
+    first_day.tm_mday -= (int)midnights;
+  }
+
+  if (!run_pass(slices, n, second_pass)) {
+    perror("pthread_create");
+    return false;
+  }
+  seconds = (double)(mono_ns() - start) / 1e9;
+
+  for (uint32_t i = 0; i < n; i++) {
+    if (slices[i].write_failed) {
+      perror("store");
+      munmap((void *)data, (size_t)st.st_size);
+      return false;
+    }
+    if ((slices[i].malformed > 0) && (malformed == 0)) {
+      fprintf(stderr, "%s: first malformed line at byte %lld\n", path,
+              (long long)(slices[i].first_malformed - data));
+    }
+    windows += slices[i].windows;
+    malformed += slices[i].malformed;
+    headers += slices[i].headers;
+  }
+  munmap((void *)data, (size_t)st.st_size);
+
+  printf("%s: %llu windows over %u days, %llu malformed lines, %llu header lines, "
+         "%.1f MB in %.3f s (%.0f MB/s, %u threads)\n",
+         path, (unsigned long long)windows, midnights + 1, (unsigned long long)malformed,
+         (unsigned long long)headers, st.st_size / 1e6, seconds,
+         (seconds > 0) ? st.st_size / 1e6 / seconds : 0.0, n);
+  *total_windows += windows;
+  *total_bytes += (uint64_t)st.st_size;
+  return true;
+}
+
+
+int main(int argc, char *argv[])
+{
+  store_writer_t writers[MAX_THREADS];
+  const char *dir = "store";
+  struct tm date;
+  bool dated = false;
+  long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+  uint32_t n_threads = (cpus > 0) ? (uint32_t)cpus : 1;
+  uint64_t windows = 0, bytes = 0;
+  uint64_t start;
+  double seconds;
+  bool ok = true;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "o:j:d:nh")) != -1) {
+    switch (opt) {
+      case 'o':
+        dir = optarg;
+        break;
+      case 'j':
+        n_threads = (uint32_t)strtoul(optarg, NULL, 0);
+        break;
+      case 'd':
+        memset(&date, 0, sizeof(date));
+        if (sscanf(optarg, "%d-%d-%d", &date.tm_year, &date.tm_mon, &date.tm_mday) != 3) {
+          fprintf(stderr, USAGE, argv[0]);
+          return EXIT_FAILURE;
+        }
+        date.tm_year -= 1900;
+        date.tm_mon -= 1;
+        dated = true;
+        break;
+      case 'n':
+        dry_run = true;
+        break;
+      default:
+        fprintf(stderr, USAGE, argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+  if ((optind == argc) || (n_threads == 0)) {
+    fprintf(stderr, USAGE, argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (n_threads > MAX_THREADS) {
+    n_threads = MAX_THREADS;
+  }
+
+  // One writer per thread, each with segments of its own
+  for (uint32_t i = 0; (i < n_threads) && !dry_run; i++) {
+    char prefix[STORE_PREFIX_MAX];
+
+    snprintf(prefix, sizeof(prefix), "import-%02u", i);
+    if (!store_open(&writers[i], dir, prefix, STORE_RAW)) {
+      perror(dir);
+      return EXIT_FAILURE;
+    }
+  }
+
+  start = mono_ns();
+  for (int i = optind; (i < argc) && ok; i++) {
+    ok = import_file(argv[i], writers, n_threads, dated ? &date : NULL, &windows, &bytes);
+  }
+  for (uint32_t i = 0; (i < n_threads) && !dry_run; i++) {
+    ok = store_close(&writers[i]) && ok;
+  }
+  seconds = (double)(mono_ns() - start) / 1e9;
+
+  if (optind + 1 < argc) {
+    printf("total: %llu windows, %.1f MB in %.3f s (%.0f MB/s)\n", (unsigned long long)windows,
+           bytes / 1e6, seconds, (seconds > 0) ? bytes / 1e6 / seconds : 0.0);
+  }
+  return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,323 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "store_cache.h"
+
+typedef struct cache_page
+{
+  uint64_t dev;
+  uint64_t ino;
+  uint64_t name;
+  uint32_t index;               // page number in the segment
+  uint32_t next;                // next page in its hash chain, + 1; 0 ends it
+  bool used;
+  bool referenced;              // looked at since the clock hand passed
+} cache_page_t;
+
+// Guarded by lock. Aligned so that shards do not share lines.
+typedef struct cache_shard
+{
+  pthread_mutex_t lock;
+  cache_page_t *pages;
+  uint8_t *data;                // STORE_CACHE_PAGE bytes per page
+  uint32_t *buckets;            // first page of each hash chain, + 1
+  uint32_t n_pages;
+  uint32_t used;
+  uint32_t mask;                // buckets - 1
+  uint32_t hand;
+  uint64_t hits;
+  uint64_t misses;
+  uint64_t uncached;
+  uint64_t evictions;
+} __attribute__((aligned(64))) cache_shard_t;
+
+struct store_cache
+{
+  cache_shard_t shards[STORE_CACHE_SHARDS];
+};
+
+static uint64_t page_hash(const store_cache_file_t *f, uint32_t index)
+{
+  uint64_t h = f->name ^ (f->ino * 0x9e3779b97f4a7c15ull) ^ (f->dev << 32) ^ index;
+
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdull;
+  h ^= h >> 33;
+  return h;
+}
+
+static cache_shard_t *shard_of(store_cache_t *c, uint64_t h)
+{
+  return &c->shards[h % STORE_CACHE_SHARDS];
+}
+
+static uint32_t *bucket_of(cache_shard_t *s, uint64_t h)
+{
+  return &s->buckets[(h / STORE_CACHE_SHARDS) & s->mask];
+}
+
+static bool same_page(const cache_page_t *p, const store_cache_file_t *f, uint32_t index)
+{
+  return (p->index == index) && (p->ino == f->ino) && (p->name == f->name) && (p->dev == f->dev);
+}
+
+// The page's slot, or -1 if it is not in the shard. Under s->lock.
+static int64_t find(cache_shard_t *s, uint64_t h, const store_cache_file_t *f, uint32_t index)
+{
+  for (uint32_t i = *bucket_of(s, h); i != 0; i = s->pages[i - 1].next)
+  {
+    if (same_page(&s->pages[i - 1], f, index))
+    {
+      return i - 1;
+    }
+  }
+  return -1;
+}
+
+// Take a page out of its hash chain. Under s->lock.
+static void unlink_page(cache_shard_t *s, uint32_t slot)
+{
+  cache_page_t *p = &s->pages[slot];
+  store_cache_file_t key = { .dev = p->dev, .ino = p->ino, .name = p->name };
+  uint32_t *link = bucket_of(s, page_hash(&key, p->index));
+
+  while (*link != slot + 1)
+  {
+    link = &s->pages[*link - 1].next;
+  }
+  *link = p->next;
+  p->used = false;
+}
+
+// A slot for a new page: a free one, or the first the clock hand finds
+// not looked at since it last passed. Under s->lock.
+static uint32_t victim(cache_shard_t *s)
+{
+  for (;;)
+  {
+    uint32_t slot = s->hand;
+    cache_page_t *p = &s->pages[slot];
+
+    s->hand = (s->hand + 1) % s->n_pages;
+    if (!p->used)
+    {
+      s->used++;
+      return slot;
+    }
+    if (p->referenced)
+    {
+      p->referenced = false;
+      continue;
+    }
+    unlink_page(s, slot);
+    s->evictions++;
+    return slot;
+  }
+}
+
+static void insert(cache_shard_t *s, uint64_t h, const store_cache_file_t *f, uint32_t index, const uint8_t *data)
+{
+  uint32_t *bucket;
+  cache_page_t *p;
+  uint32_t slot;
+
+  pthread_mutex_lock(&s->lock);
+  // another reader may have read it meanwhile
+  if (find(s, h, f, index) < 0)
+  {
+    slot = victim(s);
+    p = &s->pages[slot];
+    bucket = bucket_of(s, h);
+    p->dev = f->dev;
+    p->ino = f->ino;
+    p->name = f->name;
+    p->index = index;
+    p->used = true;
+    p->referenced = false;
+    p->next = *bucket;
+    *bucket = slot + 1;
+    memcpy(&s->data[(size_t)slot * STORE_CACHE_PAGE], data, STORE_CACHE_PAGE);
+  }
+  s->misses++;
+  pthread_mutex_unlock(&s->lock);
+}
+
+store_cache_t *store_cache_create(size_t bytes)
+{
+  size_t per_shard = bytes / STORE_CACHE_SHARDS / STORE_CACHE_PAGE;
+  store_cache_t *c = calloc(1, sizeof(store_cache_t));
+  uint32_t buckets = 1;
+
+  if (c == NULL)
+  {
+    return NULL;
+  }
+  if (per_shard == 0)
+  {
+    per_shard = 1;
+  }
+  while (buckets < per_shard)
+  {
+    buckets <<= 1;
+  }
+  for (int i = 0; i < STORE_CACHE_SHARDS; i++)
+  {
+    cache_shard_t *s = &c->shards[i];
+
+    pthread_mutex_init(&s->lock, NULL);
+    s->n_pages = (uint32_t)per_shard;
+    s->mask = buckets - 1;
+    s->pages = calloc(per_shard, sizeof(cache_page_t));
+    s->buckets = calloc(buckets, sizeof(uint32_t));
+    s->data = malloc(per_shard * STORE_CACHE_PAGE);
+    if ((s->pages == NULL) || (s->buckets == NULL) || (s->data == NULL))
+    {
+      store_cache_destroy(c);
+      return NULL;
+    }
+  }
+  return c;
+}
+
+void store_cache_destroy(store_cache_t *c)
+{
+  if (c == NULL)
+  {
+    return;
+  }
+  for (int i = 0; i < STORE_CACHE_SHARDS; i++)
+  {
+    cache_shard_t *s = &c->shards[i];
+
+    free(s->pages);
+    free(s->buckets);
+    free(s->data);
+    pthread_mutex_destroy(&s->lock);
+  }
+  free(c);
+}
+
+bool store_cache_attach(store_cache_t *c, store_reader_t *r, const char *path, store_cache_file_t *f)
+{
+  const char *name = strrchr(path, '/');
+  struct stat st;
+
+  memset(f, 0, sizeof(*f));
+  if (fstat(r->fd, &st) != 0)
+  {
+    return false;
+  }
+  f->cache = c;
+  f->fd = r->fd;
+  f->dev = (uint64_t)st.st_dev;
+  f->ino = (uint64_t)st.st_ino;
+
+  // FNV-1a: the name, not the directory, as retention moves segments
+  f->name = 0xcbf29ce484222325ull;
+  for (name = (name != NULL) ? name + 1 : path; *name != '\0'; name++)
+  {
+    f->name = (f->name ^ (uint8_t)*name) * 0x100000001b3ull;
+  }
+
+  r->read = store_cache_read;
+  r->read_ctx = f;
+  return true;
+}
+
+ssize_t store_cache_read(void *ctx, void *buf, size_t len, uint64_t offset)
+{
+  store_cache_file_t *f = ctx;
+  uint8_t *out = buf;
+  uint8_t page[STORE_CACHE_PAGE];
+  size_t done = 0;
+
+  while (done < len)
+  {
+    uint64_t at = offset + done;
+    uint32_t index = (uint32_t)(at / STORE_CACHE_PAGE);
+    size_t in = (size_t)(at % STORE_CACHE_PAGE);
+    size_t n = STORE_CACHE_PAGE - in;
+    uint64_t h = page_hash(f, index);
+    cache_shard_t *s = shard_of(f->cache, h);
+    int64_t slot;
+    ssize_t got;
+
+    if (n > len - done)
+    {
+      n = len - done;
+    }
+
+    pthread_mutex_lock(&s->lock);
+    slot = find(s, h, f, index);
+    if (slot >= 0)
+    {
+      s->pages[slot].referenced = true;
+      memcpy(&out[done], &s->data[(size_t)slot * STORE_CACHE_PAGE + in], n);
+      s->hits++;
+      pthread_mutex_unlock(&s->lock);
+      f->hits++;
+      done += n;
+      continue;
+    }
+    pthread_mutex_unlock(&s->lock);
+
+    do
+    {
+      got = pread(f->fd, page, STORE_CACHE_PAGE, (off_t)index * STORE_CACHE_PAGE);
+    } while ((got < 0) && (errno == EINTR));
+    if (got < 0)
+    {
+      return (done > 0) ? (ssize_t)done : -1;
+    }
+    if (got == STORE_CACHE_PAGE)
+    {
+      insert(s, h, f, index, page);
+      f->misses++;
+    }
+    else
+    {
+      // the end of the segment, which may still grow
+      pthread_mutex_lock(&s->lock);
+      s->uncached++;
+      pthread_mutex_unlock(&s->lock);
+    }
+
+    if ((size_t)got <= in)
+    {
+      break;
+    }
+    if (n > (size_t)got - in)
+    {
+      n = (size_t)got - in;
+    }
+    memcpy(&out[done], &page[in], n);
+    done += n;
+    if (got < STORE_CACHE_PAGE)
+    {
+      break;
+    }
+  }
+  return (ssize_t)done;
+}
+
+void store_cache_get_stats(store_cache_t *c, store_cache_stats_t *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+  for (int i = 0; i < STORE_CACHE_SHARDS; i++)
+  {
+    cache_shard_t *s = &c->shards[i];
+
+    pthread_mutex_lock(&s->lock);
+    stats->hits += s->hits;
+    stats->misses += s->misses;
+    stats->uncached += s->uncached;
+    stats->evictions += s->evictions;
+    stats->pages += s->used;
+    stats->capacity += s->n_pages;
+    pthread_mutex_unlock(&s->lock);
+  }
+}
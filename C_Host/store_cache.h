@@ -0,0 +1,82 @@
+#ifndef STORE_CACHE_H
+#define STORE_CACHE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "host_store.h"
+
+/*
+ * Page cache of window store segments, bounded in size and shared by the
+ * threads that read them, so that readers going over the same recent
+ * segments read each page from disk once rather than once each.
+ *
+ * Pages are STORE_CACHE_PAGE bytes of a segment, keyed by its device,
+ * inode and file name: retention removes old segments and a new one may
+ * get their inode, but segment names are never used twice. Only
+ * whole pages are kept. Segments are only ever appended to, so a whole
+ * page does not change, except for the header at the start of the first,
+ * which readers do not take from the cache (store_segment_info() reads it
+ * itself). The end of a segment still being written is read from disk
+ * every time.
+ *
+ * The pages are split into shards, each with its own lock and clock hand:
+ * a reader holds a lock only to look a page up or copy it out, never while
+ * reading from disk.
+ */
+
+#define STORE_CACHE_PAGE (16u << 10)
+
+// Shards of the cache, each with 1 / STORE_CACHE_SHARDS of its pages
+#define STORE_CACHE_SHARDS 16
+
+typedef struct store_cache store_cache_t;
+
+typedef struct store_cache_stats
+{
+  uint64_t hits;                // pages copied from the cache
+  uint64_t misses;              // pages read from disk and kept
+  uint64_t uncached;            // reads of the end of a segment
+  uint64_t evictions;
+  uint32_t pages;               // pages in the cache
+  uint32_t capacity;
+} store_cache_stats_t;
+
+/**
+ * A segment read through the cache by one store_reader_t.
+ */
+typedef struct store_cache_file
+{
+  store_cache_t *cache;
+  int fd;
+  uint64_t dev;
+  uint64_t ino;
+  uint64_t name;                // hash of the file name
+  uint64_t hits;                // of this file
+  uint64_t misses;
+} store_cache_file_t;
+
+/**
+ * A cache of at most bytes (at least a page per shard). NULL if out of
+ * memory.
+ */
+store_cache_t *store_cache_create(size_t bytes);
+
+void store_cache_destroy(store_cache_t *c);
+
+/**
+ * Read the segment at path, open in r, through the cache: f must live as
+ * long as r. False if the segment cannot be identified (r then reads from
+ * disk).
+ */
+bool store_cache_attach(store_cache_t *c, store_reader_t *r, const char *path, store_cache_file_t *f);
+
+/**
+ * store_read_fn of an attached reader: ctx is its store_cache_file_t.
+ */
+ssize_t store_cache_read(void *ctx, void *buf, size_t len, uint64_t offset);
+
+void store_cache_get_stats(store_cache_t *c, store_cache_stats_t *stats);
+
+#endif // STORE_CACHE_H
@@ -0,0 +1,414 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <dirent.h>
+
+#include "store_query.h"
+#include "store_retention.h"
+
+#define PATH_LEN (STORE_PATH_MAX + STORE_PREFIX_MAX + 64)
+
+typedef struct query_segment
+{
+  char path[PATH_LEN];
+  uint32_t first_time;
+} query_segment_t;
+
+// Summaries being merged, open addressing on (level, cow, start)
+typedef struct summary_table
+{
+  store_summary_t *entries;
+  uint32_t count;
+  uint32_t *index;            // entry + 1, 0 if free
+  uint32_t size;              // power of two
+} summary_table_t;
+
+typedef struct query_state
+{
+  const store_query_t *q;
+  uint32_t minute_cutoff;
+  char **skip;                // raw segments of a committed round
+  uint32_t skip_count;
+  query_segment_t *segments;
+  uint32_t segment_count;
+  uint32_t segment_cap;
+  summary_table_t summaries;
+  store_query_stats_t stats;
+} query_state_t;
+
+static uint32_t minute_cutoff(const char *dir)
+{
+  char path[PATH_LEN];
+  unsigned long cutoff = 0;
+  FILE *f;
+
+  snprintf(path, sizeof(path), "%s/%s", dir, RETENTION_STATE);
+  f = fopen(path, "r");
+  if (f != NULL)
+  {
+    if (fscanf(f, "minute_cutoff %lu", &cutoff) != 1)
+    {
+      cutoff = 0;
+    }
+    fclose(f);
+  }
+  return (uint32_t)cutoff;
+}
+
+// The raw segments a committed round replaces, false if there is none
+static bool load_manifest(const char *dir, query_state_t *s)
+{
+  char path[PATH_LEN];
+  char line[STORE_PREFIX_MAX + 32];
+  FILE *f;
+
+  snprintf(path, sizeof(path), "%s/%s/%s", dir, RETENTION_COMPACT_DIR, RETENTION_MANIFEST);
+  f = fopen(path, "r");
+  if (f == NULL)
+  {
+    return false;
+  }
+  while (fgets(line, sizeof(line), f) != NULL)
+  {
+    char **skip = realloc(s->skip, (s->skip_count + 1) * sizeof(char *));
+
+    if (skip == NULL)
+    {
+      break;
+    }
+    s->skip = skip;
+    line[strcspn(line, "\n")] = '\0';
+    s->skip[s->skip_count] = strdup(line);
+    if (s->skip[s->skip_count] != NULL)
+    {
+      s->skip_count++;
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+static bool skipped(const query_state_t *s, const char *name)
+{
+  for (uint32_t i = 0; i < s->skip_count; i++)
+  {
+    if (strcmp(s->skip[i], name) == 0)
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Whether a segment can hold records in the range
+static bool segment_overlaps(const query_state_t *s, const store_segment_t *seg)
+{
+  uint32_t last = seg->last_time;
+
+  if (seg->committed != seg->size)
+  {
+    // records past the commit: their times are not in the header
+    last = UINT32_MAX;
+  }
+  else if (seg->level == STORE_MINUTE)
+  {
+    if (last < s->minute_cutoff)
+    {
+      return false;
+    }
+    last += 60;
+  }
+  else if (seg->level == STORE_HOUR)
+  {
+    if (seg->first_time >= s->minute_cutoff)
+    {
+      return false;
+    }
+    last += 3600;
+  }
+  return (seg->first_time < s->q->to) && (last > s->q->from);
+}
+
+static bool list_dir(const char *dir, bool raw, query_state_t *s)
+{
+  store_segment_t seg;
+  struct dirent *entry;
+  DIR *d = opendir(dir);
+
+  if (d == NULL)
+  {
+    return false;
+  }
+  while ((entry = readdir(d)) != NULL)
+  {
+    size_t len = strlen(entry->d_name);
+    query_segment_t *qs;
+
+    if ((len < 4) || (strcmp(&entry->d_name[len - 4], ".seg") != 0) || (len >= STORE_PREFIX_MAX + 32))
+    {
+      continue;
+    }
+    if (s->segment_count == s->segment_cap)
+    {
+      uint32_t cap = (s->segment_cap == 0) ? 64 : s->segment_cap * 2;
+      query_segment_t *list = realloc(s->segments, cap * sizeof(query_segment_t));
+
+      if (list == NULL)
+      {
+        closedir(d);
+        return false;
+      }
+      s->segments = list;
+      s->segment_cap = cap;
+    }
+    qs = &s->segments[s->segment_count];
+    snprintf(qs->path, sizeof(qs->path), "%s/%s", dir, entry->d_name);
+    if (!store_segment_info(qs->path, &seg) || ((seg.level == STORE_RAW) && (!raw || skipped(s, entry->d_name))))
+    {
+      continue;
+    }
+    if (!segment_overlaps(s, &seg))
+    {
+      s->stats.pruned++;
+      continue;
+    }
+    qs->first_time = seg.first_time;
+    s->segment_count++;
+  }
+  closedir(d);
+  return true;
+}
+
+static int by_first_time(const void *a, const void *b)
+{
+  const query_segment_t *x = a;
+  const query_segment_t *y = b;
+
+  return (x->first_time > y->first_time) - (x->first_time < y->first_time);
+}
+
+static uint32_t summary_hash(const store_summary_t *sum)
+{
+  uint32_t h = sum->start * 2654435761u;
+
+  h ^= ((uint32_t)sum->cow_id << 8 | sum->level) * 2246822519u;
+  return h ^ (h >> 15);
+}
+
+static bool table_grow(summary_table_t *t)
+{
+  uint32_t size = (t->size == 0) ? 1024 : t->size * 2;
+  uint32_t *index = calloc(size, sizeof(uint32_t));
+  store_summary_t *entries = realloc(t->entries, (size / 2) * sizeof(store_summary_t));
+
+  if ((index == NULL) || (entries == NULL))
+  {
+    free(index);
+    if (entries != NULL)
+    {
+      t->entries = entries;
+    }
+    return false;
+  }
+  for (uint32_t i = 0; i < t->count; i++)
+  {
+    uint32_t idx = summary_hash(&entries[i]) & (size - 1);
+
+    while (index[idx] != 0)
+    {
+      idx = (idx + 1) & (size - 1);
+    }
+    index[idx] = i + 1;
+  }
+  free(t->index);
+  t->index = index;
+  t->entries = entries;
+  t->size = size;
+  return true;
+}
+
+static bool table_add(summary_table_t *t, const store_summary_t *sum)
+{
+  uint32_t idx;
+
+  if ((t->count + 1 > t->size / 2) && !table_grow(t))
+  {
+    return false;
+  }
+  idx = summary_hash(sum) & (t->size - 1);
+  while (t->index[idx] != 0)
+  {
+    store_summary_t *e = &t->entries[t->index[idx] - 1];
+
+    if ((e->start == sum->start) && (e->cow_id == sum->cow_id) && (e->level == sum->level))
+    {
+      store_summary_merge(e, sum);
+      return true;
+    }
+    idx = (idx + 1) & (t->size - 1);
+  }
+  t->entries[t->count] = *sum;
+  t->index[idx] = ++t->count;
+  return true;
+}
+
+static int by_start(const void *a, const void *b)
+{
+  const store_summary_t *x = a;
+  const store_summary_t *y = b;
+
+  if (x->start != y->start)
+  {
+    return (x->start > y->start) - (x->start < y->start);
+  }
+  if (x->cow_id != y->cow_id)
+  {
+    return (x->cow_id > y->cow_id) - (x->cow_id < y->cow_id);
+  }
+  return (x->level > y->level) - (x->level < y->level);
+}
+
+static bool stopped(const store_query_t *q)
+{
+  return (q->stop != NULL) && *q->stop;
+}
+
+static bool read_segment(query_state_t *s, const char *path, store_window_fn on_window, void *ctx)
+{
+  const store_query_t *q = s->q;
+  store_cache_file_t file;
+  store_reader_t r;
+  store_record_t rec;
+  int status = 0;
+
+  if (!store_reader_open(&r, path))
+  {
+    return false;
+  }
+  if (q->cache != NULL)
+  {
+    store_cache_attach(q->cache, &r, path, &file);
+  }
+  s->stats.segments++;
+  while (!stopped(q) && ((status = store_reader_next(&r, &rec)) > 0))
+  {
+    if (rec.kind != STORE_KIND_SUMMARY)
+    {
+      const store_window_t *win = &rec.window;
+
+      if ((win->time >= q->from) && (win->time < q->to) && (q->all_cows || (win->cow_id == q->cow_id)))
+      {
+        s->stats.windows++;
+        if (on_window != NULL)
+        {
+          on_window(win, ctx);
+        }
+      }
+    }
+    else
+    {
+      const store_summary_t *sum = &rec.summary;
+      uint32_t len = (sum->level == STORE_MINUTE) ? 60 : 3600;
+      bool level_ok = (sum->level == STORE_MINUTE) ? (sum->start >= s->minute_cutoff)
+                                                  : (sum->start < s->minute_cutoff);
+
+      if (level_ok && (sum->start < q->to) && (sum->start + len > q->from)
+          && (q->all_cows || (sum->cow_id == q->cow_id)) && !table_add(&s->summaries, sum))
+      {
+        status = -1;
+        break;
+      }
+    }
+  }
+  if (r.read != NULL)
+  {
+    s->stats.cache_hits += file.hits;
+    s->stats.cache_misses += file.misses;
+  }
+  store_reader_close(&r);
+  return (status == 0) || stopped(q);
+}
+
+bool store_query(const char *dir, const store_query_t *q, store_window_fn on_window,
+                 store_summary_fn on_summary, void *ctx, store_query_stats_t *stats)
+{
+  char compact[PATH_LEN];
+  query_state_t s;
+  bool ok;
+
+  memset(&s, 0, sizeof(s));
+  s.q = q;
+  s.minute_cutoff = minute_cutoff(dir);
+
+  // a committed round: its summaries in place of its raw segments. They
+  // are listed first, as retention moves them into dir when done
+  ok = true;
+  if (load_manifest(dir, &s))
+  {
+    snprintf(compact, sizeof(compact), "%s/%s", dir, RETENTION_COMPACT_DIR);
+    ok = list_dir(compact, false, &s);
+  }
+  ok = ok && list_dir(dir, true, &s);
+
+  qsort(s.segments, s.segment_count, sizeof(query_segment_t), by_first_time);
+  for (uint32_t i = 0; ok && !stopped(q) && (i < s.segment_count); i++)
+  {
+    // gone since it was listed: moved into dir (listed there too) or
+    // removed by retention
+    ok = read_segment(&s, s.segments[i].path, on_window, ctx) || (access(s.segments[i].path, F_OK) != 0);
+  }
+
+  if (ok)
+  {
+    qsort(s.summaries.entries, s.summaries.count, sizeof(store_summary_t), by_start);
+    for (uint32_t i = 0; (i < s.summaries.count) && !stopped(q); i++)
+    {
+      if (on_summary != NULL)
+      {
+        on_summary(&s.summaries.entries[i], ctx);
+      }
+    }
+    s.stats.summaries = s.summaries.count;
+  }
+
+  if (stats != NULL)
+  {
+    *stats = s.stats;
+  }
+  for (uint32_t i = 0; i < s.skip_count; i++)
+  {
+    free(s.skip[i]);
+  }
+  free(s.skip);
+  free(s.segments);
+  free(s.summaries.entries);
+  free(s.summaries.index);
+  return ok;
+}
+
+bool store_query_parse_time(const char *s, uint32_t *t)
+{
+  struct tm tm;
+  char *end;
+  unsigned long v = strtoul(s, &end, 10);
+  int n;
+
+  if ((end != s) && (*end == '\0'))
+  {
+    *t = (uint32_t)v;
+    return true;
+  }
+  memset(&tm, 0, sizeof(tm));
+  n = sscanf(s, "%d-%d-%dT%d:%d:%d", &tm.tm_year, &tm.tm_mon, &tm.tm_mday, &tm.tm_hour, &tm.tm_min, &tm.tm_sec);
+  if ((n != 3) && (n != 6))
+  {
+    return false;
+  }
+  tm.tm_year -= 1900;
+  tm.tm_mon -= 1;
+  tm.tm_isdst = -1;
+  *t = (uint32_t)mktime(&tm);
+  return true;
+}
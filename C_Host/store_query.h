@@ -0,0 +1,52 @@
+#ifndef STORE_QUERY_H
+#define STORE_QUERY_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "host_store.h"
+#include "store_cache.h"
+
+typedef struct store_query
+{
+  uint32_t from;              // times from, s since the epoch
+  uint32_t to;                // up to, not included
+  bool all_cows;
+  uint16_t cow_id;            // unless all_cows
+  store_cache_t *cache;       // read segments through it, NULL: from disk
+  const bool *stop;           // once a callback sets it, the query ends; may be NULL
+} store_query_t;
+
+typedef struct store_query_stats
+{
+  uint32_t segments;          // segments read
+  uint32_t pruned;            // segments skipped by their time range
+  uint64_t windows;           // windows returned
+  uint64_t summaries;         // summaries returned, after merging
+  uint64_t cache_hits;        // pages read from the cache, with one
+  uint64_t cache_misses;      // pages read into it
+} store_query_stats_t;
+
+typedef void (*store_window_fn)(const store_window_t *win, void *ctx);
+typedef void (*store_summary_fn)(const store_summary_t *sum, void *ctx);
+
+/**
+ * Query the store in dir over a time range. The windows still held raw
+ * are passed to on_window, segment by segment in the order of their first
+ * time; where retention (store_retention.h) has replaced them, the
+ * summaries are passed to on_summary afterwards, in time order: minute
+ * summaries where they are kept, hour summaries before that. The parts of
+ * a period are merged into one summary. A summary is returned if its
+ * period overlaps the range. stats may be NULL. Any number of threads may
+ * query at once, sharing a cache.
+ */
+bool store_query(const char *dir, const store_query_t *q, store_window_fn on_window,
+                 store_summary_fn on_summary, void *ctx, store_query_stats_t *stats);
+
+/**
+ * Parse a time for a query: seconds since the epoch, or local time as
+ * YYYY-MM-DD or YYYY-MM-DDTHH:MM:SS.
+ */
+bool store_query_parse_time(const char *s, uint32_t *t);
+
+#endif // STORE_QUERY_H
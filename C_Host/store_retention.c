@@ -0,0 +1,946 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <time.h>
+#include <sys/stat.h>
+
+#include "store_retention.h"
+#include "cs_features.h"
+#include "cs_classifier.h"
+#include "app_log.h"
+
+// Raw segments in one round at most
+#define ROUND_SEGMENTS 1024
+
+#define NAME_MAX_LEN (STORE_PREFIX_MAX + 16)
+// the compact directory and any directory entry in it
+#define PATH_LEN (STORE_PATH_MAX + 16 + 256 + 2)
+
+#define PHASE_IDLE    0
+#define PHASE_COMPACT 1   // summarizing the round's raw segments
+#define PHASE_REMOVE  2   // committed: removing them, moving the summaries in
+
+typedef struct round_segment
+{
+  char name[NAME_MAX_LEN];
+  uint32_t first_time;
+  uint32_t last_time;
+  uint64_t size;
+} round_segment_t;
+
+// Summaries being built for one cow
+typedef struct cow_acc
+{
+  bool in_use;
+  bool seq_valid;
+  uint16_t cow_id;
+  uint16_t seq;               // of its last window
+  store_summary_t minute;
+  store_summary_t hour;
+} cow_acc_t;
+
+retention_stats_t retention_stats;
+
+static retention_config_t config;
+static char store_dir[STORE_PATH_MAX];
+static char compact_dir[STORE_PATH_MAX + 16];
+static store_writer_t *live_writer = NULL;
+static int64_t live_segment = -1;   // live segment seen open since live_since_ms
+static uint64_t live_since_ms = 0;
+static uint32_t minute_cutoff = 0;  // minute summaries before this are dropped
+static bool over_budget_warned = false;
+
+static uint8_t phase = PHASE_IDLE;
+static uint64_t next_step_ms = 0;
+static uint64_t next_scan_ms = 0;
+
+// The round
+static round_segment_t *round_list = NULL;
+static uint32_t round_count = 0;
+static uint32_t round_next = 0;     // segment being read or removed
+static uint32_t round_id = 0;
+static store_reader_t reader;
+static bool reader_open = false;
+static store_writer_t minute_writer;
+static store_writer_t hour_writer;
+static cow_acc_t *cows = NULL;
+static uint32_t cow_count = 0;
+
+// Copy of a segment to an archive on another file system
+static int copy_in = -1;
+static int copy_out = -1;
+static uint64_t copy_offset = 0;
+
+static void sync_dir(const char *dir)
+{
+  int fd = open(dir, O_RDONLY | O_DIRECTORY);
+
+  if (fd >= 0)
+  {
+    fsync(fd);
+    close(fd);
+  }
+}
+
+static bool is_segment(const char *name)
+{
+  size_t len = strlen(name);
+
+  return (len > 4) && (len < NAME_MAX_LEN) && (strcmp(&name[len - 4], ".seg") == 0);
+}
+
+// Write a small file in place of path, all or nothing
+static bool write_atomic(const char *dir, const char *name, const char *text)
+{
+  char path[PATH_LEN];
+  char tmp[PATH_LEN + 4];
+  size_t len = strlen(text);
+  bool ok;
+  int fd;
+
+  snprintf(path, sizeof(path), "%s/%s", dir, name);
+  snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+  fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+  if (fd < 0)
+  {
+    return false;
+  }
+  ok = (write(fd, text, len) == (ssize_t)len) && (fdatasync(fd) == 0);
+  ok = (close(fd) == 0) && ok;
+  ok = ok && (rename(tmp, path) == 0);
+  sync_dir(dir);
+  return ok;
+}
+
+/*
+ * Minute summaries
+ */
+
+static void load_state(void)
+{
+  char path[PATH_LEN];
+  unsigned long cutoff;
+  FILE *f;
+
+  snprintf(path, sizeof(path), "%s/%s", store_dir, RETENTION_STATE);
+  f = fopen(path, "r");
+  if (f == NULL)
+  {
+    return;
+  }
+  if (fscanf(f, "minute_cutoff %lu", &cutoff) == 1)
+  {
+    minute_cutoff = (uint32_t)cutoff;
+  }
+  fclose(f);
+}
+
+static bool save_state(uint32_t cutoff)
+{
+  char text[64];
+
+  snprintf(text, sizeof(text), "minute_cutoff %lu\n", (unsigned long)cutoff);
+  if (!write_atomic(store_dir, RETENTION_STATE, text))
+  {
+    return false;
+  }
+  minute_cutoff = cutoff;
+  return true;
+}
+
+/*
+ * Summarizing
+ */
+
+// value, for each of n windows
+static void stat_add(store_stat_t *stat, int32_t value, uint16_t n, bool first)
+{
+  if (first || value < stat->min)
+  {
+    stat->min = (int16_t)value;
+  }
+  if (first || value > stat->max)
+  {
+    stat->max = (int16_t)value;
+  }
+  stat->sum += value * n;
+}
+
+// What a stored record says of the windows it stands for
+typedef struct window_facts
+{
+  uint16_t windows;
+  uint16_t lying;             // of them
+  bool active;                // odba is known
+  int32_t odba;
+} window_facts_t;
+
+static void window_facts(const store_window_t *win, window_facts_t *f)
+{
+  memset(f, 0, sizeof(*f));
+  switch (win->kind)
+  {
+    case CS_KIND_SUMMARY:
+      f->windows = (win->summary.windows > 0) ? win->summary.windows : 1;
+      f->lying = (win->summary.posture == CS_POSTURE_LYING) ? f->windows : 0;
+      f->active = true;
+      f->odba = (win->summary.odba > INT16_MAX) ? INT16_MAX : win->summary.odba;
+      break;
+
+    case CS_KIND_CLASS:
+      f->windows = win->n_labels;
+      for (uint8_t i = 0; i < win->n_labels; i++)
+      {
+        f->lying += (win->labels[i].class == CS_CLASS_LYING);
+      }
+      break;
+
+    default:
+    {
+      cs_features_acc_t acc;
+      cs_summary_t features;
+
+      cs_features_reset(&acc);
+      cs_features_add_window(&acc, (const int16_t (*)[3])win->samples, win->n_samples);
+      cs_features_finish(&acc, &features);
+      f->windows = 1;
+      f->lying = (features.posture == CS_POSTURE_LYING);
+      f->active = true;
+      f->odba = (features.odba > INT16_MAX) ? INT16_MAX : features.odba;
+      break;
+    }
+  }
+}
+
+static void summary_add(store_summary_t *sum, const store_window_t *win, const window_facts_t *f,
+                        uint16_t missed)
+{
+  bool first = (sum->windows == 0);
+
+  if (f->active)
+  {
+    stat_add(&sum->activity, f->odba, f->windows, sum->active == 0);
+    sum->activity_sq += (uint64_t)((int64_t)f->odba * f->odba) * f->windows;
+    sum->active += f->windows;
+  }
+  stat_add(&sum->temp, win->temp, f->windows, first);
+  stat_add(&sum->battery, win->battery, f->windows, first);
+  stat_add(&sum->rssi, win->rssi, f->windows, first);
+  sum->windows += f->windows;
+  sum->missed += missed;
+  sum->lying += f->lying;
+}
+
+static bool flush_summary(store_writer_t *w, store_summary_t *sum)
+{
+  bool ok = true;
+
+  if (sum->windows > 0)
+  {
+    ok = store_append_summary(w, sum);
+    if (sum->level == STORE_MINUTE)
+    {
+      retention_stats.minutes++;
+    }
+    else
+    {
+      retention_stats.hours++;
+    }
+    sum->windows = 0;
+  }
+  return ok;
+}
+
+// Write out the summaries open for every cow
+static bool flush_cows(void)
+{
+  bool ok = true;
+
+  for (uint32_t i = 0; i < RETENTION_MAX_COWS; i++)
+  {
+    if (cows[i].in_use)
+    {
+      ok = flush_summary(&minute_writer, &cows[i].minute) && ok;
+      ok = flush_summary(&hour_writer, &cows[i].hour) && ok;
+    }
+  }
+  memset(cows, 0, RETENTION_MAX_COWS * sizeof(cow_acc_t));
+  cow_count = 0;
+  return ok;
+}
+
+// Open addressing, linear probing, as in collar_table.c
+static cow_acc_t *cow_get(uint16_t cow_id)
+{
+  uint32_t idx;
+
+  if (cow_count >= RETENTION_MAX_COWS / 2)
+  {
+    // summaries split early are merged again by the queries
+    flush_cows();
+  }
+  idx = (((uint32_t)cow_id * 2654435761u) >> 16) & (RETENTION_MAX_COWS - 1);
+  while (cows[idx].in_use && cows[idx].cow_id != cow_id)
+  {
+    idx = (idx + 1) & (RETENTION_MAX_COWS - 1);
+  }
+  if (!cows[idx].in_use)
+  {
+    cows[idx].in_use = true;
+    cows[idx].cow_id = cow_id;
+    cow_count++;
+  }
+  return &cows[idx];
+}
+
+static bool summarize(const store_window_t *win)
+{
+  cow_acc_t *cow = cow_get(win->cow_id);
+  uint32_t minute = win->time - win->time % 60;
+  uint32_t hour = win->time - win->time % 3600;
+  window_facts_t f;
+  uint16_t missed = 0;
+  bool ok = true;
+
+  window_facts(win, &f);
+  if (f.windows == 0)
+  {
+    return true;
+  }
+  if (win->flags & STORE_WINDOW_SEQ)
+  {
+    uint16_t step = (uint16_t)(win->seq - cow->seq);
+
+    // a record missed stood for as many windows as this one
+    if (cow->seq_valid && step > 1 && step <= RETENTION_MAX_MISSED)
+    {
+      uint32_t n = (uint32_t)(step - 1) * f.windows;
+
+      missed = (n > UINT16_MAX) ? UINT16_MAX : (uint16_t)n;
+    }
+    cow->seq = win->seq;
+    cow->seq_valid = true;
+  }
+
+  if (cow->minute.windows > 0 && cow->minute.start != minute)
+  {
+    ok = flush_summary(&minute_writer, &cow->minute);
+  }
+  if (cow->minute.windows == 0)
+  {
+    store_summary_init(&cow->minute, win->cow_id, STORE_MINUTE, minute);
+  }
+  if (cow->hour.windows > 0 && cow->hour.start != hour)
+  {
+    ok = flush_summary(&hour_writer, &cow->hour) && ok;
+  }
+  if (cow->hour.windows == 0)
+  {
+    store_summary_init(&cow->hour, win->cow_id, STORE_HOUR, hour);
+  }
+
+  summary_add(&cow->minute, win, &f, missed);
+  summary_add(&cow->hour, win, &f, missed);
+  retention_stats.windows++;
+  return ok;
+}
+
+/*
+ * Rounds
+ */
+
+static int by_first_time(const void *a, const void *b)
+{
+  const round_segment_t *x = a;
+  const round_segment_t *y = b;
+
+  return (x->first_time > y->first_time) - (x->first_time < y->first_time);
+}
+
+// Remove the files a round cut short left in the compact directory
+static void clear_compact_dir(void)
+{
+  char path[PATH_LEN];
+  struct dirent *entry;
+  DIR *d = opendir(compact_dir);
+
+  if (d == NULL)
+  {
+    return;
+  }
+  while ((entry = readdir(d)) != NULL)
+  {
+    if (entry->d_name[0] != '.')
+    {
+      snprintf(path, sizeof(path), "%s/%s", compact_dir, entry->d_name);
+      unlink(path);
+    }
+  }
+  closedir(d);
+}
+
+static bool open_segment(void)
+{
+  char path[PATH_LEN];
+
+  snprintf(path, sizeof(path), "%s/%s", store_dir, round_list[round_next].name);
+  reader_open = store_reader_open(&reader, path);
+  if (!reader_open)
+  {
+    app_log_warning("Retention: cannot read %s" APP_LOG_NL, path);
+  }
+  return reader_open;
+}
+
+static bool start_round(void)
+{
+  char prefix[STORE_PREFIX_MAX];
+  long long now = (long long)time(NULL);
+
+  if (((mkdir(compact_dir, 0755) != 0) && (errno != EEXIST)))
+  {
+    return false;
+  }
+  clear_compact_dir();
+
+  round_id++;
+  snprintf(prefix, sizeof(prefix), "minute-%lld-%u", now, round_id);
+  if (!store_open(&minute_writer, compact_dir, prefix, STORE_MINUTE))
+  {
+    return false;
+  }
+  snprintf(prefix, sizeof(prefix), "hour-%lld-%u", now, round_id);
+  if (!store_open(&hour_writer, compact_dir, prefix, STORE_HOUR))
+  {
+    store_close(&minute_writer);
+    return false;
+  }
+  memset(cows, 0, RETENTION_MAX_COWS * sizeof(cow_acc_t));
+  cow_count = 0;
+  round_next = 0;
+  phase = PHASE_COMPACT;
+  return open_segment();
+}
+
+// The summaries are written: commit the round
+static bool commit_round(void)
+{
+  char *text;
+  size_t len = 0;
+  bool ok;
+
+  ok = flush_cows();
+  ok = store_close(&minute_writer) && ok;
+  ok = store_close(&hour_writer) && ok;
+  if (!ok)
+  {
+    return false;
+  }
+
+  text = malloc((size_t)round_count * NAME_MAX_LEN + 1);
+  if (text == NULL)
+  {
+    return false;
+  }
+  text[0] = '\0';
+  for (uint32_t i = 0; i < round_count; i++)
+  {
+    len += (size_t)sprintf(&text[len], "%s\n", round_list[i].name);
+  }
+  ok = write_atomic(compact_dir, RETENTION_MANIFEST, text);
+  free(text);
+  if (!ok)
+  {
+    return false;
+  }
+
+  retention_stats.rounds++;
+  retention_stats.segments += round_count;
+  round_next = 0;
+  phase = PHASE_REMOVE;
+  return true;
+}
+
+static uint64_t now_us(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000ULL + (uint64_t)ts.tv_nsec / 1000ULL;
+}
+
+static bool compact_step(void)
+{
+  store_record_t rec;
+  uint64_t end = now_us() + RETENTION_STEP_US;
+
+  if (!reader_open && !open_segment())
+  {
+    return false;
+  }
+  for (uint32_t n = 1; ((n & 63) != 0) || (now_us() < end); n++)
+  {
+    int status = store_reader_next(&reader, &rec);
+
+    if (status < 0)
+    {
+      return false;
+    }
+    if (status == 0)
+    {
+      // read once: keep it out of the page cache
+      posix_fadvise(reader.fd, 0, 0, POSIX_FADV_DONTNEED);
+      store_reader_close(&reader);
+      reader_open = false;
+      if (++round_next == round_count)
+      {
+        return commit_round();
+      }
+      return true;
+    }
+    if ((rec.kind != STORE_KIND_SUMMARY) && !summarize(&rec.window))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+static bool load_manifest(void)
+{
+  char path[PATH_LEN];
+  char line[NAME_MAX_LEN + 2];
+  FILE *f;
+
+  snprintf(path, sizeof(path), "%s/%s", compact_dir, RETENTION_MANIFEST);
+  f = fopen(path, "r");
+  if (f == NULL)
+  {
+    return false;
+  }
+  round_count = 0;
+  while ((round_count < ROUND_SEGMENTS) && (fgets(line, sizeof(line), f) != NULL))
+  {
+    line[strcspn(line, "\n")] = '\0';
+    if (is_segment(line))
+    {
+      memset(&round_list[round_count], 0, sizeof(round_list[0]));
+      strcpy(round_list[round_count].name, line);
+      round_count++;
+    }
+  }
+  fclose(f);
+  return true;
+}
+
+// Copy part of the segment to the archive; true with *done when complete
+static bool archive_copy(const char *from, const char *to, bool *done)
+{
+  static uint8_t buf[RETENTION_STEP_BYTES];
+  char part[PATH_LEN + 8];
+  ssize_t n;
+
+  snprintf(part, sizeof(part), "%s.part", to);
+  if (copy_in < 0)
+  {
+    copy_in = open(from, O_RDONLY);
+    copy_out = open(part, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    copy_offset = 0;
+    if ((copy_in < 0) || (copy_out < 0))
+    {
+      return false;
+    }
+  }
+
+  n = pread(copy_in, buf, sizeof(buf), (off_t)copy_offset);
+  if ((n < 0) || (pwrite(copy_out, buf, (size_t)n, (off_t)copy_offset) != n))
+  {
+    return false;
+  }
+  copy_offset += (uint64_t)n;
+  retention_stats.archived_bytes += (uint64_t)n;
+  *done = (n == 0);
+  if (!*done)
+  {
+    return true;
+  }
+
+  close(copy_in);
+  copy_in = -1;
+  if ((fdatasync(copy_out) != 0) || (close(copy_out) != 0))
+  {
+    copy_out = -1;
+    return false;
+  }
+  copy_out = -1;
+  return rename(part, to) == 0;
+}
+
+// Remove one raw segment of the round, or part of it for a copy
+static bool remove_segment(const char *name, bool *done)
+{
+  char from[PATH_LEN];
+  char to[PATH_LEN];
+  struct stat st;
+
+  snprintf(from, sizeof(from), "%s/%s", store_dir, name);
+  *done = true;
+  if (stat(from, &st) != 0)
+  {
+    // removed before a restart
+    return errno == ENOENT;
+  }
+  if (config.archive_dir == NULL)
+  {
+    retention_stats.deleted_bytes += (uint64_t)st.st_size;
+    return unlink(from) == 0;
+  }
+
+  snprintf(to, sizeof(to), "%s/%s", config.archive_dir, name);
+  if ((copy_in < 0) && (rename(from, to) == 0))
+  {
+    retention_stats.archived_bytes += (uint64_t)st.st_size;
+    sync_dir(config.archive_dir);
+    return true;
+  }
+  if ((copy_in < 0) && (errno != EXDEV))
+  {
+    return false;
+  }
+  // another file system: copy a piece per step
+  if (!archive_copy(from, to, done))
+  {
+    return false;
+  }
+  if (*done)
+  {
+    sync_dir(config.archive_dir);
+    return unlink(from) == 0;
+  }
+  return true;
+}
+
+// Move the round's summaries into the store and forget the round
+static bool finish_round(void)
+{
+  char from[PATH_LEN];
+  char to[PATH_LEN];
+  char manifest[PATH_LEN];
+  struct dirent *entry;
+  bool ok = true;
+  DIR *d = opendir(compact_dir);
+
+  if (d == NULL)
+  {
+    return false;
+  }
+  while ((entry = readdir(d)) != NULL)
+  {
+    if (is_segment(entry->d_name))
+    {
+      snprintf(from, sizeof(from), "%s/%s", compact_dir, entry->d_name);
+      snprintf(to, sizeof(to), "%s/%s", store_dir, entry->d_name);
+      ok = (rename(from, to) == 0) && ok;
+    }
+  }
+  closedir(d);
+  sync_dir(store_dir);
+  if (!ok)
+  {
+    return false;
+  }
+
+  snprintf(manifest, sizeof(manifest), "%s/%s", compact_dir, RETENTION_MANIFEST);
+  if (unlink(manifest) != 0)
+  {
+    return false;
+  }
+  sync_dir(compact_dir);
+  app_log_info("Retention: %u raw segments summarized and %s" APP_LOG_NL, round_count,
+               (config.archive_dir != NULL) ? "archived" : "deleted");
+  phase = PHASE_IDLE;
+  return true;
+}
+
+static bool remove_step(void)
+{
+  bool done;
+
+  if (round_next == round_count)
+  {
+    return finish_round();
+  }
+  if (!remove_segment(round_list[round_next].name, &done))
+  {
+    app_log_warning("Retention: cannot remove %s/%s" APP_LOG_NL, store_dir, round_list[round_next].name);
+    return false;
+  }
+  if (done)
+  {
+    round_next++;
+  }
+  return true;
+}
+
+/*
+ * Looking for work
+ */
+
+// Drop the minute segments before cutoff
+static bool expire_minutes(uint32_t cutoff)
+{
+  char path[PATH_LEN];
+  store_segment_t seg;
+  struct dirent *entry;
+  bool ok = true;
+  DIR *d;
+
+  // queries go by the cutoff: record it before the segments go
+  if (!save_state(cutoff))
+  {
+    return false;
+  }
+  d = opendir(store_dir);
+  if (d == NULL)
+  {
+    return false;
+  }
+  while ((entry = readdir(d)) != NULL)
+  {
+    if (!is_segment(entry->d_name))
+    {
+      continue;
+    }
+    snprintf(path, sizeof(path), "%s/%s", store_dir, entry->d_name);
+    if (store_segment_info(path, &seg) && (seg.level == STORE_MINUTE) && (seg.last_time < cutoff))
+    {
+      retention_stats.deleted_bytes += seg.size;
+      ok = (unlink(path) == 0) && ok;
+    }
+  }
+  closedir(d);
+  return ok;
+}
+
+static bool scan(void)
+{
+  char live_path[PATH_LEN];
+  char path[PATH_LEN];
+  store_segment_t seg;
+  struct dirent *entry;
+  struct stat st;
+  uint32_t now = (uint32_t)time(NULL);
+  uint32_t candidates = 0;
+  uint32_t oldest_minute = UINT32_MAX;
+  uint64_t total = 0;
+  uint64_t round_bytes = 0;
+  uint32_t cutoff;
+  bool over;
+  DIR *d;
+
+  live_path[0] = '\0';
+  if (live_writer != NULL)
+  {
+    store_segment_path(live_writer, live_path, sizeof(live_path));
+  }
+
+  d = opendir(store_dir);
+  if (d == NULL)
+  {
+    return false;
+  }
+  while ((entry = readdir(d)) != NULL)
+  {
+    if (!is_segment(entry->d_name))
+    {
+      continue;
+    }
+    snprintf(path, sizeof(path), "%s/%s", store_dir, entry->d_name);
+    if ((stat(path, &st) != 0) || !store_segment_info(path, &seg))
+    {
+      continue;
+    }
+    total += seg.size;
+    if (seg.level == STORE_MINUTE && seg.last_time < oldest_minute)
+    {
+      oldest_minute = seg.last_time;
+    }
+    // sealed raw segments no one writes to any more
+    if ((seg.level != STORE_RAW) || (seg.committed != seg.size) || (strcmp(path, live_path) == 0)
+        || (st.st_mtime + RETENTION_QUIET_S > (time_t)now) || (candidates == ROUND_SEGMENTS))
+    {
+      continue;
+    }
+    strcpy(round_list[candidates].name, entry->d_name);
+    round_list[candidates].first_time = seg.first_time;
+    round_list[candidates].last_time = seg.last_time;
+    round_list[candidates].size = seg.size;
+    candidates++;
+  }
+  closedir(d);
+  retention_stats.store_bytes = total;
+  over = (config.max_bytes != 0) && (total > config.max_bytes);
+
+  // the oldest raw segments past the raw age, or regardless of it while
+  // the store is over its size
+  qsort(round_list, candidates, sizeof(round_list[0]), by_first_time);
+  round_count = 0;
+  while ((round_count < candidates) && (round_bytes < RETENTION_ROUND_BYTES)
+         && (over || (round_list[round_count].last_time + config.raw_age_s < now)))
+  {
+    round_bytes += round_list[round_count].size;
+    round_count++;
+  }
+  if (round_count > 0)
+  {
+    over_budget_warned = false;
+    return start_round();
+  }
+
+  // minute summaries past their age, or the oldest hour of them while
+  // over size
+  cutoff = (now > config.minute_age_s) ? now - config.minute_age_s : 0;
+  cutoff -= cutoff % 3600;
+  if (over && (oldest_minute != UINT32_MAX) && (oldest_minute - oldest_minute % 3600 + 3600 > cutoff))
+  {
+    cutoff = oldest_minute - oldest_minute % 3600 + 3600;
+  }
+  if ((cutoff > minute_cutoff) && ((oldest_minute < cutoff) || (minute_cutoff == 0)))
+  {
+    return expire_minutes(cutoff);
+  }
+
+  if (over && !over_budget_warned)
+  {
+    app_log_warning("Retention: window store %s holds %llu MB, over its %llu MB, with nothing left to reduce"
+                    APP_LOG_NL, store_dir, (unsigned long long)(total >> 20),
+                    (unsigned long long)(config.max_bytes >> 20));
+    over_budget_warned = true;
+  }
+  return true;
+}
+
+bool retention_init(const char *dir, const retention_config_t *cfg, store_writer_t *live)
+{
+  if (strlen(dir) >= sizeof(store_dir))
+  {
+    return false;
+  }
+  strcpy(store_dir, dir);
+  snprintf(compact_dir, sizeof(compact_dir), "%s/%s", dir, RETENTION_COMPACT_DIR);
+  config = *cfg;
+  live_writer = live;
+  memset(&retention_stats, 0, sizeof(retention_stats));
+
+  if (((mkdir(dir, 0755) != 0) && (errno != EEXIST))
+      || ((config.archive_dir != NULL) && (mkdir(config.archive_dir, 0755) != 0) && (errno != EEXIST)))
+  {
+    return false;
+  }
+  round_list = malloc(ROUND_SEGMENTS * sizeof(round_segment_t));
+  cows = malloc(RETENTION_MAX_COWS * sizeof(cow_acc_t));
+  if ((round_list == NULL) || (cows == NULL))
+  {
+    return false;
+  }
+  load_state();
+
+  // a committed round is finished, one cut short is redone
+  if (load_manifest())
+  {
+    round_next = 0;
+    phase = PHASE_REMOVE;
+  }
+  else
+  {
+    clear_compact_dir();
+    phase = PHASE_IDLE;
+  }
+  next_step_ms = 0;
+  next_scan_ms = 0;
+  return true;
+}
+
+bool retention_poll(uint64_t now_ms)
+{
+  bool ok = true;
+
+  if ((round_list == NULL) || (now_ms < next_step_ms))
+  {
+    return true;
+  }
+  next_step_ms = now_ms + RETENTION_STEP_MS;
+
+  // by the gateway's clock: window times are the collars'
+  if ((live_writer != NULL) && (live_writer->fd >= 0))
+  {
+    if (live_segment != live_writer->segment)
+    {
+      live_segment = live_writer->segment;
+      live_since_ms = now_ms;
+    }
+    else if (now_ms - live_since_ms >= RETENTION_ROTATE_S * 1000ull)
+    {
+      ok = store_rotate(live_writer);
+    }
+  }
+
+  switch (phase)
+  {
+    case PHASE_COMPACT:
+      ok = compact_step() && ok;
+      break;
+    case PHASE_REMOVE:
+      ok = remove_step() && ok;
+      break;
+    default:
+      if (now_ms >= next_scan_ms)
+      {
+        next_scan_ms = now_ms + RETENTION_SCAN_MS;
+        ok = scan() && ok;
+      }
+      break;
+  }
+
+  if (!ok && phase == PHASE_COMPACT)
+  {
+    // start the round again at the next look
+    retention_close();
+    clear_compact_dir();
+  }
+  if (!ok)
+  {
+    // back off
+    next_step_ms = now_ms + RETENTION_SCAN_MS;
+  }
+  return ok;
+}
+
+void retention_close(void)
+{
+  if (reader_open)
+  {
+    store_reader_close(&reader);
+    reader_open = false;
+  }
+  if (phase == PHASE_COMPACT)
+  {
+    store_close(&minute_writer);
+    store_close(&hour_writer);
+    phase = PHASE_IDLE;
+  }
+  if (copy_in >= 0)
+  {
+    close(copy_in);
+    copy_in = -1;
+  }
+  if (copy_out >= 0)
+  {
+    close(copy_out);
+    copy_out = -1;
+  }
+}
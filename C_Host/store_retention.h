@@ -0,0 +1,99 @@
+#ifndef STORE_RETENTION_H
+#define STORE_RETENTION_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "host_store.h"
+
+/*
+ * Retention of the window store: raw segments older than the raw age are
+ * rolled up into per-minute and per-hour summaries of each cow (activity,
+ * temperature, battery, RSSI, windows missed), then deleted or moved to an
+ * archive directory. Minute summaries are dropped in turn after the minute
+ * age, hour summaries are kept.
+ *
+ * The work is done in rounds of raw segments. A round writes its summaries
+ * to <dir>/compact/, then commits by writing compact/manifest, which lists
+ * the raw segments it replaces; only then are those removed and the
+ * summaries moved into the store. store_query() (store_query.h) reads a
+ * committed round's summaries in place of its raw segments, so queries
+ * see either one at any time. A round cut short by a crash is redone.
+ *
+ * Dropped minute summaries are recorded as a cutoff in
+ * <dir>/retention.state: queries take hour summaries before it.
+ */
+
+// Directory of the round being compacted, inside the store
+#define RETENTION_COMPACT_DIR "compact"
+#define RETENTION_MANIFEST "manifest"
+#define RETENTION_STATE "retention.state"
+
+// Raw bytes compacted in one round at most
+#define RETENTION_ROUND_BYTES (256ull << 20)
+
+// Work done per step: time spent summarizing, or bytes archived
+#define RETENTION_STEP_US 2000
+#define RETENTION_STEP_BYTES (1u << 20)
+
+// Time between steps while there is work, and between looks for work
+#define RETENTION_STEP_MS 20
+#define RETENTION_SCAN_MS 60000
+
+// Segments written to this recently may still have a writer
+#define RETENTION_QUIET_S 600
+
+// The live segment is sealed at this age so that it can be compacted
+#define RETENTION_ROTATE_S 3600
+
+// Cows summarized at once; more in a round flush the open summaries early
+#define RETENTION_MAX_COWS 4096
+
+// A gap in the window sequence numbers of more than this is a collar reset,
+// not windows missed
+#define RETENTION_MAX_MISSED 1000
+
+typedef struct retention_config
+{
+  uint32_t raw_age_s;         // raw windows older than this are summarized
+  uint32_t minute_age_s;      // minute summaries older than this are dropped
+  uint64_t max_bytes;         // store size to stay under, 0: no limit
+  const char *archive_dir;    // raw segments are moved here, NULL: deleted
+} retention_config_t;
+
+typedef struct retention_stats
+{
+  uint64_t rounds;
+  uint64_t segments;          // raw segments compacted
+  uint64_t windows;           // windows summarized
+  uint64_t minutes;           // summary records written
+  uint64_t hours;
+  uint64_t archived_bytes;
+  uint64_t deleted_bytes;     // raw and minute segments deleted
+  uint64_t store_bytes;       // size of the store at the last look
+} retention_stats_t;
+
+extern retention_stats_t retention_stats;
+
+/**
+ * Start the retention of the store in dir, finishing or undoing a round
+ * an earlier run left. live is the writer of this process's raw windows
+ * (NULL if none): its open segment is left alone, and sealed every
+ * RETENTION_ROTATE_S.
+ */
+bool retention_init(const char *dir, const retention_config_t *config, store_writer_t *live);
+
+/**
+ * Do one step of the work when it is due, a bounded amount so that the
+ * windows coming in are not held up. Call from the main loop. False on an
+ * error, logged; the work is tried again later.
+ */
+bool retention_poll(uint64_t now_ms);
+
+/**
+ * Close what a round in progress has open. The round is redone on the
+ * next start.
+ */
+void retention_close(void);
+
+#endif // STORE_RETENTION_H
@@ -0,0 +1,449 @@
+#include <string.h>
+#include <math.h>
+
+#include "sync_acquire.h"
+
+#define ADV_LOST    0         // not synced: open a sync when heard
+#define ADV_PENDING 1         // sync asked for, not open yet
+#define ADV_SYNCED  2
+
+// Reports closer than this are the same advertising event on two channels
+#define ADV_GAP_MIN_MS 20
+
+// Wait after a refused sync open before asking again
+#define OPEN_RETRY_MS 5000
+
+// Missed event counts are halved past this, so the loss follows the link
+#define LOSS_WINDOW 4096
+
+// Prior of the loss estimate: one event in ten missed, over ten events
+#define LOSS_PRIOR_MISSED 1.0
+#define LOSS_PRIOR_EVENTS 10.0
+
+typedef struct advertiser
+{
+  bd_addr address;
+  bool in_use;
+  uint8_t state;              // ADV_*
+  uint8_t primary_phy;
+  bool was_synced;            // lost_ms is the time of a sync loss
+  bool have_counter;
+  uint16_t handle;            // sync handle while pending or synced
+  uint16_t pa_interval;       // 1.25 ms units, 0 if not known
+  uint16_t last_counter;
+  uint32_t adv_interval_ms;   // 0 until measured
+  uint32_t received;          // periodic events received while synced
+  uint32_t missed;            // and missed
+  uint64_t last_adv_ms;
+  uint64_t lost_ms;           // sync lost, or first heard
+  uint64_t open_ms;           // sync asked for
+  uint64_t retry_ms;          // no open before this
+} advertiser_t;
+
+sync_acq_stats_t sync_acq_stats;
+
+static advertiser_t advertisers[SYNC_ACQ_TABLE_SIZE];
+static uint16_t used[SYNC_ACQ_TABLE_SIZE];    // indexes of the entries in use
+static uint16_t by_handle[65536];             // entry + 1 by sync handle, 0 if none
+static uint64_t expect_until_ms = 0;
+
+static uint32_t adv_hash(const bd_addr *address)
+{
+  uint32_t h = 2166136261u;
+
+  for (int i = 0; i < 6; i++)
+  {
+    h = (h ^ address->addr[i]) * 16777619u;
+  }
+  return h;
+}
+
+void sync_acq_init(void)
+{
+  memset(advertisers, 0, sizeof(advertisers));
+  memset(by_handle, 0, sizeof(by_handle));
+  memset(&sync_acq_stats, 0, sizeof(sync_acq_stats));
+  expect_until_ms = 0;
+}
+
+static advertiser_t *adv_lookup(const bd_addr *address, bool insert)
+{
+  uint32_t idx = adv_hash(address) & (SYNC_ACQ_TABLE_SIZE - 1);
+
+  for (uint32_t n = 0; n < SYNC_ACQ_TABLE_SIZE; n++)
+  {
+    advertiser_t *a = &advertisers[idx];
+
+    if (!a->in_use)
+    {
+      if (!insert)
+      {
+        return NULL;
+      }
+      a->in_use = true;
+      a->address = *address;
+      a->state = ADV_LOST;
+      used[sync_acq_stats.advertisers++] = (uint16_t)idx;
+      return a;
+    }
+    if (memcmp(a->address.addr, address->addr, sizeof(address->addr)) == 0)
+    {
+      return a;
+    }
+    idx = (idx + 1) & (SYNC_ACQ_TABLE_SIZE - 1);
+  }
+  return NULL;
+}
+
+static advertiser_t *adv_by_handle(uint16_t handle)
+{
+  uint16_t i = by_handle[handle];
+
+  return (i == 0) ? NULL : &advertisers[i - 1];
+}
+
+static uint32_t adv_interval_ms(const advertiser_t *a)
+{
+  return (a->adv_interval_ms != 0) ? a->adv_interval_ms : SYNC_ACQ_ADV_INTERVAL_MS;
+}
+
+static uint64_t burst_ms(const advertiser_t *a)
+{
+  uint64_t ms = (uint64_t)SYNC_ACQ_BURST_ADVS * adv_interval_ms(a);
+
+  return (ms > SYNC_ACQ_BURST_MS) ? ms : SYNC_ACQ_BURST_MS;
+}
+
+// Periodic intervals without a report after which the sync is given up:
+// enough that loss alone times it out at most once in
+// SYNC_ACQ_FALSE_LOSS_DAYS, plus one for drift
+static uint16_t sync_timeout(const advertiser_t *a)
+{
+  double interval_ms = (a->pa_interval != 0) ? a->pa_interval * 1.25 : SYNC_ACQ_ADV_INTERVAL_MS;
+  double loss = (a->missed + LOSS_PRIOR_MISSED) / (a->received + a->missed + LOSS_PRIOR_EVENTS);
+  double events = SYNC_ACQ_FALSE_LOSS_DAYS * 86400000.0 / interval_ms;
+  double ms;
+
+  if (loss < 0.01)
+  {
+    loss = 0.01;
+  }
+  else if (loss > 0.9)
+  {
+    loss = 0.9;
+  }
+  ms = (ceil(log(events) / -log(loss)) + 1) * interval_ms;
+  if (ms < SYNC_ACQ_TIMEOUT_MIN_MS)
+  {
+    ms = SYNC_ACQ_TIMEOUT_MIN_MS;
+  }
+  else if (ms > SYNC_ACQ_TIMEOUT_MAX_MS)
+  {
+    ms = SYNC_ACQ_TIMEOUT_MAX_MS;
+  }
+  return (uint16_t)(ms / 10);
+}
+
+bool sync_acq_adv(const bd_addr *address, uint8_t primary_phy, uint16_t pa_interval, uint64_t now_ms,
+                  uint16_t *skip, uint16_t *timeout)
+{
+  advertiser_t *a = adv_lookup(address, true);
+
+  if (a == NULL)
+  {
+    return false;
+  }
+
+  // reports are a whole number of advertising intervals apart, the
+  // smallest spacing seen is the interval
+  if (a->last_adv_ms != 0)
+  {
+    uint64_t gap = now_ms - a->last_adv_ms;
+
+    if ((gap >= ADV_GAP_MIN_MS) && ((a->adv_interval_ms == 0) || (gap < a->adv_interval_ms)))
+    {
+      a->adv_interval_ms = (uint32_t)gap;
+    }
+  }
+  else
+  {
+    a->lost_ms = now_ms;
+  }
+  a->last_adv_ms = now_ms;
+  a->primary_phy = primary_phy;
+  if (pa_interval != 0)
+  {
+    a->pa_interval = pa_interval;
+  }
+
+  if ((a->state != ADV_LOST) || (now_ms < a->retry_ms))
+  {
+    return false;
+  }
+
+  // every event is wanted: redundancy copies are what cover the radio
+  // loss, skipping them would only make the timeout longer
+  *skip = 0;
+  *timeout = sync_timeout(a);
+  sync_acq_stats.opens++;
+  return true;
+}
+
+void sync_acq_open_result(const bd_addr *address, bool ok, uint16_t handle, uint64_t now_ms)
+{
+  advertiser_t *a = adv_lookup(address, false);
+
+  if (a == NULL)
+  {
+    return;
+  }
+  if (!ok)
+  {
+    a->retry_ms = now_ms + OPEN_RETRY_MS;
+    return;
+  }
+  a->state = ADV_PENDING;
+  a->handle = handle;
+  a->open_ms = now_ms;
+  by_handle[handle] = (uint16_t)(a - advertisers + 1);
+}
+
+uint64_t sync_acq_opened(uint16_t handle, const bd_addr *address, uint16_t interval, uint64_t now_ms)
+{
+  advertiser_t *a = adv_lookup(address, true);
+  uint64_t ms = 0;
+
+  if (a == NULL)
+  {
+    return 0;
+  }
+  if (a->was_synced)
+  {
+    uint32_t msb;
+    uint32_t bucket;
+
+    ms = now_ms - a->lost_ms;
+    if (ms < (1u << SYNC_ACQ_HIST_SUB_BITS))
+    {
+      bucket = (uint32_t)ms;
+    }
+    else
+    {
+      msb = 63 - __builtin_clzll(ms);
+      bucket = ((msb - SYNC_ACQ_HIST_SUB_BITS + 1) << SYNC_ACQ_HIST_SUB_BITS)
+               | ((ms >> (msb - SYNC_ACQ_HIST_SUB_BITS)) & ((1u << SYNC_ACQ_HIST_SUB_BITS) - 1));
+      if (bucket >= SYNC_ACQ_HIST_BUCKETS)
+      {
+        bucket = SYNC_ACQ_HIST_BUCKETS - 1;
+      }
+    }
+    sync_acq_stats.hist[bucket]++;
+    sync_acq_stats.reacquired++;
+    sync_acq_stats.sum_ms += ms;
+  }
+
+  a->state = ADV_SYNCED;
+  a->was_synced = true;
+  a->have_counter = false;
+  a->handle = handle;
+  if (interval != 0)
+  {
+    a->pa_interval = interval;
+  }
+  by_handle[handle] = (uint16_t)(a - advertisers + 1);
+  return ms;
+}
+
+void sync_acq_report(uint16_t handle, uint16_t counter)
+{
+  advertiser_t *a = adv_by_handle(handle);
+  uint16_t gap;
+
+  if ((a == NULL) || (a->state != ADV_SYNCED))
+  {
+    return;
+  }
+  gap = (uint16_t)(counter - a->last_counter);
+  if (a->have_counter && (gap == 0))
+  {
+    // the rest of a chain
+    return;
+  }
+  if (a->have_counter)
+  {
+    a->missed += gap - 1;
+  }
+  a->received++;
+  a->have_counter = true;
+  a->last_counter = counter;
+
+  if (a->received + a->missed > LOSS_WINDOW)
+  {
+    a->received /= 2;
+    a->missed /= 2;
+  }
+}
+
+void sync_acq_closed(uint16_t handle, uint64_t now_ms)
+{
+  advertiser_t *a = adv_by_handle(handle);
+
+  by_handle[handle] = 0;
+  if (a == NULL)
+  {
+    return;
+  }
+  if (a->state == ADV_SYNCED)
+  {
+    a->lost_ms = now_ms;
+  }
+  // a sync that never opened keeps the time of the loss before it
+  a->state = ADV_LOST;
+  a->have_counter = false;
+}
+
+void sync_acq_expect(uint64_t now_ms)
+{
+  expect_until_ms = now_ms + SYNC_ACQ_BURST_MS;
+}
+
+// Interval and window for a duty cycle below one: the advertiser's events
+// fall a window later in the scan interval each time, so none of its
+// phases is missed for long
+static void scan_timing(double duty, uint32_t adv_ms, sync_acq_scan_t *scan)
+{
+  double adv = adv_ms * 1.6;
+  double q = floor(adv / SYNC_ACQ_SCAN_INTERVAL - duty + 0.5);
+  double interval;
+
+  if (q < 0)
+  {
+    q = 0;
+  }
+  interval = adv / (q + duty);
+  if (interval > 0xFFFF)
+  {
+    interval = 0xFFFF;
+  }
+  else if (interval < 8)
+  {
+    interval = 8;
+  }
+  scan->interval = (uint16_t)interval;
+  scan->window = (uint16_t)(interval * duty + 0.5);
+  if (scan->window < 4)
+  {
+    scan->window = 4;
+  }
+}
+
+void sync_acq_scan(uint64_t now_ms, sync_acq_scan_t *scan)
+{
+  const advertiser_t *oldest = NULL;
+  uint64_t oldest_ms = UINT64_MAX;
+  bool coded_only = true;
+  double cost = 0;            // reports per second at full duty from synced advertisers
+  double duty;
+  uint32_t synced = 0;
+  uint32_t acquiring = 0;
+
+  for (uint32_t i = 0; i < sync_acq_stats.advertisers; i++)
+  {
+    const advertiser_t *a = &advertisers[used[i]];
+    uint64_t since;
+
+    if (a->state == ADV_SYNCED)
+    {
+      synced++;
+      cost += 1000.0 / adv_interval_ms(a);
+      continue;
+    }
+    if (a->state == ADV_PENDING)
+    {
+      since = a->open_ms;
+    }
+    else if (a->was_synced)
+    {
+      since = a->lost_ms;
+    }
+    else
+    {
+      // never synced: opened as soon as it is heard
+      continue;
+    }
+    if (now_ms - since >= burst_ms(a))
+    {
+      continue;
+    }
+    acquiring++;
+    coded_only = coded_only && (a->primary_phy == sl_bt_gap_phy_coded);
+    if (since < oldest_ms)
+    {
+      oldest_ms = since;
+      oldest = a;
+    }
+  }
+  sync_acq_stats.synced = synced;
+  sync_acq_stats.acquiring = acquiring;
+
+  duty = (cost > SYNC_ACQ_ADV_BUDGET) ? SYNC_ACQ_ADV_BUDGET / cost : 1.0;
+  if ((acquiring == 0) && (now_ms >= expect_until_ms))
+  {
+    // watching for new collars, bulk backlogs and provisioning
+    if (duty > SYNC_ACQ_WATCH_DUTY / 100.0)
+    {
+      duty = SYNC_ACQ_WATCH_DUTY / 100.0;
+    }
+    coded_only = false;
+  }
+  else if (now_ms < expect_until_ms)
+  {
+    coded_only = false;
+  }
+  if (duty < SYNC_ACQ_MIN_DUTY / 100.0)
+  {
+    duty = SYNC_ACQ_MIN_DUTY / 100.0;
+  }
+
+  scan->on = true;
+  scan->phy = coded_only ? sl_bt_scanner_scan_phy_coded : sl_bt_scanner_scan_phy_1m_and_coded;
+  if (duty >= 1.0)
+  {
+    scan->interval = SYNC_ACQ_SCAN_INTERVAL;
+    scan->window = SYNC_ACQ_SCAN_INTERVAL;
+  }
+  else
+  {
+    scan_timing(duty, (oldest != NULL) ? adv_interval_ms(oldest) : SYNC_ACQ_ADV_INTERVAL_MS, scan);
+  }
+}
+
+uint64_t sync_acq_bucket_ms(uint32_t bucket)
+{
+  uint32_t next = bucket + 1;
+  uint32_t msb;
+
+  if (next < (1u << SYNC_ACQ_HIST_SUB_BITS))
+  {
+    return bucket;
+  }
+  msb = (next >> SYNC_ACQ_HIST_SUB_BITS) + SYNC_ACQ_HIST_SUB_BITS - 1;
+  return ((((uint64_t)(next & ((1u << SYNC_ACQ_HIST_SUB_BITS) - 1)) | (1u << SYNC_ACQ_HIST_SUB_BITS))
+           << (msb - SYNC_ACQ_HIST_SUB_BITS)) - 1);
+}
+
+uint64_t sync_acq_percentile(double p)
+{
+  uint64_t target = (uint64_t)ceil(p * sync_acq_stats.reacquired);
+  uint64_t seen = 0;
+
+  for (uint32_t b = 0; b < SYNC_ACQ_HIST_BUCKETS; b++)
+  {
+    seen += sync_acq_stats.hist[b];
+    if ((seen > 0) && (seen >= target))
+    {
+      return sync_acq_bucket_ms(b);
+    }
+  }
+  return 0;
+}
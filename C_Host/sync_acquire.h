@@ -0,0 +1,149 @@
+#ifndef SYNC_ACQUIRE_H
+#define SYNC_ACQUIRE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "sl_bt_api.h"
+
+/*
+ * Periodic sync acquisition: which advertisers to sync to, with what sync
+ * timeout, and how the scanner should run for it.
+ *
+ * Each periodic advertiser heard is tracked by address: its extended
+ * advertising interval (the smallest spacing of its reports), its primary
+ * PHY, its periodic advertising interval and the share of periodic events
+ * missed while synced. From these:
+ *
+ *  - the sync timeout is as many periodic intervals as make a false
+ *    timeout from packet loss alone rarer than SYNC_ACQ_FALSE_LOSS_DAYS,
+ *    rather than one fixed timeout for all;
+ *  - after a sync loss the scanner runs flat out on the advertiser's
+ *    primary PHY for a burst, then falls back to a low duty cycle on both
+ *    PHYs that also finds new and bulk advertising collars. Below full
+ *    duty the scan interval is picked so that the advertiser's events walk
+ *    across the scan window by a window each, so one is heard within
+ *    1 / duty events whatever its phase;
+ *  - the duty is capped by what the extended advertising of the collars
+ *    already synced costs in reports over the NCP (SYNC_ACQ_ADV_BUDGET).
+ *
+ * Time from a sync closing to it opening again is kept as a histogram.
+ * The module issues no commands; the host applies sync_acq_scan().
+ */
+
+// Advertisers tracked, power of two. Entries are never removed.
+#define SYNC_ACQ_TABLE_SIZE 16384
+
+// Extended advertising interval assumed until one is measured (ms), the
+// collar's EXTENDED_ADV_INT
+#define SYNC_ACQ_ADV_INTERVAL_MS 1000
+
+// Full effort after a loss: this many advertising intervals, at least
+// SYNC_ACQ_BURST_MS
+#define SYNC_ACQ_BURST_ADVS 10
+#define SYNC_ACQ_BURST_MS 10000
+
+// Duty cycle while no sync is being acquired, and the least ever used (%)
+#define SYNC_ACQ_WATCH_DUTY 10
+#define SYNC_ACQ_MIN_DUTY 5
+
+// Extended advertising reports per second the scan may cost from
+// advertisers already synced
+#define SYNC_ACQ_ADV_BUDGET 100
+
+// Scan interval aimed at when below full duty (0.625 ms units, 100 ms)
+#define SYNC_ACQ_SCAN_INTERVAL 160
+
+// False sync timeouts from packet loss: at most one per advertiser in
+// this many days
+#define SYNC_ACQ_FALSE_LOSS_DAYS 1
+
+// Sync timeout limits (ms): the controller allows 100 ms to 163.84 s
+#define SYNC_ACQ_TIMEOUT_MIN_MS 2000
+#define SYNC_ACQ_TIMEOUT_MAX_MS 163840
+
+// Time to sync histogram: SYNC_ACQ_HIST_SUB steps per power of two of ms
+#define SYNC_ACQ_HIST_SUB_BITS 3
+#define SYNC_ACQ_HIST_BUCKETS (32 << SYNC_ACQ_HIST_SUB_BITS)
+
+typedef struct sync_acq_scan
+{
+  bool on;
+  uint8_t phy;                // sl_bt_scanner_scan_phy_*
+  uint16_t interval;          // 0.625 ms units
+  uint16_t window;
+} sync_acq_scan_t;
+
+typedef struct sync_acq_stats
+{
+  uint32_t advertisers;       // periodic advertisers known
+  uint32_t synced;            // of them synced now
+  uint32_t acquiring;         // lost or pending, within their burst
+  uint64_t opens;             // sync opens asked for
+  uint64_t reacquired;        // syncs opened again after a loss
+  uint64_t sum_ms;            // time to sync of those, in all
+  uint32_t hist[SYNC_ACQ_HIST_BUCKETS];
+} sync_acq_stats_t;
+
+extern sync_acq_stats_t sync_acq_stats;
+
+/**
+ * Forget all advertisers.
+ */
+void sync_acq_init(void);
+
+/**
+ * An extended advertising report of a periodic advertiser: primary PHY
+ * and periodic interval (1.25 ms units, 0 if not given). Returns true if
+ * a sync should be opened to it now, with the sync timeout in *timeout
+ * (10 ms units) and the skip in *skip.
+ */
+bool sync_acq_adv(const bd_addr *address, uint8_t primary_phy, uint16_t pa_interval, uint64_t now_ms,
+                  uint16_t *skip, uint16_t *timeout);
+
+/**
+ * Result of the sync open asked for by sync_acq_adv(). handle is the
+ * sync handle when ok.
+ */
+void sync_acq_open_result(const bd_addr *address, bool ok, uint16_t handle, uint64_t now_ms);
+
+/**
+ * The sync opened; interval is the periodic interval (1.25 ms units).
+ * Returns the time since it was lost (ms), 0 for a first sync.
+ */
+uint64_t sync_acq_opened(uint16_t handle, const bd_addr *address, uint16_t interval, uint64_t now_ms);
+
+/**
+ * A periodic report of the sync. counter is its periodic event counter;
+ * the events skipped since the last report count as missed.
+ */
+void sync_acq_report(uint16_t handle, uint16_t counter);
+
+/**
+ * The sync closed, lost or never established.
+ */
+void sync_acq_closed(uint16_t handle, uint64_t now_ms);
+
+/**
+ * Expect a new advertiser soon, e.g. a collar just provisioned: scan at
+ * full duty on both PHYs for a burst.
+ */
+void sync_acq_expect(uint64_t now_ms);
+
+/**
+ * How the scanner should run now.
+ */
+void sync_acq_scan(uint64_t now_ms, sync_acq_scan_t *scan);
+
+/**
+ * Time to sync (ms) at or above fraction p of the syncs reacquired,
+ * 0 before the first.
+ */
+uint64_t sync_acq_percentile(double p);
+
+/**
+ * Upper bound (ms) of a histogram bucket.
+ */
+uint64_t sync_acq_bucket_ms(uint32_t bucket);
+
+#endif // SYNC_ACQUIRE_H
@@ -0,0 +1,440 @@
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdatomic.h>
+
+#include "work_pool.h"
+
+// Cows the pool can tell apart: every cow ID
+#define POOL_COWS 65536
+
+// Where a cow is
+#define COW_IDLE    0         // nothing to do
+#define COW_QUEUED  1         // in its home worker's run queue
+#define COW_RUNNING 2         // with a worker
+
+typedef struct pool_cow
+{
+  work_item_t *head;          // mailbox
+  work_item_t *tail;
+  void *owner;
+  uint64_t tick_ms;
+  bool tick;                  // a tick is waiting
+  uint8_t state;
+} pool_cow_t;
+
+// Guarded by lock: the run queue, and the mailboxes and states of the cows
+// at home here. Aligned so that workers do not share lines.
+typedef struct pool_worker
+{
+  pthread_mutex_t lock;
+  uint16_t *queue;            // cow IDs, a ring
+  uint32_t mask;
+  uint32_t head;
+  uint32_t count;
+  pthread_t thread;
+  uint8_t index;
+  atomic_uint_fast64_t items;
+  atomic_uint_fast64_t ticks;
+  atomic_uint_fast64_t runs;
+  atomic_uint_fast64_t steals;
+} __attribute__((aligned(64))) pool_worker_t;
+
+// A cow taken from a run queue, with the work it had
+typedef struct pool_run
+{
+  uint16_t cow_id;
+  void *owner;
+  work_item_t *mail;
+  bool tick;
+  uint64_t tick_ms;
+} pool_run_t;
+
+static pool_worker_t workers[WORK_POOL_MAX_WORKERS];
+static uint8_t n_workers = 0;
+static pool_cow_t *cows = NULL;
+static work_fn_t handle = NULL;
+static work_tick_fn_t handle_tick = NULL;
+
+// One post per cow put in a run queue: a worker waits before taking one
+static sem_t queued;
+static atomic_bool stopping;
+
+// Items and ticks submitted and not yet handled
+static atomic_uint_fast64_t outstanding;
+static pthread_mutex_t drain_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t drained = PTHREAD_COND_INITIALIZER;
+
+static work_item_t *items = NULL;
+static work_item_t *free_items = NULL;
+static pthread_mutex_t free_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t freed = PTHREAD_COND_INITIALIZER;
+static uint64_t full = 0;
+
+static pool_worker_t *home(uint16_t cow_id)
+{
+  return &workers[cow_id % n_workers];
+}
+
+// Put a cow with work at the back of its home run queue. Under w->lock.
+static void enqueue(pool_worker_t *w, uint16_t cow_id)
+{
+  w->queue[(w->head + w->count) & w->mask] = cow_id;
+  w->count++;
+  cows[cow_id].state = COW_QUEUED;
+}
+
+// Take a cow from a run queue: the owner from the front, a thief from the
+// back, away from the cows the owner is about to reach
+static bool take(pool_worker_t *self, pool_worker_t *w, pool_run_t *run)
+{
+  pool_cow_t *c;
+
+  pthread_mutex_lock(&w->lock);
+  if (w->count == 0)
+  {
+    pthread_mutex_unlock(&w->lock);
+    return false;
+  }
+  w->count--;
+  if (w == self)
+  {
+    run->cow_id = w->queue[w->head];
+    w->head = (w->head + 1) & w->mask;
+  }
+  else
+  {
+    run->cow_id = w->queue[(w->head + w->count) & w->mask];
+  }
+
+  c = &cows[run->cow_id];
+  c->state = COW_RUNNING;
+  run->owner = c->owner;
+  run->mail = c->head;
+  run->tick = c->tick;
+  run->tick_ms = c->tick_ms;
+  c->head = c->tail = NULL;
+  c->tick = false;
+  pthread_mutex_unlock(&w->lock);
+
+  atomic_fetch_add_explicit(&self->runs, 1, memory_order_relaxed);
+  if (w != self)
+  {
+    atomic_fetch_add_explicit(&self->steals, 1, memory_order_relaxed);
+  }
+  return true;
+}
+
+static void done(uint64_t n)
+{
+  if (atomic_fetch_sub(&outstanding, n) == n)
+  {
+    pthread_mutex_lock(&drain_lock);
+    pthread_cond_broadcast(&drained);
+    pthread_mutex_unlock(&drain_lock);
+  }
+}
+
+static void *worker_main(void *arg)
+{
+  pool_worker_t *self = arg;
+  sigset_t all;
+
+  // signals are for the event thread
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, NULL);
+
+  for (;;)
+  {
+    pool_run_t run;
+    work_item_t *last = NULL;
+    bool found = false;
+    bool again;
+    uint64_t n = 0;
+    pool_worker_t *w;
+    pool_cow_t *c;
+
+    while (sem_wait(&queued) != 0)
+    {
+    }
+
+    // a post stands for a queued cow, but another worker may take the one
+    // seen here first and leave it elsewhere
+    while (!found)
+    {
+      for (uint8_t i = 0; (i < n_workers) && !found; i++)
+      {
+        found = take(self, &workers[(self->index + i) % n_workers], &run);
+      }
+      if (!found)
+      {
+        if (atomic_load(&stopping))
+        {
+          return NULL;
+        }
+        sched_yield();
+      }
+    }
+
+    for (work_item_t *item = run.mail; item != NULL; item = item->next)
+    {
+      handle(run.owner, item);
+      last = item;
+      n++;
+    }
+    if (run.tick)
+    {
+      handle_tick(run.owner, run.tick_ms);
+    }
+
+    if (run.mail != NULL)
+    {
+      pthread_mutex_lock(&free_lock);
+      last->next = free_items;
+      free_items = run.mail;
+      pthread_cond_signal(&freed);
+      pthread_mutex_unlock(&free_lock);
+    }
+    atomic_fetch_add_explicit(&self->items, n, memory_order_relaxed);
+    atomic_fetch_add_explicit(&self->ticks, run.tick, memory_order_relaxed);
+
+    // back in the run queue if more came in meanwhile
+    w = home(run.cow_id);
+    c = &cows[run.cow_id];
+    pthread_mutex_lock(&w->lock);
+    again = (c->head != NULL) || c->tick;
+    if (again)
+    {
+      enqueue(w, run.cow_id);
+    }
+    else
+    {
+      c->state = COW_IDLE;
+    }
+    pthread_mutex_unlock(&w->lock);
+    if (again)
+    {
+      sem_post(&queued);
+    }
+
+    done(n + run.tick);
+  }
+}
+
+bool work_pool_start(uint8_t n, work_fn_t fn, work_tick_fn_t tick)
+{
+  uint32_t size = 1;
+
+  if ((n == 0) || (n > WORK_POOL_MAX_WORKERS) || (n_workers != 0))
+  {
+    return false;
+  }
+
+  // room in a run queue for every cow at home there
+  while (size < (uint32_t)((POOL_COWS + n - 1) / n))
+  {
+    size <<= 1;
+  }
+  cows = calloc(POOL_COWS, sizeof(pool_cow_t));
+  items = calloc(WORK_POOL_ITEMS, sizeof(work_item_t));
+  if ((cows == NULL) || (items == NULL))
+  {
+    free(cows);
+    free(items);
+    return false;
+  }
+  free_items = NULL;
+  for (int i = WORK_POOL_ITEMS - 1; i >= 0; i--)
+  {
+    items[i].next = free_items;
+    free_items = &items[i];
+  }
+
+  handle = fn;
+  handle_tick = tick;
+  full = 0;
+  atomic_store(&outstanding, 0);
+  atomic_store(&stopping, false);
+  sem_init(&queued, 0, 0);
+
+  n_workers = n;
+  for (uint8_t i = 0; i < n; i++)
+  {
+    pool_worker_t *w = &workers[i];
+
+    atomic_store(&w->items, 0);
+    atomic_store(&w->ticks, 0);
+    atomic_store(&w->runs, 0);
+    atomic_store(&w->steals, 0);
+    pthread_mutex_init(&w->lock, NULL);
+    w->queue = malloc(size * sizeof(uint16_t));
+    w->mask = size - 1;
+    w->head = 0;
+    w->count = 0;
+    w->index = i;
+  }
+  for (uint8_t i = 0; i < n; i++)
+  {
+    if ((workers[i].queue == NULL) || (pthread_create(&workers[i].thread, NULL, worker_main, &workers[i]) != 0))
+    {
+      // stop the ones started
+      atomic_store(&stopping, true);
+      for (uint8_t j = 0; j < i; j++)
+      {
+        sem_post(&queued);
+      }
+      for (uint8_t j = 0; j < i; j++)
+      {
+        pthread_join(workers[j].thread, NULL);
+      }
+      for (uint8_t j = 0; j < n; j++)
+      {
+        free(workers[j].queue);
+        pthread_mutex_destroy(&workers[j].lock);
+      }
+      sem_destroy(&queued);
+      free(cows);
+      free(items);
+      n_workers = 0;
+      return false;
+    }
+  }
+  return true;
+}
+
+work_item_t *work_pool_item(void)
+{
+  work_item_t *item;
+
+  pthread_mutex_lock(&free_lock);
+  if (free_items == NULL)
+  {
+    full++;
+    while (free_items == NULL)
+    {
+      pthread_cond_wait(&freed, &free_lock);
+    }
+  }
+  item = free_items;
+  free_items = item->next;
+  pthread_mutex_unlock(&free_lock);
+
+  item->next = NULL;
+  return item;
+}
+
+void work_pool_submit(void *owner, work_item_t *item)
+{
+  pool_worker_t *w = home(item->cow_id);
+  pool_cow_t *c = &cows[item->cow_id];
+  bool post = false;
+
+  item->next = NULL;
+  atomic_fetch_add(&outstanding, 1);
+
+  pthread_mutex_lock(&w->lock);
+  c->owner = owner;
+  if (c->tail != NULL)
+  {
+    c->tail->next = item;
+  }
+  else
+  {
+    c->head = item;
+  }
+  c->tail = item;
+  if (c->state == COW_IDLE)
+  {
+    enqueue(w, item->cow_id);
+    post = true;
+  }
+  pthread_mutex_unlock(&w->lock);
+
+  if (post)
+  {
+    sem_post(&queued);
+  }
+}
+
+void work_pool_tick(uint16_t cow_id, void *owner, uint64_t now_ms)
+{
+  pool_worker_t *w = home(cow_id);
+  pool_cow_t *c = &cows[cow_id];
+  bool post = false;
+
+  pthread_mutex_lock(&w->lock);
+  if (!c->tick)
+  {
+    atomic_fetch_add(&outstanding, 1);
+    c->owner = owner;
+    c->tick = true;
+    c->tick_ms = now_ms;
+    if (c->state == COW_IDLE)
+    {
+      enqueue(w, cow_id);
+      post = true;
+    }
+  }
+  pthread_mutex_unlock(&w->lock);
+
+  if (post)
+  {
+    sem_post(&queued);
+  }
+}
+
+void work_pool_drain(void)
+{
+  pthread_mutex_lock(&drain_lock);
+  while (atomic_load(&outstanding) != 0)
+  {
+    pthread_cond_wait(&drained, &drain_lock);
+  }
+  pthread_mutex_unlock(&drain_lock);
+}
+
+void work_pool_stop(void)
+{
+  if (n_workers == 0)
+  {
+    return;
+  }
+  work_pool_drain();
+
+  atomic_store(&stopping, true);
+  for (uint8_t i = 0; i < n_workers; i++)
+  {
+    sem_post(&queued);
+  }
+  for (uint8_t i = 0; i < n_workers; i++)
+  {
+    pthread_join(workers[i].thread, NULL);
+    free(workers[i].queue);
+    pthread_mutex_destroy(&workers[i].lock);
+  }
+  sem_destroy(&queued);
+  free(cows);
+  free(items);
+  cows = NULL;
+  items = NULL;
+  free_items = NULL;
+  n_workers = 0;
+}
+
+void work_pool_get_stats(work_pool_stats_t *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+  for (uint8_t i = 0; i < n_workers; i++)
+  {
+    stats->items += atomic_load(&workers[i].items);
+    stats->ticks += atomic_load(&workers[i].ticks);
+    stats->runs += atomic_load(&workers[i].runs);
+    stats->steals += atomic_load(&workers[i].steals);
+  }
+  pthread_mutex_lock(&free_lock);
+  stats->full = full;
+  pthread_mutex_unlock(&free_lock);
+}
@@ -0,0 +1,100 @@
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cs_payload.h"
+
+/*
+ * Worker pool for the per-cow analytics of decoded windows (features,
+ * alert rules), sharded by cow.
+ *
+ * Each cow has a home worker (cow ID modulo the number of workers) and a
+ * mailbox of the windows submitted for it. A cow with mail waits in its
+ * home worker's run queue; the worker that takes it handles its whole
+ * mailbox in order, then puts it back if more came in meanwhile. A worker
+ * with nothing of its own to do steals a waiting cow from another run
+ * queue. A cow is never with two workers at once, so its windows are
+ * handled in the order they were submitted and its state needs no lock:
+ * the run queue locks order one worker's handling of a cow before the
+ * next's.
+ *
+ * Windows are copied into work items from a fixed set; submitting waits
+ * while all of them are in use.
+ *
+ * The BLE event thread submits, the handlers run on the workers: they may
+ * touch only the state of their item's cow, and must lock anything shared.
+ */
+
+#define WORK_POOL_MAX_WORKERS 64
+
+// Work items in flight at most
+#define WORK_POOL_ITEMS 4096
+
+typedef struct work_item
+{
+  struct work_item *next;
+  uint16_t cow_id;
+  uint64_t now_ms;            // time the window arrived
+  cs_window_t window;
+} work_item_t;
+
+/**
+ * Handle a window of a cow. owner is the pointer given when the cow was
+ * submitted (e.g. its collar_t).
+ */
+typedef void (*work_fn_t)(void *owner, const work_item_t *item);
+
+/**
+ * Periodic work on a cow (work_pool_tick()), after the windows submitted
+ * before it.
+ */
+typedef void (*work_tick_fn_t)(void *owner, uint64_t now_ms);
+
+typedef struct work_pool_stats
+{
+  uint64_t items;             // windows handled
+  uint64_t ticks;             // ticks handled
+  uint64_t runs;              // mailboxes handled
+  uint64_t steals;            // of them taken from another worker's run queue
+  uint64_t full;              // submits that waited for a free item
+} work_pool_stats_t;
+
+/**
+ * Start workers (1..WORK_POOL_MAX_WORKERS) threads. False if they could
+ * not be started.
+ */
+bool work_pool_start(uint8_t workers, work_fn_t fn, work_tick_fn_t tick);
+
+/**
+ * A free work item. Waits for one if none is free.
+ */
+work_item_t *work_pool_item(void);
+
+/**
+ * Queue an item filled in by the caller for its cow.
+ */
+void work_pool_submit(void *owner, work_item_t *item);
+
+/**
+ * Queue a tick for a cow, unless it has one waiting already.
+ */
+void work_pool_tick(uint16_t cow_id, void *owner, uint64_t now_ms);
+
+/**
+ * Wait until everything submitted has been handled.
+ */
+void work_pool_drain(void);
+
+/**
+ * Handle what is queued, then stop the workers.
+ */
+void work_pool_stop(void);
+
+/**
+ * Counters summed over the workers. Exact once drained.
+ */
+void work_pool_get_stats(work_pool_stats_t *stats);
+
+#endif // WORK_POOL_H
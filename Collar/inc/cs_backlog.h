@@ -0,0 +1,44 @@
+/*
+ * cs_backlog.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ */
+
+#ifndef CS_BACKLOG_H_
+#define CS_BACKLOG_H_
+
+
+#include "stdlib.h"
+#include "stdint.h"
+#include "stdbool.h"
+#include "cs_payload.h"
+
+
+// RAM kept for advertised records: 24 windows of 30 samples, fewer when the
+// windows are longer
+#define BACKLOG_BYTES         4680
+
+// Most records stored at once (short summary and class records)
+#define BACKLOG_WINDOWS       64
+
+// Largest window that can be stored (encoded payload size)
+#define BACKLOG_WINDOW_SIZE   CS_PAYLOAD_MAX_LEN
+
+
+void backlog_init(void);
+
+uint32_t backlog_push(const uint8_t *window, uint16_t len);
+
+bool backlog_get(uint32_t seq, const uint8_t **window, uint16_t *len);
+
+void backlog_release(uint32_t seq);
+
+uint32_t backlog_first_seq(void);
+
+uint32_t backlog_next_seq(void);
+
+uint32_t backlog_count(void);
+
+
+#endif /* CS_BACKLOG_H_ */
@@ -16,6 +16,8 @@
 
 sl_status_t sensor_imu_enable(bool enable, float sample_rate);
 
+sl_status_t sensor_imu_set_rate(float sample_rate);
+
 sl_status_t sensor_imu_get_avec(int16_t avec[3]);
 
 sl_status_t sensor_imu_get(int16_t ovec[3], int16_t avec[3]);
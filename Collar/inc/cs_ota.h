@@ -0,0 +1,44 @@
+/*
+ * cs_ota.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Delta firmware update over the bulk connection: the patch
+ *  (Common/inc/cs_delta.h) is applied against the application in flash as
+ *  it arrives and the new image is written to bootloader storage slot 0,
+ *  the slot of the in-place OTA DFU. Only the applier state stays in RAM,
+ *  so a transfer cut by a lost link resumes where it stopped as long as
+ *  the collar does not reset.
+ *
+ *  ota_ctrl and ota_data are open to any central that connects, with no
+ *  pairing, so what is installed must be proven by the bootloader: the
+ *  collar takes no update (CS_DELTA_ERR_UNSIGNED) unless its bootloader
+ *  enforces signed GBL images (BOOTLOADER_CAPABILITY_ENFORCE_UPGRADE_SIGNATURE,
+ *  with the signing key programmed on the device). Updates are signed with
+ *  the key before collar_delta makes the patch.
+ */
+
+#ifndef CS_OTA_H_
+#define CS_OTA_H_
+
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "cs_delta.h"
+
+
+// Bootloader storage slot the new image is written to
+#define OTA_SLOT          0
+
+
+void ota_init(void);
+
+uint8_t ota_command(const uint8_t *data, uint16_t len, uint8_t *status);
+
+bool ota_data(const uint8_t *data, uint16_t len, uint8_t *status);
+
+void ota_install(void);
+
+
+#endif /* CS_OTA_H_ */
@@ -0,0 +1,56 @@
+/*
+ * cs_radio.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ */
+
+#ifndef CS_RADIO_H_
+#define CS_RADIO_H_
+
+
+#include "stdlib.h"
+#include "stdint.h"
+#include "stdbool.h"
+#include "cs_link.h"
+
+
+// Extended header bytes in front of the AdvData of an AUX_SYNC_IND
+#define RADIO_AUX_SYNC_EXT_HEADER  2
+
+// AuxPtr field added to the extended header of every PDU but the last of a
+// chain, and the largest advertising PDU payload
+#define RADIO_AUX_PTR_LEN          3
+#define RADIO_ADV_PDU_MAX          255
+
+
+// Periodic advertising airtime accounting
+typedef struct radio_pa_metrics{
+  uint32_t windows;           // windows published
+  uint32_t pdus;              // periodic PDUs carrying them, chained PDUs included
+  uint32_t window_airtime_us; // airtime spent on the last window (all copies)
+  uint32_t total_airtime_ms;  // airtime spent on periodic PDUs since boot
+  uint16_t airtime_rem_us;    // sub-millisecond remainder of the total
+}radio_pa_metrics_t;
+
+
+// Periodic advertising energy against the default link level
+typedef struct radio_link_metrics{
+  uint32_t changes;           // link level changes applied
+  uint32_t energy_saved_mj;   // estimated TX energy saved since boot
+  uint32_t energy_rem_nj;     // sub-millijoule remainder
+}radio_link_metrics_t;
+
+
+uint32_t radio_airtime_us(uint8_t phy, uint16_t payload_len);
+
+uint32_t radio_pa_energy_nj(uint8_t phy, int16_t tx_power, uint16_t data_len);
+
+void radio_link_account(radio_link_metrics_t *metrics, uint8_t level, uint16_t data_len, uint8_t redundancy);
+
+uint32_t radio_chain_airtime_us(uint8_t phy, uint16_t data_len, uint8_t *pdus);
+
+void radio_pa_account(radio_pa_metrics_t *metrics, uint8_t phy, uint16_t data_len, uint8_t redundancy);
+
+
+#endif /* CS_RADIO_H_ */
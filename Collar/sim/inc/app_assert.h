@@ -0,0 +1,38 @@
+/*
+ * app_assert.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: a failed assert reports the location and aborts, where the
+ *  collar would trap and wait for the watchdog.
+ */
+
+#ifndef APP_ASSERT_H_
+#define APP_ASSERT_H_
+
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "sl_status.h"
+
+
+#define app_assert(expr, ...)                                              \
+  do {                                                                     \
+    if (!(expr)) {                                                         \
+      fprintf(stderr, "%s:%d: assert failed: %s\n", __FILE__, __LINE__, #expr); \
+      abort();                                                             \
+    }                                                                      \
+  } while (0)
+
+#define app_assert_status(sc)                                              \
+  do {                                                                     \
+    sl_status_t sc_ = (sc);                                                \
+    if (sc_ != SL_STATUS_OK) {                                             \
+      fprintf(stderr, "%s:%d: status 0x%04x\n", __FILE__, __LINE__, (unsigned int)sc_); \
+      abort();                                                             \
+    }                                                                      \
+  } while (0)
+
+
+#endif /* APP_ASSERT_H_ */
@@ -0,0 +1,58 @@
+/*
+ * btl_interface.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: the application interface of the Gecko bootloader used by a
+ *  delta update. Storage slot 0 lies in sim_flash behind the application,
+ *  writes erase a page when they reach its start as on the device, and
+ *  rebootAndInstall ends the run (Collar/sim/src/sim_hal.c). It reports
+ *  signed images enforced, as a production bootloader must.
+ */
+
+#ifndef BTL_INTERFACE_H_
+#define BTL_INTERFACE_H_
+
+
+#include "sl_common.h"
+
+
+#define BOOTLOADER_OK                     0
+#define BOOTLOADER_ERROR_STORAGE_BASE     0x0400
+#define BOOTLOADER_ERROR_STORAGE_INVALID_SLOT    (BOOTLOADER_ERROR_STORAGE_BASE + 0x1)
+#define BOOTLOADER_ERROR_STORAGE_INVALID_ADDRESS (BOOTLOADER_ERROR_STORAGE_BASE + 0x2)
+
+#define BOOTLOADER_CAPABILITY_ENFORCE_UPGRADE_SIGNATURE  (1 << 0)
+#define BOOTLOADER_CAPABILITY_ENFORCE_UPGRADE_ENCRYPTION (1 << 1)
+
+typedef struct {
+  uint32_t type;
+  uint32_t version;
+  uint32_t capabilities;
+} BootloaderInformation_t;
+
+typedef struct {
+  uint32_t address;
+  uint32_t length;
+} BootloaderStorageSlot_t;
+
+typedef void (*BootloaderParserCallback_t)(uint32_t address, uint8_t *data, size_t length, void *context);
+
+
+int32_t bootloader_init(void);
+
+void bootloader_getInfo(BootloaderInformation_t *info);
+
+int32_t bootloader_getStorageSlotInfo(uint32_t slotId, BootloaderStorageSlot_t *slot);
+
+int32_t bootloader_eraseWriteStorage(uint32_t slotId, uint32_t offset, uint8_t *buffer, uint32_t length);
+
+int32_t bootloader_verifyImage(uint32_t slotId, BootloaderParserCallback_t callbackFunction);
+
+int32_t bootloader_setImageToBootload(int32_t slotId);
+
+void bootloader_rebootAndInstall(void);
+
+
+#endif /* BTL_INTERFACE_H_ */
@@ -0,0 +1,32 @@
+/*
+ * em_cmu.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: clock management calls used by the collar; clocks always run.
+ */
+
+#ifndef EM_CMU_H_
+#define EM_CMU_H_
+
+
+#include "sl_common.h"
+
+
+typedef enum {
+  cmuClock_WDOG0 = 1,
+} CMU_Clock_TypeDef;
+
+typedef enum {
+  cmuSelect_ULFRCO = 1,
+  cmuSelect_LFRCO = 2,
+} CMU_Select_TypeDef;
+
+
+void CMU_ClockEnable(CMU_Clock_TypeDef clock, bool enable);
+
+void CMU_ClockSelectSet(CMU_Clock_TypeDef clock, CMU_Select_TypeDef ref);
+
+
+#endif /* EM_CMU_H_ */
@@ -0,0 +1,28 @@
+/*
+ * em_device.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: main flash of an EFR32BG22 (512 kB). Flash addresses are
+ *  offsets into sim_flash, where a run loads the application image a
+ *  delta update is made against (Collar/sim/src/sim_hal.c).
+ */
+
+#ifndef EM_DEVICE_H_
+#define EM_DEVICE_H_
+
+
+#include "sl_common.h"
+
+
+#define FLASH_BASE        0x00000000UL
+#define FLASH_SIZE        0x00080000UL
+#define FLASH_PAGE_SIZE   0x00002000UL
+
+extern uint8_t sim_flash[FLASH_SIZE];
+
+#define FLASH_MEM(addr)   ((const uint8_t *)&sim_flash[(addr) - FLASH_BASE])
+
+
+#endif /* EM_DEVICE_H_ */
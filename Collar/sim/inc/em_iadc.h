@@ -0,0 +1,94 @@
+/*
+ * em_iadc.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: the IADC registers and emlib calls used for the battery
+ *  reading. A single conversion completes at once and returns the supply
+ *  set with sim_adc_set() (Collar/sim/src/sim_hal.c).
+ */
+
+#ifndef EM_IADC_H_
+#define EM_IADC_H_
+
+
+#include "sl_common.h"
+
+
+// Device header: the part has an IADC
+#define IADC_PRESENT
+
+typedef struct {
+  volatile uint32_t CTRL;
+  volatile uint32_t IF;
+  volatile uint32_t IEN;
+} IADC_TypeDef;
+
+extern IADC_TypeDef sim_iadc0;
+
+#define IADC0                   (&sim_iadc0)
+#define _IADC_CTRL_RESETVALUE   0x00000000UL
+#define IADC_IF_SINGLEDONE      (0x1UL << 3)
+#define IADC_IEN_SINGLEDONE     (0x1UL << 3)
+
+typedef enum {
+  iadcCmdStartSingle = 0x1,
+  iadcCmdStopSingle = 0x2,
+} IADC_Cmd_t;
+
+typedef enum {
+  iadcPosInputGnd = 0x0,
+  iadcPosInputAvdd = 0x10,
+} IADC_PosInput_t;
+
+typedef struct {
+  bool warmup;
+} IADC_Init_t;
+
+typedef struct {
+  uint8_t reference;
+} IADC_AllConfigs_t;
+
+typedef struct {
+  bool start;
+} IADC_InitSingle_t;
+
+typedef struct {
+  IADC_PosInput_t posInput;
+  uint8_t negInput;
+} IADC_SingleInput_t;
+
+#define IADC_INIT_DEFAULT         { false }
+#define IADC_ALLCONFIGS_DEFAULT   { 0 }
+#define IADC_INITSINGLE_DEFAULT   { false }
+#define IADC_SINGLEINPUT_DEFAULT  { iadcPosInputGnd, 0 }
+
+
+void IADC_init(IADC_TypeDef *iadc, const IADC_Init_t *init, const IADC_AllConfigs_t *allConfigs);
+
+void IADC_initSingle(IADC_TypeDef *iadc, const IADC_InitSingle_t *init, const IADC_SingleInput_t *input);
+
+void IADC_reset(IADC_TypeDef *iadc);
+
+void IADC_command(IADC_TypeDef *iadc, IADC_Cmd_t cmd);
+
+uint32_t IADC_readSingleData(IADC_TypeDef *iadc);
+
+static inline void IADC_enableInt(IADC_TypeDef *iadc, uint32_t flags)
+{
+  iadc->IEN |= flags;
+}
+
+static inline void IADC_clearInt(IADC_TypeDef *iadc, uint32_t flags)
+{
+  iadc->IF &= ~flags;
+}
+
+static inline uint32_t IADC_getInt(IADC_TypeDef *iadc)
+{
+  return iadc->IF;
+}
+
+
+#endif /* EM_IADC_H_ */
@@ -0,0 +1,25 @@
+/*
+ * em_rmu.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: reset cause; every run starts from a power on reset.
+ */
+
+#ifndef EM_RMU_H_
+#define EM_RMU_H_
+
+
+#include "sl_common.h"
+
+
+#define EMU_RSTCAUSE_POR  (0x1UL << 0)
+
+
+uint32_t RMU_ResetCauseGet(void);
+
+void RMU_ResetCauseClear(void);
+
+
+#endif /* EM_RMU_H_ */
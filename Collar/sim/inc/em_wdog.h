@@ -0,0 +1,66 @@
+/*
+ * em_wdog.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: watchdog on the virtual clock. The simulator stops with an
+ *  error when the collar misses a feed (Collar/sim/src/sim_hal.c).
+ */
+
+#ifndef EM_WDOG_H_
+#define EM_WDOG_H_
+
+
+#include "sl_common.h"
+
+
+typedef struct {
+  bool enabled;
+  uint32_t period_ms;
+  uint64_t deadline;        // tick by which the next feed is due
+} WDOG_TypeDef;
+
+extern WDOG_TypeDef sim_wdog0;
+
+#define WDOG0   (&sim_wdog0)
+
+// Timeout of 2^(3 + perSel) + 1 ULFRCO (1 kHz) cycles
+typedef enum {
+  wdogPeriod_9 = 0,
+  wdogPeriod_17,
+  wdogPeriod_33,
+  wdogPeriod_65,
+  wdogPeriod_129,
+  wdogPeriod_257,
+  wdogPeriod_513,
+  wdogPeriod_1k,
+  wdogPeriod_2k,
+  wdogPeriod_4k,
+  wdogPeriod_8k,
+  wdogPeriod_16k,
+  wdogPeriod_32k,
+  wdogPeriod_64k,
+  wdogPeriod_128k,
+  wdogPeriod_256k,
+} WDOG_PeriodSel_TypeDef;
+
+typedef struct {
+  bool enable;
+  bool debugRun;
+  bool em2Run;
+  bool em3Run;
+  bool em4Block;
+  WDOG_PeriodSel_TypeDef perSel;
+  bool resetDisable;
+} WDOG_Init_TypeDef;
+
+#define WDOG_INIT_DEFAULT { true, false, true, true, false, wdogPeriod_256k, false }
+
+
+void WDOGn_Init(WDOG_TypeDef *wdog, const WDOG_Init_TypeDef *init);
+
+void WDOGn_Feed(WDOG_TypeDef *wdog);
+
+
+#endif /* EM_WDOG_H_ */
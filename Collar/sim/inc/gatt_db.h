@@ -0,0 +1,37 @@
+/*
+ * gatt_db.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: attribute handles of Collar/gatt_configuration.btconf. The SDK
+ *  generates this file; keep the list in step with the btconf when a
+ *  characteristic is added.
+ */
+
+#ifndef GATT_DB_H_
+#define GATT_DB_H_
+
+
+#define gattdb_device_name                3
+#define gattdb_manufacturer_name_string   8
+#define gattdb_model_number_string        10
+#define gattdb_hardware_revision_string   12
+#define gattdb_firmware_revision_string   14
+#define gattdb_system_id                  16
+#define gattdb_date_time                  19
+#define gattdb_cow_id                     21
+#define gattdb_collar_config              23
+#define gattdb_pa_metrics                 25
+#define gattdb_link_metrics               27
+#define gattdb_adapt_metrics              29
+#define gattdb_bulk_ctrl                  32
+#define gattdb_bulk_data                  34
+#define gattdb_ota_ctrl                   37
+#define gattdb_ota_data                   40
+
+// One past the highest attribute handle
+#define SIM_GATTDB_HANDLES                41
+
+
+#endif /* GATT_DB_H_ */
@@ -0,0 +1,98 @@
+/*
+ * sim.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Firmware in the loop simulator: Collar/src built for Linux against the
+ *  stub SDK in Collar/sim/inc. These calls drive the collar from the outside
+ *  (virtual clock, host actions, sensor values) and read back what it sent.
+ *  sim_main.c is the command line front end; a test or fuzz harness links
+ *  the same sources with its own main().
+ */
+
+#ifndef SIM_H_
+#define SIM_H_
+
+
+#include "sl_common.h"
+#include "sl_bt_api.h"
+
+
+// Sleeptimer tick rate (LFXO)
+#define SIM_TIMER_FREQUENCY   32768
+
+// Longest periodic advertising data the controller takes
+#define SIM_PA_DATA_MAX       1650
+
+
+// Virtual clock (sim_sleeptimer.c)
+uint64_t sim_now(void);
+
+uint64_t sim_ms_to_tick(uint64_t ms);
+
+double sim_tick_to_s(uint64_t tick);
+
+bool sim_sleeptimer_next(uint64_t *tick);
+
+void sim_sleeptimer_run(uint64_t tick);
+
+
+// Bluetooth stack (sim_bt.c)
+typedef void (*sim_pa_hook_t)(const uint8_t *data, uint16_t len);
+
+typedef void (*sim_notify_hook_t)(uint8_t connection, uint16_t characteristic, const uint8_t *data, uint16_t len);
+
+typedef struct sim_radio_stats{
+  uint32_t legacy_events;     // legacy advertising events (connectable sets)
+  uint32_t extended_events;   // extended advertising events
+  uint32_t periodic_events;   // periodic advertising events
+  uint32_t scan_windows;      // scan windows opened
+  uint32_t notifications;     // GATT notifications sent
+}sim_radio_stats_t;
+
+void sim_bt_boot(void);
+
+bool sim_bt_pop(sl_bt_msg_t *evt);
+
+uint8_t sim_bt_connect(uint8_t advertiser);
+
+void sim_bt_gatt_write(uint8_t connection, uint16_t attribute, const uint8_t *data, uint8_t len);
+
+bool sim_bt_gatt_read(uint16_t attribute, uint8_t *data, uint8_t *len);
+
+void sim_bt_set_pa_hook(sim_pa_hook_t hook);
+
+void sim_bt_set_notify_hook(sim_notify_hook_t hook);
+
+void sim_bt_radio_stats(sim_radio_stats_t *stats);
+
+
+// IMU fed from a recording (sim_imu.c)
+uint32_t sim_imu_load(const char *path, uint32_t period_ms, bool repeat);
+
+bool sim_imu_done(void);
+
+uint32_t sim_imu_reads(void);
+
+
+// Battery, RHT sensor and watchdog (sim_hal.c)
+void sim_adc_set(uint16_t raw);
+
+void sim_rht_set(uint32_t rh, int32_t t);
+
+bool sim_wdog_expired(uint64_t tick);
+
+
+// Main flash and bootloader storage slot 0 (sim_hal.c). The collar reboots
+// into the bootloader once sim_btl_installing() turns true.
+bool sim_flash_load(uint32_t address, const uint8_t *data, uint32_t len);
+
+const uint8_t *sim_btl_slot(void);
+
+bool sim_btl_installing(void);
+
+uint32_t sim_flash_erases(void);
+
+
+#endif /* SIM_H_ */
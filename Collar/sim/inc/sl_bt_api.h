@@ -0,0 +1,293 @@
+/*
+ * sl_bt_api.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: the part of the Bluetooth stack API used by the collar,
+ *  implemented by Collar/sim/src/sim_bt.c. Names, constants and argument
+ *  order follow the SDK so Collar/src builds unchanged.
+ */
+
+#ifndef SL_BT_API_H_
+#define SL_BT_API_H_
+
+
+#include "sl_common.h"
+#include "sl_status.h"
+
+
+typedef struct {
+  uint8_t addr[6];
+} bd_addr;
+
+typedef struct {
+  uint8_t len;
+  uint8_t data[255];
+} uint8array;
+
+
+// PHYs
+#define sl_bt_gap_phy_1m      0x1
+#define sl_bt_gap_phy_2m      0x2
+#define sl_bt_gap_phy_coded   0x4
+#define sl_bt_gap_phy_any     0xff
+
+// Advertising
+#define sl_bt_advertiser_non_discoverable         0x0
+#define sl_bt_advertiser_limited_discoverable     0x1
+#define sl_bt_advertiser_general_discoverable     0x2
+
+#define sl_bt_advertiser_advertising_data_packet  0x0
+#define sl_bt_advertiser_scan_response_packet     0x1
+
+#define sl_bt_legacy_advertiser_non_connectable   0x0
+#define sl_bt_legacy_advertiser_connectable       0x2
+#define sl_bt_legacy_advertiser_scannable         0x3
+
+#define sl_bt_extended_advertiser_non_connectable 0x0
+#define sl_bt_extended_advertiser_scannable       0x3
+#define sl_bt_extended_advertiser_connectable     0x4
+
+#define SL_BT_EXTENDED_ADVERTISER_ANONYMOUS_ADVERTISING           0x1
+#define SL_BT_EXTENDED_ADVERTISER_INCLUDE_TX_POWER                0x2
+#define SL_BT_PERIODIC_ADVERTISER_INCLUDE_TX_POWER                0x1
+#define SL_BT_PERIODIC_ADVERTISER_AUTO_START_EXTENDED_ADVERTISING 0x2
+
+// Scanner and sync
+#define sl_bt_scanner_scan_phy_1m             0x1
+#define sl_bt_scanner_scan_phy_coded          0x4
+#define sl_bt_scanner_scan_phy_1m_and_coded   0x5
+
+#define sl_bt_scanner_scan_mode_passive       0x0
+#define sl_bt_scanner_scan_mode_active        0x1
+
+#define sl_bt_scanner_discover_limited        0x0
+#define sl_bt_scanner_discover_generic        0x1
+#define sl_bt_scanner_discover_observation    0x2
+
+#define sl_bt_sync_report_none                0x0
+#define sl_bt_sync_report_all                 0x1
+
+// GATT server
+#define sl_bt_gatt_disable                    0x0
+#define sl_bt_gatt_notification               0x1
+#define sl_bt_gatt_indication                 0x2
+
+#define sl_bt_gatt_server_client_config       0x1
+#define sl_bt_gatt_server_confirmation        0x2
+
+
+// Events
+#define SL_BT_MSG_ID(HDR) ((HDR) & 0xffff00f8)
+
+#define sl_bt_evt_system_boot_id                           0x000100a0
+#define sl_bt_evt_system_external_signal_id                0x030100a0
+#define sl_bt_evt_connection_opened_id                     0x000600a0
+#define sl_bt_evt_connection_closed_id                     0x010600a0
+#define sl_bt_evt_gatt_server_attribute_value_id           0x000a00a0
+#define sl_bt_evt_gatt_server_characteristic_status_id     0x030a00a0
+#define sl_bt_evt_scanner_extended_advertisement_report_id 0x020500a0
+#define sl_bt_evt_sync_closed_id                           0x014200a0
+#define sl_bt_evt_pawr_sync_opened_id                      0x004e00a0
+#define sl_bt_evt_pawr_sync_subevent_report_id             0x014e00a0
+
+typedef struct {
+  uint16_t major;
+  uint16_t minor;
+  uint16_t patch;
+  uint16_t build;
+  uint32_t bootloader;
+  uint16_t hw;
+  uint32_t hash;
+} sl_bt_evt_system_boot_t;
+
+typedef struct {
+  uint32_t extsignals;
+} sl_bt_evt_system_external_signal_t;
+
+typedef struct {
+  bd_addr address;
+  uint8_t address_type;
+  uint8_t master;
+  uint8_t connection;
+  uint8_t bonding;
+  uint8_t advertiser;
+  uint16_t sync;
+} sl_bt_evt_connection_opened_t;
+
+typedef struct {
+  uint16_t reason;
+  uint8_t connection;
+} sl_bt_evt_connection_closed_t;
+
+typedef struct {
+  uint8_t connection;
+  uint16_t attribute;
+  uint8_t att_opcode;
+  uint16_t offset;
+  uint8array value;
+} sl_bt_evt_gatt_server_attribute_value_t;
+
+typedef struct {
+  uint8_t connection;
+  uint16_t characteristic;
+  uint8_t status_flags;
+  uint16_t client_config_flags;
+  uint16_t client_config;
+} sl_bt_evt_gatt_server_characteristic_status_t;
+
+typedef struct {
+  uint8_t event_flags;
+  bd_addr address;
+  uint8_t address_type;
+  bd_addr target_address;
+  uint8_t target_address_type;
+  uint8_t adv_sid;
+  uint8_t primary_phy;
+  uint8_t secondary_phy;
+  int8_t tx_power;
+  int8_t rssi;
+  uint8_t channel;
+  uint16_t periodic_interval;
+  uint8_t data_completeness;
+  uint8_t counter;
+  uint8array data;
+} sl_bt_evt_scanner_extended_advertisement_report_t;
+
+typedef struct {
+  uint16_t reason;
+  uint16_t sync;
+} sl_bt_evt_sync_closed_t;
+
+typedef struct {
+  uint16_t sync;
+  uint8_t adv_sid;
+  bd_addr address;
+  uint8_t address_type;
+  uint8_t adv_phy;
+  uint16_t adv_interval;
+  uint16_t clock_accuracy;
+  uint8_t num_subevents;
+  uint8_t subevent_interval;
+  uint8_t response_slot_delay;
+  uint8_t response_slot_spacing;
+  uint8_t bonding;
+} sl_bt_evt_pawr_sync_opened_t;
+
+typedef struct {
+  uint16_t sync;
+  int8_t tx_power;
+  int8_t rssi;
+  uint8_t cte_type;
+  uint16_t event_counter;
+  uint8_t subevent;
+  uint8_t data_status;
+  uint8array data;
+} sl_bt_evt_pawr_sync_subevent_report_t;
+
+typedef struct {
+  uint32_t header;
+  union {
+    uint8_t handle;
+    sl_bt_evt_system_boot_t evt_system_boot;
+    sl_bt_evt_system_external_signal_t evt_system_external_signal;
+    sl_bt_evt_connection_opened_t evt_connection_opened;
+    sl_bt_evt_connection_closed_t evt_connection_closed;
+    sl_bt_evt_gatt_server_attribute_value_t evt_gatt_server_attribute_value;
+    sl_bt_evt_gatt_server_characteristic_status_t evt_gatt_server_characteristic_status;
+    sl_bt_evt_scanner_extended_advertisement_report_t evt_scanner_extended_advertisement_report;
+    sl_bt_evt_sync_closed_t evt_sync_closed;
+    sl_bt_evt_pawr_sync_opened_t evt_pawr_sync_opened;
+    sl_bt_evt_pawr_sync_subevent_report_t evt_pawr_sync_subevent_report;
+    uint8_t payload[256];
+  } data;
+} sl_bt_msg_t;
+
+
+// Implemented by the application
+void sl_bt_on_event(sl_bt_msg_t *evt);
+
+
+// System
+void sl_bt_external_signal(uint32_t signals);
+
+sl_status_t sl_bt_system_data_buffer_write(size_t data_len, const uint8_t *data);
+
+sl_status_t sl_bt_system_data_buffer_clear(void);
+
+sl_status_t sl_bt_system_get_random_data(uint8_t length, size_t max_data_size, size_t *data_len, uint8_t *data);
+
+// Advertiser
+sl_status_t sl_bt_advertiser_create_set(uint8_t *handle);
+
+sl_status_t sl_bt_advertiser_set_timing(uint8_t advertising_set, uint32_t interval_min, uint32_t interval_max,
+                                        uint16_t duration, uint8_t maxevents);
+
+sl_status_t sl_bt_advertiser_set_tx_power(uint8_t advertising_set, int16_t power, int16_t *set_power);
+
+sl_status_t sl_bt_advertiser_stop(uint8_t advertising_set);
+
+sl_status_t sl_bt_legacy_advertiser_generate_data(uint8_t advertising_set, uint8_t discover);
+
+sl_status_t sl_bt_legacy_advertiser_set_data(uint8_t advertising_set, uint8_t type, size_t data_len, const uint8_t *data);
+
+sl_status_t sl_bt_legacy_advertiser_start(uint8_t advertising_set, uint8_t connect);
+
+sl_status_t sl_bt_extended_advertiser_set_phy(uint8_t advertising_set, uint8_t primary_phy, uint8_t secondary_phy);
+
+sl_status_t sl_bt_extended_advertiser_generate_data(uint8_t advertising_set, uint8_t discover);
+
+sl_status_t sl_bt_extended_advertiser_start(uint8_t advertising_set, uint8_t connect, uint32_t flags);
+
+sl_status_t sl_bt_periodic_advertiser_set_data(uint8_t advertising_set, size_t data_len, const uint8_t *data);
+
+sl_status_t sl_bt_periodic_advertiser_set_long_data(uint8_t advertising_set);
+
+sl_status_t sl_bt_periodic_advertiser_start(uint8_t advertising_set, uint16_t interval_min, uint16_t interval_max,
+                                            uint32_t flags);
+
+sl_status_t sl_bt_periodic_advertiser_stop(uint8_t advertising_set);
+
+// Connection
+sl_status_t sl_bt_connection_close(uint8_t connection);
+
+sl_status_t sl_bt_connection_set_preferred_phy(uint8_t connection, uint8_t preferred_phy, uint8_t accepted_phy);
+
+sl_status_t sl_bt_connection_set_data_length(uint8_t connection, uint16_t tx_data_len, uint16_t tx_time_us);
+
+sl_status_t sl_bt_connection_set_parameters(uint8_t connection, uint16_t min_interval, uint16_t max_interval,
+                                            uint16_t latency, uint16_t timeout, uint16_t min_ce_length,
+                                            uint16_t max_ce_length);
+
+// GATT server
+sl_status_t sl_bt_gatt_server_set_max_mtu(uint16_t max_mtu, uint16_t *max_mtu_out);
+
+sl_status_t sl_bt_gatt_server_read_attribute_value(uint16_t attribute, uint16_t offset, size_t max_value_size,
+                                                   size_t *value_len, uint8_t *value);
+
+sl_status_t sl_bt_gatt_server_write_attribute_value(uint16_t attribute, uint16_t offset, size_t value_len,
+                                                    const uint8_t *value);
+
+sl_status_t sl_bt_gatt_server_send_notification(uint8_t connection, uint16_t characteristic, size_t value_len,
+                                                const uint8_t *value);
+
+// Scanner, sync and PAwR
+sl_status_t sl_bt_scanner_set_parameters(uint8_t mode, uint16_t interval, uint16_t window);
+
+sl_status_t sl_bt_scanner_start(uint8_t scanning_phy, uint8_t discover_mode);
+
+sl_status_t sl_bt_scanner_stop(void);
+
+sl_status_t sl_bt_sync_scanner_set_sync_parameters(uint16_t skip, uint16_t timeout, uint32_t reporting_mode);
+
+sl_status_t sl_bt_sync_scanner_open(bd_addr address, uint8_t address_type, uint8_t adv_sid, uint16_t *sync);
+
+sl_status_t sl_bt_pawr_sync_set_sync_subevents(uint16_t sync, size_t subevents_len, const uint8_t *subevents);
+
+sl_status_t sl_bt_pawr_sync_set_response_data(uint16_t sync, uint16_t event_counter, uint8_t subevent,
+                                              uint8_t response_subevent, uint8_t response_slot,
+                                              size_t response_data_len, const uint8_t *response_data);
+
+
+#endif /* SL_BT_API_H_ */
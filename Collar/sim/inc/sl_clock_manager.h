@@ -0,0 +1,21 @@
+/*
+ * sl_clock_manager.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: bus clocks are always on.
+ */
+
+#ifndef SL_CLOCK_MANAGER_H_
+#define SL_CLOCK_MANAGER_H_
+
+
+#include "sl_status.h"
+#include "sl_device_clock.h"
+
+
+sl_status_t sl_clock_manager_enable_bus_clock(sl_bus_clock_t module_bus_clock);
+
+
+#endif /* SL_CLOCK_MANAGER_H_ */
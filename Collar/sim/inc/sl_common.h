@@ -0,0 +1,23 @@
+/*
+ * sl_common.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: common SDK definitions for a Linux build of the collar.
+ */
+
+#ifndef SL_COMMON_H_
+#define SL_COMMON_H_
+
+
+#include "stdint.h"
+#include "stddef.h"
+#include "stdbool.h"
+#include "string.h"
+
+
+#define SL_WEAK __attribute__((weak))
+
+
+#endif /* SL_COMMON_H_ */
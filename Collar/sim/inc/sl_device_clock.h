@@ -0,0 +1,23 @@
+/*
+ * sl_device_clock.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: bus clock identifiers used by the collar.
+ */
+
+#ifndef SL_DEVICE_CLOCK_H_
+#define SL_DEVICE_CLOCK_H_
+
+
+#include "stdint.h"
+
+
+typedef uint32_t sl_bus_clock_t;
+
+#define SL_BUS_CLOCK_IADC0  ((sl_bus_clock_t)1)
+#define SL_BUS_CLOCK_PRS    ((sl_bus_clock_t)2)
+
+
+#endif /* SL_DEVICE_CLOCK_H_ */
@@ -0,0 +1,44 @@
+/*
+ * sl_imu.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: IMU driver API fed from a recorded acceleration log
+ *  (Collar/sim/src/sim_imu.c).
+ */
+
+#ifndef SL_IMU_H_
+#define SL_IMU_H_
+
+
+#include "sl_common.h"
+#include "sl_status.h"
+
+
+#define IMU_STATE_DISABLED      0x00
+#define IMU_STATE_READY         0x01
+#define IMU_STATE_INITIALIZING  0x02
+#define IMU_STATE_CALIBRATING   0x03
+
+
+sl_status_t sl_imu_init(void);
+
+void sl_imu_deinit(void);
+
+uint8_t sl_imu_get_state(void);
+
+void sl_imu_configure(float sampleRate);
+
+bool sl_imu_is_data_ready(void);
+
+void sl_imu_update(void);
+
+void sl_imu_get_acceleration(int16_t avec[3]);
+
+void sl_imu_get_orientation(int16_t ovec[3]);
+
+sl_status_t sl_imu_calibrate_gyro(void);
+
+
+#endif /* SL_IMU_H_ */
@@ -0,0 +1,81 @@
+/*
+ * sl_sleeptimer.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: sleeptimer API on a virtual clock (Collar/sim/src/sim_sleeptimer.c).
+ *  Time only moves when the simulator advances it, so a run is repeatable and
+ *  as fast as the host allows.
+ */
+
+#ifndef SL_SLEEPTIMER_H_
+#define SL_SLEEPTIMER_H_
+
+
+#include "sl_common.h"
+#include "sl_status.h"
+
+
+typedef struct sl_sleeptimer_timer_handle sl_sleeptimer_timer_handle_t;
+
+typedef void (*sl_sleeptimer_timer_callback_t)(sl_sleeptimer_timer_handle_t *handle, void *data);
+
+struct sl_sleeptimer_timer_handle {
+  void *callback_data;
+  uint8_t priority;
+  uint16_t option_flags;
+  sl_sleeptimer_timer_handle_t *next;
+  sl_sleeptimer_timer_callback_t callback;
+  uint64_t expire;          // absolute tick of the next expiry
+  uint64_t start;           // periodic: tick the period is counted from
+  uint32_t period_ms;       // 0 for a one shot timer
+  uint32_t periods;         // periodic: expiries so far
+};
+
+// Calendar date; year counts from 1900 and month from 0 as in struct tm
+typedef struct time_date {
+  uint8_t sec;
+  uint8_t min;
+  uint8_t hour;
+  uint8_t month_day;
+  uint8_t month;
+  uint16_t year;
+  uint8_t day_of_week;
+  uint16_t day_of_year;
+  int32_t time_zone;
+} sl_sleeptimer_date_t;
+
+
+sl_status_t sl_sleeptimer_start_timer_ms(sl_sleeptimer_timer_handle_t *handle, uint32_t timeout_ms,
+                                         sl_sleeptimer_timer_callback_t callback, void *callback_data,
+                                         uint8_t priority, uint16_t option_flags);
+
+sl_status_t sl_sleeptimer_start_periodic_timer_ms(sl_sleeptimer_timer_handle_t *handle, uint32_t timeout_ms,
+                                                  sl_sleeptimer_timer_callback_t callback, void *callback_data,
+                                                  uint8_t priority, uint16_t option_flags);
+
+sl_status_t sl_sleeptimer_restart_periodic_timer_ms(sl_sleeptimer_timer_handle_t *handle, uint32_t timeout_ms,
+                                                    sl_sleeptimer_timer_callback_t callback, void *callback_data,
+                                                    uint8_t priority, uint16_t option_flags);
+
+sl_status_t sl_sleeptimer_stop_timer(sl_sleeptimer_timer_handle_t *handle);
+
+sl_status_t sl_sleeptimer_is_timer_running(sl_sleeptimer_timer_handle_t *handle, bool *running);
+
+void sl_sleeptimer_delay_millisecond(uint16_t time_ms);
+
+uint32_t sl_sleeptimer_get_tick_count(void);
+
+uint64_t sl_sleeptimer_get_tick_count64(void);
+
+uint32_t sl_sleeptimer_get_timer_frequency(void);
+
+sl_status_t sl_sleeptimer_set_datetime(sl_sleeptimer_date_t *date);
+
+sl_status_t sl_sleeptimer_get_datetime(sl_sleeptimer_date_t *date);
+
+sl_status_t sl_sleeptimer_convert_date_to_time(sl_sleeptimer_date_t *date, uint32_t *time);
+
+
+#endif /* SL_SLEEPTIMER_H_ */
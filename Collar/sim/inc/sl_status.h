@@ -0,0 +1,32 @@
+/*
+ * sl_status.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Simulator: the status codes of the Silicon Labs SDK used by the collar.
+ */
+
+#ifndef SL_STATUS_H_
+#define SL_STATUS_H_
+
+
+#include "stdint.h"
+
+
+typedef uint32_t sl_status_t;
+
+#define SL_STATUS_OK                  ((sl_status_t)0x0000)
+#define SL_STATUS_FAIL                ((sl_status_t)0x0001)
+#define SL_STATUS_INVALID_STATE       ((sl_status_t)0x0002)
+#define SL_STATUS_NOT_READY           ((sl_status_t)0x0003)
+#define SL_STATUS_BUSY                ((sl_status_t)0x0004)
+#define SL_STATUS_NOT_SUPPORTED       ((sl_status_t)0x000F)
+#define SL_STATUS_NOT_INITIALIZED     ((sl_status_t)0x0011)
+#define SL_STATUS_NO_MORE_RESOURCE    ((sl_status_t)0x0019)
+#define SL_STATUS_WOULD_OVERFLOW      ((sl_status_t)0x001C)
+#define SL_STATUS_INVALID_PARAMETER   ((sl_status_t)0x0021)
+#define SL_STATUS_INVALID_HANDLE      ((sl_status_t)0x0026)
+
+
+#endif /* SL_STATUS_H_ */
@@ -0,0 +1,709 @@
+/*
+ * sim_bt.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Bluetooth stack model for the collar simulator: event queue with merged
+ *  external signals, advertising sets, a GATT attribute store and the
+ *  scanner. Commands check the state the real stack checks, so a call the
+ *  controller would reject fails here too. Radio activity is counted per
+ *  advertising, periodic and scan event on the virtual clock.
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "sl_bt_api.h"
+#include "gatt_db.h"
+#include "sim.h"
+
+
+#define SIM_ADV_SETS        4
+#define SIM_CONNECTIONS     4
+#define SIM_EVENT_QUEUE     16
+#define SIM_ATTRIBUTE_MAX   255
+
+// Longest data of sl_bt_periodic_advertiser_set_data()
+#define SIM_PA_SHORT_MAX    254
+
+// Advertising interval units (us): 0.625 ms, periodic 1.25 ms
+#define ADV_UNIT_US         625
+#define PA_UNIT_US          1250
+
+// sl_bt_connection_close() reason: connection terminated by local host
+#define CLOSE_LOCAL_HOST    0x1016
+
+#define ADV_OFF             0
+#define ADV_LEGACY          1
+#define ADV_EXTENDED        2
+
+
+// Radio activity repeating every period_us while running
+typedef struct sim_activity{
+  bool running;
+  uint64_t period_us;
+  uint64_t next_us;         // virtual time of the next event
+  uint32_t events;
+}sim_activity_t;
+
+typedef struct sim_adv_set{
+  bool created;
+  uint8_t mode;             // ADV_OFF, ADV_LEGACY or ADV_EXTENDED
+  bool connectable;
+  uint32_t interval;        // units of 0.625 ms
+  int16_t tx_power;         // 0.1 dBm
+  uint8_t secondary_phy;
+  bool periodic;
+  uint16_t pa_interval;     // units of 1.25 ms
+  sim_activity_t legacy;
+  sim_activity_t extended;
+  sim_activity_t pa;
+}sim_adv_set_t;
+
+typedef struct sim_connection{
+  bool open;
+  uint8_t advertiser;
+}sim_connection_t;
+
+
+static sim_adv_set_t sets[SIM_ADV_SETS];
+static sim_connection_t connections[SIM_CONNECTIONS];
+
+static sl_bt_msg_t queue[SIM_EVENT_QUEUE];
+static uint8_t queue_head = 0;
+static uint8_t queue_count = 0;
+
+// Signals raised since the last external signal event, merged as by the stack
+static uint32_t pending_signals = 0;
+
+static uint8_t attributes[SIM_GATTDB_HANDLES][SIM_ATTRIBUTE_MAX];
+static uint8_t attribute_len[SIM_GATTDB_HANDLES];
+
+static uint8_t data_buffer[SIM_PA_DATA_MAX];
+static uint16_t data_buffer_len = 0;
+
+static bool scanning = false;
+static uint16_t scan_interval = 0x10;
+static sim_activity_t scan;
+
+static uint32_t notifications = 0;
+
+static sim_pa_hook_t pa_hook = NULL;
+static sim_notify_hook_t notify_hook = NULL;
+
+
+static uint64_t now_us(void)
+{
+  return (sim_now() * 1000000ULL) / SIM_TIMER_FREQUENCY;
+}
+
+static void activity_settle(sim_activity_t *a)
+{
+  uint64_t now = now_us();
+
+  if (a->running && (a->next_us <= now)) {
+    uint64_t n = (now - a->next_us) / a->period_us + 1;
+
+    a->events += (uint32_t)n;
+    a->next_us += n * a->period_us;
+  }
+}
+
+static void activity_start(sim_activity_t *a, uint64_t period_us)
+{
+  activity_settle(a);
+  a->running = true;
+  a->period_us = (period_us > 0) ? period_us : 1;
+  a->next_us = now_us();
+}
+
+static void activity_stop(sim_activity_t *a)
+{
+  activity_settle(a);
+  a->running = false;
+}
+
+static void adv_stop(sim_adv_set_t *set)
+{
+  set->mode = ADV_OFF;
+  activity_stop(&set->legacy);
+  activity_stop(&set->extended);
+}
+
+static void push_event(const sl_bt_msg_t *evt)
+{
+  if (queue_count == SIM_EVENT_QUEUE) {
+    fprintf(stderr, "sim: stack event queue overflow\n");
+    abort();
+  }
+  queue[(queue_head + queue_count) % SIM_EVENT_QUEUE] = *evt;
+  queue_count++;
+}
+
+static sim_adv_set_t *get_set(uint8_t handle)
+{
+  if ((handle >= SIM_ADV_SETS) || !sets[handle].created) {
+    return NULL;
+  }
+  return &sets[handle];
+}
+
+
+// ---------------------------------------------------------------------------
+// Simulator side
+
+void sim_bt_boot(void)
+{
+  sl_bt_msg_t evt;
+
+  memset(&evt, 0, sizeof(evt));
+  evt.header = sl_bt_evt_system_boot_id;
+  evt.data.evt_system_boot.major = 9;
+  push_event(&evt);
+}
+
+// Next stack event: queued events first, then the merged external signals
+bool sim_bt_pop(sl_bt_msg_t *evt)
+{
+  if (queue_count > 0) {
+    *evt = queue[queue_head];
+    queue_head = (queue_head + 1) % SIM_EVENT_QUEUE;
+    queue_count--;
+    return true;
+  }
+  if (pending_signals != 0) {
+    memset(evt, 0, sizeof(*evt));
+    evt->header = sl_bt_evt_system_external_signal_id;
+    evt->data.evt_system_external_signal.extsignals = pending_signals;
+    pending_signals = 0;
+    return true;
+  }
+  return false;
+}
+
+// A central connects to a connectable advertising set; 0xff if it is not
+// advertising connectable
+uint8_t sim_bt_connect(uint8_t advertiser)
+{
+  sim_adv_set_t *set = get_set(advertiser);
+  sl_bt_msg_t evt;
+
+  if ((set == NULL) || (set->mode == ADV_OFF) || !set->connectable) {
+    return 0xff;
+  }
+
+  for (uint8_t c = 0; c < SIM_CONNECTIONS; c++) {
+    if (!connections[c].open) {
+      connections[c].open = true;
+      connections[c].advertiser = advertiser;
+
+      // the set stops advertising when the connection opens
+      adv_stop(set);
+
+      memset(&evt, 0, sizeof(evt));
+      evt.header = sl_bt_evt_connection_opened_id;
+      evt.data.evt_connection_opened.connection = c + 1;
+      evt.data.evt_connection_opened.advertiser = advertiser;
+      evt.data.evt_connection_opened.sync = 0xffff;
+      push_event(&evt);
+      return c + 1;
+    }
+  }
+  return 0xff;
+}
+
+// The connected central writes a characteristic
+void sim_bt_gatt_write(uint8_t connection, uint16_t attribute, const uint8_t *data, uint8_t len)
+{
+  sl_bt_msg_t evt;
+
+  if (attribute >= SIM_GATTDB_HANDLES) {
+    return;
+  }
+  memcpy(attributes[attribute], data, len);
+  attribute_len[attribute] = len;
+
+  memset(&evt, 0, sizeof(evt));
+  evt.header = sl_bt_evt_gatt_server_attribute_value_id;
+  evt.data.evt_gatt_server_attribute_value.connection = connection;
+  evt.data.evt_gatt_server_attribute_value.attribute = attribute;
+  evt.data.evt_gatt_server_attribute_value.att_opcode = 0x52;  // write command
+  evt.data.evt_gatt_server_attribute_value.value.len = len;
+  memcpy(evt.data.evt_gatt_server_attribute_value.value.data, data, len);
+  push_event(&evt);
+}
+
+bool sim_bt_gatt_read(uint16_t attribute, uint8_t *data, uint8_t *len)
+{
+  if (attribute >= SIM_GATTDB_HANDLES) {
+    return false;
+  }
+  memcpy(data, attributes[attribute], attribute_len[attribute]);
+  *len = attribute_len[attribute];
+  return true;
+}
+
+void sim_bt_set_pa_hook(sim_pa_hook_t hook)
+{
+  pa_hook = hook;
+}
+
+void sim_bt_set_notify_hook(sim_notify_hook_t hook)
+{
+  notify_hook = hook;
+}
+
+void sim_bt_radio_stats(sim_radio_stats_t *stats)
+{
+  memset(stats, 0, sizeof(*stats));
+
+  for (uint8_t h = 0; h < SIM_ADV_SETS; h++) {
+    activity_settle(&sets[h].legacy);
+    activity_settle(&sets[h].extended);
+    activity_settle(&sets[h].pa);
+    stats->legacy_events += sets[h].legacy.events;
+    stats->extended_events += sets[h].extended.events;
+    stats->periodic_events += sets[h].pa.events;
+  }
+  activity_settle(&scan);
+  stats->scan_windows = scan.events;
+  stats->notifications = notifications;
+}
+
+
+// ---------------------------------------------------------------------------
+// System
+
+void sl_bt_external_signal(uint32_t signals)
+{
+  pending_signals |= signals;
+}
+
+sl_status_t sl_bt_system_data_buffer_write(size_t data_len, const uint8_t *data)
+{
+  if (data_buffer_len + data_len > sizeof(data_buffer)) {
+    return SL_STATUS_WOULD_OVERFLOW;
+  }
+  memcpy(&data_buffer[data_buffer_len], data, data_len);
+  data_buffer_len += (uint16_t)data_len;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_system_data_buffer_clear(void)
+{
+  data_buffer_len = 0;
+  return SL_STATUS_OK;
+}
+
+// The TRNG: differs on every run, as on every boot of the collar
+sl_status_t sl_bt_system_get_random_data(uint8_t length, size_t max_data_size, size_t *data_len, uint8_t *data)
+{
+  FILE *f;
+
+  if (length > max_data_size) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  f = fopen("/dev/urandom", "rb");
+  if ((f == NULL) || (fread(data, 1, length, f) != length)) {
+    for (uint8_t i = 0; i < length; i++) {
+      data[i] = (uint8_t)rand();
+    }
+  }
+  if (f != NULL) {
+    fclose(f);
+  }
+  *data_len = length;
+  return SL_STATUS_OK;
+}
+
+
+// ---------------------------------------------------------------------------
+// Advertiser
+
+sl_status_t sl_bt_advertiser_create_set(uint8_t *handle)
+{
+  for (uint8_t h = 0; h < SIM_ADV_SETS; h++) {
+    if (!sets[h].created) {
+      memset(&sets[h], 0, sizeof(sets[h]));
+      sets[h].created = true;
+      sets[h].interval = 160;   // 100 ms
+      *handle = h;
+      return SL_STATUS_OK;
+    }
+  }
+  return SL_STATUS_NO_MORE_RESOURCE;
+}
+
+sl_status_t sl_bt_advertiser_set_timing(uint8_t advertising_set, uint32_t interval_min, uint32_t interval_max,
+                                        uint16_t duration, uint8_t maxevents)
+{
+  sim_adv_set_t *set = get_set(advertising_set);
+
+  (void)duration;
+  (void)maxevents;
+  if (set == NULL) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  if ((interval_min < 0x20) || (interval_max < interval_min)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  set->interval = interval_min;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_advertiser_set_tx_power(uint8_t advertising_set, int16_t power, int16_t *set_power)
+{
+  sim_adv_set_t *set = get_set(advertising_set);
+
+  if (set == NULL) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  // applied from the next start
+  set->tx_power = power;
+  *set_power = power;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_advertiser_stop(uint8_t advertising_set)
+{
+  sim_adv_set_t *set = get_set(advertising_set);
+
+  if (set == NULL) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  adv_stop(set);
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_legacy_advertiser_generate_data(uint8_t advertising_set, uint8_t discover)
+{
+  (void)discover;
+  return (get_set(advertising_set) == NULL) ? SL_STATUS_INVALID_HANDLE : SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_legacy_advertiser_set_data(uint8_t advertising_set, uint8_t type, size_t data_len, const uint8_t *data)
+{
+  (void)type;
+  (void)data;
+  if (get_set(advertising_set) == NULL) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  return (data_len > 31) ? SL_STATUS_INVALID_PARAMETER : SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_legacy_advertiser_start(uint8_t advertising_set, uint8_t connect)
+{
+  sim_adv_set_t *set = get_set(advertising_set);
+
+  if (set == NULL) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  if (set->mode != ADV_OFF) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  set->mode = ADV_LEGACY;
+  set->connectable = (connect == sl_bt_legacy_advertiser_connectable);
+  activity_start(&set->legacy, (uint64_t)set->interval * ADV_UNIT_US);
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_extended_advertiser_set_phy(uint8_t advertising_set, uint8_t primary_phy, uint8_t secondary_phy)
+{
+  sim_adv_set_t *set = get_set(advertising_set);
+
+  (void)primary_phy;
+  if (set == NULL) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  // PHYs only change while the set is not advertising
+  if (set->mode != ADV_OFF) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  set->secondary_phy = secondary_phy;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_extended_advertiser_generate_data(uint8_t advertising_set, uint8_t discover)
+{
+  (void)discover;
+  return (get_set(advertising_set) == NULL) ? SL_STATUS_INVALID_HANDLE : SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_extended_advertiser_start(uint8_t advertising_set, uint8_t connect, uint32_t flags)
+{
+  sim_adv_set_t *set = get_set(advertising_set);
+
+  (void)flags;
+  if (set == NULL) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  if (set->mode != ADV_OFF) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  if (set->secondary_phy == 0) {
+    set->secondary_phy = sl_bt_gap_phy_1m;
+  }
+  set->mode = ADV_EXTENDED;
+  set->connectable = (connect == sl_bt_extended_advertiser_connectable);
+  activity_start(&set->extended, (uint64_t)set->interval * ADV_UNIT_US);
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_periodic_advertiser_set_data(uint8_t advertising_set, size_t data_len, const uint8_t *data)
+{
+  if (get_set(advertising_set) == NULL) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  if (data_len > SIM_PA_SHORT_MAX) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  if (pa_hook != NULL) {
+    pa_hook(data, (uint16_t)data_len);
+  }
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_periodic_advertiser_set_long_data(uint8_t advertising_set)
+{
+  if (get_set(advertising_set) == NULL) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  if (pa_hook != NULL) {
+    pa_hook(data_buffer, data_buffer_len);
+  }
+  data_buffer_len = 0;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_periodic_advertiser_start(uint8_t advertising_set, uint16_t interval_min, uint16_t interval_max,
+                                            uint32_t flags)
+{
+  sim_adv_set_t *set = get_set(advertising_set);
+
+  if (set == NULL) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  if (set->periodic) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  if ((interval_min < 0x06) || (interval_max < interval_min)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  if (set->mode == ADV_OFF) {
+    if (!(flags & SL_BT_PERIODIC_ADVERTISER_AUTO_START_EXTENDED_ADVERTISING)) {
+      return SL_STATUS_INVALID_STATE;
+    }
+    sl_bt_extended_advertiser_start(advertising_set, sl_bt_extended_advertiser_non_connectable, 0);
+  }
+  set->periodic = true;
+  set->pa_interval = interval_min;
+  activity_start(&set->pa, (uint64_t)interval_min * PA_UNIT_US);
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_periodic_advertiser_stop(uint8_t advertising_set)
+{
+  sim_adv_set_t *set = get_set(advertising_set);
+
+  if (set == NULL) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  if (!set->periodic) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  set->periodic = false;
+  activity_stop(&set->pa);
+  return SL_STATUS_OK;
+}
+
+
+// ---------------------------------------------------------------------------
+// Connection
+
+sl_status_t sl_bt_connection_close(uint8_t connection)
+{
+  sl_bt_msg_t evt;
+
+  if ((connection == 0) || (connection > SIM_CONNECTIONS) || !connections[connection - 1].open) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  connections[connection - 1].open = false;
+
+  memset(&evt, 0, sizeof(evt));
+  evt.header = sl_bt_evt_connection_closed_id;
+  evt.data.evt_connection_closed.reason = CLOSE_LOCAL_HOST;
+  evt.data.evt_connection_closed.connection = connection;
+  push_event(&evt);
+  return SL_STATUS_OK;
+}
+
+static sl_status_t connection_check(uint8_t connection)
+{
+  if ((connection == 0) || (connection > SIM_CONNECTIONS) || !connections[connection - 1].open) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_connection_set_preferred_phy(uint8_t connection, uint8_t preferred_phy, uint8_t accepted_phy)
+{
+  (void)preferred_phy;
+  (void)accepted_phy;
+  return connection_check(connection);
+}
+
+sl_status_t sl_bt_connection_set_data_length(uint8_t connection, uint16_t tx_data_len, uint16_t tx_time_us)
+{
+  (void)tx_data_len;
+  (void)tx_time_us;
+  return connection_check(connection);
+}
+
+sl_status_t sl_bt_connection_set_parameters(uint8_t connection, uint16_t min_interval, uint16_t max_interval,
+                                            uint16_t latency, uint16_t timeout, uint16_t min_ce_length,
+                                            uint16_t max_ce_length)
+{
+  (void)min_interval;
+  (void)max_interval;
+  (void)latency;
+  (void)timeout;
+  (void)min_ce_length;
+  (void)max_ce_length;
+  return connection_check(connection);
+}
+
+
+// ---------------------------------------------------------------------------
+// GATT server
+
+sl_status_t sl_bt_gatt_server_set_max_mtu(uint16_t max_mtu, uint16_t *max_mtu_out)
+{
+  *max_mtu_out = (max_mtu > 250) ? 250 : max_mtu;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_gatt_server_read_attribute_value(uint16_t attribute, uint16_t offset, size_t max_value_size,
+                                                   size_t *value_len, uint8_t *value)
+{
+  size_t len;
+
+  if (attribute >= SIM_GATTDB_HANDLES) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  if (offset > attribute_len[attribute]) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  len = attribute_len[attribute] - offset;
+  if (len > max_value_size) {
+    len = max_value_size;
+  }
+  memcpy(value, &attributes[attribute][offset], len);
+  *value_len = len;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_gatt_server_write_attribute_value(uint16_t attribute, uint16_t offset, size_t value_len,
+                                                    const uint8_t *value)
+{
+  if (attribute >= SIM_GATTDB_HANDLES) {
+    return SL_STATUS_INVALID_HANDLE;
+  }
+  if (offset + value_len > SIM_ATTRIBUTE_MAX) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  memcpy(&attributes[attribute][offset], value, value_len);
+  attribute_len[attribute] = (uint8_t)(offset + value_len);
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_gatt_server_send_notification(uint8_t connection, uint16_t characteristic, size_t value_len,
+                                                const uint8_t *value)
+{
+  sl_status_t sc = connection_check(connection);
+
+  if (sc == SL_STATUS_OK) {
+    notifications++;
+    if (notify_hook != NULL) {
+      notify_hook(connection, characteristic, value, (uint16_t)value_len);
+    }
+  }
+  return sc;
+}
+
+
+// ---------------------------------------------------------------------------
+// Scanner, sync and PAwR. No gateway is simulated: the collar keeps scanning.
+
+sl_status_t sl_bt_scanner_set_parameters(uint8_t mode, uint16_t interval, uint16_t window)
+{
+  (void)mode;
+  if (scanning) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  if ((window > interval) || (interval < 0x04)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  scan_interval = interval;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_scanner_start(uint8_t scanning_phy, uint8_t discover_mode)
+{
+  (void)scanning_phy;
+  (void)discover_mode;
+  if (scanning) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  scanning = true;
+  activity_start(&scan, (uint64_t)scan_interval * ADV_UNIT_US);
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_scanner_stop(void)
+{
+  if (!scanning) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  scanning = false;
+  activity_stop(&scan);
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_sync_scanner_set_sync_parameters(uint16_t skip, uint16_t timeout, uint32_t reporting_mode)
+{
+  (void)skip;
+  (void)timeout;
+  (void)reporting_mode;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_bt_sync_scanner_open(bd_addr address, uint8_t address_type, uint8_t adv_sid, uint16_t *sync)
+{
+  (void)address;
+  (void)address_type;
+  (void)adv_sid;
+  (void)sync;
+  return SL_STATUS_NOT_SUPPORTED;
+}
+
+sl_status_t sl_bt_pawr_sync_set_sync_subevents(uint16_t sync, size_t subevents_len, const uint8_t *subevents)
+{
+  (void)sync;
+  (void)subevents_len;
+  (void)subevents;
+  return SL_STATUS_INVALID_HANDLE;
+}
+
+sl_status_t sl_bt_pawr_sync_set_response_data(uint16_t sync, uint16_t event_counter, uint8_t subevent,
+                                              uint8_t response_subevent, uint8_t response_slot,
+                                              size_t response_data_len, const uint8_t *response_data)
+{
+  (void)sync;
+  (void)event_counter;
+  (void)subevent;
+  (void)response_subevent;
+  (void)response_slot;
+  (void)response_data_len;
+  (void)response_data;
+  return SL_STATUS_INVALID_HANDLE;
+}
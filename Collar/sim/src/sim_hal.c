@@ -0,0 +1,262 @@
+/*
+ * sim_hal.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Peripherals of the collar simulator: IADC battery reading, RHT sensor,
+ *  reset cause, clocks, the watchdog, main flash and the bootloader
+ *  storage slot.
+ */
+
+#include "em_iadc.h"
+#include "em_cmu.h"
+#include "em_rmu.h"
+#include "em_wdog.h"
+#include "sl_clock_manager.h"
+#include "em_device.h"
+#include "btl_interface.h"
+#include "cs_temp.h"
+#include "sim.h"
+
+
+// IADC reading of a 3.0 V supply (AVDD / 4 against the 1.21 V reference)
+#define SIM_ADC_DEFAULT   2538
+
+#define SIM_RH_DEFAULT    55000   // milli %RH
+#define SIM_T_DEFAULT     21000   // milli deg C
+
+// ULFRCO clocking the watchdog (Hz)
+#define ULFRCO_FREQUENCY  1000
+
+// Storage slot 0 of the in-place OTA DFU: the upper half of flash less NVM3
+#define SIM_SLOT_ADDRESS  0x00040000UL
+#define SIM_SLOT_LENGTH   0x0003A000UL
+
+
+IADC_TypeDef sim_iadc0;
+WDOG_TypeDef sim_wdog0;
+
+static uint16_t adc_raw = SIM_ADC_DEFAULT;
+static uint32_t rht_rh = SIM_RH_DEFAULT;
+static int32_t rht_t = SIM_T_DEFAULT;
+static bool rht_on = false;
+
+uint8_t sim_flash[FLASH_SIZE];
+
+static int32_t boot_slot = -1;
+static bool installing = false;
+static uint32_t page_erases = 0;
+
+
+void sim_adc_set(uint16_t raw)
+{
+  adc_raw = raw;
+}
+
+void sim_rht_set(uint32_t rh, int32_t t)
+{
+  rht_rh = rh;
+  rht_t = t;
+}
+
+// The watchdog bites before tick unless fed: the clock is moved to the
+// reset and true returned
+bool sim_wdog_expired(uint64_t tick)
+{
+  if (sim_wdog0.enabled && (tick > sim_wdog0.deadline)) {
+    sim_sleeptimer_run(sim_wdog0.deadline);
+    return true;
+  }
+  return false;
+}
+
+
+// IADC
+void IADC_init(IADC_TypeDef *iadc, const IADC_Init_t *init, const IADC_AllConfigs_t *allConfigs)
+{
+  (void)init;
+  (void)allConfigs;
+  iadc->CTRL = 1;
+}
+
+void IADC_initSingle(IADC_TypeDef *iadc, const IADC_InitSingle_t *init, const IADC_SingleInput_t *input)
+{
+  (void)iadc;
+  (void)init;
+  (void)input;
+}
+
+void IADC_reset(IADC_TypeDef *iadc)
+{
+  iadc->CTRL = _IADC_CTRL_RESETVALUE;
+  iadc->IF = 0;
+  iadc->IEN = 0;
+}
+
+void IADC_command(IADC_TypeDef *iadc, IADC_Cmd_t cmd)
+{
+  if (cmd == iadcCmdStartSingle) {
+    iadc->IF |= IADC_IF_SINGLEDONE;
+  }
+}
+
+uint32_t IADC_readSingleData(IADC_TypeDef *iadc)
+{
+  (void)iadc;
+  return adc_raw;
+}
+
+
+// RHT sensor
+sl_status_t sl_sensor_rht_init(void)
+{
+  rht_on = true;
+  return SL_STATUS_OK;
+}
+
+void sl_sensor_rht_deinit(void)
+{
+  rht_on = false;
+}
+
+sl_status_t sl_sensor_rht_get(uint32_t *rh, int32_t *t)
+{
+  if (!rht_on) {
+    return SL_STATUS_NOT_INITIALIZED;
+  }
+  *rh = rht_rh;
+  *t = rht_t;
+  return SL_STATUS_OK;
+}
+
+
+// Reset cause, clocks
+uint32_t RMU_ResetCauseGet(void)
+{
+  return EMU_RSTCAUSE_POR;
+}
+
+void RMU_ResetCauseClear(void)
+{
+}
+
+void CMU_ClockEnable(CMU_Clock_TypeDef clock, bool enable)
+{
+  (void)clock;
+  (void)enable;
+}
+
+void CMU_ClockSelectSet(CMU_Clock_TypeDef clock, CMU_Select_TypeDef ref)
+{
+  (void)clock;
+  (void)ref;
+}
+
+sl_status_t sl_clock_manager_enable_bus_clock(sl_bus_clock_t module_bus_clock)
+{
+  (void)module_bus_clock;
+  return SL_STATUS_OK;
+}
+
+
+// Watchdog
+void WDOGn_Init(WDOG_TypeDef *wdog, const WDOG_Init_TypeDef *init)
+{
+  wdog->enabled = init->enable && !init->resetDisable;
+  wdog->period_ms = (((1UL << (3 + init->perSel)) + 1) * 1000) / ULFRCO_FREQUENCY;
+  WDOGn_Feed(wdog);
+}
+
+void WDOGn_Feed(WDOG_TypeDef *wdog)
+{
+  wdog->deadline = sim_now() + sim_ms_to_tick(wdog->period_ms);
+}
+
+
+// Main flash and bootloader
+bool sim_flash_load(uint32_t address, const uint8_t *data, uint32_t len)
+{
+  if ((address - FLASH_BASE > FLASH_SIZE) || (len > FLASH_SIZE - (address - FLASH_BASE))) {
+    return false;
+  }
+  memcpy(&sim_flash[address - FLASH_BASE], data, len);
+  return true;
+}
+
+const uint8_t *sim_btl_slot(void)
+{
+  return &sim_flash[SIM_SLOT_ADDRESS - FLASH_BASE];
+}
+
+bool sim_btl_installing(void)
+{
+  return installing && (boot_slot == 0);
+}
+
+uint32_t sim_flash_erases(void)
+{
+  return page_erases;
+}
+
+int32_t bootloader_init(void)
+{
+  return BOOTLOADER_OK;
+}
+
+void bootloader_getInfo(BootloaderInformation_t *info)
+{
+  info->type = 1;
+  info->version = 0x02000000;
+  info->capabilities = BOOTLOADER_CAPABILITY_ENFORCE_UPGRADE_SIGNATURE;
+}
+
+int32_t bootloader_getStorageSlotInfo(uint32_t slotId, BootloaderStorageSlot_t *slot)
+{
+  if (slotId != 0) {
+    return BOOTLOADER_ERROR_STORAGE_INVALID_SLOT;
+  }
+  slot->address = SIM_SLOT_ADDRESS;
+  slot->length = SIM_SLOT_LENGTH;
+  return BOOTLOADER_OK;
+}
+
+// A page is erased when a write reaches its start; writing can only clear
+// bits, as on the device
+int32_t bootloader_eraseWriteStorage(uint32_t slotId, uint32_t offset, uint8_t *buffer, uint32_t length)
+{
+  uint8_t *slot = &sim_flash[SIM_SLOT_ADDRESS - FLASH_BASE];
+
+  if (slotId != 0) {
+    return BOOTLOADER_ERROR_STORAGE_INVALID_SLOT;
+  }
+  if ((offset > SIM_SLOT_LENGTH) || (length > SIM_SLOT_LENGTH - offset) || (offset % 4) || (length % 4)) {
+    return BOOTLOADER_ERROR_STORAGE_INVALID_ADDRESS;
+  }
+  for (uint32_t i = 0; i < length; i++) {
+    if (((offset + i) % FLASH_PAGE_SIZE) == 0) {
+      memset(&slot[offset + i], 0xFF, FLASH_PAGE_SIZE);
+      page_erases++;
+    }
+    slot[offset + i] &= buffer[i];
+  }
+  return BOOTLOADER_OK;
+}
+
+// There is no GBL parser here: the patch applier has checked the CRC
+int32_t bootloader_verifyImage(uint32_t slotId, BootloaderParserCallback_t callbackFunction)
+{
+  (void)callbackFunction;
+  return (slotId == 0) ? BOOTLOADER_OK : BOOTLOADER_ERROR_STORAGE_INVALID_SLOT;
+}
+
+int32_t bootloader_setImageToBootload(int32_t slotId)
+{
+  boot_slot = slotId;
+  return BOOTLOADER_OK;
+}
+
+void bootloader_rebootAndInstall(void)
+{
+  installing = true;
+}
@@ -0,0 +1,177 @@
+/*
+ * sim_imu.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  IMU driver fed from recorded acceleration. The recording is a host log
+ *  (ble_data_log.csv: 6 ID columns, x,y,z per sample, Counter, RSSI) taken
+ *  one sample per period_ms; a read returns the sample recorded at the
+ *  current virtual time, so a collar sampling slower skips samples as it
+ *  would on a cow. A repeated recording starts over at its end. New data is
+ *  ready once per output period of the rate set with sl_imu_configure().
+ *  The recording has no gyro: orientation is roll and pitch of the gravity
+ *  in the current sample, yaw 0.
+ */
+
+#include "stdio.h"
+#include "stdlib.h"
+#include "math.h"
+#include "sl_imu.h"
+#include "sim.h"
+
+
+#define LINE_MAX_LEN    4096
+#define ROW_MAX_VALUES  (6 + 3 * 255 + 2)
+
+
+static int16_t (*samples)[3] = NULL;
+static uint32_t n_samples = 0;
+static uint32_t sample_period_ms = 100;
+static bool repeat_samples = false;
+
+static uint8_t state = IMU_STATE_DISABLED;
+static float output_rate = 0;
+static uint64_t last_update = 0;
+static bool updated = false;
+static int16_t current[3];
+static uint32_t reads = 0;
+static bool done = false;
+
+
+// Append the samples of one log row; header and malformed rows are skipped
+static void load_row(char *line)
+{
+  static long values[ROW_MAX_VALUES];
+  int count = 0;
+  char *tok;
+
+  for (tok = strtok(line, ",\r\n"); tok && (count < ROW_MAX_VALUES); tok = strtok(NULL, ",\r\n")) {
+    char *end;
+    values[count] = strtol(tok, &end, 10);
+    if (end == tok) {
+      return;
+    }
+    count++;
+  }
+
+  // drop the ID columns and the trailing counter and RSSI
+  count -= 6 + 2;
+  if ((count <= 0) || (count % 3)) {
+    return;
+  }
+
+  samples = realloc(samples, (n_samples + count / 3) * sizeof(samples[0]));
+  if (samples == NULL) {
+    perror("sim_imu");
+    exit(EXIT_FAILURE);
+  }
+  for (int i = 0; i < count / 3; i++) {
+    for (int a = 0; a < 3; a++) {
+      samples[n_samples][a] = (int16_t)values[6 + i * 3 + a];
+    }
+    n_samples++;
+  }
+}
+
+// Load a recording taken every period_ms; returns the number of samples
+uint32_t sim_imu_load(const char *path, uint32_t period_ms, bool repeat)
+{
+  static char line[LINE_MAX_LEN];
+  FILE *f = fopen(path, "r");
+
+  if (f == NULL) {
+    perror(path);
+    return 0;
+  }
+  while (fgets(line, sizeof(line), f)) {
+    load_row(line);
+  }
+  fclose(f);
+
+  sample_period_ms = period_ms;
+  repeat_samples = repeat;
+  return n_samples;
+}
+
+// The collar has read past the end of the recording
+bool sim_imu_done(void)
+{
+  return done;
+}
+
+uint32_t sim_imu_reads(void)
+{
+  return reads;
+}
+
+
+sl_status_t sl_imu_init(void)
+{
+  if (n_samples == 0) {
+    return SL_STATUS_NOT_INITIALIZED;
+  }
+  state = IMU_STATE_READY;
+  return SL_STATUS_OK;
+}
+
+void sl_imu_deinit(void)
+{
+  state = IMU_STATE_DISABLED;
+}
+
+uint8_t sl_imu_get_state(void)
+{
+  return state;
+}
+
+void sl_imu_configure(float sampleRate)
+{
+  output_rate = sampleRate;
+}
+
+bool sl_imu_is_data_ready(void)
+{
+  if ((state != IMU_STATE_READY) || (output_rate <= 0)) {
+    return false;
+  }
+  return !updated || ((sim_now() - last_update) >= (uint64_t)(SIM_TIMER_FREQUENCY / output_rate));
+}
+
+void sl_imu_update(void)
+{
+  uint64_t index = (sim_now() * 1000) / ((uint64_t)sample_period_ms * SIM_TIMER_FREQUENCY);
+
+  if (repeat_samples) {
+    index %= n_samples;
+  } else if (index >= n_samples) {
+    done = true;
+    index = n_samples - 1;
+  }
+  memcpy(current, samples[index], sizeof(current));
+  last_update = sim_now();
+  updated = true;
+  reads++;
+}
+
+void sl_imu_get_acceleration(int16_t avec[3])
+{
+  memcpy(avec, current, sizeof(current));
+}
+
+// 0.01 deg, as the sensor fusion reports it
+void sl_imu_get_orientation(int16_t ovec[3])
+{
+  double x = current[0];
+  double y = current[1];
+  double z = current[2];
+
+  ovec[0] = (int16_t)lround(atan2(y, z) * 18000.0 / M_PI);
+  ovec[1] = (int16_t)lround(atan2(-x, sqrt(y * y + z * z)) * 18000.0 / M_PI);
+  ovec[2] = 0;
+}
+
+sl_status_t sl_imu_calibrate_gyro(void)
+{
+  return SL_STATUS_OK;
+}
@@ -0,0 +1,562 @@
+/*
+ * sim_main.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Runs the collar firmware (Collar/src) on Linux against the simulated
+ *  SDK. A host provisions the collar like C_Host does (date/time, cow ID and
+ *  optionally collar_config), the IMU plays back a recorded log and every
+ *  payload handed to the periodic advertiser is written out byte for byte.
+ *  At the end the run is summarised per window: wakeups, radio events and
+ *  the host CPU cycles spent in the firmware.
+ *
+ *  With -u the application image a patch was made against is loaded into
+ *  flash and, after provisioning, the host sends the patch over the bulk
+ *  connection as C_Host does. The run ends when the collar reboots into
+ *  the bootloader; the image in the storage slot is checked against the
+ *  patch header.
+ *
+ *  Build and run from the repository root:
+ *    gcc -O2 -ICollar/sim/inc -ICollar/inc -ICommon/inc \
+ *        Collar/sim/src/sim_main.c Collar/sim/src/sim_bt.c \
+ *        Collar/sim/src/sim_sleeptimer.c Collar/sim/src/sim_imu.c \
+ *        Collar/sim/src/sim_hal.c Collar/src/app.c Collar/src/cs_imu.c \
+ *        Collar/src/cs_adc.c Collar/src/cs_backlog.c Collar/src/cs_radio.c \
+ *        Collar/src/cs_ota.c Common/src/cs_payload.c Common/src/cs_crc16.c \
+ *        Common/src/cs_features.c Common/src/cs_classifier.c Common/src/cs_delta.c Common/src/cs_orient.c \
+ *        -lm -o collar_sim
+ *    ./collar_sim -i C_Host/ble_data_log.csv -o payloads.csv
+ *    ./collar_sim -i C_Host/ble_data_log.csv -r -t 600 -o /dev/null -u old.bin,update.patch
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "app.h"
+#include "gatt_db.h"
+#include "sl_sleeptimer.h"
+#include "sim.h"
+#include "cs_config.h"
+#include "cs_endian.h"
+#include "cs_payload.h"
+#include "cs_delta.h"
+
+
+#define USAGE "usage: %s -i <ble_data_log.csv> [-p <sample_ms>] [-r -t <seconds>] [-n <cow_id>]\n" \
+              "          [-c <imu_ms>,<window>,<env_s>,<pa_ms>,<k>[,<mode>[,<options>]]] [-o <payloads.csv>]\n" \
+              "          [-u <base image>,<patch>]\n"
+
+// Recorded sample period when not given (ms)
+#define DEFAULT_SAMPLE_MS   100
+
+// Host provisioning: connect after boot, then one write per step
+#define PROVISION_START_MS  500
+#define PROVISION_STEP_MS   100
+
+// Date and time written at provisioning: YY, MM, DD, hh, mm, ss
+#define PROVISION_DATE      { 26, 10, 19, 6, 0, 0 }
+
+// Delta update: the host connects to the bulk advertising set (the second
+// set the collar creates) once provisioning is over, then writes
+// OTA_WRITES_PER_STEP chunks every OTA_STEP_MS, about what a 2M PHY
+// connection carries, at most OTA_WINDOW bytes ahead of the progress
+// notified
+#define OTA_START_MS        5000
+#define OTA_STEP_MS         10
+#define OTA_WRITES_PER_STEP 4
+#define OTA_WINDOW          (4 * CS_DELTA_ACK_BYTES)
+#define OTA_CHUNK           (244 - CS_DELTA_DATA_HEADER_LEN)
+#define OTA_BULK_SET        1
+
+
+static FILE *out = NULL;
+
+static uint8_t cow_id = 1;
+static cs_config_t collar_config;
+static bool config_set = false;
+
+// Host side of the provisioning connection
+static sl_sleeptimer_timer_handle_t host_timer;
+static uint8_t host_step = 0;
+static uint8_t host_connection = 0xff;
+
+// Run statistics
+static uint32_t records = 0;
+static uint32_t windows = 0;
+static uint32_t payload_bytes = 0;
+static uint32_t bad_records = 0;
+static uint32_t wakeups = 0;
+static uint32_t events = 0;
+static unsigned long long cpu_cost = 0;
+
+// Host side of the delta update
+#define OTA_IDLE      0
+#define OTA_CONNECT   1
+#define OTA_SEND      2
+#define OTA_INSTALL   3
+#define OTA_END       4
+
+static uint8_t *ota_patch = NULL;
+static uint32_t ota_patch_len = 0;
+static cs_delta_header_t ota_header;
+static sl_sleeptimer_timer_handle_t ota_timer;
+static uint8_t ota_state = OTA_IDLE;
+static uint8_t ota_connection = 0xff;
+static uint32_t ota_sent = 0;
+static uint32_t ota_taken = 0;
+static uint8_t ota_code = CS_DELTA_OK;
+static uint32_t ota_writes = 0;
+static uint64_t ota_start = 0;
+static uint64_t ota_end = 0;
+static unsigned long long ota_cost = 0;
+
+
+static unsigned long long cpu_now(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+  return __rdtsc();
+#else
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+
+// Every payload the collar hands to its periodic advertiser
+static void on_payload(const uint8_t *data, uint16_t len)
+{
+  cs_window_t w;
+
+  fprintf(out, "%.3f,%u,", sim_tick_to_s(sim_now()), len);
+  for (uint16_t i = 0; i < len; i++) {
+    fprintf(out, "%02x", data[i]);
+  }
+  fprintf(out, "\n");
+
+  records++;
+  payload_bytes += len;
+
+  if (cs_payload_decode(data, len, &w) != CS_PAYLOAD_OK) {
+    bad_records++;
+    return;
+  }
+  switch (w.kind) {
+    case CS_KIND_SUMMARY:
+      windows += w.summary.windows;
+      break;
+
+    case CS_KIND_CLASS:
+      windows += w.n_labels;
+      break;
+
+    default:
+      windows++;
+      break;
+  }
+}
+
+
+// Provisioning as done by C_Host: connect, date/time, cow ID, configuration.
+// The collar closes the connection itself 2 s after the cow ID.
+static void host_callback(sl_sleeptimer_timer_handle_t *handle, void *data)
+{
+  static const uint8_t date_time[6] = PROVISION_DATE;
+
+  (void)handle;
+  (void)data;
+
+  switch (host_step++) {
+    case 0:
+      // the collar's first advertising set is the connectable one
+      host_connection = sim_bt_connect(0);
+      if (host_connection == 0xff) {
+        fprintf(stderr, "collar is not advertising connectable\n");
+        exit(EXIT_FAILURE);
+      }
+      break;
+
+    case 1:
+      sim_bt_gatt_write(host_connection, gattdb_date_time, date_time, sizeof(date_time));
+      break;
+
+    case 2:
+      sim_bt_gatt_write(host_connection, gattdb_cow_id, &cow_id, sizeof(cow_id));
+      break;
+
+    case 3:
+      if (config_set) {
+        uint8_t buffer[CS_CONFIG_LEN];
+        uint8_t len = cs_config_encode(&collar_config, buffer);
+
+        sim_bt_gatt_write(host_connection, gattdb_collar_config, buffer, len);
+      }
+      return;
+
+    default:
+      return;
+  }
+
+  sl_sleeptimer_start_timer_ms(&host_timer, PROVISION_STEP_MS, host_callback, NULL, 0, 0);
+}
+
+
+static uint8_t *read_file(const char *path, uint32_t *len)
+{
+  FILE *f = fopen(path, "rb");
+  uint8_t *data = NULL;
+  long size;
+
+  if (f == NULL) {
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  if (size > 0) {
+    data = malloc(size);
+  }
+  if ((data != NULL) && (fread(data, 1, size, f) != (size_t)size)) {
+    free(data);
+    data = NULL;
+  }
+  fclose(f);
+  *len = (uint32_t)size;
+  return data;
+}
+
+
+// Load the base image where the patch says it is and check the patch
+static bool ota_load(const char *arg)
+{
+  char base_path[256];
+  const char *comma = strchr(arg, ',');
+  uint8_t *base;
+  uint32_t base_len;
+
+  if ((comma == NULL) || ((size_t)(comma - arg) >= sizeof(base_path))) {
+    return false;
+  }
+  memcpy(base_path, arg, comma - arg);
+  base_path[comma - arg] = '\0';
+
+  ota_patch = read_file(comma + 1, &ota_patch_len);
+  base = read_file(base_path, &base_len);
+  if ((ota_patch == NULL) || (base == NULL)
+      || !cs_delta_header_decode(ota_patch, (uint16_t)((ota_patch_len > 0xFFFF) ? 0xFFFF : ota_patch_len), &ota_header)
+      || (ota_patch_len != CS_DELTA_HEADER_LEN + ota_header.body_len) || (base_len != ota_header.base_len)
+      || !sim_flash_load(ota_header.base_addr, base, base_len)) {
+    free(base);
+    return false;
+  }
+  free(base);
+  return true;
+}
+
+// Progress notified on ota_ctrl
+static void on_notify(uint8_t connection, uint16_t characteristic, const uint8_t *data, uint16_t len)
+{
+  if ((connection != ota_connection) || (characteristic != gattdb_ota_ctrl) || (len < CS_DELTA_STATUS_LEN)) {
+    return;
+  }
+  ota_code = data[0];
+  ota_taken = cs_get_le32(&data[1]);
+  if (ota_code == CS_DELTA_ERR_OFFSET) {
+    ota_sent = ota_taken;
+    ota_code = CS_DELTA_OK;
+  }
+}
+
+static void ota_callback(sl_sleeptimer_timer_handle_t *handle, void *data)
+{
+  uint8_t value[CS_DELTA_DATA_HEADER_LEN + OTA_CHUNK];
+
+  (void)handle;
+  (void)data;
+
+  if ((ota_code != CS_DELTA_OK) && (ota_code != CS_DELTA_DONE)) {
+    fprintf(stderr, "delta update failed, status %u at %u\n", ota_code, ota_taken);
+    ota_state = OTA_END;
+    return;
+  }
+
+  switch (ota_state) {
+    case OTA_CONNECT:
+      ota_connection = sim_bt_connect(OTA_BULK_SET);
+      if (ota_connection == 0xff) {
+        break;
+      }
+      ota_start = sim_now();
+      value[0] = CS_DELTA_CMD_BEGIN;
+      memcpy(&value[1], ota_patch, CS_DELTA_HEADER_LEN);
+      sim_bt_gatt_write(ota_connection, gattdb_ota_ctrl, value, 1 + CS_DELTA_HEADER_LEN);
+      ota_state = OTA_SEND;
+      break;
+
+    case OTA_SEND:
+      if (ota_code == CS_DELTA_DONE) {
+        value[0] = CS_DELTA_CMD_INSTALL;
+        sim_bt_gatt_write(ota_connection, gattdb_ota_ctrl, value, 1);
+        ota_state = OTA_INSTALL;
+        break;
+      }
+      for (int i = 0; (i < OTA_WRITES_PER_STEP) && (ota_sent < ota_header.body_len)
+           && (ota_sent - ota_taken < OTA_WINDOW); i++) {
+        uint32_t n = ota_header.body_len - ota_sent;
+
+        if (n > OTA_CHUNK) {
+          n = OTA_CHUNK;
+        }
+        cs_put_le32(value, ota_sent);
+        memcpy(&value[CS_DELTA_DATA_HEADER_LEN], &ota_patch[CS_DELTA_HEADER_LEN + ota_sent], n);
+        sim_bt_gatt_write(ota_connection, gattdb_ota_data, value, (uint8_t)(CS_DELTA_DATA_HEADER_LEN + n));
+        ota_sent += n;
+        ota_writes++;
+      }
+      break;
+
+    case OTA_INSTALL:
+      if (sim_btl_installing()) {
+        ota_end = sim_now();
+        ota_state = OTA_END;
+        return;
+      }
+      break;
+
+    default:
+      return;
+  }
+
+  sl_sleeptimer_start_timer_ms(&ota_timer, OTA_STEP_MS, ota_callback, NULL, 0, 0);
+}
+
+static void ota_report(void)
+{
+  uint32_t crc = cs_delta_crc32(CS_DELTA_CRC32_INIT, sim_btl_slot(), ota_header.new_len) ^ CS_DELTA_CRC32_INIT;
+  double s = sim_tick_to_s(ota_end - ota_start);
+
+  fprintf(stderr, "delta update: %u byte patch for a %u byte image (%.1f%%), %u writes in %.2f s, "
+                  "%u page erases\n",
+          ota_patch_len, ota_header.new_len, 100.0 * ota_patch_len / ota_header.new_len, ota_writes, s,
+          sim_flash_erases());
+#if defined(__x86_64__) || defined(__i386__)
+  fprintf(stderr, "firmware CPU during the update: %.0f host TSC cycles per image kB\n",
+          ota_cost / (ota_header.new_len / 1024.0));
+#endif
+  fprintf(stderr, "storage slot image CRC %08x, %s\n", crc, (crc == ota_header.new_crc) ? "ok" : "WRONG");
+}
+
+
+// Deliver every pending stack event to the application
+static void dispatch(void)
+{
+  sl_bt_msg_t evt;
+
+  while (sim_bt_pop(&evt)) {
+    unsigned long long start = cpu_now();
+
+    sl_bt_on_event(&evt);
+    app_process_action();
+
+    cpu_cost += cpu_now() - start;
+    if ((ota_state == OTA_SEND) || (ota_state == OTA_INSTALL)) {
+      ota_cost += cpu_now() - start;
+    }
+    events++;
+  }
+}
+
+static void print_characteristic(const char *name, uint16_t attribute)
+{
+  uint8_t value[255];
+  uint8_t len = 0;
+
+  sim_bt_gatt_read(attribute, value, &len);
+
+  fprintf(stderr, "%-14s", name);
+  for (uint8_t i = 0; i + 4 <= len; i += 4) {
+    fprintf(stderr, " %10u", (unsigned int)cs_get_le32(&value[i]));
+  }
+  fprintf(stderr, "\n");
+}
+
+static void report(void)
+{
+  sim_radio_stats_t radio;
+  double per = (windows > 0) ? (double)windows : 1.0;
+
+  sim_bt_radio_stats(&radio);
+
+  fprintf(stderr, "simulated %.1f s, %u IMU reads, %u records (%u bytes, %u undecodable), %u windows\n",
+          sim_tick_to_s(sim_now()), sim_imu_reads(), records, payload_bytes, bad_records, windows);
+  fprintf(stderr, "per window: %.2f wakeups, %.2f stack events, %.2f periodic events, %.2f extended adv events,\n"
+                  "            %.2f legacy adv events, %.2f scan windows\n",
+          wakeups / per, events / per, radio.periodic_events / per, radio.extended_events / per,
+          radio.legacy_events / per, radio.scan_windows / per);
+#if defined(__x86_64__) || defined(__i386__)
+  fprintf(stderr, "firmware CPU: %.0f host TSC cycles per window\n", cpu_cost / per);
+#else
+  fprintf(stderr, "firmware CPU: %.0f host ns per window\n", cpu_cost / per);
+#endif
+  print_characteristic("pa_metrics", gattdb_pa_metrics);
+  print_characteristic("adapt_metrics", gattdb_adapt_metrics);
+}
+
+
+int main(int argc, char *argv[])
+{
+  const char *input = NULL;
+  const char *output = NULL;
+  uint32_t sample_ms = DEFAULT_SAMPLE_MS;
+  double duration_s = 0;
+  bool repeat = false;
+  uint64_t end = UINT64_MAX;
+  int opt;
+
+  while ((opt = getopt(argc, argv, "i:p:rt:n:c:o:u:h")) != -1) {
+    switch (opt) {
+      case 'i':
+        input = optarg;
+        break;
+
+      case 'p':
+        sample_ms = (uint32_t)atoi(optarg);
+        break;
+
+      case 'r':
+        repeat = true;
+        break;
+
+      case 't':
+        duration_s = atof(optarg);
+        break;
+
+      case 'n':
+        cow_id = (uint8_t)atoi(optarg);
+        break;
+
+      case 'c':
+      {
+        unsigned int imu_ms, window, env_s, pa_ms, k, mode = CS_MODE_RAW, options = 0;
+
+        if (sscanf(optarg, "%u,%u,%u,%u,%u,%u,%u", &imu_ms, &window, &env_s, &pa_ms, &k, &mode, &options) < 5
+            || imu_ms > 0xFFFF || window > 0xFF || env_s > 0xFFFF || pa_ms > 0xFFFF || k > 0xFF || mode > 0xFF
+            || options > 0xFF) {
+          fprintf(stderr, USAGE, argv[0]);
+          return EXIT_FAILURE;
+        }
+        collar_config.imu_period_ms = (uint16_t)imu_ms;
+        collar_config.window_samples = (uint8_t)window;
+        collar_config.env_period_s = (uint16_t)env_s;
+        collar_config.pa_interval_ms = (uint16_t)pa_ms;
+        collar_config.pa_redundancy = (uint8_t)k;
+        collar_config.mode = (uint8_t)mode;
+        collar_config.options = (uint8_t)options;
+
+        if (!cs_config_valid(&collar_config)) {
+          fprintf(stderr, "invalid collar configuration: %s\n", optarg);
+          return EXIT_FAILURE;
+        }
+        config_set = true;
+        break;
+      }
+
+      case 'o':
+        output = optarg;
+        break;
+
+      case 'u':
+        if (!ota_load(optarg)) {
+          fprintf(stderr, "%s: not a base image and a patch for it\n", optarg);
+          return EXIT_FAILURE;
+        }
+        ota_state = OTA_CONNECT;
+        break;
+
+      default:
+        fprintf(stderr, USAGE, argv[0]);
+        return (opt == 'h') ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
+  }
+
+  // a repeated recording never ends by itself
+  if ((input == NULL) || (sample_ms == 0) || (repeat && (duration_s <= 0))) {
+    fprintf(stderr, USAGE, argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (sim_imu_load(input, sample_ms, repeat) == 0) {
+    fprintf(stderr, "no samples in %s\n", input);
+    return EXIT_FAILURE;
+  }
+  if (duration_s > 0) {
+    end = sim_ms_to_tick((uint64_t)(duration_s * 1000));
+  }
+
+  out = stdout;
+  if (output != NULL) {
+    out = fopen(output, "w");
+    if (out == NULL) {
+      perror(output);
+      return EXIT_FAILURE;
+    }
+  }
+  fprintf(out, "Time_s,Len,Payload\n");
+  sim_bt_set_pa_hook(on_payload);
+
+  // main.c: system init, app_init(), then the stack boots
+  app_init();
+  sim_bt_boot();
+  sl_sleeptimer_start_timer_ms(&host_timer, PROVISION_START_MS, host_callback, NULL, 0, 0);
+  if (ota_state == OTA_CONNECT) {
+    sim_bt_set_notify_hook(on_notify);
+    sl_sleeptimer_start_timer_ms(&ota_timer, OTA_START_MS, ota_callback, NULL, 0, 0);
+  }
+
+  while (1) {
+    uint64_t tick;
+    unsigned long long start;
+
+    dispatch();
+
+    if (sim_imu_done() || (sim_now() >= end) || (ota_state == OTA_END) || !sim_sleeptimer_next(&tick)) {
+      break;
+    }
+    if (tick > end) {
+      tick = end;
+    }
+
+    // sleep until the next timer; the watchdog must be fed before then
+    if (sim_wdog_expired(tick)) {
+      fprintf(stderr, "watchdog reset at %.3f s\n", sim_tick_to_s(sim_now()));
+      report();
+      return EXIT_FAILURE;
+    }
+
+    start = cpu_now();
+    sim_sleeptimer_run(tick);
+    cpu_cost += cpu_now() - start;
+    wakeups++;
+  }
+
+  if (out != stdout) {
+    fclose(out);
+  }
+  report();
+  if (ota_patch != NULL) {
+    if (ota_end == 0) {
+      fprintf(stderr, "delta update not installed, %u of %u patch bytes taken\n", ota_taken, ota_header.body_len);
+      return EXIT_FAILURE;
+    }
+    ota_report();
+  }
+
+  return (bad_records == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,283 @@
+/*
+ * sim_sleeptimer.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Sleeptimer on a virtual clock. Timers due on the same tick all fire
+ *  before the stack runs again, as they would from one RTC interrupt.
+ *  Periodic timers keep their phase (no drift from the ms to tick rounding)
+ *  like the SDK's drift corrected periodic timers.
+ */
+
+#include "sl_sleeptimer.h"
+#include "sim.h"
+
+
+#define SECONDS_PER_DAY   86400UL
+
+// sl_sleeptimer_date_t counts years from 1900; the calendar starts at 1970
+#define DATE_YEAR_BASE    1900
+#define DATE_YEAR_MIN     70
+
+
+static uint64_t now_tick = 0;
+
+// Running timers, unsorted: the collar never has more than a handful
+static sl_sleeptimer_timer_handle_t *timers = NULL;
+
+// Calendar: seconds since 1970 at date_tick
+static uint32_t date_seconds = 0;
+static uint64_t date_tick = 0;
+
+
+uint64_t sim_now(void)
+{
+  return now_tick;
+}
+
+uint64_t sim_ms_to_tick(uint64_t ms)
+{
+  return (ms * SIM_TIMER_FREQUENCY) / 1000;
+}
+
+double sim_tick_to_s(uint64_t tick)
+{
+  return (double)tick / SIM_TIMER_FREQUENCY;
+}
+
+
+static bool timer_running(const sl_sleeptimer_timer_handle_t *handle)
+{
+  for (const sl_sleeptimer_timer_handle_t *t = timers; t != NULL; t = t->next) {
+    if (t == handle) {
+      return true;
+    }
+  }
+  return false;
+}
+
+static void timer_remove(sl_sleeptimer_timer_handle_t *handle)
+{
+  sl_sleeptimer_timer_handle_t **link = &timers;
+
+  while (*link != NULL) {
+    if (*link == handle) {
+      *link = handle->next;
+      handle->next = NULL;
+      return;
+    }
+    link = &(*link)->next;
+  }
+}
+
+static sl_status_t timer_start(sl_sleeptimer_timer_handle_t *handle, uint32_t timeout_ms, bool periodic,
+                               sl_sleeptimer_timer_callback_t callback, void *callback_data,
+                               uint8_t priority, uint16_t option_flags)
+{
+  if ((handle == NULL) || (periodic && (sim_ms_to_tick(timeout_ms) == 0))) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+  if (timer_running(handle)) {
+    return SL_STATUS_NOT_READY;
+  }
+
+  handle->callback = callback;
+  handle->callback_data = callback_data;
+  handle->priority = priority;
+  handle->option_flags = option_flags;
+  handle->start = now_tick;
+  handle->period_ms = periodic ? timeout_ms : 0;
+  handle->periods = periodic ? 1 : 0;
+  handle->expire = now_tick + sim_ms_to_tick(timeout_ms);
+
+  handle->next = timers;
+  timers = handle;
+
+  return SL_STATUS_OK;
+}
+
+
+sl_status_t sl_sleeptimer_start_timer_ms(sl_sleeptimer_timer_handle_t *handle, uint32_t timeout_ms,
+                                         sl_sleeptimer_timer_callback_t callback, void *callback_data,
+                                         uint8_t priority, uint16_t option_flags)
+{
+  return timer_start(handle, timeout_ms, false, callback, callback_data, priority, option_flags);
+}
+
+sl_status_t sl_sleeptimer_start_periodic_timer_ms(sl_sleeptimer_timer_handle_t *handle, uint32_t timeout_ms,
+                                                  sl_sleeptimer_timer_callback_t callback, void *callback_data,
+                                                  uint8_t priority, uint16_t option_flags)
+{
+  return timer_start(handle, timeout_ms, true, callback, callback_data, priority, option_flags);
+}
+
+sl_status_t sl_sleeptimer_restart_periodic_timer_ms(sl_sleeptimer_timer_handle_t *handle, uint32_t timeout_ms,
+                                                    sl_sleeptimer_timer_callback_t callback, void *callback_data,
+                                                    uint8_t priority, uint16_t option_flags)
+{
+  timer_remove(handle);
+  return timer_start(handle, timeout_ms, true, callback, callback_data, priority, option_flags);
+}
+
+sl_status_t sl_sleeptimer_stop_timer(sl_sleeptimer_timer_handle_t *handle)
+{
+  if (!timer_running(handle)) {
+    return SL_STATUS_INVALID_STATE;
+  }
+  timer_remove(handle);
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_sleeptimer_is_timer_running(sl_sleeptimer_timer_handle_t *handle, bool *running)
+{
+  *running = timer_running(handle);
+  return SL_STATUS_OK;
+}
+
+
+// Earliest expiry of the running timers
+bool sim_sleeptimer_next(uint64_t *tick)
+{
+  bool found = false;
+
+  for (const sl_sleeptimer_timer_handle_t *t = timers; t != NULL; t = t->next) {
+    if (!found || (t->expire < *tick)) {
+      *tick = t->expire;
+      found = true;
+    }
+  }
+  return found;
+}
+
+// Move the clock to tick, firing every timer that expires on the way
+void sim_sleeptimer_run(uint64_t tick)
+{
+  uint64_t expire;
+
+  while (sim_sleeptimer_next(&expire) && (expire <= tick)) {
+    sl_sleeptimer_timer_handle_t *t;
+
+    for (t = timers; t->expire != expire; t = t->next) {
+    }
+
+    if (expire > now_tick) {
+      now_tick = expire;
+    }
+
+    if (t->period_ms != 0) {
+      t->periods++;
+      t->expire = t->start + sim_ms_to_tick((uint64_t)t->period_ms * t->periods);
+    } else {
+      timer_remove(t);
+    }
+
+    // the callback may restart or stop any timer, this one included
+    t->callback(t, t->callback_data);
+  }
+
+  if (tick > now_tick) {
+    now_tick = tick;
+  }
+}
+
+
+void sl_sleeptimer_delay_millisecond(uint16_t time_ms)
+{
+  sim_sleeptimer_run(now_tick + sim_ms_to_tick(time_ms));
+}
+
+uint32_t sl_sleeptimer_get_tick_count(void)
+{
+  return (uint32_t)now_tick;
+}
+
+uint64_t sl_sleeptimer_get_tick_count64(void)
+{
+  return now_tick;
+}
+
+uint32_t sl_sleeptimer_get_timer_frequency(void)
+{
+  return SIM_TIMER_FREQUENCY;
+}
+
+
+static bool is_leap(uint32_t year)
+{
+  return ((year % 4) == 0) && (((year % 100) != 0) || ((year % 400) == 0));
+}
+
+static uint8_t days_in_month(uint32_t year, uint8_t month)
+{
+  static const uint8_t days[12] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+
+  return ((month == 1) && is_leap(year)) ? 29 : days[month];
+}
+
+sl_status_t sl_sleeptimer_convert_date_to_time(sl_sleeptimer_date_t *date, uint32_t *time)
+{
+  uint32_t year = DATE_YEAR_BASE + date->year;
+  uint32_t days = 0;
+
+  if ((date->year < DATE_YEAR_MIN) || (date->month > 11)
+      || (date->month_day == 0) || (date->month_day > days_in_month(year, date->month))
+      || (date->hour > 23) || (date->min > 59) || (date->sec > 59)) {
+    return SL_STATUS_INVALID_PARAMETER;
+  }
+
+  for (uint32_t y = DATE_YEAR_BASE + DATE_YEAR_MIN; y < year; y++) {
+    days += is_leap(y) ? 366 : 365;
+  }
+  for (uint8_t m = 0; m < date->month; m++) {
+    days += days_in_month(year, m);
+  }
+  days += date->month_day - 1;
+
+  *time = days * SECONDS_PER_DAY + date->hour * 3600UL + date->min * 60UL + date->sec - date->time_zone;
+  return SL_STATUS_OK;
+}
+
+sl_status_t sl_sleeptimer_set_datetime(sl_sleeptimer_date_t *date)
+{
+  uint32_t time;
+  sl_status_t sc = sl_sleeptimer_convert_date_to_time(date, &time);
+
+  if (sc == SL_STATUS_OK) {
+    date_seconds = time;
+    date_tick = now_tick;
+  }
+  return sc;
+}
+
+sl_status_t sl_sleeptimer_get_datetime(sl_sleeptimer_date_t *date)
+{
+  uint32_t time = date_seconds + (uint32_t)((now_tick - date_tick) / SIM_TIMER_FREQUENCY);
+  uint32_t days = time / SECONDS_PER_DAY;
+  uint32_t secs = time % SECONDS_PER_DAY;
+  uint32_t year = DATE_YEAR_BASE + DATE_YEAR_MIN;
+  uint8_t month = 0;
+
+  date->hour = (uint8_t)(secs / 3600);
+  date->min = (uint8_t)((secs / 60) % 60);
+  date->sec = (uint8_t)(secs % 60);
+  // 1 Jan 1970 was a Thursday
+  date->day_of_week = (uint8_t)((days + 4) % 7);
+
+  while (days >= (is_leap(year) ? 366U : 365U)) {
+    days -= is_leap(year) ? 366 : 365;
+    year++;
+  }
+  date->year = (uint16_t)(year - DATE_YEAR_BASE);
+  date->day_of_year = (uint16_t)(days + 1);
+
+  while (days >= days_in_month(year, month)) {
+    days -= days_in_month(year, month);
+    month++;
+  }
+  date->month = month;
+  date->month_day = (uint8_t)(days + 1);
+  date->time_zone = 0;
+
+  return SL_STATUS_OK;
+}
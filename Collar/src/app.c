@@ -42,15 +42,29 @@
 #include "cs_imu.h"
 #include "cs_temp.h"
 #include "cs_adc.h"
+#include "cs_backlog.h"
+#include "cs_radio.h"
+#include "cs_endian.h"
+#include "cs_pawr.h"
+#include "cs_payload.h"
+#include "cs_config.h"
+#include "cs_features.h"
+#include "cs_classifier.h"
+#include "cs_link.h"
+#include "cs_ota.h"
 
 #include "em_rmu.h"
 #include "em_wdog.h"
 #include "em_cmu.h"
 
 
-#define SAMPLE_IMU  1
-#define SAMPLE_TEMP 2
-#define CLOSE_CONNECTION  3
+// External signals, one bit each: signals raised before the stack delivers
+// the event arrive together
+#define SAMPLE_IMU  0x01
+#define SAMPLE_TEMP 0x02
+#define CLOSE_CONNECTION  0x04
+#define BULK_PUMP   0x08
+#define OTA_INSTALL 0x10
 
 
 // Legacy adv interval milliseconds*1.6
@@ -59,23 +73,89 @@
 // Extended adv interval milliseconds*16
 #define EXTENDED_ADV_INT 1000 * 1.6
 
-// periodic adv interval milliseconds*0.8
-#define PERIODIC_ADV_INT 1000 * 0.8
+// Defaults of the runtime configuration (collar_config characteristic)
 
-// > 10 Hz as the imu is sampled every 100 ms
-#define IMU_SAMPLE_RATE 15.0f //Hz
-
-// IMU sample time in ms
+// IMU sample time in ms, the IMU itself runs at 1.5x this rate (15 Hz)
 #define IMU_SAMPLE_TIME  100
 
+// IMU samples per advertised window
+#define WINDOW_SAMPLES  30
+
+// Default number of periodic PDUs carrying each window
+#define PA_REDUNDANCY 1
+
+// Default data mode: raw windows, per minute activity summaries or
+// behaviour labels
+#define DATA_MODE CS_MODE_RAW
+
+// Default options (CS_OPT_*): CS_OPT_ORIENT adds the fused orientation to
+// every record
+#define DATA_OPTIONS 0
+
+// Secondary PHY and TX power of extended and periodic advertising follow the
+// link level set by the gateway (cs_link.h). A cheaper level is taken at most
+// once per LINK_DWELL_WINDOWS published windows, a more robust one at once.
+#define LINK_DWELL_WINDOWS  10
+
 // RTH and batter voltage sampling
 #define RTH_BAT_SAMPLE_TIME 30000
 
+// Bulk transfer (connectable legacy) adv interval milliseconds*1.6
+#define BULK_ADV_INT 5000 * 1.6
+
+// Retry time in ms when the stack is out of notification buffers
+#define BULK_PUMP_TIME 10
+
+// Bulk notification: 4 byte little endian window sequence number + window.
+// A window longer than one notification (MTU 247) is split; every fragment
+// but the last has BULK_SEQ_MORE set in the sequence number.
+#define BULK_HEADER_LEN   4
+#define BULK_FRAGMENT_MAX 240
+#define BULK_SEQ_MORE     0x80000000UL
+
+// Longest data accepted by sl_bt_periodic_advertiser_set_data(); longer
+// payloads go through the system data buffer in chunks of PA_DATA_CHUNK
+#define PA_SHORT_DATA_MAX 254
+#define PA_DATA_CHUNK     255
+
+// Time in ms from the install command to the reboot, so the status
+// notification gets out first
+#define OTA_INSTALL_DELAY 500
+
+// Silicon Labs company ID used in the bulk manufacturer data
+#define BULK_COMPANY_ID 0x02FF
+
+// Motion adaptive sampling: after ADAPT_STILL_WINDOWS windows with an ODBA
+// below ADAPT_STILL_ODBA the sample period is multiplied by 1 << ADAPT_RATE_SHIFT.
+// A sample to sample change above ADAPT_WAKE_DELTA (mg, summed over the axes)
+// closes the low rate window early and restores the full rate.
+#define ADAPT_SAMPLING          1
+#define ADAPT_RATE_SHIFT        2
+#define ADAPT_STILL_ODBA        15
+#define ADAPT_STILL_WINDOWS     3
+#define ADAPT_WAKE_DELTA        60
+
+// Estimated IMU conversion, I2C read and MCU wake energy per sample (uJ)
+#define ADAPT_SAMPLE_ENERGY_UJ  25
+
+// Longest low rate sample period: the sample timer feeds the 2 s watchdog
+#define ADAPT_PERIOD_MAX_MS     1500
+
+// Low duty cycle scan for the gateway PAwR train (units of 0.625 ms)
+#define PAWR_SCAN_INTERVAL  2048  // 1.28 s
+#define PAWR_SCAN_WINDOW    48    // 30 ms
+
+// PAwR sync timeout (units of 10 ms): about 3 missed events
+#define PAWR_SYNC_TIMEOUT   1000
+
 
 
 // acceleration vector from IMU
 int16_t avec[3];
 
+// fused orientation from IMU, 0.01 deg, read with CS_OPT_ORIENT
+int16_t ovec[3];
+
 // temp and himidity data
 uint32_t relh;
 int32_t temp;
@@ -90,14 +170,52 @@ sl_sleeptimer_date_t date_time;
 uint8_t cow_id;
 
 
+// Active configuration, applied live when the host writes collar_config
+cs_config_t config = {
+  .imu_period_ms = IMU_SAMPLE_TIME,
+  .window_samples = WINDOW_SAMPLES,
+  .env_period_s = RTH_BAT_SAMPLE_TIME / 1000,
+  .pa_interval_ms = 0,
+  .pa_redundancy = PA_REDUNDANCY,
+  .mode = DATA_MODE,
+  .options = DATA_OPTIONS,
+};
+
+// IMU / RHT timers are running
+bool sampling_started = false;
+
+radio_pa_metrics_t pa_metrics;
+
+// Link level in use and windows left before a cheaper one may be applied
+uint8_t link_level = CS_LINK_LEVEL_DEFAULT;
+uint8_t link_dwell = 0;
+radio_link_metrics_t link_metrics;
+
+// Summary mode: feature sums of the windows since the last summary
+cs_features_acc_t features;
+
+// Motion adaptive sampling state and counters (adapt_metrics characteristic)
+uint8_t rate_shift = 0;
+uint8_t still_windows = 0;
+bool motion_wake = false;
+int16_t last_avec[3];
+uint32_t low_rate_windows = 0;
+uint32_t skipped_samples = 0;
+
+
 //Fist sample Boolean
 bool first_sample = true;
 
 
-// IMU buffer variables
-uint8_t imu_buffer[186];
+// IMU window being collected and its encoded payload
+cs_window_t window;
 uint8_t imu_index = 0;
-uint8_t imu_offset = 0;
+uint8_t window_limit = WINDOW_SAMPLES;
+uint8_t payload[CS_PAYLOAD_MAX_LEN];
+uint16_t payload_len = 0;
+
+// Changes on every boot so the host can tell a reset from lost windows
+uint8_t session_id = 0;
 
 
 // Cow tag struct
@@ -136,6 +254,38 @@ static uint8_t advertising_set_handle = 0xff;
 uint8_t connection_handle = 0xff;
 
 
+// Bulk transfer service state
+static uint8_t bulk_set_handle = 0xff;
+uint8_t bulk_connection = 0xff;
+bool bulk_notify = false;
+bool bulk_started = false;
+uint32_t bulk_seq = 0;
+uint16_t bulk_offset = 0;
+uint8_t bulk_packet[BULK_HEADER_LEN + BULK_FRAGMENT_MAX];
+
+sl_sleeptimer_timer_handle_t bulk_pump_handle;
+
+void bulk_pump_callback(sl_sleeptimer_timer_handle_t *handle, void *data);
+
+// Delta firmware update over the bulk connection (cs_ota.h)
+sl_sleeptimer_timer_handle_t ota_install_handle;
+
+void ota_install_callback(sl_sleeptimer_timer_handle_t *handle, void *data);
+
+
+// PAwR control channel state
+uint16_t pawr_sync_handle = 0xffff;
+bool pawr_scanning = false;
+
+static const uint8_t gateway_uuid[16] = CS_PAWR_GATEWAY_UUID;
+
+// Bulk service UUID ea9f6097-7d60-48b6-a840-cda6813ef401 (little-endian)
+static const uint8_t bulk_service_uuid[16] = {
+  0x01, 0xf4, 0x3e, 0x81, 0xa6, 0xcd, 0x40, 0xa8,
+  0xb6, 0x48, 0x60, 0x7d, 0x97, 0x60, 0x9f, 0xea
+};
+
+
 /**************************************************************************//**
  * @brief Watchdog initialization
  *****************************************************************************/
@@ -153,6 +303,712 @@ void initWDOG(void)
 
 
 
+/**************************************************************************//**
+ * @brief Advertise the bulk transfer service (connectable legacy adv).
+ * The manufacturer data carries the cow ID and the number of stored windows
+ * so the host only connects to collars it has fallen behind on.
+ *****************************************************************************/
+void bulk_adv_update(bool start)
+{
+  sl_status_t sc;
+  uint8_t adv_data[27];
+  uint32_t count = backlog_count();
+
+  if (bulk_set_handle == 0xff) {
+    sc = sl_bt_advertiser_create_set(&bulk_set_handle);
+    app_assert_status(sc);
+
+    sc = sl_bt_advertiser_set_timing(bulk_set_handle,
+                                     BULK_ADV_INT,
+                                     BULK_ADV_INT,
+                                     0,
+                                     0);
+    app_assert_status(sc);
+  }
+
+  // Flags
+  adv_data[0] = 2;
+  adv_data[1] = 0x01;
+  adv_data[2] = 0x06;
+
+  // Complete list of 128-bit service UUIDs
+  adv_data[3] = 17;
+  adv_data[4] = 0x07;
+  memcpy(&adv_data[5], bulk_service_uuid, sizeof(bulk_service_uuid));
+
+  // Manufacturer data: company ID, cow ID, stored windows
+  adv_data[21] = 5;
+  adv_data[22] = 0xFF;
+  adv_data[23] = (uint8_t)(BULK_COMPANY_ID & 0xFF);
+  adv_data[24] = (uint8_t)(BULK_COMPANY_ID >> 8);
+  adv_data[25] = cow_id;
+  adv_data[26] = (count > 0xFF) ? 0xFF : (uint8_t)count;
+
+  sc = sl_bt_legacy_advertiser_set_data(bulk_set_handle,
+                                        sl_bt_advertiser_advertising_data_packet,
+                                        sizeof(adv_data),
+                                        adv_data);
+  app_assert_status(sc);
+
+  if (start) {
+    sc = sl_bt_legacy_advertiser_start(bulk_set_handle,
+                                       sl_bt_legacy_advertiser_connectable);
+    app_assert_status(sc);
+  }
+}
+
+/**************************************************************************//**
+ * @brief Stream stored windows to the host over notifications, starting at
+ * the resume offset written to bulk_ctrl. Stops when the stack runs out of
+ * buffers and retries from a short timer.
+ *****************************************************************************/
+void bulk_pump(void)
+{
+  sl_status_t sc;
+  const uint8_t *record;
+  uint16_t len;
+  uint16_t fragment;
+  uint32_t header;
+
+  while (bulk_started && bulk_notify) {
+
+    if (bulk_seq < backlog_first_seq()) {
+      // requested windows have already been overwritten
+      bulk_seq = backlog_first_seq();
+      bulk_offset = 0;
+    }
+
+    cs_put_le32(bulk_packet, bulk_seq);
+
+    if (!backlog_get(bulk_seq, &record, &len)) {
+      // header only: end of backlog, next sequence number to ask for
+      sc = sl_bt_gatt_server_send_notification(bulk_connection, gattdb_bulk_data,
+                                               BULK_HEADER_LEN, bulk_packet);
+      if (sc == SL_STATUS_OK) {
+        bulk_started = false;
+        backlog_release(bulk_seq);
+      }
+      break;
+    }
+
+    fragment = len - bulk_offset;
+    header = bulk_seq;
+    if (fragment > BULK_FRAGMENT_MAX) {
+      fragment = BULK_FRAGMENT_MAX;
+      header |= BULK_SEQ_MORE;
+    }
+    cs_put_le32(bulk_packet, header);
+    memcpy(&bulk_packet[BULK_HEADER_LEN], &record[bulk_offset], fragment);
+
+    sc = sl_bt_gatt_server_send_notification(bulk_connection, gattdb_bulk_data,
+                                             BULK_HEADER_LEN + fragment, bulk_packet);
+    if (sc != SL_STATUS_OK) {
+      break;
+    }
+
+    bulk_offset += fragment;
+    if (bulk_offset >= len) {
+      bulk_offset = 0;
+      bulk_seq++;
+    }
+  }
+
+  if (bulk_started && bulk_notify) {
+    sc = sl_sleeptimer_start_timer_ms(&bulk_pump_handle, BULK_PUMP_TIME, bulk_pump_callback, (void*)NULL, 0, 0);
+    app_assert_status(sc);
+  }
+}
+
+
+
+/**************************************************************************//**
+ * @brief Periodic advertising interval (units of 1.25 ms). Unless set
+ * explicitly it is matched to the record period (window or summary) so every
+ * record is sent pa_redundancy times.
+ *****************************************************************************/
+uint16_t pa_interval(void)
+{
+  uint32_t interval_ms;
+
+  if (config.pa_interval_ms != 0) {
+    return (uint16_t)(config.pa_interval_ms * 0.8);
+  }
+  // low rate windows take longer, so do the records built from them
+  interval_ms = (cs_config_publish_period_ms(&config) << rate_shift) / config.pa_redundancy;
+  if (interval_ms > CS_CONFIG_PA_INT_MAX) {
+    interval_ms = CS_CONFIG_PA_INT_MAX;
+  }
+  return (uint16_t)(interval_ms * 0.8);
+}
+
+/**************************************************************************//**
+ * @brief IMU sample period in use, longer than configured while the cow is
+ * still.
+ *****************************************************************************/
+uint32_t imu_period_ms(void)
+{
+  return (uint32_t)config.imu_period_ms << rate_shift;
+}
+
+/**************************************************************************//**
+ * @brief Periodic train already running: move it to the current interval if
+ * it differs from old_interval.
+ *****************************************************************************/
+void pa_interval_update(uint16_t old_interval)
+{
+  sl_status_t sc;
+
+  if (!first_sample && (pa_interval() != old_interval)) {
+    sc = sl_bt_periodic_advertiser_stop(advertising_set_handle);
+    app_assert_status(sc);
+    sc = sl_bt_periodic_advertiser_start(advertising_set_handle, pa_interval(), pa_interval(), 0);
+    app_assert_status(sc);
+  }
+}
+
+/**************************************************************************//**
+ * @brief Show the active configuration in the collar_config characteristic.
+ *****************************************************************************/
+void config_publish(void)
+{
+  sl_status_t sc;
+  uint8_t buffer[CS_CONFIG_LEN];
+  uint8_t len = cs_config_encode(&config, buffer);
+
+  sc = sl_bt_gatt_server_write_attribute_value(gattdb_collar_config, 0, len, buffer);
+  app_assert_status(sc);
+}
+
+/**************************************************************************//**
+ * @brief Switch to a new (validated) configuration without a restart:
+ * IMU rate and timers, environment timer and periodic advertising interval.
+ *****************************************************************************/
+void config_apply(const cs_config_t *new_config)
+{
+  sl_status_t sc;
+  uint16_t old_interval = pa_interval();
+  bool imu_changed = (new_config->imu_period_ms != config.imu_period_ms);
+  bool env_changed = (new_config->env_period_s != config.env_period_s);
+
+  // a summary or label batch never mixes windows of two configurations
+  if ((new_config->mode != config.mode) || imu_changed || (new_config->window_samples != config.window_samples)) {
+    cs_features_reset(&features);
+    window.n_labels = 0;
+  }
+
+  // a new sample period starts at full rate
+  if (imu_changed) {
+    rate_shift = 0;
+    still_windows = 0;
+  }
+
+  config = *new_config;
+
+  window_limit = config.window_samples;
+
+  if (imu_changed) {
+    sc = sensor_imu_set_rate(cs_config_imu_rate_hz(&config) / (1 << rate_shift));
+    app_assert_status(sc);
+  }
+
+  if (sampling_started) {
+    if (imu_changed) {
+      sc = sl_sleeptimer_restart_periodic_timer_ms(&imu_sample_handle, imu_period_ms(), imu_sample_callback, (void*)NULL, 0, 0);
+      app_assert_status(sc);
+    }
+    if (env_changed) {
+      sc = sl_sleeptimer_restart_periodic_timer_ms(&rht_sample_handle, config.env_period_s * 1000, rht_sample_callback, (void*)NULL, 0, 0);
+      app_assert_status(sc);
+    }
+  }
+
+  pa_interval_update(old_interval);
+
+  config_publish();
+}
+
+/**************************************************************************//**
+ * @brief Hand a payload to the periodic advertiser. Up to the controller
+ * limit, long payloads are chained over several PDUs by the stack.
+ *****************************************************************************/
+void pa_set_data(const uint8_t *data, uint16_t len)
+{
+  sl_status_t sc;
+
+  if (len <= PA_SHORT_DATA_MAX) {
+    sc = sl_bt_periodic_advertiser_set_data(advertising_set_handle, len, data);
+    app_assert_status(sc);
+    return;
+  }
+
+  sc = sl_bt_system_data_buffer_clear();
+  app_assert_status(sc);
+
+  for (uint16_t offset = 0; offset < len; offset += PA_DATA_CHUNK) {
+    uint16_t chunk = ((len - offset) > PA_DATA_CHUNK) ? PA_DATA_CHUNK : (len - offset);
+
+    sc = sl_bt_system_data_buffer_write(chunk, &data[offset]);
+    app_assert_status(sc);
+  }
+
+  // consumes and clears the system data buffer
+  sc = sl_bt_periodic_advertiser_set_long_data(advertising_set_handle);
+  app_assert_status(sc);
+}
+
+/**************************************************************************//**
+ * @brief Expose the link level and the estimated energy saved through the
+ * link_metrics characteristic.
+ *****************************************************************************/
+void link_metrics_publish(void)
+{
+  sl_status_t sc;
+  uint8_t buffer[12];
+
+  buffer[0] = link_level;
+  buffer[1] = cs_link_levels[link_level].phy;
+  cs_put_le16(&buffer[2], (uint16_t)cs_link_levels[link_level].tx_power);
+  cs_put_le32(&buffer[4], link_metrics.changes);
+  cs_put_le32(&buffer[8], link_metrics.energy_saved_mj);
+
+  sc = sl_bt_gatt_server_write_attribute_value(gattdb_link_metrics, 0, sizeof(buffer), buffer);
+  app_assert_status(sc);
+}
+
+/**************************************************************************//**
+ * @brief Move extended and periodic advertising to a link level: the
+ * secondary PHY and TX power only change with the advertisers stopped.
+ *****************************************************************************/
+void link_apply(uint8_t level)
+{
+  sl_status_t sc;
+  int16_t result;
+
+  if ((level >= CS_LINK_LEVELS) || (level == link_level)) {
+    return;
+  }
+  // cheaper than now: only after the dwell time
+  if ((level > link_level) && (link_dwell > 0)) {
+    return;
+  }
+
+  link_level = level;
+  link_dwell = LINK_DWELL_WINDOWS;
+  link_metrics.changes++;
+
+  if (sampling_started) {
+    if (!first_sample) {
+      sc = sl_bt_periodic_advertiser_stop(advertising_set_handle);
+      app_assert_status(sc);
+    }
+    sc = sl_bt_advertiser_stop(advertising_set_handle);
+    app_assert_status(sc);
+  }
+
+  sc = sl_bt_advertiser_set_tx_power(advertising_set_handle, cs_link_levels[link_level].tx_power, &result);
+  app_assert_status(sc);
+
+  if (sampling_started) {
+    sc = sl_bt_extended_advertiser_set_phy(advertising_set_handle, sl_bt_gap_phy_coded, cs_link_levels[link_level].phy);
+    app_assert_status(sc);
+
+    sc = sl_bt_extended_advertiser_start(advertising_set_handle,
+                                         sl_bt_extended_advertiser_non_connectable,
+                                         SL_BT_EXTENDED_ADVERTISER_INCLUDE_TX_POWER);
+    app_assert_status(sc);
+
+    if (!first_sample) {
+      sc = sl_bt_periodic_advertiser_start(advertising_set_handle, pa_interval(), pa_interval(), 0);
+      app_assert_status(sc);
+      pa_set_data(payload, payload_len);
+    }
+  }
+
+  link_metrics_publish();
+}
+
+/**************************************************************************//**
+ * @brief Account the airtime of a published window and expose the metrics
+ * through the pa_metrics characteristic.
+ *****************************************************************************/
+void pa_metrics_update(uint16_t data_len)
+{
+  sl_status_t sc;
+  uint32_t values[4];
+  uint8_t buffer[16];
+
+  radio_pa_account(&pa_metrics, cs_link_levels[link_level].phy, data_len, config.pa_redundancy);
+  radio_link_account(&link_metrics, link_level, data_len, config.pa_redundancy);
+  link_metrics_publish();
+
+  if (link_dwell > 0) {
+    link_dwell--;
+  }
+
+  values[0] = pa_metrics.windows;
+  values[1] = pa_metrics.pdus;
+  values[2] = pa_metrics.window_airtime_us;
+  values[3] = pa_metrics.total_airtime_ms;
+
+  // little endian u32 fields
+  for (uint8_t i = 0; i < 4; i++) {
+    buffer[i * 4] = (uint8_t)(values[i]);
+    buffer[i * 4 + 1] = (uint8_t)(values[i] >> 8);
+    buffer[i * 4 + 2] = (uint8_t)(values[i] >> 16);
+    buffer[i * 4 + 3] = (uint8_t)(values[i] >> 24);
+  }
+
+  sc = sl_bt_gatt_server_write_attribute_value(gattdb_pa_metrics, 0, sizeof(buffer), buffer);
+  app_assert_status(sc);
+}
+
+
+
+/**************************************************************************//**
+ * @brief Check an advertisement for a 128-bit service UUID.
+ *****************************************************************************/
+bool adv_has_uuid(const uint8_t *data, uint8_t len, const uint8_t *uuid)
+{
+  uint8_t i = 0;
+
+  while ((i + 1) < len) {
+    uint8_t field_len = data[i];
+
+    if ((field_len == 0) || ((i + field_len) >= len)) {
+      break;
+    }
+    if (((data[i + 1] == 0x06) || (data[i + 1] == 0x07)) && (field_len == 17)
+        && (memcmp(&data[i + 2], uuid, 16) == 0)) {
+      return true;
+    }
+    i += field_len + 1;
+  }
+  return false;
+}
+
+/**************************************************************************//**
+ * @brief Low duty cycle scan for the gateway's PAwR train.
+ *****************************************************************************/
+void pawr_scan_start(void)
+{
+  sl_status_t sc;
+
+  if (pawr_scanning) {
+    return;
+  }
+
+  sc = sl_bt_scanner_set_parameters(sl_bt_scanner_scan_mode_passive, PAWR_SCAN_INTERVAL, PAWR_SCAN_WINDOW);
+  app_assert_status(sc);
+
+  sc = sl_bt_sync_scanner_set_sync_parameters(0, PAWR_SYNC_TIMEOUT, sl_bt_sync_report_all);
+  app_assert_status(sc);
+
+  sc = sl_bt_scanner_start(sl_bt_scanner_scan_phy_1m, sl_bt_scanner_discover_observation);
+  app_assert_status(sc);
+
+  pawr_scanning = true;
+}
+
+/**************************************************************************//**
+ * @brief Listen only to the subevent of this cow.
+ *****************************************************************************/
+void pawr_listen(void)
+{
+  sl_status_t sc;
+  uint8_t subevent = cs_pawr_subevent(cow_id);
+
+  sc = sl_bt_pawr_sync_set_sync_subevents(pawr_sync_handle, 1, &subevent);
+  app_assert_status(sc);
+}
+
+/**************************************************************************//**
+ * @brief Apply the gateway time if the collar clock is more than 1 s off.
+ *****************************************************************************/
+void pawr_apply_time(const uint8_t *gw_time)
+{
+  sl_status_t sc;
+  sl_sleeptimer_date_t now;
+  sl_sleeptimer_date_t gw;
+  uint32_t now_s;
+  uint32_t gw_s;
+
+  sc = sl_sleeptimer_get_datetime(&now);
+  app_assert_status(sc);
+
+  gw = now;
+  gw.year = (2000 + gw_time[0]) - 1900;
+  gw.month = gw_time[1] - 1;
+  gw.month_day = gw_time[2];
+  gw.hour = gw_time[3];
+  gw.min = gw_time[4];
+  gw.sec = gw_time[5];
+
+  if ((sl_sleeptimer_convert_date_to_time(&now, &now_s) != SL_STATUS_OK)
+      || (sl_sleeptimer_convert_date_to_time(&gw, &gw_s) != SL_STATUS_OK)) {
+    return;
+  }
+
+  if ((now_s > gw_s + 1) || (gw_s > now_s + 1)) {
+    sc = sl_sleeptimer_set_datetime(&gw);
+    app_assert_status(sc);
+  }
+}
+
+/**************************************************************************//**
+ * @brief Handle the subevent this collar listens to: apply the gateway time
+ * and our commands, then answer in our response slot.
+ *****************************************************************************/
+void pawr_subevent_report(sl_bt_evt_pawr_sync_subevent_report_t *report)
+{
+  sl_status_t sc;
+  const uint8_t *data = report->data.data;
+  uint8_t len = report->data.len;
+  uint8_t response[CS_PAWR_RSP_LEN];
+  uint8_t i;
+
+  if ((report->data_status != 0) || (len < CS_PAWR_CMD_HEADER_LEN) || (data[0] != CS_PAWR_VERSION)) {
+    return;
+  }
+
+  pawr_apply_time(&data[1]);
+
+  i = CS_PAWR_CMD_HEADER_LEN;
+  while ((i + CS_PAWR_CMD_RECORD_LEN) <= len) {
+    uint8_t rec_cow = data[i];
+    uint8_t rec_type = data[i + 1];
+    uint8_t rec_len = data[i + 2];
+    const uint8_t *value = &data[i + CS_PAWR_CMD_RECORD_LEN];
+
+    if ((i + CS_PAWR_CMD_RECORD_LEN + rec_len) > len) {
+      break;
+    }
+    i += CS_PAWR_CMD_RECORD_LEN + rec_len;
+
+    if (rec_cow != cow_id) {
+      continue;
+    }
+
+    if ((rec_type == CS_PAWR_CMD_ACK) && (rec_len == 4)) {
+      // the gateway has these windows, no need to keep them for bulk transfer
+      backlog_release(cs_get_le32(value));
+      bulk_adv_update(false);
+
+    }else if((rec_type == CS_PAWR_CMD_COW_ID) && (rec_len == 1)){
+      cow_id = value[0];
+      cow_data.cow_id = cow_id;
+      pawr_listen();
+
+    }else if((rec_type == CS_PAWR_CMD_PA_CONFIG) && (rec_len == 1)){
+      cs_config_t new_config = config;
+
+      new_config.pa_redundancy = value[0];
+      if (cs_config_valid(&new_config)) {
+        config_apply(&new_config);
+      }
+
+    }else if((rec_type == CS_PAWR_CMD_LINK) && (rec_len == 1)){
+      link_apply(value[0]);
+    }
+  }
+
+  if (report->subevent != cs_pawr_subevent(cow_id)) {
+    // cow ID just moved us to another subevent
+    return;
+  }
+
+  response[CS_PAWR_RSP_VERSION] = CS_PAWR_VERSION;
+  response[CS_PAWR_RSP_COW_ID] = cow_id;
+  response[CS_PAWR_RSP_BATTERY] = cow_data.battery;
+  response[CS_PAWR_RSP_REDUNDANCY] = config.pa_redundancy;
+  cs_put_le32(&response[CS_PAWR_RSP_FIRST_SEQ], backlog_first_seq());
+  cs_put_le32(&response[CS_PAWR_RSP_NEXT_SEQ], backlog_next_seq());
+  response[CS_PAWR_RSP_LINK] = link_level;
+
+  sc = sl_bt_pawr_sync_set_response_data(pawr_sync_handle,
+                                         report->event_counter,
+                                         report->subevent,
+                                         report->subevent,
+                                         cs_pawr_slot(cow_id),
+                                         sizeof(response),
+                                         response);
+  // a late response is simply dropped, the next event will carry it
+  (void)sc;
+}
+
+
+
+/**************************************************************************//**
+ * @brief Expose the adaptive sampling counters through the adapt_metrics
+ * characteristic: low rate windows, samples skipped and the estimated energy
+ * saved (uJ).
+ *****************************************************************************/
+void adapt_metrics_update(void)
+{
+  sl_status_t sc;
+  uint8_t buffer[12];
+
+  cs_put_le32(&buffer[0], low_rate_windows);
+  cs_put_le32(&buffer[4], skipped_samples);
+  cs_put_le32(&buffer[8], skipped_samples * ADAPT_SAMPLE_ENERGY_UJ);
+
+  sc = sl_bt_gatt_server_write_attribute_value(gattdb_adapt_metrics, 0, sizeof(buffer), buffer);
+  app_assert_status(sc);
+}
+
+/**************************************************************************//**
+ * @brief Move the IMU and the sample timer to a new rate shift.
+ *****************************************************************************/
+void adapt_set_rate(uint8_t shift)
+{
+  sl_status_t sc;
+  uint16_t old_interval = pa_interval();
+
+  rate_shift = shift;
+
+  sc = sensor_imu_set_rate(cs_config_imu_rate_hz(&config) / (1 << rate_shift));
+  app_assert_status(sc);
+
+  sc = sl_sleeptimer_restart_periodic_timer_ms(&imu_sample_handle, imu_period_ms(), imu_sample_callback, (void*)NULL, 0, 0);
+  app_assert_status(sc);
+
+  pa_interval_update(old_interval);
+}
+
+/**************************************************************************//**
+ * @brief Pick the sample rate of the next window from the motion in the
+ * window just published.
+ *****************************************************************************/
+void adapt_window(void)
+{
+  cs_features_acc_t acc;
+  cs_summary_t s;
+
+  window_limit = config.window_samples;
+
+  if (!ADAPT_SAMPLING) {
+    return;
+  }
+
+  if (rate_shift) {
+    low_rate_windows++;
+    skipped_samples += (uint32_t)window.n_samples * ((1 << rate_shift) - 1);
+    adapt_metrics_update();
+  }
+
+  cs_features_reset(&acc);
+  cs_features_add_window(&acc, window.samples, window.n_samples);
+  cs_features_finish(&acc, &s);
+
+  if (!motion_wake && (s.odba < ADAPT_STILL_ODBA)) {
+    if ((still_windows < ADAPT_STILL_WINDOWS) && (++still_windows == ADAPT_STILL_WINDOWS)) {
+      uint8_t shift = ADAPT_RATE_SHIFT;
+
+      // slow sample periods are only stretched as far as the watchdog allows
+      while ((shift > 0) && (((uint32_t)config.imu_period_ms << shift) > ADAPT_PERIOD_MAX_MS)) {
+        shift--;
+      }
+      if (shift > 0) {
+        adapt_set_rate(shift);
+      }
+    }
+  } else {
+    motion_wake = false;
+    still_windows = 0;
+    if (rate_shift) {
+      adapt_set_rate(0);
+    }
+  }
+}
+
+/**************************************************************************//**
+ * @brief At low rate, end the window early when the collar starts moving.
+ *****************************************************************************/
+void adapt_sample(const int16_t sample[3])
+{
+  uint32_t delta = 0;
+
+  if (ADAPT_SAMPLING && rate_shift && (imu_index > 0)) {
+    for (uint8_t a = 0; a < 3; a++) {
+      delta += (uint32_t)abs(sample[a] - last_avec[a]);
+    }
+    if (delta > ADAPT_WAKE_DELTA) {
+      // publish the samples so far on the next tick, then back to full rate
+      motion_wake = true;
+      window_limit = imu_index + 1;
+    }
+  }
+  memcpy(last_avec, sample, sizeof(last_avec));
+}
+
+/**************************************************************************//**
+ * @brief Encode the record in window, store it for bulk transfer and hand it
+ * to the periodic advertiser.
+ *****************************************************************************/
+void publish_record(void)
+{
+  window.seq = (uint16_t)backlog_next_seq();
+
+  payload_len = cs_payload_encode(&window, payload, sizeof(payload));
+
+  backlog_push(payload, payload_len);
+  bulk_adv_update(false);
+
+  pa_set_data(payload, payload_len);
+
+  pa_metrics_update(payload_len);
+}
+
+/**************************************************************************//**
+ * @brief Publish the collected window. In summary mode it is folded into the
+ * running features, in class mode it is classified; the record goes out once
+ * per summary period.
+ *****************************************************************************/
+void publish_window(void)
+{
+  window.version = CS_PAYLOAD_VERSION;
+  window.flags = rate_shift & CS_FLAG_RATE_SHIFT_MASK;
+  if (config.options & CS_OPT_ORIENT) {
+    // where the collar points as the record closes
+    window.flags |= CS_FLAG_ORIENT;
+    cs_orient_quantize(ovec, &window.orient);
+  }
+  window.session = session_id;
+  window.cow_id = cow_data.cow_id;
+  window.hour = cow_data.hour;
+  window.min = cow_data.min;
+  window.sec = cow_data.sec;
+  window.battery = cow_data.battery;
+  window.temp = cow_data.temp;
+
+  if (config.mode == CS_MODE_SUMMARY) {
+    cs_features_add_window(&features, window.samples, window.n_samples);
+
+    if (features.windows >= cs_config_summary_windows(&config)) {
+      window.kind = CS_KIND_SUMMARY;
+      cs_features_finish(&features, &window.summary);
+      cs_features_reset(&features);
+      publish_record();
+    }
+  } else if (config.mode == CS_MODE_CLASS) {
+    window.labels[window.n_labels++] = cs_classifier_window(window.samples, window.n_samples);
+
+    if (window.n_labels >= cs_config_class_labels(&config)) {
+      window.kind = CS_KIND_CLASS;
+      publish_record();
+      window.n_labels = 0;
+    }
+  } else {
+    window.kind = CS_KIND_RAW;
+    publish_record();
+  }
+
+  adapt_window();
+
+  memset(window.samples, 0, sizeof(window.samples));
+}
+
+
+
 // Application Init.
 void app_init(void)
 {
@@ -168,9 +1024,15 @@ void app_init(void)
 
 
   // IMU sensor enable
-  sc = sensor_imu_enable(true, IMU_SAMPLE_RATE);
+  sc = sensor_imu_enable(true, cs_config_imu_rate_hz(&config));
   app_assert_status(sc);
 
+  backlog_init();
+
+  cs_features_reset(&features);
+
+  ota_init();
+
 
 
   /////////////////////////////////////////////////////////////////////////////
@@ -195,20 +1057,32 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
 {
   sl_status_t sc;
   int16_t result;
+  uint16_t max_mtu_out;
+  size_t random_len;
 
   switch (SL_BT_MSG_ID(evt->header)) {
     // -------------------------------
     // This event indicates the device has started and the radio is ready.
     // Do not call any stack command before receiving this boot event!
     case sl_bt_evt_system_boot_id:
+      // Window sequence numbers restart at 0: take a new session from the TRNG
+      sc = sl_bt_system_get_random_data(sizeof(session_id), sizeof(session_id), &random_len, &session_id);
+      app_assert_status(sc);
+
       // Create an advertising set.
       sc = sl_bt_advertiser_create_set(&advertising_set_handle);
       app_assert_status(sc);
 
-      // set max tx power
-      sc = sl_bt_advertiser_set_tx_power(advertising_set_handle, 60, &result);
+      // TX power of the default (most robust) link level
+      sc = sl_bt_advertiser_set_tx_power(advertising_set_handle, cs_link_levels[link_level].tx_power, &result);
       app_assert_status(sc);
 
+      // a bulk notification carries a full window
+      sc = sl_bt_gatt_server_set_max_mtu(247, &max_mtu_out);
+      app_assert_status(sc);
+
+      config_publish();
+
       // Generate data for advertising
       sc = sl_bt_legacy_advertiser_generate_data(advertising_set_handle,
                                                  sl_bt_advertiser_general_discoverable);
@@ -233,6 +1107,24 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
     case sl_bt_evt_connection_opened_id:
 //      app_log("Connection opened \r\n");
 
+      if (evt->data.evt_connection_opened.advertiser == bulk_set_handle) {
+
+          // bulk transfer: 2M PHY, data length extension and short interval
+          bulk_connection = evt->data.evt_connection_opened.connection;
+
+          sc = sl_bt_connection_set_preferred_phy(bulk_connection, sl_bt_gap_phy_2m, sl_bt_gap_phy_any);
+          app_assert_status(sc);
+
+          sc = sl_bt_connection_set_data_length(bulk_connection, 251, 2120);
+          app_assert_status(sc);
+
+          // 7.5 - 15 ms interval, 1 s supervision timeout
+          sc = sl_bt_connection_set_parameters(bulk_connection, 6, 12, 0, 100, 0, 0xffff);
+          app_assert_status(sc);
+
+          break;
+      }
+
       connection_handle = evt->data.evt_connection_opened.connection;
 
       break;
@@ -279,6 +1171,82 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
 
           app_assert_status(sc);
 
+      }else if(evt->data.evt_gatt_server_attribute_value.attribute == gattdb_collar_config){
+
+          uint8_t buffer[CS_CONFIG_LEN];
+          cs_config_t new_config;
+
+          sc = sl_bt_gatt_server_read_attribute_value(gattdb_collar_config, 0, sizeof(buffer), &data_len, buffer);
+          app_assert_status(sc);
+
+          if (cs_config_decode(buffer, (uint16_t)data_len, &new_config)) {
+              config_apply(&new_config);
+          } else {
+              // rejected, show the configuration still in use
+              config_publish();
+          }
+
+      }else if(evt->data.evt_gatt_server_attribute_value.attribute == gattdb_bulk_ctrl){
+
+          uint8_t offset[4];
+
+          sc = sl_bt_gatt_server_read_attribute_value(gattdb_bulk_ctrl, 0, sizeof(offset), &data_len, offset);
+          app_assert_status(sc);
+
+          // resume offset: first window sequence number the host is missing
+          bulk_seq = (uint32_t)offset[0] | ((uint32_t)offset[1] << 8)
+                     | ((uint32_t)offset[2] << 16) | ((uint32_t)offset[3] << 24);
+          bulk_offset = 0;
+          bulk_started = true;
+
+          bulk_pump();
+
+      }else if(evt->data.evt_gatt_server_attribute_value.attribute == gattdb_ota_ctrl){
+
+          uint8_t command[1 + CS_DELTA_HEADER_LEN];
+          uint8_t status[CS_DELTA_STATUS_LEN];
+
+          sc = sl_bt_gatt_server_read_attribute_value(gattdb_ota_ctrl, 0, sizeof(command), &data_len, command);
+          app_assert_status(sc);
+
+          if (ota_command(command, (uint16_t)data_len, status) == CS_DELTA_DONE) {
+              // image checked, reboot into the bootloader once the host knows
+              sc = sl_sleeptimer_start_timer_ms(&ota_install_handle, OTA_INSTALL_DELAY, ota_install_callback, (void*)NULL, 0, 0);
+              app_assert_status(sc);
+          }
+
+          sl_bt_gatt_server_write_attribute_value(gattdb_ota_ctrl, 0, sizeof(status), status);
+          sl_bt_gatt_server_send_notification(evt->data.evt_gatt_server_attribute_value.connection,
+                                              gattdb_ota_ctrl, sizeof(status), status);
+
+      }else if(evt->data.evt_gatt_server_attribute_value.attribute == gattdb_ota_data){
+
+          uint8_t status[CS_DELTA_STATUS_LEN];
+
+          // writes without response come several per connection event: the
+          // attribute may already hold a later one, the event has this one.
+          // Progress is notified every few kB, the host keeps its writes
+          // within a window of the last.
+          if (ota_data(evt->data.evt_gatt_server_attribute_value.value.data,
+                       evt->data.evt_gatt_server_attribute_value.value.len, status)) {
+              sl_bt_gatt_server_write_attribute_value(gattdb_ota_ctrl, 0, sizeof(status), status);
+              sl_bt_gatt_server_send_notification(evt->data.evt_gatt_server_attribute_value.connection,
+                                                  gattdb_ota_ctrl, sizeof(status), status);
+          }
+      }
+
+      break;
+
+
+    // Notifications on bulk_data enabled / disabled by the host
+    case sl_bt_evt_gatt_server_characteristic_status_id:
+
+      if ((evt->data.evt_gatt_server_characteristic_status.characteristic == gattdb_bulk_data)
+          && (evt->data.evt_gatt_server_characteristic_status.status_flags == sl_bt_gatt_server_client_config)) {
+
+          bulk_notify = (evt->data.evt_gatt_server_characteristic_status.client_config_flags & sl_bt_gatt_notification) != 0;
+
+          bulk_pump();
       }
 
       break;
@@ -289,6 +1257,19 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
     case sl_bt_evt_connection_closed_id:
 //      app_log("Connection closed start extended advertising & IMU sampling\r\n");
 
+      if (evt->data.evt_connection_closed.connection == bulk_connection) {
+
+          // bulk transfer done or link lost, windows not drained stay stored
+          bulk_connection = 0xff;
+          bulk_notify = false;
+          bulk_started = false;
+          sl_sleeptimer_stop_timer(&bulk_pump_handle);
+
+          bulk_adv_update(true);
+
+          break;
+      }
+
       // set extended adv timing
       sc = sl_bt_advertiser_set_timing(advertising_set_handle,
                                        EXTENDED_ADV_INT,
@@ -301,7 +1282,7 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
 //      sl_bt_gap_phy_1m    = 0x1,  /**< (0x1) 1M PHY */
 //      sl_bt_gap_phy_2m    = 0x2,  /**< (0x2) 2M PHY */
 //      sl_bt_gap_phy_coded = 0x4,  /**< (0x4) Coded PHY, 125k (S=8) or 500k (S=2) */
-      sc = sl_bt_extended_advertiser_set_phy(advertising_set_handle,sl_bt_gap_phy_coded, sl_bt_gap_phy_coded );
+      sc = sl_bt_extended_advertiser_set_phy(advertising_set_handle,sl_bt_gap_phy_coded, cs_link_levels[link_level].phy);
       app_assert_status(sc);
 
       // Start general advertising
@@ -318,24 +1299,89 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
       app_assert_status(sc);
 
       // timer every 100ms to sample IMU
-      sc = sl_sleeptimer_start_periodic_timer_ms(&imu_sample_handle, IMU_SAMPLE_TIME , imu_sample_callback, (void*)NULL, 0, 0);
+      sc = sl_sleeptimer_start_periodic_timer_ms(&imu_sample_handle, imu_period_ms(), imu_sample_callback, (void*)NULL, 0, 0);
 
 
       app_assert_status(sc);
 
       // timer to update RHT and hour/sec 5 min = 60000*5
-      sc = sl_sleeptimer_start_periodic_timer_ms(&rht_sample_handle, RTH_BAT_SAMPLE_TIME, rht_sample_callback, (void*)NULL, 0, 0);
+      sc = sl_sleeptimer_start_periodic_timer_ms(&rht_sample_handle, config.env_period_s * 1000, rht_sample_callback, (void*)NULL, 0, 0);
 
 
       app_assert_status(sc);
 
+      sampling_started = true;
+
+      // make stored windows available for bulk transfer
+      bulk_adv_update(true);
+
+      // look for the gateway PAwR control channel
+      pawr_scan_start();
+
 
       break;
 
 
 
+    // Gateway PAwR train found, sync to it
+    case sl_bt_evt_scanner_extended_advertisement_report_id:
+
+      if (adv_has_uuid(evt->data.evt_scanner_extended_advertisement_report.data.data,
+                       evt->data.evt_scanner_extended_advertisement_report.data.len,
+                       gateway_uuid)
+          && (evt->data.evt_scanner_extended_advertisement_report.periodic_interval != 0)
+          && (pawr_sync_handle == 0xffff)) {
+
+          sc = sl_bt_sync_scanner_open(evt->data.evt_scanner_extended_advertisement_report.address,
+                                       evt->data.evt_scanner_extended_advertisement_report.address_type,
+                                       evt->data.evt_scanner_extended_advertisement_report.adv_sid,
+                                       &pawr_sync_handle);
+          if (sc != SL_STATUS_OK) {
+              pawr_sync_handle = 0xffff;
+          }
+      }
+
+      break;
+
+
+    case sl_bt_evt_pawr_sync_opened_id:
+
+      pawr_sync_handle = evt->data.evt_pawr_sync_opened.sync;
+
+      sc = sl_bt_scanner_stop();
+      app_assert_status(sc);
+      pawr_scanning = false;
+
+      pawr_listen();
+
+      break;
+
+
+    case sl_bt_evt_pawr_sync_subevent_report_id:
+
+      pawr_subevent_report(&evt->data.evt_pawr_sync_subevent_report);
+
+      break;
+
+
+    // Lost the gateway (or the sync attempt failed), look for it again
+    case sl_bt_evt_sync_closed_id:
+
+      if (evt->data.evt_sync_closed.sync == pawr_sync_handle) {
+          pawr_sync_handle = 0xffff;
+          pawr_scanning = false;
+          pawr_scan_start();
+
+          // nobody is steering the link any more: be heard from afar
+          link_dwell = 0;
+          link_apply(CS_LINK_LEVEL_DEFAULT);
+      }
+
+      break;
+
+
     case sl_bt_evt_system_external_signal_id:
-      if(evt->data.evt_system_external_signal.extsignals == CLOSE_CONNECTION){
+      if(evt->data.evt_system_external_signal.extsignals & CLOSE_CONNECTION){
           // close the connection after time&date received
           sc = sl_bt_connection_close(connection_handle);
           app_assert_status(sc);
@@ -345,19 +1391,40 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
 
           initWDOG();
 
-      }else if(evt->data.evt_system_external_signal.extsignals ==  SAMPLE_IMU){
+      }
+
+      if(evt->data.evt_system_external_signal.extsignals & BULK_PUMP){
+
+          bulk_pump();
+
+      }
+
+      if(evt->data.evt_system_external_signal.extsignals & OTA_INSTALL){
+
+          ota_install();
+
+      }
+
+      if(evt->data.evt_system_external_signal.extsignals & SAMPLE_IMU){
 
           WDOGn_Feed(WDOG0);
 
-          // Sample IMU accleration vector
-          sc = sensor_imu_get_avec(avec);
+          // Sample IMU accleration vector, and the fused orientation when
+          // the records carry it (the fusion runs on every update anyway)
+          if (config.options & CS_OPT_ORIENT) {
+              sc = sensor_imu_get(ovec, avec);
+          } else {
+              sc = sensor_imu_get_avec(avec);
+          }
           //app_assert_status(sc);
           if(sc == SL_STATUS_NOT_READY){
               memset(avec, 0, sizeof(avec));
           }
 
 
-          if(imu_index > 29){
+          if(imu_index >= window_limit){
+
+              window.n_samples = imu_index;
 
               if(first_sample){
 
@@ -390,20 +1457,14 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
 
                   adc_deinit();
 
-                  memcpy(&imu_buffer[180], &cow_data, sizeof(cow_data));
-
+                  publish_window();
 
-                  sc = sl_bt_periodic_advertiser_set_data(advertising_set_handle, sizeof(imu_buffer), imu_buffer);
-                  app_assert_status(sc);
-
-                  sc = sl_bt_periodic_advertiser_start(advertising_set_handle, PERIODIC_ADV_INT, PERIODIC_ADV_INT,
+                  // the train starts on a window boundary and runs at the window rate
+                  sc = sl_bt_periodic_advertiser_start(advertising_set_handle, pa_interval(), pa_interval(),
                                                        SL_BT_PERIODIC_ADVERTISER_AUTO_START_EXTENDED_ADVERTISING);
                   app_assert_status(sc);
 
 
-                  memset(imu_buffer, 0, sizeof(imu_buffer));
-
-
                   first_sample = false;
               }else{
 
@@ -416,28 +1477,24 @@ void sl_bt_on_event(sl_bt_msg_t *evt)
               cow_data.min = date_time.min;
               cow_data.sec = date_time.sec;
 
-              memcpy(&imu_buffer[180], &cow_data, sizeof(cow_data));
-
-
-              sc = sl_bt_periodic_advertiser_set_data(advertising_set_handle, sizeof(imu_buffer), imu_buffer);
-              app_assert_status(sc);
-
-              memset(imu_buffer, 0, sizeof(imu_buffer));
+              publish_window();
 
               }
 
           }else{
-              imu_offset = imu_index * 6;
-
               //app_log("%d,%d,%d\r\n", avec[0], avec[1], avec[2]);
 
-              memcpy(&imu_buffer[imu_offset],avec,sizeof(avec));
+              memcpy(window.samples[imu_index], avec, sizeof(avec));
+
+              adapt_sample(avec);
 
               imu_index++;
           }
 
 
-      }else if(evt->data.evt_system_external_signal.extsignals ==  SAMPLE_TEMP){
+      }
+
+      if(evt->data.evt_system_external_signal.extsignals & SAMPLE_TEMP){
 
             sc = sl_sleeptimer_get_datetime(&date_time);
             app_assert_status(sc);
@@ -497,3 +1554,17 @@ void connection_close_callback(sl_sleeptimer_timer_handle_t *handle, void *data)
   sl_bt_external_signal(CLOSE_CONNECTION);
 }
 
+void bulk_pump_callback(sl_sleeptimer_timer_handle_t *handle, void *data){
+  (void)handle;
+  (void)data;
+
+  sl_bt_external_signal(BULK_PUMP);
+}
+
+void ota_install_callback(sl_sleeptimer_timer_handle_t *handle, void *data){
+  (void)handle;
+  (void)data;
+
+  sl_bt_external_signal(OTA_INSTALL);
+}
+
@@ -0,0 +1,112 @@
+/*
+ * cs_backlog.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ */
+
+#include "cs_backlog.h"
+#include "string.h"
+
+// Every window gets a sequence number that keeps counting up from boot.
+// Records are stored back to back in a byte ring so long windows do not cost
+// RAM for short ones; a record never wraps, the unused end of the ring is
+// skipped instead. The oldest records are overwritten first.
+typedef struct backlog_entry{
+  uint16_t offset;
+  uint16_t len;
+}backlog_entry_t;
+
+static uint8_t ring[BACKLOG_BYTES];
+static backlog_entry_t entries[BACKLOG_WINDOWS];
+static uint16_t head = 0;
+static uint32_t first_seq = 0;
+static uint32_t next_seq = 0;
+
+
+void backlog_init(void)
+{
+  head = 0;
+  first_seq = 0;
+  next_seq = 0;
+}
+
+
+uint32_t backlog_push(const uint8_t *window, uint16_t len)
+{
+  uint32_t seq = next_seq;
+  backlog_entry_t *entry = &entries[seq % BACKLOG_WINDOWS];
+  uint16_t offset = head;
+  bool wrapped = false;
+
+  if (len > BACKLOG_WINDOW_SIZE) {
+    len = BACKLOG_WINDOW_SIZE;
+  }
+  if (offset + len > BACKLOG_BYTES) {
+    offset = 0;
+    wrapped = true;
+  }
+
+  // free the space: records in the skipped end are older than those at the
+  // start of the ring, then anything the new record overlaps
+  while (first_seq != next_seq) {
+    const backlog_entry_t *oldest = &entries[first_seq % BACKLOG_WINDOWS];
+
+    if ((next_seq - first_seq >= BACKLOG_WINDOWS)
+        || (wrapped && (oldest->offset >= head))
+        || ((oldest->offset < offset + len) && (offset < oldest->offset + oldest->len))) {
+      first_seq++;
+    } else {
+      break;
+    }
+  }
+
+  memcpy(&ring[offset], window, len);
+  entry->offset = offset;
+  entry->len = len;
+
+  head = offset + len;
+  next_seq++;
+  return seq;
+}
+
+
+bool backlog_get(uint32_t seq, const uint8_t **window, uint16_t *len)
+{
+  if ((seq < first_seq) || (seq >= next_seq)) {
+    return false;
+  }
+  *window = &ring[entries[seq % BACKLOG_WINDOWS].offset];
+  *len = entries[seq % BACKLOG_WINDOWS].len;
+  return true;
+}
+
+
+// Drop every window older than seq (it has been delivered).
+void backlog_release(uint32_t seq)
+{
+  if (seq > next_seq) {
+    seq = next_seq;
+  }
+  if (seq > first_seq) {
+    first_seq = seq;
+  }
+}
+
+
+uint32_t backlog_first_seq(void)
+{
+  return first_seq;
+}
+
+
+uint32_t backlog_next_seq(void)
+{
+  return next_seq;
+}
+
+
+uint32_t backlog_count(void)
+{
+  return next_seq - first_seq;
+}
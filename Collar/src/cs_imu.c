@@ -29,6 +29,17 @@ sl_status_t sensor_imu_enable(bool enable, float sample_rate)
 }
 
 
+sl_status_t sensor_imu_set_rate(float sample_rate)
+{
+  if (initialized) {
+    sl_imu_configure(sample_rate);
+    return SL_STATUS_OK;
+  } else {
+    return SL_STATUS_NOT_INITIALIZED;
+  }
+}
+
+
 sl_status_t sensor_imu_get_avec(int16_t avec[3])
 {
   sl_status_t sc = SL_STATUS_NOT_READY;
@@ -0,0 +1,168 @@
+/*
+ * cs_ota.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ */
+
+#include "cs_ota.h"
+#include "cs_endian.h"
+#include "em_device.h"
+#include "btl_interface.h"
+
+// Application flash is memory mapped: the base image is read in place
+#ifndef FLASH_MEM
+#define FLASH_MEM(addr) ((const uint8_t *)(uintptr_t)(addr))
+#endif
+
+static cs_delta_t delta;
+static cs_delta_header_t header;
+static bool active = false;
+static uint32_t acked = 0;
+
+// The bootloader only installs signed images
+static bool signed_only = false;
+
+
+static void put_status(uint8_t *status, uint8_t code)
+{
+  status[0] = code;
+  cs_put_le32(&status[1], active ? delta.taken : 0);
+}
+
+
+// Pages of the slot are erased as the writes reach them
+static bool slot_write(uint32_t offset, const uint8_t *data, uint16_t len, void *ctx)
+{
+  (void)ctx;
+  return bootloader_eraseWriteStorage(OTA_SLOT, offset, (uint8_t *)data, len) == BOOTLOADER_OK;
+}
+
+
+void ota_init(void)
+{
+  BootloaderInformation_t info;
+
+  active = false;
+  bootloader_init();
+  bootloader_getInfo(&info);
+  signed_only = (info.capabilities & BOOTLOADER_CAPABILITY_ENFORCE_UPGRADE_SIGNATURE) != 0;
+}
+
+
+// Check the patch fits this collar: the base is the application in flash,
+// clear of the storage slot, and the new image fits the slot
+static uint8_t ota_begin(const uint8_t *data, uint16_t len)
+{
+  cs_delta_header_t h;
+  BootloaderStorageSlot_t slot;
+  uint32_t crc;
+
+  // anyone can write the patch: it is the signature that is trusted
+  if (!signed_only) {
+    return CS_DELTA_ERR_UNSIGNED;
+  }
+  if (!cs_delta_header_decode(data, len, &h)) {
+    return CS_DELTA_ERR_HEADER;
+  }
+
+  // the transfer in progress: resume at the offset reported. One that
+  // failed starts over.
+  if (active && (delta.status <= CS_DELTA_DONE) && (h.body_crc == header.body_crc)
+      && (h.body_len == header.body_len) && (h.new_crc == header.new_crc)) {
+    return delta.status;
+  }
+  active = false;
+
+  if ((bootloader_getStorageSlotInfo(OTA_SLOT, &slot) != BOOTLOADER_OK) || (h.new_len > slot.length)) {
+    return CS_DELTA_ERR_SIZE;
+  }
+  // below FLASH_BASE wraps round to past the end
+  if ((h.base_addr - FLASH_BASE > FLASH_SIZE) || (h.base_len > FLASH_SIZE - (h.base_addr - FLASH_BASE))
+      || ((h.base_addr < slot.address + slot.length) && (slot.address < h.base_addr + h.base_len))) {
+    return CS_DELTA_ERR_BASE;
+  }
+  crc = cs_delta_crc32(CS_DELTA_CRC32_INIT, FLASH_MEM(h.base_addr), h.base_len) ^ CS_DELTA_CRC32_INIT;
+  if (crc != h.base_crc) {
+    return CS_DELTA_ERR_BASE;
+  }
+
+  header = h;
+  cs_delta_init(&delta, &header, FLASH_MEM(h.base_addr), slot_write, NULL);
+  active = true;
+  acked = 0;
+  return CS_DELTA_OK;
+}
+
+
+// A command written to ota_ctrl. The status to notify, CS_DELTA_STATUS_LEN
+// bytes, is left in status; its code is returned.
+uint8_t ota_command(const uint8_t *data, uint16_t len, uint8_t *status)
+{
+  uint8_t code = CS_DELTA_ERR_STATE;
+
+  if (len >= 1) {
+    switch (data[0]) {
+      case CS_DELTA_CMD_BEGIN:
+        code = ota_begin(&data[1], len - 1);
+        break;
+
+      case CS_DELTA_CMD_INSTALL:
+        // the bootloader checks the GBL and its signature once more
+        if (!signed_only) {
+          code = CS_DELTA_ERR_UNSIGNED;
+        } else if (active && (delta.status == CS_DELTA_DONE)) {
+          code = (bootloader_verifyImage(OTA_SLOT, NULL) == BOOTLOADER_OK) ? CS_DELTA_DONE : CS_DELTA_ERR_CRC;
+        }
+        break;
+
+      case CS_DELTA_CMD_ABORT:
+        active = false;
+        code = CS_DELTA_OK;
+        break;
+    }
+  }
+  put_status(status, code);
+  return code;
+}
+
+
+// Body bytes written to ota_data: offset, then data. Returns true when the
+// status left in status should be notified: every CS_DELTA_ACK_BYTES, at
+// the end and on an error.
+bool ota_data(const uint8_t *data, uint16_t len, uint8_t *status)
+{
+  uint8_t code;
+
+  if (!active) {
+    put_status(status, CS_DELTA_ERR_STATE);
+    return true;
+  }
+  if ((len < CS_DELTA_DATA_HEADER_LEN) || (cs_get_le32(data) != delta.taken)) {
+    // lost or repeated: the host goes back to the offset reported
+    put_status(status, CS_DELTA_ERR_OFFSET);
+    return true;
+  }
+
+  code = cs_delta_feed(&delta, &data[CS_DELTA_DATA_HEADER_LEN], len - CS_DELTA_DATA_HEADER_LEN);
+  if ((code == CS_DELTA_OK) && (delta.taken >= header.body_len)) {
+    // body over, image not complete
+    code = CS_DELTA_ERR_CORRUPT;
+    delta.status = code;
+  }
+  put_status(status, code);
+  if ((code != CS_DELTA_OK) || (delta.taken - acked >= CS_DELTA_ACK_BYTES)) {
+    acked = delta.taken;
+    return true;
+  }
+  return false;
+}
+
+
+// Boot into the bootloader to copy the new image over the application.
+// Does not return.
+void ota_install(void)
+{
+  bootloader_setImageToBootload(OTA_SLOT);
+  bootloader_rebootAndInstall();
+}
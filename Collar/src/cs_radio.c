@@ -0,0 +1,102 @@
+/*
+ * cs_radio.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ */
+
+#include "cs_radio.h"
+#include "sl_bt_api.h"
+
+// Time on air of one advertising channel PDU with payload_len bytes of PDU
+// payload (2 byte PDU header and 3 byte CRC are added here).
+uint32_t radio_airtime_us(uint8_t phy, uint16_t payload_len)
+{
+  uint32_t bytes = 2 + payload_len + 3;
+
+  switch (phy) {
+    case sl_bt_gap_phy_2m:
+      // 2 byte preamble + 4 byte access address, 4 us per byte
+      return (2 + 4 + bytes) * 4;
+
+    case sl_bt_gap_phy_coded:
+      // S=8: preamble 80 us, access address 256 us, CI 16 us, TERM1 24 us,
+      // 64 us per byte, TERM2 24 us
+      return 80 + 256 + 16 + 24 + bytes * 64 + 24;
+
+    case sl_bt_gap_phy_1m:
+    default:
+      // 1 byte preamble + 4 byte access address, 8 us per byte
+      return (1 + 4 + bytes) * 8;
+  }
+}
+
+
+// Time on air of data_len bytes of periodic advertising data: an AUX_SYNC_IND
+// followed by AUX_CHAIN_INDs while the data does not fit. Returns the number
+// of PDUs in pdus.
+uint32_t radio_chain_airtime_us(uint8_t phy, uint16_t data_len, uint8_t *pdus)
+{
+  uint32_t airtime = 0;
+
+  *pdus = 0;
+  do {
+    uint16_t room = RADIO_ADV_PDU_MAX - RADIO_AUX_SYNC_EXT_HEADER;
+    uint16_t chunk;
+
+    if (data_len > room) {
+      room -= RADIO_AUX_PTR_LEN;
+    }
+    chunk = (data_len > room) ? room : data_len;
+
+    airtime += radio_airtime_us(phy, RADIO_AUX_SYNC_EXT_HEADER + ((data_len > chunk) ? RADIO_AUX_PTR_LEN : 0) + chunk);
+    data_len -= chunk;
+    (*pdus)++;
+  } while (data_len > 0);
+
+  return airtime;
+}
+
+
+// Estimated radio energy of one copy of data_len bytes of periodic data.
+uint32_t radio_pa_energy_nj(uint8_t phy, int16_t tx_power, uint16_t data_len)
+{
+  uint8_t pdus;
+  uint64_t fj = (uint64_t)radio_chain_airtime_us(phy, data_len, &pdus)
+                * cs_link_tx_current_ua(tx_power) * CS_LINK_SUPPLY_MV;
+
+  return (uint32_t)(fj / 1000000);
+}
+
+
+// Account the energy saved on one published window by sending it at link
+// level instead of the default level.
+void radio_link_account(radio_link_metrics_t *metrics, uint8_t level, uint16_t data_len, uint8_t redundancy)
+{
+  const cs_link_level_t *def = &cs_link_levels[CS_LINK_LEVEL_DEFAULT];
+  const cs_link_level_t *cur = &cs_link_levels[level];
+  uint32_t saved_nj;
+
+  saved_nj = (radio_pa_energy_nj(def->phy, def->tx_power, data_len)
+              - radio_pa_energy_nj(cur->phy, cur->tx_power, data_len)) * redundancy;
+
+  saved_nj += metrics->energy_rem_nj;
+  metrics->energy_saved_mj += saved_nj / 1000000;
+  metrics->energy_rem_nj = saved_nj % 1000000;
+}
+
+
+// Account one published window of data_len bytes sent redundancy times.
+void radio_pa_account(radio_pa_metrics_t *metrics, uint8_t phy, uint16_t data_len, uint8_t redundancy)
+{
+  uint32_t total_us;
+  uint8_t pdus;
+
+  metrics->window_airtime_us = radio_chain_airtime_us(phy, data_len, &pdus) * redundancy;
+  metrics->windows++;
+  metrics->pdus += (uint32_t)pdus * redundancy;
+
+  total_us = metrics->airtime_rem_us + metrics->window_airtime_us;
+  metrics->total_airtime_ms += total_us / 1000;
+  metrics->airtime_rem_us = (uint16_t)(total_us % 1000);
+}
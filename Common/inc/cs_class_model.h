@@ -0,0 +1,41 @@
+/*
+ * cs_class_model.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Default behaviour tree, thresholds in the units of cs_summary_t (mg,
+ *  crossings per window, degrees). These are hand set starting values;
+ *  a tree trained on labelled windows replaces this table unchanged as long
+ *  as it passes cs_classifier_check().
+ */
+
+#ifndef CS_CLASS_MODEL_H_
+#define CS_CLASS_MODEL_H_
+
+
+#include "cs_classifier.h"
+
+
+static const cs_tree_node_t cs_class_model[] = {
+  /* 0 */ CS_TREE_SPLIT(CS_FEAT_TILT, 30, 1, 2),
+  /* 1 */ CS_TREE_SPLIT(CS_FEAT_ODBA, 60, 3, 4),
+  /* 2 */ CS_TREE_LEAF(CS_CLASS_LYING, 220),
+  // little body motion: chewing shows as jaw-axis crossings
+  /* 3 */ CS_TREE_SPLIT(CS_FEAT_ZC_Y, 4, 5, 6),
+  /* 4 */ CS_TREE_SPLIT(CS_FEAT_ODBA, 150, 7, 8),
+  /* 5 */ CS_TREE_LEAF(CS_CLASS_RUMINATING, 120),
+  /* 6 */ CS_TREE_LEAF(CS_CLASS_RUMINATING, 210),
+  // moderate motion: head swings while grazing vs gait impacts on z
+  /* 7 */ CS_TREE_SPLIT(CS_FEAT_STD_Z, 120, 9, 10),
+  /* 8 */ CS_TREE_SPLIT(CS_FEAT_ZC_Z, 6, 11, 12),
+  /* 9 */ CS_TREE_LEAF(CS_CLASS_GRAZING, 200),
+  /* 10 */ CS_TREE_LEAF(CS_CLASS_WALKING, 130),
+  /* 11 */ CS_TREE_LEAF(CS_CLASS_GRAZING, 120),
+  /* 12 */ CS_TREE_LEAF(CS_CLASS_WALKING, 220),
+};
+
+#define CS_CLASS_MODEL_NODES  (sizeof(cs_class_model) / sizeof(cs_class_model[0]))
+
+
+#endif /* CS_CLASS_MODEL_H_ */
@@ -0,0 +1,79 @@
+/*
+ * cs_classifier.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Behaviour classifier: a quantized decision tree over the fixed point
+ *  features of one window (cs_features.h). Every test is one integer compare
+ *  and children always come after their parent, so inference takes at most
+ *  CS_TREE_MAX_DEPTH compares whatever the input.
+ */
+
+#ifndef CS_CLASSIFIER_H_
+#define CS_CLASSIFIER_H_
+
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "cs_features.h"
+
+
+// Behaviour classes
+#define CS_CLASS_GRAZING      0
+#define CS_CLASS_RUMINATING   1
+#define CS_CLASS_LYING        2
+#define CS_CLASS_WALKING      3
+#define CS_CLASS_COUNT        4
+
+// Features a node can test
+#define CS_FEAT_MEAN_X        0
+#define CS_FEAT_MEAN_Y        1
+#define CS_FEAT_MEAN_Z        2
+#define CS_FEAT_STD_X         3
+#define CS_FEAT_STD_Y         4
+#define CS_FEAT_STD_Z         5
+#define CS_FEAT_ODBA          6
+#define CS_FEAT_ZC_X          7
+#define CS_FEAT_ZC_Y          8
+#define CS_FEAT_ZC_Z          9
+#define CS_FEAT_TILT          10
+#define CS_FEAT_COUNT         11
+
+#define CS_FEAT_LEAF          0xFF
+
+#define CS_TREE_MAX_NODES     64
+#define CS_TREE_MAX_DEPTH     8
+
+
+// Split: go left when feature <= threshold. Leaf: left is the class,
+// right the confidence (0..255).
+typedef struct cs_tree_node{
+  uint8_t feature;
+  uint8_t left;
+  uint8_t right;
+  int16_t threshold;
+}cs_tree_node_t;
+
+#define CS_TREE_SPLIT(feature, threshold, left, right)  { (feature), (left), (right), (threshold) }
+#define CS_TREE_LEAF(class, confidence)                 { CS_FEAT_LEAF, (class), (confidence), 0 }
+
+// Classifier output for one window
+typedef struct cs_label{
+  uint8_t class;
+  uint8_t confidence;
+}cs_label_t;
+
+
+int16_t cs_classifier_feature(const cs_summary_t *s, uint8_t feature);
+
+bool cs_classifier_check(const cs_tree_node_t *tree, uint8_t n_nodes);
+
+cs_label_t cs_classifier_run(const cs_tree_node_t *tree, const cs_summary_t *s);
+
+cs_label_t cs_classifier_window(const int16_t samples[][3], uint8_t n);
+
+const char *cs_classifier_name(uint8_t class);
+
+
+#endif /* CS_CLASSIFIER_H_ */
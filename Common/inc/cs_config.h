@@ -0,0 +1,180 @@
+/*
+ * cs_config.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Runtime collar configuration written through the collar_config
+ *  characteristic. Both sides validate with cs_config_valid() so the host
+ *  rejects a bad setting before it reaches a collar.
+ *
+ *  Wire format (little endian, CS_CONFIG_LEN bytes):
+ *    [0]    version
+ *    [1..2] IMU sample period, ms
+ *    [3]    samples per window
+ *    [4..5] temperature / battery sampling period, s
+ *    [6..7] periodic advertising interval, ms (0: window period / redundancy)
+ *    [8]    periodic advertising redundancy
+ *    [9]    data mode, CS_MODE_* (v2, a v1 configuration is raw mode)
+ *    [10]   options, CS_OPT_* (v3, none before)
+ *
+ *  A configuration without options is encoded as v2, which collars that
+ *  predate them still take.
+ */
+
+#ifndef CS_CONFIG_H_
+#define CS_CONFIG_H_
+
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "cs_endian.h"
+#include "cs_payload.h"
+
+
+#define CS_CONFIG_VERSION         3
+#define CS_CONFIG_LEN             11
+#define CS_CONFIG_V2_LEN          10
+#define CS_CONFIG_V1_LEN          9
+
+#define CS_CONFIG_IMU_PERIOD_MIN  20
+#define CS_CONFIG_IMU_PERIOD_MAX  1000
+#define CS_CONFIG_ENV_PERIOD_MIN  5
+#define CS_CONFIG_ENV_PERIOD_MAX  3600
+#define CS_CONFIG_PA_INT_MIN      100
+#define CS_CONFIG_REDUNDANCY_MAX  8
+
+// Longest periodic advertising interval, well inside the host sync timeout
+#define CS_CONFIG_PA_INT_MAX      20000
+
+// Data modes
+#define CS_MODE_RAW               0   // every window is advertised
+#define CS_MODE_SUMMARY           1   // one CS_KIND_SUMMARY record per summary period
+#define CS_MODE_CLASS             2   // behaviour labels of each window, CS_KIND_CLASS
+
+#define CS_SUMMARY_PERIOD_MS      60000
+
+// Options
+#define CS_OPT_ORIENT             0x01  // orientation with every record, CS_FLAG_ORIENT
+#define CS_OPT_ALL                CS_OPT_ORIENT
+
+
+typedef struct cs_config{
+  uint16_t imu_period_ms;
+  uint8_t window_samples;
+  uint16_t env_period_s;
+  uint16_t pa_interval_ms;
+  uint8_t pa_redundancy;
+  uint8_t mode;
+  uint8_t options;
+}cs_config_t;
+
+
+// A window is published every window_samples samples plus the publishing tick
+static inline uint32_t cs_config_window_period_ms(const cs_config_t *c)
+{
+  return (uint32_t)(c->window_samples + 1) * c->imu_period_ms;
+}
+
+// Windows summed into one summary record: a summary period, shorter for
+// very short windows so the count fits cs_features_acc_t
+static inline uint8_t cs_config_summary_windows(const cs_config_t *c)
+{
+  uint32_t n = (CS_SUMMARY_PERIOD_MS + cs_config_window_period_ms(c) - 1) / cs_config_window_period_ms(c);
+
+  return (uint8_t)((n > UINT8_MAX) ? UINT8_MAX : n);
+}
+
+// Window labels batched into one class record: a summary period, if it fits
+static inline uint8_t cs_config_class_labels(const cs_config_t *c)
+{
+  uint8_t n = cs_config_summary_windows(c);
+
+  return (n > CS_CLASS_MAX_LABELS) ? CS_CLASS_MAX_LABELS : n;
+}
+
+// Time between two advertised records
+static inline uint32_t cs_config_publish_period_ms(const cs_config_t *c)
+{
+  switch (c->mode) {
+    case CS_MODE_SUMMARY:
+      return cs_config_summary_windows(c) * cs_config_window_period_ms(c);
+    case CS_MODE_CLASS:
+      return cs_config_class_labels(c) * cs_config_window_period_ms(c);
+    default:
+      return cs_config_window_period_ms(c);
+  }
+}
+
+// IMU output data rate: 1.5x the sampling rate so a fresh sample is ready
+static inline float cs_config_imu_rate_hz(const cs_config_t *c)
+{
+  return 1500.0f / c->imu_period_ms;
+}
+
+static inline bool cs_config_valid(const cs_config_t *c)
+{
+  if ((c->imu_period_ms < CS_CONFIG_IMU_PERIOD_MIN) || (c->imu_period_ms > CS_CONFIG_IMU_PERIOD_MAX)) {
+    return false;
+  }
+  if ((c->window_samples == 0) || (c->window_samples > CS_WINDOW_MAX_SAMPLES)) {
+    return false;
+  }
+  if ((c->env_period_s < CS_CONFIG_ENV_PERIOD_MIN) || (c->env_period_s > CS_CONFIG_ENV_PERIOD_MAX)) {
+    return false;
+  }
+  if ((c->pa_redundancy == 0) || (c->pa_redundancy > CS_CONFIG_REDUNDANCY_MAX)) {
+    return false;
+  }
+  if (c->mode > CS_MODE_CLASS) {
+    return false;
+  }
+  if (c->options & ~CS_OPT_ALL) {
+    return false;
+  }
+  // an explicit interval may not be slower than the data it carries
+  if ((c->pa_interval_ms != 0)
+      && ((c->pa_interval_ms < CS_CONFIG_PA_INT_MIN) || (c->pa_interval_ms > CS_CONFIG_PA_INT_MAX)
+          || (c->pa_interval_ms > cs_config_publish_period_ms(c)))) {
+    return false;
+  }
+  return true;
+}
+
+// Encode into buf (CS_CONFIG_LEN bytes), returns the length used
+static inline uint8_t cs_config_encode(const cs_config_t *c, uint8_t *buf)
+{
+  buf[0] = c->options ? CS_CONFIG_VERSION : 2;
+  cs_put_le16(&buf[1], c->imu_period_ms);
+  buf[3] = c->window_samples;
+  cs_put_le16(&buf[4], c->env_period_s);
+  cs_put_le16(&buf[6], c->pa_interval_ms);
+  buf[8] = c->pa_redundancy;
+  buf[9] = c->mode;
+  if (c->options) {
+    buf[10] = c->options;
+    return CS_CONFIG_LEN;
+  }
+  return CS_CONFIG_V2_LEN;
+}
+
+static inline bool cs_config_decode(const uint8_t *buf, uint16_t len, cs_config_t *c)
+{
+  if ((len < CS_CONFIG_V1_LEN) || (buf[0] == 0) || (buf[0] > CS_CONFIG_VERSION)) {
+    return false;
+  }
+  if (((buf[0] == 2) && (len < CS_CONFIG_V2_LEN)) || ((buf[0] >= 3) && (len < CS_CONFIG_LEN))) {
+    return false;
+  }
+  c->imu_period_ms = cs_get_le16(&buf[1]);
+  c->window_samples = buf[3];
+  c->env_period_s = cs_get_le16(&buf[4]);
+  c->pa_interval_ms = cs_get_le16(&buf[6]);
+  c->pa_redundancy = buf[8];
+  c->mode = (buf[0] >= 2) ? buf[9] : CS_MODE_RAW;
+  c->options = (buf[0] >= 3) ? buf[10] : 0;
+  return cs_config_valid(c);
+}
+
+
+#endif /* CS_CONFIG_H_ */
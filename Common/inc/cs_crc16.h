@@ -0,0 +1,23 @@
+/*
+ * cs_crc16.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ */
+
+#ifndef CS_CRC16_H_
+#define CS_CRC16_H_
+
+
+#include "stdint.h"
+#include "stddef.h"
+
+
+// CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF)
+#define CS_CRC16_INIT 0xFFFF
+
+
+uint16_t cs_crc16(uint16_t crc, const uint8_t *data, size_t len);
+
+
+#endif /* CS_CRC16_H_ */
@@ -0,0 +1,143 @@
+/*
+ * cs_delta.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Delta firmware patches: the new image is rebuilt from the image the
+ *  collar is running and a patch the host made from the two
+ *  (C_Host/delta_diff.h). The applier streams: the patch is fed in pieces
+ *  of any size as they arrive and the new image comes out in
+ *  CS_DELTA_BUF_LEN byte writes, so it needs no more RAM than cs_delta_t
+ *  whatever the image size. The base image is read in place (memory
+ *  mapped flash on the collar).
+ *
+ *  Patch header (little endian, CS_DELTA_HEADER_LEN bytes):
+ *    [0..3]   CS_DELTA_MAGIC
+ *    [4..7]   base image address (flash address on the collar)
+ *    [8..11]  base image length
+ *    [12..15] base image CRC-32
+ *    [16..19] new image length
+ *    [20..23] new image CRC-32
+ *    [24..27] body length
+ *    [28..31] body CRC-32, also the patch ID when a transfer is resumed
+ *
+ *  The body is a run of blocks until the new image is complete. Each block
+ *  (numbers are LEB128 varints, the seek zigzag coded) is
+ *    copy length, extra length, seek,
+ *    copy: base bytes plus differences, coded as pairs of a run of zero
+ *          differences and a run of literal differences,
+ *            zeros, literals, <literals bytes>, ...
+ *          until the copy length is covered,
+ *    extra: <extra length> new bytes,
+ *  after which the base position moves by the seek. Code that only moved
+ *  differs from its old copy in few bytes (the addresses), so the
+ *  differences are mostly zero runs.
+ *
+ *  Over the air (Bulk_service, Collar/src/cs_ota.c):
+ *    ota_ctrl write:  CS_DELTA_CMD_BEGIN + header, CS_DELTA_CMD_INSTALL
+ *                     or CS_DELTA_CMD_ABORT
+ *    ota_data write:  body offset (u32) + body bytes, in order
+ *    ota_ctrl notify: status (CS_DELTA_*), body bytes taken (u32)
+ *  A BEGIN with the patch ID of the transfer in progress resumes it at
+ *  the offset notified.
+ */
+
+#ifndef CS_DELTA_H_
+#define CS_DELTA_H_
+
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "stddef.h"
+
+
+#define CS_DELTA_MAGIC          0x31445343u   // "CSD1"
+#define CS_DELTA_HEADER_LEN     32
+
+// New image bytes buffered before a write; writes are at multiples of it
+#define CS_DELTA_BUF_LEN        256
+
+// The last write is padded with 0xFF to a multiple of this (flash words)
+#define CS_DELTA_WRITE_ALIGN    4
+
+// Applier and transfer status
+#define CS_DELTA_OK             0   // more patch wanted
+#define CS_DELTA_DONE           1   // new image complete, CRC good
+#define CS_DELTA_ERR_HEADER     2   // not a patch
+#define CS_DELTA_ERR_BASE       3   // base image is not the one running
+#define CS_DELTA_ERR_SIZE       4   // new image does not fit
+#define CS_DELTA_ERR_CORRUPT    5   // body reads outside the images or past its end
+#define CS_DELTA_ERR_CRC        6   // new image CRC wrong
+#define CS_DELTA_ERR_WRITE      7   // write failed
+#define CS_DELTA_ERR_OFFSET     8   // body data not at the offset taken so far
+#define CS_DELTA_ERR_STATE      9   // no transfer, or not complete
+#define CS_DELTA_ERR_UNSIGNED   10  // bootloader takes unsigned images: no updates
+
+// Over the air commands
+#define CS_DELTA_CMD_BEGIN      1
+#define CS_DELTA_CMD_INSTALL    2
+#define CS_DELTA_CMD_ABORT      3
+
+#define CS_DELTA_DATA_HEADER_LEN 4
+#define CS_DELTA_STATUS_LEN      5
+
+// The collar notifies progress each time this much more body is taken
+#define CS_DELTA_ACK_BYTES      2048
+
+// CRC-32 (IEEE 802.3, reflected poly 0xEDB88320)
+#define CS_DELTA_CRC32_INIT     0xFFFFFFFFu
+
+
+typedef struct cs_delta_header{
+  uint32_t base_addr;
+  uint32_t base_len;
+  uint32_t base_crc;
+  uint32_t new_len;
+  uint32_t new_crc;
+  uint32_t body_len;
+  uint32_t body_crc;
+}cs_delta_header_t;
+
+// Writes len bytes of the new image at offset. False stops the patch.
+typedef bool (*cs_delta_write_t)(uint32_t offset, const uint8_t *data, uint16_t len, void *ctx);
+
+typedef struct cs_delta{
+  const uint8_t *base;
+  uint32_t base_len;
+  uint32_t new_len;
+  uint32_t new_crc;
+  cs_delta_write_t write;
+  void *ctx;
+
+  uint32_t base_pos;
+  uint32_t out_pos;           // new image bytes produced
+  uint32_t crc;               // of them
+  uint32_t taken;             // body bytes taken
+  uint32_t copy_left;
+  uint32_t extra_left;
+  uint32_t run_left;
+  int32_t seek;
+  uint32_t var;               // varint being read
+  uint8_t var_shift;
+  uint8_t state;
+  uint8_t status;
+
+  uint16_t buf_len;
+  uint8_t buf[CS_DELTA_BUF_LEN];
+}cs_delta_t;
+
+
+uint32_t cs_delta_crc32(uint32_t crc, const uint8_t *data, size_t len);
+
+void cs_delta_header_encode(const cs_delta_header_t *h, uint8_t *buf);
+
+bool cs_delta_header_decode(const uint8_t *buf, uint16_t len, cs_delta_header_t *h);
+
+void cs_delta_init(cs_delta_t *d, const cs_delta_header_t *h, const uint8_t *base,
+                   cs_delta_write_t write, void *ctx);
+
+uint8_t cs_delta_feed(cs_delta_t *d, const uint8_t *data, uint32_t len);
+
+
+#endif /* CS_DELTA_H_ */
@@ -0,0 +1,42 @@
+/*
+ * cs_endian.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Little endian field access shared by the collar and the host.
+ */
+
+#ifndef CS_ENDIAN_H_
+#define CS_ENDIAN_H_
+
+
+#include "stdint.h"
+
+
+static inline void cs_put_le16(uint8_t *p, uint16_t v)
+{
+  p[0] = (uint8_t)(v);
+  p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void cs_put_le32(uint8_t *p, uint32_t v)
+{
+  p[0] = (uint8_t)(v);
+  p[1] = (uint8_t)(v >> 8);
+  p[2] = (uint8_t)(v >> 16);
+  p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t cs_get_le16(const uint8_t *p)
+{
+  return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t cs_get_le32(const uint8_t *p)
+{
+  return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+
+#endif /* CS_ENDIAN_H_ */
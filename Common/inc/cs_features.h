@@ -0,0 +1,67 @@
+/*
+ * cs_features.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Fixed point activity features over the acceleration stream (mg), shared
+ *  by the collar summary mode and the Linux tools. No floating point, no
+ *  division in the per-sample path.
+ */
+
+#ifndef CS_FEATURES_H_
+#define CS_FEATURES_H_
+
+
+#include "stdint.h"
+#include "stdbool.h"
+
+
+// Dynamic acceleration must leave +-deadband (mg) to count as a zero crossing
+#define CS_FEATURES_ZC_DEADBAND     20
+
+// Gravity tilt from the standing axis (z) above which the cow is lying, deg
+#define CS_FEATURES_LYING_TILT_DEG  30
+
+#define CS_POSTURE_STANDING         0
+#define CS_POSTURE_LYING            1
+
+
+// Running sums over the windows of one summary period
+typedef struct cs_features_acc{
+  uint8_t windows;
+  uint16_t samples;
+  int32_t sum[3];
+  int64_t sum_sq[3];
+  uint32_t odba_sum;          // sum over samples of |dynamic x|+|y|+|z|
+  uint16_t zc[3];
+}cs_features_acc_t;
+
+// Summary record carried by CS_KIND_SUMMARY payloads
+typedef struct cs_summary{
+  uint8_t windows;
+  uint16_t samples;
+  int16_t mean[3];            // static acceleration (gravity), mg
+  uint16_t std[3];            // standard deviation, mg
+  uint16_t odba;              // mean overall dynamic body acceleration, mg
+  uint16_t zc[3];             // zero crossings of the dynamic acceleration
+  uint8_t tilt_deg;           // gravity angle from the standing axis
+  uint8_t posture;            // CS_POSTURE_*
+}cs_summary_t;
+
+// Encoded size of cs_summary_t
+#define CS_SUMMARY_LEN  25
+
+
+void cs_features_reset(cs_features_acc_t *acc);
+
+void cs_features_add_window(cs_features_acc_t *acc, const int16_t samples[][3], uint8_t n);
+
+void cs_features_finish(const cs_features_acc_t *acc, cs_summary_t *out);
+
+uint32_t cs_isqrt(uint64_t v);
+
+uint8_t cs_atan2_deg(uint32_t y, uint32_t x);
+
+
+#endif /* CS_FEATURES_H_ */
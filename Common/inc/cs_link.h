@@ -0,0 +1,84 @@
+/*
+ * cs_link.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Link levels for the collar's periodic advertising: secondary PHY and TX
+ *  power, ordered from the most robust (and most expensive) to the cheapest.
+ *  The host picks a level from the RSSI it sees and sends its index over
+ *  PAwR (CS_PAWR_CMD_LINK); the collar looks the settings up here.
+ */
+
+#ifndef CS_LINK_H_
+#define CS_LINK_H_
+
+
+#include "stdint.h"
+
+
+// Same values as sl_bt_gap_phy_*
+#define CS_LINK_PHY_1M          1
+#define CS_LINK_PHY_2M          2
+#define CS_LINK_PHY_CODED       4
+
+// Gateway receiver sensitivity per PHY, dBm
+#define CS_LINK_SENS_1M         (-98)
+#define CS_LINK_SENS_2M         (-95)
+#define CS_LINK_SENS_CODED      (-106)
+
+// Level used at boot and whenever the collar loses the gateway
+#define CS_LINK_LEVEL_DEFAULT   0
+
+// Supply voltage of the energy estimate, mV
+#define CS_LINK_SUPPLY_MV       3000
+
+
+typedef struct cs_link_level{
+  uint8_t phy;
+  int16_t tx_power;         // 0.1 dBm
+}cs_link_level_t;
+
+// Relative energy per byte is airtime x TX current: coded S=8 takes 8x the
+// airtime of 1M, 2M half of it
+static const cs_link_level_t cs_link_levels[] = {
+  { CS_LINK_PHY_CODED, 60 },
+  { CS_LINK_PHY_CODED, 30 },
+  { CS_LINK_PHY_CODED, 0 },
+  { CS_LINK_PHY_1M,    60 },
+  { CS_LINK_PHY_1M,    30 },
+  { CS_LINK_PHY_2M,    60 },
+  { CS_LINK_PHY_1M,    0 },
+  { CS_LINK_PHY_2M,    30 },
+  { CS_LINK_PHY_2M,    0 },
+};
+
+#define CS_LINK_LEVELS  (sizeof(cs_link_levels) / sizeof(cs_link_levels[0]))
+
+
+static inline int8_t cs_link_sensitivity(uint8_t phy)
+{
+  switch (phy) {
+    case CS_LINK_PHY_2M:
+      return CS_LINK_SENS_2M;
+    case CS_LINK_PHY_CODED:
+      return CS_LINK_SENS_CODED;
+    default:
+      return CS_LINK_SENS_1M;
+  }
+}
+
+// EFR32BG22 radio current while transmitting at tx_power (0.1 dBm), uA
+static inline uint32_t cs_link_tx_current_ua(int16_t tx_power)
+{
+  if (tx_power > 30) {
+    return 8200;
+  }
+  if (tx_power > 0) {
+    return 5600;
+  }
+  return 4100;
+}
+
+
+#endif /* CS_LINK_H_ */
@@ -0,0 +1,46 @@
+/*
+ * cs_orient.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Quantized orientation carried with a record (CS_FLAG_ORIENT): the
+ *  fused IMU Euler angles, roll, pitch and yaw, in one signed byte each,
+ *  180 degrees per 128 steps (1.4 deg). Roll and yaw wrap round at
+ *  +-180 deg, pitch stays within +-90 deg (+-64).
+ *
+ *  The host reads tilt and posture from roll and pitch with two table
+ *  reads and a multiply instead of running the features over the samples.
+ */
+
+#ifndef CS_ORIENT_H_
+#define CS_ORIENT_H_
+
+
+#include "stdint.h"
+
+
+// Encoded size of cs_orient_t
+#define CS_ORIENT_LEN           3
+
+// Steps per 180 degrees
+#define CS_ORIENT_STEPS_180     128
+
+
+typedef struct cs_orient{
+  int8_t roll;
+  int8_t pitch;
+  int8_t yaw;
+}cs_orient_t;
+
+
+void cs_orient_quantize(const int16_t ovec[3], cs_orient_t *o);
+
+int16_t cs_orient_deg(int8_t q);
+
+uint8_t cs_orient_tilt_deg(const cs_orient_t *o);
+
+uint8_t cs_orient_posture(const cs_orient_t *o);
+
+
+#endif /* CS_ORIENT_H_ */
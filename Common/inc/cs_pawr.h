@@ -0,0 +1,75 @@
+/*
+ * cs_pawr.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Periodic Advertising with Responses (PAwR) control channel between the
+ *  gateway (PAwR advertiser) and the collars (PAwR synchronizers).
+ *
+ *  Every subevent carries the gateway time followed by commands for the
+ *  collars listening on it. Each collar answers in its own response slot.
+ *  Subevent and slot are derived from the cow ID, so no slot assignment
+ *  exchange is needed.
+ */
+
+#ifndef CS_PAWR_H_
+#define CS_PAWR_H_
+
+
+#include "stdint.h"
+
+
+// Gateway service UUID fb17c02e-f390-4110-a44d-0402ccfe3d5b (little-endian),
+// advertised in the extended advertising of the PAwR train
+#define CS_PAWR_GATEWAY_UUID { \
+  0x5b, 0x3d, 0xfe, 0xcc, 0x02, 0x04, 0x4d, 0xa4, \
+  0x10, 0x41, 0x90, 0xf3, 0x2e, 0xc0, 0x17, 0xfb  \
+}
+
+// Train timing: one event per collar window (3.1 s, units of 1.25 ms)
+#define CS_PAWR_INTERVAL            2480
+#define CS_PAWR_SUBEVENTS           32
+#define CS_PAWR_SUBEVENT_INTERVAL   12    // 15 ms (1.25 ms units)
+#define CS_PAWR_RESPONSE_SLOT_DELAY 2     // 2.5 ms (1.25 ms units)
+#define CS_PAWR_RESPONSE_SLOT_SPACING 5   // 0.625 ms (0.125 ms units)
+#define CS_PAWR_RESPONSE_SLOTS      16
+
+#define CS_PAWR_VERSION             1
+
+// Subevent data: version, gateway date/time (YY MM DD hh mm ss), commands
+#define CS_PAWR_CMD_HEADER_LEN      7
+
+// Command record: cow ID, type, length, value
+#define CS_PAWR_CMD_RECORD_LEN      3
+
+#define CS_PAWR_CMD_ACK             1   // u32: host has every window before this seq
+#define CS_PAWR_CMD_COW_ID          2   // u8: new cow ID
+#define CS_PAWR_CMD_PA_CONFIG       3   // u8: periodic advertising redundancy
+#define CS_PAWR_CMD_LINK            4   // u8: link level, index into cs_link_levels
+
+// Response: version, cow ID, battery, redundancy, first and next stored seq,
+// link level in use (absent from collars older than CS_PAWR_CMD_LINK)
+#define CS_PAWR_RSP_VERSION         0
+#define CS_PAWR_RSP_COW_ID          1
+#define CS_PAWR_RSP_BATTERY         2
+#define CS_PAWR_RSP_REDUNDANCY      3
+#define CS_PAWR_RSP_FIRST_SEQ       4
+#define CS_PAWR_RSP_NEXT_SEQ        8
+#define CS_PAWR_RSP_LINK            12
+#define CS_PAWR_RSP_MIN_LEN         12
+#define CS_PAWR_RSP_LEN             13
+
+
+static inline uint8_t cs_pawr_subevent(uint8_t cow_id)
+{
+  return cow_id % CS_PAWR_SUBEVENTS;
+}
+
+static inline uint8_t cs_pawr_slot(uint8_t cow_id)
+{
+  return (cow_id / CS_PAWR_SUBEVENTS) % CS_PAWR_RESPONSE_SLOTS;
+}
+
+
+#endif /* CS_PAWR_H_ */
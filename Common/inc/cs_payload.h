@@ -0,0 +1,148 @@
+/*
+ * cs_payload.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Periodic advertising / bulk transfer window payload, shared by the
+ *  collar (encoder) and the host (decoder).
+ *
+ *  The v1 header is described once in CS_PAYLOAD_V1_HEADER. The struct,
+ *  the encoder and the decoder are all generated from that list, so a field
+ *  can only be added in one place. Fields are little endian on the wire.
+ *
+ *  v1:  header | kind specific body | [orientation] | CRC-16 over all before
+ *       the orientation (cs_orient.h) only with CS_FLAG_ORIENT
+ *  v0:  30 x 3 int16 samples | cow_t (hour, min, sec, battery, temp, cow_id)
+ *       the unversioned format of the first collar firmware, 186 bytes;
+ *       a v1 payload of that length (28 raw samples and the orientation)
+ *       is told from it by its version byte and CRC
+ */
+
+#ifndef CS_PAYLOAD_H_
+#define CS_PAYLOAD_H_
+
+
+#include "stdint.h"
+#include "stdbool.h"
+#include "cs_endian.h"
+#include "cs_features.h"
+#include "cs_classifier.h"
+#include "cs_orient.h"
+
+
+#define CS_PAYLOAD_VERSION      1
+
+// X(type, name): wire order of the v1 header
+#define CS_PAYLOAD_V1_HEADER(X) \
+  X(uint8_t,  version)          \
+  X(uint8_t,  kind)             \
+  X(uint8_t,  flags)            \
+  X(uint8_t,  session)          \
+  X(uint16_t, seq)              \
+  X(uint16_t, cow_id)           \
+  X(uint8_t,  hour)             \
+  X(uint8_t,  min)              \
+  X(uint8_t,  sec)              \
+  X(uint8_t,  battery)          \
+  X(uint8_t,  temp)
+
+// Record kinds
+#define CS_KIND_RAW             0   // body: n x 3 int16 acceleration samples
+#define CS_KIND_SUMMARY         1   // body: cs_summary_t, CS_SUMMARY_LEN bytes
+#define CS_KIND_CLASS           2   // body: n x (class, confidence), one per window
+
+// Header flags
+#define CS_FLAG_RATE_SHIFT_MASK 0x03  // samples taken every imu_period_ms << shift
+#define CS_FLAG_ORIENT          0x04  // orientation at the end of the record follows the body
+
+// Largest window carried in one payload. Above about 40 samples the
+// periodic advertising data is chained over several PDUs.
+#define CS_WINDOW_MAX_SAMPLES   120
+
+// Most window labels carried in one CS_KIND_CLASS payload
+#define CS_CLASS_MAX_LABELS     60
+
+#define CS_PAYLOAD_CRC_LEN      2
+
+#define CS_PAYLOAD_V0_SAMPLES   30
+#define CS_PAYLOAD_V0_LEN       186
+
+// Decode results
+#define CS_PAYLOAD_OK           0
+#define CS_PAYLOAD_ERR_LEN      1
+#define CS_PAYLOAD_ERR_CRC      2
+#define CS_PAYLOAD_ERR_VERSION  3
+#define CS_PAYLOAD_ERR_KIND     4
+
+
+// Header size, summed from the schema
+#define CS_PAYLOAD_FIELD_SIZE(type, name) + sizeof(type)
+#define CS_PAYLOAD_HEADER_LEN   (0 CS_PAYLOAD_V1_HEADER(CS_PAYLOAD_FIELD_SIZE))
+
+#define CS_PAYLOAD_MAX_LEN      (CS_PAYLOAD_HEADER_LEN + CS_WINDOW_MAX_SAMPLES * 6 + CS_ORIENT_LEN + CS_PAYLOAD_CRC_LEN)
+
+
+// Decoded window: the header fields plus the kind specific body
+typedef struct cs_window{
+#define CS_PAYLOAD_FIELD_MEMBER(type, name) type name;
+  CS_PAYLOAD_V1_HEADER(CS_PAYLOAD_FIELD_MEMBER)
+#undef CS_PAYLOAD_FIELD_MEMBER
+  uint8_t n_samples;
+  int16_t samples[CS_WINDOW_MAX_SAMPLES][3];
+  cs_summary_t summary;
+  uint8_t n_labels;
+  cs_label_t labels[CS_CLASS_MAX_LABELS];
+  cs_orient_t orient;         // with CS_FLAG_ORIENT, zero without
+}cs_window_t;
+
+
+static inline uint8_t *cs_payload_put_uint8_t(uint8_t *p, uint8_t v)
+{
+  *p = v;
+  return p + 1;
+}
+
+static inline uint8_t *cs_payload_put_uint16_t(uint8_t *p, uint16_t v)
+{
+  cs_put_le16(p, v);
+  return p + 2;
+}
+
+static inline const uint8_t *cs_payload_get_uint8_t(const uint8_t *p, uint8_t *v)
+{
+  *v = *p;
+  return p + 1;
+}
+
+static inline const uint8_t *cs_payload_get_uint16_t(const uint8_t *p, uint16_t *v)
+{
+  *v = cs_get_le16(p);
+  return p + 2;
+}
+
+// Generated header encoder: fixed offsets once inlined
+static inline uint8_t *cs_payload_put_header(uint8_t *p, const cs_window_t *w)
+{
+#define CS_PAYLOAD_FIELD_PUT(type, name) p = cs_payload_put_##type(p, w->name);
+  CS_PAYLOAD_V1_HEADER(CS_PAYLOAD_FIELD_PUT)
+#undef CS_PAYLOAD_FIELD_PUT
+  return p;
+}
+
+// Generated header decoder
+static inline const uint8_t *cs_payload_get_header(const uint8_t *p, cs_window_t *w)
+{
+#define CS_PAYLOAD_FIELD_GET(type, name) p = cs_payload_get_##type(p, &w->name);
+  CS_PAYLOAD_V1_HEADER(CS_PAYLOAD_FIELD_GET)
+#undef CS_PAYLOAD_FIELD_GET
+  return p;
+}
+
+
+uint16_t cs_payload_encode(const cs_window_t *w, uint8_t *buf, uint16_t size);
+
+uint8_t cs_payload_decode(const uint8_t *buf, uint16_t len, cs_window_t *w);
+
+
+#endif /* CS_PAYLOAD_H_ */
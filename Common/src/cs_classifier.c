@@ -0,0 +1,124 @@
+/*
+ * cs_classifier.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ */
+
+#include "cs_classifier.h"
+#include "cs_class_model.h"
+
+
+int16_t cs_classifier_feature(const cs_summary_t *s, uint8_t feature)
+{
+  switch (feature) {
+    case CS_FEAT_MEAN_X:
+    case CS_FEAT_MEAN_Y:
+    case CS_FEAT_MEAN_Z:
+      return s->mean[feature - CS_FEAT_MEAN_X];
+
+    case CS_FEAT_STD_X:
+    case CS_FEAT_STD_Y:
+    case CS_FEAT_STD_Z:
+      return (int16_t)((s->std[feature - CS_FEAT_STD_X] > INT16_MAX) ? INT16_MAX : s->std[feature - CS_FEAT_STD_X]);
+
+    case CS_FEAT_ODBA:
+      return (int16_t)((s->odba > INT16_MAX) ? INT16_MAX : s->odba);
+
+    case CS_FEAT_ZC_X:
+    case CS_FEAT_ZC_Y:
+    case CS_FEAT_ZC_Z:
+      return (int16_t)s->zc[feature - CS_FEAT_ZC_X];
+
+    case CS_FEAT_TILT:
+      return s->tilt_deg;
+
+    default:
+      return 0;
+  }
+}
+
+
+// Check a tree before it is used: known features, children after their
+// parent and within the table, no path longer than CS_TREE_MAX_DEPTH.
+bool cs_classifier_check(const cs_tree_node_t *tree, uint8_t n_nodes)
+{
+  uint8_t depth[CS_TREE_MAX_NODES] = { 0 };
+
+  if ((n_nodes == 0) || (n_nodes > CS_TREE_MAX_NODES)) {
+    return false;
+  }
+
+  depth[0] = 1;
+  for (uint8_t i = 0; i < n_nodes; i++) {
+    const cs_tree_node_t *node = &tree[i];
+
+    if (node->feature == CS_FEAT_LEAF) {
+      if (node->left >= CS_CLASS_COUNT) {
+        return false;
+      }
+      continue;
+    }
+    if ((node->feature >= CS_FEAT_COUNT) || (depth[i] == 0) || (depth[i] >= CS_TREE_MAX_DEPTH)) {
+      return false;
+    }
+    if ((node->left <= i) || (node->right <= i) || (node->left >= n_nodes) || (node->right >= n_nodes)) {
+      return false;
+    }
+    depth[node->left] = depth[i] + 1;
+    depth[node->right] = depth[i] + 1;
+  }
+  return true;
+}
+
+
+// Walk the tree. The loop bound only matters for a tree that was never
+// checked; a checked tree reaches a leaf first.
+cs_label_t cs_classifier_run(const cs_tree_node_t *tree, const cs_summary_t *s)
+{
+  cs_label_t label = { CS_CLASS_COUNT, 0 };
+  uint8_t i = 0;
+
+  for (uint8_t step = 0; step < CS_TREE_MAX_DEPTH; step++) {
+    const cs_tree_node_t *node = &tree[i];
+
+    if (node->feature == CS_FEAT_LEAF) {
+      label.class = node->left;
+      label.confidence = node->right;
+      break;
+    }
+    i = (cs_classifier_feature(s, node->feature) <= node->threshold) ? node->left : node->right;
+  }
+  return label;
+}
+
+
+// Features of a single window run through the built in model.
+cs_label_t cs_classifier_window(const int16_t samples[][3], uint8_t n)
+{
+  cs_features_acc_t acc;
+  cs_summary_t s;
+
+  cs_features_reset(&acc);
+  cs_features_add_window(&acc, samples, n);
+  cs_features_finish(&acc, &s);
+
+  return cs_classifier_run(cs_class_model, &s);
+}
+
+
+const char *cs_classifier_name(uint8_t class)
+{
+  switch (class) {
+    case CS_CLASS_GRAZING:
+      return "grazing";
+    case CS_CLASS_RUMINATING:
+      return "ruminating";
+    case CS_CLASS_LYING:
+      return "lying";
+    case CS_CLASS_WALKING:
+      return "walking";
+    default:
+      return "unknown";
+  }
+}
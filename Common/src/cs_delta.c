@@ -0,0 +1,271 @@
+/*
+ * cs_delta.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ */
+
+#include "cs_delta.h"
+#include "cs_endian.h"
+#include "string.h"
+
+// Body parser states
+#define ST_COPY_LEN     0
+#define ST_EXTRA_LEN    1
+#define ST_SEEK         2
+#define ST_ZEROS        3
+#define ST_LITERALS_LEN 4
+#define ST_LITERALS     5
+#define ST_EXTRA        6
+#define ST_END          7
+
+// A nibble table is small enough for the collar and checks the base image
+// well inside a connection supervision timeout.
+static const uint32_t crc32_table[16] = {
+  0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+  0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+
+uint32_t cs_delta_crc32(uint32_t crc, const uint8_t *data, size_t len)
+{
+  while (len--) {
+    crc ^= *data++;
+    crc = (crc >> 4) ^ crc32_table[crc & 0x0F];
+    crc = (crc >> 4) ^ crc32_table[crc & 0x0F];
+  }
+  return crc;
+}
+
+
+void cs_delta_header_encode(const cs_delta_header_t *h, uint8_t *buf)
+{
+  cs_put_le32(&buf[0], CS_DELTA_MAGIC);
+  cs_put_le32(&buf[4], h->base_addr);
+  cs_put_le32(&buf[8], h->base_len);
+  cs_put_le32(&buf[12], h->base_crc);
+  cs_put_le32(&buf[16], h->new_len);
+  cs_put_le32(&buf[20], h->new_crc);
+  cs_put_le32(&buf[24], h->body_len);
+  cs_put_le32(&buf[28], h->body_crc);
+}
+
+
+bool cs_delta_header_decode(const uint8_t *buf, uint16_t len, cs_delta_header_t *h)
+{
+  if ((len < CS_DELTA_HEADER_LEN) || (cs_get_le32(&buf[0]) != CS_DELTA_MAGIC)) {
+    return false;
+  }
+  h->base_addr = cs_get_le32(&buf[4]);
+  h->base_len = cs_get_le32(&buf[8]);
+  h->base_crc = cs_get_le32(&buf[12]);
+  h->new_len = cs_get_le32(&buf[16]);
+  h->new_crc = cs_get_le32(&buf[20]);
+  h->body_len = cs_get_le32(&buf[24]);
+  h->body_crc = cs_get_le32(&buf[28]);
+  return h->new_len > 0;
+}
+
+
+void cs_delta_init(cs_delta_t *d, const cs_delta_header_t *h, const uint8_t *base,
+                   cs_delta_write_t write, void *ctx)
+{
+  memset(d, 0, sizeof(*d));
+  d->base = base;
+  d->base_len = h->base_len;
+  d->new_len = h->new_len;
+  d->new_crc = h->new_crc;
+  d->write = write;
+  d->ctx = ctx;
+  d->crc = CS_DELTA_CRC32_INIT;
+  d->state = ST_COPY_LEN;
+  d->status = CS_DELTA_OK;
+}
+
+
+// Write out the buffer; the last write of the image is padded to a flash word
+static bool flush(cs_delta_t *d)
+{
+  uint16_t len = d->buf_len;
+  uint32_t offset = d->out_pos - d->buf_len;
+
+  if (len == 0) {
+    return true;
+  }
+  d->crc = cs_delta_crc32(d->crc, d->buf, len);
+  while (len % CS_DELTA_WRITE_ALIGN) {
+    d->buf[len++] = 0xFF;
+  }
+  d->buf_len = 0;
+  return d->write(offset, d->buf, len, d->ctx);
+}
+
+
+static bool put(cs_delta_t *d, uint8_t byte)
+{
+  d->buf[d->buf_len++] = byte;
+  d->out_pos++;
+  return (d->buf_len < CS_DELTA_BUF_LEN) || flush(d);
+}
+
+
+// Copy n base bytes unchanged, the zero differences of a copy
+static bool put_base(cs_delta_t *d, uint32_t n)
+{
+  while (n > 0) {
+    uint32_t room = CS_DELTA_BUF_LEN - d->buf_len;
+    uint32_t chunk = (n < room) ? n : room;
+
+    memcpy(&d->buf[d->buf_len], &d->base[d->base_pos], chunk);
+    d->buf_len += (uint16_t)chunk;
+    d->out_pos += chunk;
+    d->base_pos += chunk;
+    n -= chunk;
+    if ((d->buf_len == CS_DELTA_BUF_LEN) && !flush(d)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+
+// Move on after the copy and extra bytes of a block are written
+static uint8_t block_end(cs_delta_t *d)
+{
+  int64_t pos = (int64_t)d->base_pos + d->seek;
+
+  if ((pos < 0) || (pos > (int64_t)d->base_len)) {
+    return CS_DELTA_ERR_CORRUPT;
+  }
+  d->base_pos = (uint32_t)pos;
+  if (d->out_pos < d->new_len) {
+    d->state = ST_COPY_LEN;
+    return CS_DELTA_OK;
+  }
+
+  d->state = ST_END;
+  if (!flush(d)) {
+    return CS_DELTA_ERR_WRITE;
+  }
+  return ((d->crc ^ CS_DELTA_CRC32_INIT) == d->new_crc) ? CS_DELTA_DONE : CS_DELTA_ERR_CRC;
+}
+
+
+// Next state once a copy run ends
+static uint8_t copy_next(cs_delta_t *d)
+{
+  if (d->copy_left > 0) {
+    d->state = ST_ZEROS;
+  } else if (d->extra_left > 0) {
+    d->state = ST_EXTRA;
+  } else {
+    return block_end(d);
+  }
+  return CS_DELTA_OK;
+}
+
+
+// A whole varint has been read in d->var
+static uint8_t number(cs_delta_t *d)
+{
+  uint32_t v = d->var;
+
+  switch (d->state) {
+    case ST_COPY_LEN:
+      d->copy_left = v;
+      d->state = ST_EXTRA_LEN;
+      break;
+
+    case ST_EXTRA_LEN:
+      d->extra_left = v;
+      if (((uint64_t)d->copy_left + v > d->new_len - d->out_pos)
+          || (d->copy_left > d->base_len - d->base_pos)) {
+        return CS_DELTA_ERR_CORRUPT;
+      }
+      d->state = ST_SEEK;
+      break;
+
+    case ST_SEEK:
+      d->seek = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+      return copy_next(d);
+
+    case ST_ZEROS:
+      if (v > d->copy_left) {
+        return CS_DELTA_ERR_CORRUPT;
+      }
+      d->copy_left -= v;
+      if (!put_base(d, v)) {
+        return CS_DELTA_ERR_WRITE;
+      }
+      if (d->copy_left == 0) {
+        return copy_next(d);
+      }
+      d->state = ST_LITERALS_LEN;
+      break;
+
+    case ST_LITERALS_LEN:
+      if ((v == 0) || (v > d->copy_left)) {
+        return CS_DELTA_ERR_CORRUPT;
+      }
+      d->run_left = v;
+      d->state = ST_LITERALS;
+      break;
+  }
+  return CS_DELTA_OK;
+}
+
+
+// Feed the next len body bytes. Returns CS_DELTA_OK while more are wanted,
+// CS_DELTA_DONE once the new image is written and its CRC checked, or an
+// error, which sticks.
+uint8_t cs_delta_feed(cs_delta_t *d, const uint8_t *data, uint32_t len)
+{
+  uint32_t i = 0;
+
+  while ((i < len) && (d->status == CS_DELTA_OK)) {
+    uint8_t byte = data[i++];
+
+    d->taken++;
+    switch (d->state) {
+      case ST_LITERALS:
+        if (!put(d, (uint8_t)(d->base[d->base_pos++] + byte))) {
+          d->status = CS_DELTA_ERR_WRITE;
+          break;
+        }
+        d->copy_left--;
+        if (--d->run_left == 0) {
+          d->status = copy_next(d);
+        }
+        break;
+
+      case ST_EXTRA:
+        if (!put(d, byte)) {
+          d->status = CS_DELTA_ERR_WRITE;
+          break;
+        }
+        if (--d->extra_left == 0) {
+          d->status = block_end(d);
+        }
+        break;
+
+      case ST_END:
+        d->status = CS_DELTA_ERR_CORRUPT;
+        break;
+
+      default:
+        if (d->var_shift > 28) {
+          d->status = CS_DELTA_ERR_CORRUPT;
+          break;
+        }
+        d->var |= (uint32_t)(byte & 0x7F) << d->var_shift;
+        d->var_shift += 7;
+        if ((byte & 0x80) == 0) {
+          d->status = number(d);
+          d->var = 0;
+          d->var_shift = 0;
+        }
+        break;
+    }
+  }
+  return d->status;
+}
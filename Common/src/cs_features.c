@@ -0,0 +1,166 @@
+/*
+ * cs_features.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ */
+
+#include "string.h"
+
+#include "cs_features.h"
+
+
+static inline uint32_t cs_abs32(int32_t v)
+{
+  return (v < 0) ? (uint32_t)(-v) : (uint32_t)v;
+}
+
+
+// Division rounded to nearest, halves away from zero
+static inline int32_t cs_div_round(int32_t num, uint16_t den)
+{
+  return (num < 0) ? -(int32_t)((cs_abs32(num) + den / 2) / den) : (int32_t)((cs_abs32(num) + den / 2) / den);
+}
+
+
+void cs_features_reset(cs_features_acc_t *acc)
+{
+  memset(acc, 0, sizeof(*acc));
+}
+
+
+// Add one window of samples. The static component used for ODBA and zero
+// crossings is the window mean, so the window is walked twice.
+void cs_features_add_window(cs_features_acc_t *acc, const int16_t samples[][3], uint8_t n)
+{
+  int32_t wsum[3] = { 0, 0, 0 };
+  int32_t wmean[3];
+
+  if (n == 0) {
+    return;
+  }
+
+  for (uint8_t i = 0; i < n; i++) {
+    for (uint8_t a = 0; a < 3; a++) {
+      int32_t v = samples[i][a];
+      wsum[a] += v;
+      acc->sum_sq[a] += (int64_t)(v * v);
+    }
+  }
+
+  for (uint8_t a = 0; a < 3; a++) {
+    acc->sum[a] += wsum[a];
+    wmean[a] = cs_div_round(wsum[a], n);
+  }
+
+  for (uint8_t a = 0; a < 3; a++) {
+    int8_t last = 0;
+
+    for (uint8_t i = 0; i < n; i++) {
+      int32_t dyn = samples[i][a] - wmean[a];
+
+      acc->odba_sum += cs_abs32(dyn);
+
+      // sign change with hysteresis so sensor noise does not count
+      if (dyn > CS_FEATURES_ZC_DEADBAND) {
+        if (last < 0) {
+          acc->zc[a]++;
+        }
+        last = 1;
+      } else if (dyn < -CS_FEATURES_ZC_DEADBAND) {
+        if (last > 0) {
+          acc->zc[a]++;
+        }
+        last = -1;
+      }
+    }
+  }
+
+  acc->samples += n;
+  acc->windows++;
+}
+
+
+void cs_features_finish(const cs_features_acc_t *acc, cs_summary_t *out)
+{
+  uint64_t gxy;
+  uint32_t gz;
+  uint32_t odba;
+
+  memset(out, 0, sizeof(*out));
+  out->windows = acc->windows;
+  out->samples = acc->samples;
+
+  if (acc->samples == 0) {
+    return;
+  }
+
+  for (uint8_t a = 0; a < 3; a++) {
+    int64_t n = acc->samples;
+    // n^2 var = n sum(x^2) - sum(x)^2, exact in 64 bits for a summary period
+    int64_t var_n2 = n * acc->sum_sq[a] - (int64_t)acc->sum[a] * acc->sum[a];
+    uint64_t std = (cs_isqrt((var_n2 > 0) ? (uint64_t)var_n2 * 4 : 0) + (uint64_t)n) / (uint64_t)(2 * n);
+
+    out->mean[a] = (int16_t)cs_div_round(acc->sum[a], acc->samples);
+    out->std[a] = (std > 0xFFFF) ? 0xFFFF : (uint16_t)std;
+  }
+
+  odba = (acc->odba_sum + acc->samples / 2) / acc->samples;
+  out->odba = (odba > 0xFFFF) ? 0xFFFF : (uint16_t)odba;
+  memcpy(out->zc, acc->zc, sizeof(out->zc));
+
+  // tilt of the gravity vector away from the z axis
+  gxy = (uint64_t)((int64_t)out->mean[0] * out->mean[0] + (int64_t)out->mean[1] * out->mean[1]);
+  gz = cs_abs32(out->mean[2]);
+  out->tilt_deg = cs_atan2_deg(cs_isqrt(gxy), gz);
+  if (out->mean[2] < 0) {
+    // upside down
+    out->tilt_deg = 180 - out->tilt_deg;
+  }
+  out->posture = (out->tilt_deg > CS_FEATURES_LYING_TILT_DEG) ? CS_POSTURE_LYING : CS_POSTURE_STANDING;
+}
+
+
+// Integer square root (floor), bit by bit.
+uint32_t cs_isqrt(uint64_t v)
+{
+  uint64_t res = 0;
+  uint64_t bit = (uint64_t)1 << 62;
+
+  while (bit > v) {
+    bit >>= 2;
+  }
+  while (bit != 0) {
+    if (v >= res + bit) {
+      v -= res + bit;
+      res = (res >> 1) + bit;
+    } else {
+      res >>= 1;
+    }
+    bit >>= 2;
+  }
+  return (uint32_t)res;
+}
+
+
+// atan2 for the first quadrant in whole degrees (0..90), within 1 deg.
+// atan(r) ~= 45 r - r (r - 1)(14.0 + 3.8 r) with r in Q15.
+uint8_t cs_atan2_deg(uint32_t y, uint32_t x)
+{
+  bool swap = (y > x);
+  int64_t r;
+  int64_t deg_q15;
+
+  if ((x == 0) && (y == 0)) {
+    return 0;
+  }
+  r = swap ? (((int64_t)x << 15) / y) : (((int64_t)y << 15) / x);
+
+  // all terms in Q15 degrees
+  deg_q15 = 45 * r - ((r * (r - 32768)) >> 15) * (14 * 32768 + ((38 * r) / 10)) / 32768;
+
+  if (swap) {
+    deg_q15 = 90 * 32768 - deg_q15;
+  }
+  return (uint8_t)((deg_q15 + 16384) >> 15);
+}
@@ -0,0 +1,104 @@
+/*
+ * cs_orient.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ */
+
+#include "cs_orient.h"
+#include "cs_features.h"
+
+
+// cos(i * 180 / 128 deg) in Q15, i = 0..128
+static const int16_t cos_q15[CS_ORIENT_STEPS_180 + 1] = {
+   32767,  32758,  32729,  32679,  32610,  32522,  32413,  32286,
+   32138,  31972,  31786,  31581,  31357,  31114,  30853,  30572,
+   30274,  29957,  29622,  29269,  28899,  28511,  28106,  27684,
+   27246,  26791,  26320,  25833,  25330,  24812,  24279,  23732,
+   23170,  22595,  22006,  21403,  20788,  20160,  19520,  18868,
+   18205,  17531,  16846,  16151,  15447,  14733,  14010,  13279,
+   12540,  11793,  11039,  10279,   9512,   8740,   7962,   7180,
+    6393,   5602,   4808,   4011,   3212,   2411,   1608,    804,
+       0,   -804,  -1608,  -2411,  -3212,  -4011,  -4808,  -5602,
+   -6393,  -7180,  -7962,  -8740,  -9512, -10279, -11039, -11793,
+  -12540, -13279, -14010, -14733, -15447, -16151, -16846, -17531,
+  -18205, -18868, -19520, -20160, -20788, -21403, -22006, -22595,
+  -23170, -23732, -24279, -24812, -25330, -25833, -26320, -26791,
+  -27246, -27684, -28106, -28511, -28899, -29269, -29622, -29957,
+  -30274, -30572, -30853, -31114, -31357, -31581, -31786, -31972,
+  -32138, -32286, -32413, -32522, -32610, -32679, -32729, -32758,
+  -32768,
+};
+
+// cos(CS_FEATURES_LYING_TILT_DEG) in Q15
+#define COS_LYING_Q15   28378
+
+
+// Angle in 0.01 deg (the IMU's unit) to steps, rounded; +180 deg wraps
+// round to -128
+static int8_t quantize(int16_t centideg)
+{
+  int32_t v = (int32_t)centideg * CS_ORIENT_STEPS_180;
+
+  v = (v + ((v >= 0) ? 9000 : -9000)) / 18000;
+  return (int8_t)(uint8_t)v;
+}
+
+void cs_orient_quantize(const int16_t ovec[3], cs_orient_t *o)
+{
+  o->roll = quantize(ovec[0]);
+  o->pitch = quantize(ovec[1]);
+  o->yaw = quantize(ovec[2]);
+}
+
+
+// Steps back to whole degrees
+int16_t cs_orient_deg(int8_t q)
+{
+  int16_t v = (int16_t)(q * 180);
+
+  return (int16_t)((v + ((v >= 0) ? CS_ORIENT_STEPS_180 / 2 : -CS_ORIENT_STEPS_180 / 2)) / CS_ORIENT_STEPS_180);
+}
+
+
+// cos of the angle between the collar's standing axis (z) and the vertical,
+// Q15: cos(roll) * cos(pitch)
+static int32_t cos_tilt(const cs_orient_t *o)
+{
+  uint8_t r = (uint8_t)((o->roll < 0) ? -o->roll : o->roll);
+  uint8_t p = (uint8_t)((o->pitch < 0) ? -o->pitch : o->pitch);
+
+  return ((int32_t)cos_q15[r] * cos_q15[p]) >> 15;
+}
+
+
+// Tilt of the standing axis, 0..180 deg, to the nearest step
+uint8_t cs_orient_tilt_deg(const cs_orient_t *o)
+{
+  int32_t c = cos_tilt(o);
+  uint8_t lo = 0;
+  uint8_t hi = CS_ORIENT_STEPS_180;
+
+  // first step whose cosine is not above c
+  while (lo < hi) {
+    uint8_t mid = (uint8_t)((lo + hi) / 2);
+
+    if (cos_q15[mid] > c) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  // or the step before, if nearer
+  if ((lo > 0) && (cos_q15[lo - 1] - c < c - cos_q15[lo])) {
+    lo--;
+  }
+  return (uint8_t)((lo * 180 + CS_ORIENT_STEPS_180 / 2) / CS_ORIENT_STEPS_180);
+}
+
+
+// CS_POSTURE_* as cs_features_finish() would find it from the gravity vector
+uint8_t cs_orient_posture(const cs_orient_t *o)
+{
+  return (cos_tilt(o) < COS_LYING_Q15) ? CS_POSTURE_LYING : CS_POSTURE_STANDING;
+}
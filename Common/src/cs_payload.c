@@ -0,0 +1,242 @@
+/*
+ * cs_payload.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ */
+
+#include "string.h"
+
+#include "cs_payload.h"
+#include "cs_crc16.h"
+
+
+// Summary body: windows, samples, mean[3], std[3], odba, zc[3], tilt, posture
+static uint8_t *cs_payload_put_summary(uint8_t *p, const cs_summary_t *s)
+{
+  p[0] = s->windows;
+  cs_put_le16(&p[1], s->samples);
+  for (uint8_t a = 0; a < 3; a++) {
+    cs_put_le16(&p[3 + a * 2], (uint16_t)s->mean[a]);
+    cs_put_le16(&p[9 + a * 2], s->std[a]);
+    cs_put_le16(&p[17 + a * 2], s->zc[a]);
+  }
+  cs_put_le16(&p[15], s->odba);
+  p[23] = s->tilt_deg;
+  p[24] = s->posture;
+  return p + CS_SUMMARY_LEN;
+}
+
+static void cs_payload_get_summary(const uint8_t *p, cs_summary_t *s)
+{
+  s->windows = p[0];
+  s->samples = cs_get_le16(&p[1]);
+  for (uint8_t a = 0; a < 3; a++) {
+    s->mean[a] = (int16_t)cs_get_le16(&p[3 + a * 2]);
+    s->std[a] = cs_get_le16(&p[9 + a * 2]);
+    s->zc[a] = cs_get_le16(&p[17 + a * 2]);
+  }
+  s->odba = cs_get_le16(&p[15]);
+  s->tilt_deg = p[23];
+  s->posture = p[24];
+}
+
+
+// Encode a window as a v1 payload. Returns the payload length, 0 if it does
+// not fit in size bytes.
+uint16_t cs_payload_encode(const cs_window_t *w, uint8_t *buf, uint16_t size)
+{
+  uint8_t *p = buf;
+  uint16_t len;
+  uint16_t crc;
+
+  switch (w->kind) {
+    case CS_KIND_RAW:
+      if (w->n_samples > CS_WINDOW_MAX_SAMPLES) {
+        return 0;
+      }
+      len = CS_PAYLOAD_HEADER_LEN + w->n_samples * 6 + CS_PAYLOAD_CRC_LEN;
+      break;
+
+    case CS_KIND_SUMMARY:
+      len = CS_PAYLOAD_HEADER_LEN + CS_SUMMARY_LEN + CS_PAYLOAD_CRC_LEN;
+      break;
+
+    case CS_KIND_CLASS:
+      if (w->n_labels > CS_CLASS_MAX_LABELS) {
+        return 0;
+      }
+      len = CS_PAYLOAD_HEADER_LEN + w->n_labels * 2 + CS_PAYLOAD_CRC_LEN;
+      break;
+
+    default:
+      return 0;
+  }
+  if (w->flags & CS_FLAG_ORIENT) {
+    len += CS_ORIENT_LEN;
+  }
+  if (len > size) {
+    return 0;
+  }
+
+  p = cs_payload_put_header(p, w);
+
+  if (w->kind == CS_KIND_RAW) {
+    for (uint8_t i = 0; i < w->n_samples; i++) {
+      cs_put_le16(p, (uint16_t)w->samples[i][0]);
+      cs_put_le16(p + 2, (uint16_t)w->samples[i][1]);
+      cs_put_le16(p + 4, (uint16_t)w->samples[i][2]);
+      p += 6;
+    }
+  } else if (w->kind == CS_KIND_SUMMARY) {
+    p = cs_payload_put_summary(p, &w->summary);
+  } else {
+    for (uint8_t i = 0; i < w->n_labels; i++) {
+      *p++ = w->labels[i].class;
+      *p++ = w->labels[i].confidence;
+    }
+  }
+  if (w->flags & CS_FLAG_ORIENT) {
+    *p++ = (uint8_t)w->orient.roll;
+    *p++ = (uint8_t)w->orient.pitch;
+    *p++ = (uint8_t)w->orient.yaw;
+  }
+
+  crc = cs_crc16(CS_CRC16_INIT, buf, (size_t)(p - buf));
+  cs_put_le16(p, crc);
+
+  return len;
+}
+
+
+static uint8_t cs_payload_decode_v0(const uint8_t *buf, uint16_t len, cs_window_t *w)
+{
+  const uint8_t *id = &buf[CS_PAYLOAD_V0_SAMPLES * 6];
+
+  if (len < CS_PAYLOAD_V0_LEN) {
+    return CS_PAYLOAD_ERR_LEN;
+  }
+
+  w->version = 0;
+  w->kind = CS_KIND_RAW;
+  w->flags = 0;
+  w->session = 0;
+  w->orient.roll = 0;
+  w->orient.pitch = 0;
+  w->orient.yaw = 0;
+  w->seq = 0;
+  w->hour = id[0];
+  w->min = id[1];
+  w->sec = id[2];
+  w->battery = id[3];
+  w->temp = id[4];
+  w->cow_id = id[5];
+
+  w->n_samples = CS_PAYLOAD_V0_SAMPLES;
+  for (uint8_t i = 0; i < CS_PAYLOAD_V0_SAMPLES; i++) {
+    w->samples[i][0] = (int16_t)cs_get_le16(&buf[i * 6]);
+    w->samples[i][1] = (int16_t)cs_get_le16(&buf[i * 6 + 2]);
+    w->samples[i][2] = (int16_t)cs_get_le16(&buf[i * 6 + 4]);
+  }
+  return CS_PAYLOAD_OK;
+}
+
+
+static uint8_t cs_payload_decode_v1(const uint8_t *buf, uint16_t len, cs_window_t *w)
+{
+  const uint8_t *p;
+  uint16_t body;
+
+  if (len < CS_PAYLOAD_HEADER_LEN + CS_PAYLOAD_CRC_LEN) {
+    return CS_PAYLOAD_ERR_LEN;
+  }
+  if (cs_crc16(CS_CRC16_INIT, buf, len - CS_PAYLOAD_CRC_LEN) != cs_get_le16(&buf[len - CS_PAYLOAD_CRC_LEN])) {
+    return CS_PAYLOAD_ERR_CRC;
+  }
+
+  p = cs_payload_get_header(buf, w);
+  body = len - CS_PAYLOAD_HEADER_LEN - CS_PAYLOAD_CRC_LEN;
+
+  w->orient.roll = 0;
+  w->orient.pitch = 0;
+  w->orient.yaw = 0;
+  if (w->flags & CS_FLAG_ORIENT) {
+    const uint8_t *o;
+
+    if (body < CS_ORIENT_LEN) {
+      return CS_PAYLOAD_ERR_LEN;
+    }
+    body -= CS_ORIENT_LEN;
+    o = &p[body];
+    w->orient.roll = (int8_t)o[0];
+    w->orient.pitch = (int8_t)o[1];
+    w->orient.yaw = (int8_t)o[2];
+  }
+
+  switch (w->kind) {
+    case CS_KIND_RAW:
+      if ((body % 6) || (body / 6 > CS_WINDOW_MAX_SAMPLES)) {
+        return CS_PAYLOAD_ERR_LEN;
+      }
+      w->n_samples = (uint8_t)(body / 6);
+      for (uint8_t i = 0; i < w->n_samples; i++) {
+        w->samples[i][0] = (int16_t)cs_get_le16(p);
+        w->samples[i][1] = (int16_t)cs_get_le16(p + 2);
+        w->samples[i][2] = (int16_t)cs_get_le16(p + 4);
+        p += 6;
+      }
+      return CS_PAYLOAD_OK;
+
+    case CS_KIND_SUMMARY:
+      if (body != CS_SUMMARY_LEN) {
+        return CS_PAYLOAD_ERR_LEN;
+      }
+      w->n_samples = 0;
+      cs_payload_get_summary(p, &w->summary);
+      return CS_PAYLOAD_OK;
+
+    case CS_KIND_CLASS:
+      if ((body % 2) || (body / 2 > CS_CLASS_MAX_LABELS)) {
+        return CS_PAYLOAD_ERR_LEN;
+      }
+      w->n_samples = 0;
+      w->n_labels = (uint8_t)(body / 2);
+      for (uint8_t i = 0; i < w->n_labels; i++) {
+        w->labels[i].class = p[0];
+        w->labels[i].confidence = p[1];
+        p += 2;
+      }
+      return CS_PAYLOAD_OK;
+
+    default:
+      return CS_PAYLOAD_ERR_KIND;
+  }
+}
+
+
+// Decode a payload from any collar firmware generation.
+uint8_t cs_payload_decode(const uint8_t *buf, uint16_t len, cs_window_t *w)
+{
+  uint8_t status;
+
+  if (len == 0) {
+    return CS_PAYLOAD_ERR_LEN;
+  }
+
+  // v0 has no version byte and is only told by its length, which v1
+  // payloads can have too (28 raw samples with CS_FLAG_ORIENT): a payload
+  // of that length is v1 if its version byte and CRC say so
+  switch (buf[0]) {
+    case 1:
+      status = cs_payload_decode_v1(buf, len, w);
+      break;
+
+    default:
+      status = CS_PAYLOAD_ERR_VERSION;
+      break;
+  }
+  if ((status != CS_PAYLOAD_OK) && (len == CS_PAYLOAD_V0_LEN)) {
+    return cs_payload_decode_v0(buf, len, w);
+  }
+  return status;
+}
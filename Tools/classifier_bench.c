@@ -0,0 +1,171 @@
+/*
+ * classifier_bench.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Runs the collar behaviour classifier (Common/src/cs_classifier.c) over a
+ *  host log on Linux. Each window is also classified by a double precision
+ *  reference of the same tree; the labels must match unless a feature sits
+ *  within the fixed point rounding of a threshold. Reports the cost per
+ *  window in CPU cycles (x86 TSC) or nanoseconds.
+ *
+ *  Build and run from the repository root:
+ *    gcc -O2 -ICommon/inc Tools/classifier_bench.c Tools/log_reader.c Common/src/cs_classifier.c \
+ *        Common/src/cs_features.c -lm -o classifier_bench
+ *    ./classifier_bench C_Host/ble_data_log.csv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "cs_classifier.h"
+#include "cs_class_model.h"
+#include "cs_payload.h"
+#include "log_reader.h"
+
+
+#define MAX_WINDOWS       100000
+#define BENCH_ROUNDS      2000
+
+// Largest fixed point error of a feature (rounding to whole units), so a
+// reference value this close to a threshold may go either way
+#define BOUNDARY          1.5
+
+
+static log_window_t windows[MAX_WINDOWS];
+
+
+// Double precision features of one window, indexed by CS_FEAT_*
+static void reference_features(const log_window_t *w, double f[CS_FEAT_COUNT])
+{
+  double mean[3] = { 0 }, var[3] = { 0 }, odba = 0;
+
+  for (int a = 0; a < 3; a++) {
+    int zc = 0, last = 0;
+
+    for (int i = 0; i < w->n; i++) {
+      mean[a] += w->samples[i][a];
+    }
+    mean[a] /= w->n;
+
+    for (int i = 0; i < w->n; i++) {
+      double dyn = w->samples[i][a] - mean[a];
+
+      var[a] += dyn * dyn;
+      odba += fabs(dyn);
+      if (dyn > CS_FEATURES_ZC_DEADBAND) {
+        zc += (last < 0);
+        last = 1;
+      } else if (dyn < -CS_FEATURES_ZC_DEADBAND) {
+        zc += (last > 0);
+        last = -1;
+      }
+    }
+    f[CS_FEAT_MEAN_X + a] = mean[a];
+    f[CS_FEAT_STD_X + a] = sqrt(var[a] / w->n);
+    f[CS_FEAT_ZC_X + a] = zc;
+  }
+  f[CS_FEAT_ODBA] = odba / w->n;
+  f[CS_FEAT_TILT] = atan2(hypot(mean[0], mean[1]), mean[2]) * 180.0 / M_PI;
+}
+
+
+// Same tree walk in double precision. near is set when a compare on the
+// path was within BOUNDARY of its threshold.
+static uint8_t reference_run(const double f[CS_FEAT_COUNT], int *near)
+{
+  uint8_t i = 0;
+
+  *near = 0;
+  while (cs_class_model[i].feature != CS_FEAT_LEAF) {
+    const cs_tree_node_t *node = &cs_class_model[i];
+    double v = f[node->feature];
+
+    if (fabs(v - node->threshold) <= BOUNDARY) {
+      *near = 1;
+    }
+    i = (v <= node->threshold) ? node->left : node->right;
+  }
+  return cs_class_model[i].left;
+}
+
+
+int main(int argc, char *argv[])
+{
+  int n_windows = 0;
+  int counts[CS_CLASS_COUNT + 1] = { 0 };
+  int boundary = 0;
+  int mismatches = 0;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <ble_data_log.csv>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  if (!cs_classifier_check(cs_class_model, CS_CLASS_MODEL_NODES)) {
+    fprintf(stderr, "model failed cs_classifier_check()\n");
+    return EXIT_FAILURE;
+  }
+
+  n_windows = log_read(argv[1], windows, MAX_WINDOWS);
+  if (n_windows == 0) {
+    return EXIT_FAILURE;
+  }
+
+  for (int k = 0; k < n_windows; k++) {
+    double features[CS_FEAT_COUNT];
+    cs_label_t label = cs_classifier_window(windows[k].samples, windows[k].n);
+    int near;
+    uint8_t ref;
+
+    reference_features(&windows[k], features);
+    ref = reference_run(features, &near);
+
+    counts[(label.class < CS_CLASS_COUNT) ? label.class : CS_CLASS_COUNT]++;
+    if (label.class != ref) {
+      if (near) {
+        boundary++;
+      } else {
+        mismatches++;
+        printf("window %d: %s, reference %s\n", k, cs_classifier_name(label.class), cs_classifier_name(ref));
+      }
+    }
+  }
+
+  printf("%d windows, %u nodes, depth <= %d\n", n_windows, (unsigned)CS_CLASS_MODEL_NODES, CS_TREE_MAX_DEPTH);
+  for (int c = 0; c <= CS_CLASS_COUNT; c++) {
+    if (counts[c]) {
+      printf("  %-10s %d\n", cs_classifier_name((uint8_t)c), counts[c]);
+    }
+  }
+
+  // inference cost: features plus tree walk
+  {
+    volatile uint8_t sink = 0;
+    double start = log_now_ns();
+#if defined(__x86_64__) || defined(__i386__)
+    unsigned long long cycles = __rdtsc();
+#endif
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+      for (int k = 0; k < n_windows; k++) {
+        sink ^= cs_classifier_window(windows[k].samples, windows[k].n).class;
+      }
+    }
+    (void)sink;
+
+#if defined(__x86_64__) || defined(__i386__)
+    printf("%.0f TSC cycles per window, ", (double)(__rdtsc() - cycles) / ((double)BENCH_ROUNDS * n_windows));
+#endif
+    printf("%.1f ns per window\n", (log_now_ns() - start) / ((double)BENCH_ROUNDS * n_windows));
+  }
+
+  printf("%d mismatches, %d boundary cases\n", mismatches, boundary);
+
+  return mismatches ? EXIT_FAILURE : EXIT_SUCCESS;
+}
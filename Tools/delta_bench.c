@@ -0,0 +1,212 @@
+/*
+ * delta_bench.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Runs the delta patch generator (C_Host/delta_diff.c) and the collar
+ *  patch applier (Common/src/cs_delta.c) over pairs of firmware images on
+ *  Linux. Each patch is applied in pieces of random size, as the ota_data
+ *  writes arrive, into a flash model that checks the writes land in order,
+ *  aligned and once; the result must be the new image byte for byte. Patch
+ *  size against the full image, diff time and apply time are reported.
+ *
+ *  Build and run from the repository root:
+ *    gcc -O2 -ICommon/inc -IC_Host Tools/delta_bench.c C_Host/delta_diff.c \
+ *        Common/src/cs_delta.c -o delta_bench
+ *    ./delta_bench old.bin new.gbl [old2.bin new2.gbl ...]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "cs_delta.h"
+#include "delta_diff.h"
+
+
+#define BENCH_ROUNDS      20
+
+// Largest ota_data write: 247 byte MTU less the ATT and offset headers
+#define BENCH_CHUNK_MAX   (244 - CS_DELTA_DATA_HEADER_LEN)
+
+// Base address of the application on the collar, for the header only
+#define BENCH_BASE_ADDR   0x00006000
+
+
+typedef struct flash_model{
+  uint8_t *data;
+  uint32_t size;
+  uint32_t next;              // next offset expected
+  uint32_t writes;
+  int bad;
+}flash_model_t;
+
+
+static double now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+
+static uint8_t *read_file(const char *path, uint32_t *len)
+{
+  FILE *f = fopen(path, "rb");
+  uint8_t *data;
+  long size;
+
+  if (!f) {
+    perror(path);
+    return NULL;
+  }
+  fseek(f, 0, SEEK_END);
+  size = ftell(f);
+  fseek(f, 0, SEEK_SET);
+  data = malloc(size ? size : 1);
+  if (!data || (fread(data, 1, size, f) != (size_t)size)) {
+    perror(path);
+    free(data);
+    fclose(f);
+    return NULL;
+  }
+  fclose(f);
+  *len = (uint32_t)size;
+  return data;
+}
+
+
+static bool flash_write(uint32_t offset, const uint8_t *data, uint16_t len, void *ctx)
+{
+  flash_model_t *flash = ctx;
+
+  if ((offset != flash->next) || (offset % CS_DELTA_WRITE_ALIGN) || (len % CS_DELTA_WRITE_ALIGN)
+      || (offset + len > flash->size)) {
+    flash->bad++;
+    return false;
+  }
+  memcpy(&flash->data[offset], data, len);
+  flash->next = offset + len;
+  flash->writes++;
+  return true;
+}
+
+
+// Feed the body in pieces of 1..BENCH_CHUNK_MAX bytes
+static uint8_t apply(const uint8_t *patch, const cs_delta_header_t *h, const uint8_t *base,
+                     flash_model_t *flash, unsigned *seed)
+{
+  static cs_delta_t d;
+  const uint8_t *body = &patch[CS_DELTA_HEADER_LEN];
+  uint32_t done = 0;
+  uint8_t status = CS_DELTA_OK;
+
+  flash->next = 0;
+  flash->writes = 0;
+  cs_delta_init(&d, h, base, flash_write, flash);
+  while ((done < h->body_len) && (status == CS_DELTA_OK)) {
+    uint32_t n = 1 + rand_r(seed) % BENCH_CHUNK_MAX;
+
+    if (n > h->body_len - done) {
+      n = h->body_len - done;
+    }
+    status = cs_delta_feed(&d, &body[done], n);
+    done += n;
+  }
+  return status;
+}
+
+
+int main(int argc, char *argv[])
+{
+  int failures = 0;
+  unsigned seed = 1;
+  uint64_t total_new = 0;
+  uint64_t total_patch = 0;
+
+  if ((argc < 3) || (argc % 2 == 0)) {
+    fprintf(stderr, "usage: %s <old image> <new image> [<old image> <new image> ...]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  printf("applier RAM %zu bytes, %d byte writes\n\n", sizeof(cs_delta_t), CS_DELTA_BUF_LEN);
+  printf("%-24s %8s %8s %8s %6s %9s %9s %9s\n", "new image", "old", "new", "patch", "%", "diff ms",
+         "apply ms", "MB/s");
+
+  for (int a = 1; a + 1 < argc; a += 2) {
+    uint32_t old_len;
+    uint32_t new_len;
+    uint8_t *old_image = read_file(argv[a], &old_len);
+    uint8_t *new_image = read_file(argv[a + 1], &new_len);
+    uint8_t *patch = NULL;
+    size_t patch_len;
+    cs_delta_header_t h;
+    flash_model_t flash;
+    double start;
+    double diff_ms;
+    double apply_ms;
+    int ok = 1;
+
+    if (!old_image || !new_image) {
+      return EXIT_FAILURE;
+    }
+
+    start = now_ns();
+    patch_len = delta_diff(old_image, old_len, BENCH_BASE_ADDR, new_image, new_len, &patch);
+    diff_ms = (now_ns() - start) / 1e6;
+    if ((patch_len == 0) || !delta_check(patch, patch_len, &h)) {
+      fprintf(stderr, "%s: no patch\n", argv[a + 1]);
+      return EXIT_FAILURE;
+    }
+
+    flash.size = new_len + CS_DELTA_WRITE_ALIGN;
+    flash.data = malloc(flash.size);
+    flash.bad = 0;
+
+    // correctness: every round splits the body differently
+    start = now_ns();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+      uint8_t status;
+
+      memset(flash.data, 0, flash.size);
+      status = apply(patch, &h, old_image, &flash, &seed);
+      if ((status != CS_DELTA_DONE) || flash.bad || (memcmp(flash.data, new_image, new_len) != 0)) {
+        printf("  round %d: status %u, %d bad writes%s\n", round, status, flash.bad,
+               (memcmp(flash.data, new_image, new_len) != 0) ? ", image differs" : "");
+        ok = 0;
+        break;
+      }
+    }
+    apply_ms = (now_ns() - start) / 1e6 / BENCH_ROUNDS;
+
+    // a patch for another base must be turned away by the collar's check
+    if (old_len > 0) {
+      old_image[old_len / 2] ^= 0x01;
+      if ((cs_delta_crc32(CS_DELTA_CRC32_INIT, old_image, old_len) ^ CS_DELTA_CRC32_INIT) == h.base_crc) {
+        printf("  base CRC misses a changed byte\n");
+        ok = 0;
+      }
+    }
+
+    printf("%-24s %8u %8u %8zu %6.1f %9.1f %9.2f %9.1f%s\n", argv[a + 1], old_len, new_len, patch_len,
+           100.0 * patch_len / new_len, diff_ms, apply_ms, new_len / apply_ms / 1e3,
+           ok ? "" : "  FAIL");
+    printf("  %u writes per apply\n", flash.writes);
+    total_new += new_len;
+    total_patch += patch_len;
+    failures += !ok;
+
+    free(flash.data);
+    free(patch);
+    free(old_image);
+    free(new_image);
+  }
+
+  printf("\n%llu image bytes sent as %llu patch bytes (%.1f%%), %d failures\n",
+         (unsigned long long)total_new, (unsigned long long)total_patch, 100.0 * total_patch / total_new,
+         failures);
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
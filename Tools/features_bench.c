@@ -0,0 +1,174 @@
+/*
+ * features_bench.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Runs the collar summary mode feature kernels (Common/src/cs_features.c)
+ *  over a host log on Linux. Every summary is checked against a double
+ *  precision reference and the kernel cost per window is timed.
+ *
+ *  Build and run from the repository root:
+ *    gcc -O2 -ICommon/inc Tools/features_bench.c Tools/log_reader.c Common/src/cs_features.c \
+ *        Common/src/cs_payload.c Common/src/cs_crc16.c -lm -o features_bench
+ *    ./features_bench C_Host/ble_data_log.csv [windows per summary]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#include "cs_features.h"
+#include "cs_payload.h"
+#include "log_reader.h"
+
+
+#define MAX_WINDOWS       100000
+#define BENCH_ROUNDS      2000
+
+// Windows per summary when not given: 60 s / 3.1 s
+#define DEFAULT_SUMMARY_WINDOWS  20
+
+// Allowed difference to the reference (mg, deg)
+#define TOL_MEAN          1.0
+#define TOL_STD           1.0
+#define TOL_ODBA          1.5   // window means are whole mg on 3 axes
+#define TOL_TILT          1.0
+
+
+static log_window_t windows[MAX_WINDOWS];
+
+
+// Double precision reference of one summary over windows [first, first + n)
+static void reference(int first, int n, double mean[3], double std[3], double *odba, double *tilt)
+{
+  double sum[3] = { 0 }, sum_sq[3] = { 0 }, odba_sum = 0;
+  int samples = 0;
+
+  for (int k = first; k < first + n; k++) {
+    double wmean[3] = { 0 };
+
+    for (int i = 0; i < windows[k].n; i++) {
+      for (int a = 0; a < 3; a++) {
+        wmean[a] += windows[k].samples[i][a];
+      }
+    }
+    for (int a = 0; a < 3; a++) {
+      wmean[a] /= windows[k].n;
+    }
+    for (int i = 0; i < windows[k].n; i++) {
+      for (int a = 0; a < 3; a++) {
+        double v = windows[k].samples[i][a];
+        sum[a] += v;
+        sum_sq[a] += v * v;
+        odba_sum += fabs(v - wmean[a]);
+      }
+    }
+    samples += windows[k].n;
+  }
+
+  for (int a = 0; a < 3; a++) {
+    mean[a] = sum[a] / samples;
+    std[a] = sqrt(fmax(sum_sq[a] / samples - mean[a] * mean[a], 0.0));
+  }
+  *odba = odba_sum / samples;
+  *tilt = atan2(hypot(mean[0], mean[1]), mean[2]) * 180.0 / M_PI;
+}
+
+
+int main(int argc, char *argv[])
+{
+  int n_windows = 0;
+  int per_summary = DEFAULT_SUMMARY_WINDOWS;
+  int summaries = 0;
+  int failures = 0;
+  unsigned long raw_bytes = 0;
+  unsigned long summary_bytes = 0;
+  cs_features_acc_t acc;
+  cs_summary_t summary;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <ble_data_log.csv> [windows per summary]\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+  if (argc > 2) {
+    per_summary = atoi(argv[2]);
+    if ((per_summary <= 0) || (per_summary > 255)) {
+      fprintf(stderr, "windows per summary must be 1..255\n");
+      return EXIT_FAILURE;
+    }
+  }
+
+  n_windows = log_read(argv[1], windows, MAX_WINDOWS);
+  if (n_windows == 0) {
+    return EXIT_FAILURE;
+  }
+  if (per_summary > n_windows) {
+    per_summary = n_windows;
+  }
+
+  printf("%d windows, %d windows per summary\n\n", n_windows, per_summary);
+  printf("  #  meanX  meanY  meanZ  stdX  stdY  stdZ  odba  zcX  zcY  zcZ  tilt  posture\n");
+
+  // correctness against the reference
+  for (int first = 0; first + per_summary <= n_windows; first += per_summary) {
+    double mean[3], std[3], odba, tilt;
+    int ok = 1;
+
+    cs_features_reset(&acc);
+    for (int k = first; k < first + per_summary; k++) {
+      cs_features_add_window(&acc, windows[k].samples, windows[k].n);
+      raw_bytes += CS_PAYLOAD_HEADER_LEN + windows[k].n * 6 + CS_PAYLOAD_CRC_LEN;
+    }
+    cs_features_finish(&acc, &summary);
+    summary_bytes += CS_PAYLOAD_HEADER_LEN + CS_SUMMARY_LEN + CS_PAYLOAD_CRC_LEN;
+
+    reference(first, per_summary, mean, std, &odba, &tilt);
+    for (int a = 0; a < 3; a++) {
+      ok &= fabs(summary.mean[a] - mean[a]) <= TOL_MEAN;
+      ok &= fabs(summary.std[a] - std[a]) <= TOL_STD;
+    }
+    ok &= fabs(summary.odba - odba) <= TOL_ODBA;
+    ok &= fabs(summary.tilt_deg - tilt) <= TOL_TILT;
+
+    printf("%3d %6d %6d %6d %5u %5u %5u %5u %4u %4u %4u %5u  %s%s\n", summaries,
+           summary.mean[0], summary.mean[1], summary.mean[2], summary.std[0], summary.std[1], summary.std[2],
+           summary.odba, summary.zc[0], summary.zc[1], summary.zc[2], summary.tilt_deg,
+           (summary.posture == CS_POSTURE_LYING) ? "lying" : "standing", ok ? "" : "  MISMATCH");
+    if (!ok) {
+      printf("    reference: mean %.1f %.1f %.1f std %.1f %.1f %.1f odba %.1f tilt %.1f\n",
+             mean[0], mean[1], mean[2], std[0], std[1], std[2], odba, tilt);
+      failures++;
+    }
+    summaries++;
+  }
+
+  // kernel cost: add every window, finish once per summary
+  {
+    double start = log_now_ns();
+    volatile uint16_t sink = 0;
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+      cs_features_reset(&acc);
+      for (int k = 0; k < n_windows; k++) {
+        cs_features_add_window(&acc, windows[k].samples, windows[k].n);
+        if (acc.windows == per_summary) {
+          cs_features_finish(&acc, &summary);
+          sink ^= summary.odba;
+          cs_features_reset(&acc);
+        }
+      }
+    }
+    (void)sink;
+
+    printf("\n%.1f ns per window (%d rounds)\n", (log_now_ns() - start) / ((double)BENCH_ROUNDS * n_windows), BENCH_ROUNDS);
+  }
+
+  if (summaries > 0) {
+    printf("payload bytes per summary period: raw %lu, summary %lu (%.1fx less)\n",
+           raw_bytes / summaries, summary_bytes / summaries, (double)raw_bytes / summary_bytes);
+  }
+  printf("%d summaries, %d mismatches\n", summaries, failures);
+
+  return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,82 @@
+/*
+ * log_reader.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Host log reader shared by the benches in Tools/.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "log_reader.h"
+
+
+// Parse one ble_data_log.csv row: 6 ID values, samples, Counter, RSSI.
+static int parse_row(char *line, log_window_t *w)
+{
+  long values[6 + CS_WINDOW_MAX_SAMPLES * 3 + 2];
+  int count = 0;
+  char *tok;
+
+  for (tok = strtok(line, ",\r\n"); tok && count < (int)(sizeof(values) / sizeof(values[0])); tok = strtok(NULL, ",\r\n")) {
+    char *end;
+    values[count] = strtol(tok, &end, 10);
+    if (end == tok) {
+      return -1;
+    }
+    count++;
+  }
+
+  // drop the ID columns and the trailing counter and RSSI
+  count -= 6 + 2;
+  if ((count <= 0) || (count % 3)) {
+    return -1;
+  }
+
+  w->n = (uint8_t)(count / 3);
+  for (int i = 0; i < w->n; i++) {
+    for (int a = 0; a < 3; a++) {
+      w->samples[i][a] = (int16_t)values[6 + i * 3 + a];
+    }
+  }
+  return 0;
+}
+
+
+int log_read(const char *path, log_window_t *windows, int max)
+{
+  static char line[LOG_LINE_MAX_LEN];
+  int n = 0;
+  FILE *f;
+
+  f = fopen(path, "r");
+  if (!f) {
+    perror(path);
+    return 0;
+  }
+  while (fgets(line, sizeof(line), f) && n < max) {
+    // the header row does not parse
+    if (parse_row(line, &windows[n]) == 0) {
+      n++;
+    }
+  }
+  fclose(f);
+
+  if (n == 0) {
+    fprintf(stderr, "no windows in %s\n", path);
+  }
+  return n;
+}
+
+
+double log_now_ns(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
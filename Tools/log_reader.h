@@ -0,0 +1,38 @@
+/*
+ * log_reader.h
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Reads the raw windows of a host log (C_Host/ble_data_log.csv) for the
+ *  benches in Tools/, and times them.
+ */
+
+#ifndef LOG_READER_H_
+#define LOG_READER_H_
+
+
+#include <stdint.h>
+
+#include "cs_payload.h"
+
+
+// Longest row of the log
+#define LOG_LINE_MAX_LEN  4096
+
+
+typedef struct log_window{
+  uint8_t n;
+  int16_t samples[CS_WINDOW_MAX_SAMPLES][3];
+}log_window_t;
+
+
+// Read up to max windows from the log at path. Returns the windows read,
+// 0 when the log cannot be opened or has none (the reason is printed).
+int log_read(const char *path, log_window_t *windows, int max);
+
+// Monotonic clock in nanoseconds
+double log_now_ns(void);
+
+
+#endif /* LOG_READER_H_ */
@@ -0,0 +1,231 @@
+/*
+ * orient_bench.c
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: sushantha
+ *
+ *  Checks the quantized orientation channel (Common/inc/cs_orient.h) over a
+ *  host log on Linux. The log has no gyro, so each window's orientation is
+ *  taken from its mean gravity, as the collar simulator does. Every window
+ *  goes through the payload with CS_FLAG_ORIENT and back; the tilt read
+ *  from the decoded orientation is checked against a double precision
+ *  reference and its posture against the window features. Every sample
+ *  count goes through the payload too, including the one whose payload is
+ *  as long as a v0 one. The host's cost per window is timed both ways:
+ *  features over the samples and the orientation lookup.
+ *
+ *  Build and run from the repository root:
+ *    gcc -O2 -ICommon/inc Tools/orient_bench.c Tools/log_reader.c Common/src/cs_orient.c \
+ *        Common/src/cs_features.c Common/src/cs_payload.c Common/src/cs_crc16.c -lm -o orient_bench
+ *    ./orient_bench C_Host/ble_data_log.csv
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "cs_orient.h"
+#include "cs_features.h"
+#include "cs_payload.h"
+#include "log_reader.h"
+
+
+#define MAX_WINDOWS       100000
+#define BENCH_ROUNDS      2000
+
+// Allowed difference to the reference tilt: half a step of roll and of
+// pitch, plus half a table step
+#define TOL_TILT_DEG      2.0
+
+// Windows within this of the lying threshold may fall either side
+#define POSTURE_MARGIN_DEG 2.0
+
+
+static log_window_t windows[MAX_WINDOWS];
+static cs_orient_t orients[MAX_WINDOWS];
+
+
+// Orientation of the window's mean gravity, 0.01 deg (yaw unknown: 0),
+// and the tilt of the standing axis in degrees
+static double reference(const log_window_t *w, int16_t ovec[3])
+{
+  double m[3] = { 0 };
+
+  for (int i = 0; i < w->n; i++) {
+    for (int a = 0; a < 3; a++) {
+      m[a] += w->samples[i][a];
+    }
+  }
+  ovec[0] = (int16_t)lround(atan2(m[1], m[2]) * 18000.0 / M_PI);
+  ovec[1] = (int16_t)lround(atan2(-m[0], hypot(m[1], m[2])) * 18000.0 / M_PI);
+  ovec[2] = 0;
+  return atan2(hypot(m[0], m[1]), m[2]) * 180.0 / M_PI;
+}
+
+
+int main(int argc, char *argv[])
+{
+  static cs_window_t window;
+  static cs_window_t decoded;
+  static uint8_t payload[CS_PAYLOAD_MAX_LEN];
+  int n_windows = 0;
+  int failures = 0;
+  int disagree = 0;
+  int lying = 0;
+  double max_err = 0;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s <ble_data_log.csv>\n", argv[0]);
+    return EXIT_FAILURE;
+  }
+
+  n_windows = log_read(argv[1], windows, MAX_WINDOWS);
+  if (n_windows == 0) {
+    return EXIT_FAILURE;
+  }
+
+  // correctness: through the payload and back, then tilt and posture
+  memset(&window, 0, sizeof(window));
+  window.version = CS_PAYLOAD_VERSION;
+  window.kind = CS_KIND_RAW;
+  window.flags = CS_FLAG_ORIENT;
+  for (int k = 0; k < n_windows; k++) {
+    int16_t ovec[3];
+    double tilt = reference(&windows[k], ovec);
+    cs_features_acc_t acc;
+    cs_summary_t summary;
+    uint16_t len;
+    double err;
+
+    cs_orient_quantize(ovec, &window.orient);
+    window.n_samples = windows[k].n;
+    memcpy(window.samples, windows[k].samples, windows[k].n * sizeof(windows[k].samples[0]));
+    len = cs_payload_encode(&window, payload, sizeof(payload));
+    if ((len == 0) || (cs_payload_decode(payload, len, &decoded) != CS_PAYLOAD_OK)
+        || (memcmp(&decoded.orient, &window.orient, sizeof(cs_orient_t)) != 0)
+        || (decoded.n_samples != window.n_samples)) {
+      printf("window %d: orientation lost in the payload\n", k);
+      failures++;
+      continue;
+    }
+    orients[k] = decoded.orient;
+
+    err = fabs(cs_orient_tilt_deg(&decoded.orient) - tilt);
+    if (err > max_err) {
+      max_err = err;
+    }
+    if (err > TOL_TILT_DEG) {
+      printf("window %d: tilt %u, reference %.1f\n", k, cs_orient_tilt_deg(&decoded.orient), tilt);
+      failures++;
+    }
+
+    cs_features_reset(&acc);
+    cs_features_add_window(&acc, windows[k].samples, windows[k].n);
+    cs_features_finish(&acc, &summary);
+    lying += (summary.posture == CS_POSTURE_LYING);
+    if ((cs_orient_posture(&decoded.orient) != summary.posture)
+        && (fabs(tilt - CS_FEATURES_LYING_TILT_DEG) > POSTURE_MARGIN_DEG)) {
+      disagree++;
+    }
+  }
+
+  // every sample count through the payload: with the orientation, 28
+  // samples make a v1 payload as long as a v0 one
+  for (uint8_t n = 0; n <= CS_WINDOW_MAX_SAMPLES; n++) {
+    uint16_t len;
+
+    window.n_samples = n;
+    for (uint8_t i = 0; i < n; i++) {
+      window.samples[i][0] = (int16_t)(i + 1);
+      window.samples[i][1] = (int16_t)-i;
+      window.samples[i][2] = 1000;
+    }
+    window.orient = orients[0];
+    len = cs_payload_encode(&window, payload, sizeof(payload));
+    if ((len == 0) || (cs_payload_decode(payload, len, &decoded) != CS_PAYLOAD_OK)
+        || (decoded.version != CS_PAYLOAD_VERSION) || (decoded.n_samples != n)
+        || (memcmp(decoded.samples, window.samples, n * sizeof(window.samples[0])) != 0)
+        || (memcmp(&decoded.orient, &window.orient, sizeof(cs_orient_t)) != 0)) {
+      printf("%u samples: %u byte payload %s\n", n, len,
+             (len == CS_PAYLOAD_V0_LEN) ? "taken for v0" : "does not decode");
+      failures++;
+    }
+  }
+
+  // and a v0 payload whose first sample starts with what reads as v1
+  memset(payload, 0, CS_PAYLOAD_V0_LEN);
+  payload[0] = 1;
+  payload[CS_PAYLOAD_V0_LEN - 1] = 7;
+  if ((cs_payload_decode(payload, CS_PAYLOAD_V0_LEN, &decoded) != CS_PAYLOAD_OK) || (decoded.version != 0)
+      || (decoded.cow_id != 7) || (decoded.samples[0][0] != 1)) {
+    printf("v0 payload not decoded as v0\n");
+    failures++;
+  }
+
+  printf("%d windows, %d lying, orientation adds %d bytes to a %d byte raw window\n", n_windows, lying,
+         CS_ORIENT_LEN, (int)(CS_PAYLOAD_HEADER_LEN + windows[0].n * 6 + CS_PAYLOAD_CRC_LEN));
+  printf("tilt error at most %.2f deg, posture differs from the features in %d windows\n", max_err, disagree);
+
+  // every roll and pitch a cow can take, a degree apart: a log may hold
+  // no lying at all
+  max_err = 0;
+  for (int roll = -180; roll <= 180; roll++) {
+    for (int pitch = -90; pitch <= 90; pitch++) {
+      int16_t ovec[3] = { (int16_t)(roll * 100), (int16_t)(pitch * 100), 0 };
+      double tilt = acos(cos(roll * M_PI / 180) * cos(pitch * M_PI / 180)) * 180 / M_PI;
+      uint8_t posture = (tilt > CS_FEATURES_LYING_TILT_DEG) ? CS_POSTURE_LYING : CS_POSTURE_STANDING;
+      cs_orient_t o;
+      double err;
+
+      cs_orient_quantize(ovec, &o);
+      err = fabs(cs_orient_tilt_deg(&o) - tilt);
+      if (err > max_err) {
+        max_err = err;
+      }
+      if ((err > TOL_TILT_DEG)
+          || ((cs_orient_posture(&o) != posture) && (fabs(tilt - CS_FEATURES_LYING_TILT_DEG) > POSTURE_MARGIN_DEG))) {
+        printf("roll %d pitch %d: tilt %u posture %u, reference %.1f\n", roll, pitch, cs_orient_tilt_deg(&o),
+               cs_orient_posture(&o), tilt);
+        failures++;
+      }
+    }
+  }
+  printf("roll and pitch grid: tilt error at most %.2f deg\n", max_err);
+
+  // host cost per window: features over the samples against the lookup
+  {
+    volatile uint32_t sink = 0;
+    double start = log_now_ns();
+    double features_ns;
+    double lookup_ns;
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+      for (int k = 0; k < n_windows; k++) {
+        cs_features_acc_t acc;
+        cs_summary_t summary;
+
+        cs_features_reset(&acc);
+        cs_features_add_window(&acc, windows[k].samples, windows[k].n);
+        cs_features_finish(&acc, &summary);
+        sink += summary.posture;
+      }
+    }
+    features_ns = (log_now_ns() - start) / ((double)BENCH_ROUNDS * n_windows);
+
+    start = log_now_ns();
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+      for (int k = 0; k < n_windows; k++) {
+        sink += cs_orient_posture(&orients[k]);
+      }
+    }
+    lookup_ns = (log_now_ns() - start) / ((double)BENCH_ROUNDS * n_windows);
+    (void)sink;
+
+    printf("posture per window: features %.1f ns, orientation lookup %.2f ns (%.0fx)\n", features_ns, lookup_ns,
+           features_ns / lookup_ns);
+  }
+
+  printf("%d failures\n", failures + disagree);
+  return (failures + disagree) ? EXIT_FAILURE : EXIT_SUCCESS;
+}